@@ -0,0 +1,82 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+struct AllocCounters {
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> bytes{0};
+};
+
+AllocCounters& allocCounters();
+
+struct Result {
+    double nsPerOp = 0.0;
+    double bytesPerOp = 0.0;
+    double allocsPerOp = 0.0;
+};
+
+inline void keep(size_t value) {
+    static volatile size_t sink = 0;
+    sink = sink ^ value;
+}
+
+template <typename Fn>
+Result measure(Fn&& fn) {
+    using Clock = std::chrono::steady_clock;
+    constexpr int REPETITIONS = 5;
+    constexpr auto TARGET = std::chrono::milliseconds(50);
+
+    for (int i = 0; i < 16; ++i) fn();
+
+    size_t iterations = 1;
+    while (iterations < (size_t{1} << 24)) {
+        auto start = Clock::now();
+        for (size_t i = 0; i < iterations; ++i) fn();
+        if (Clock::now() - start >= TARGET / 4) break;
+        iterations *= 2;
+    }
+    iterations *= 4;
+
+    auto& counters = allocCounters();
+    std::vector<double> samples;
+    uint64_t allocs = 0;
+    uint64_t bytes = 0;
+    for (int rep = 0; rep < REPETITIONS; ++rep) {
+        uint64_t count0 = counters.count.load(std::memory_order_relaxed);
+        uint64_t bytes0 = counters.bytes.load(std::memory_order_relaxed);
+        auto start = Clock::now();
+        for (size_t i = 0; i < iterations; ++i) fn();
+        auto elapsed = Clock::now() - start;
+        allocs += counters.count.load(std::memory_order_relaxed) - count0;
+        bytes += counters.bytes.load(std::memory_order_relaxed) - bytes0;
+        samples.push_back(std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>(iterations));
+    }
+
+    std::sort(samples.begin(), samples.end());
+    double ops = static_cast<double>(iterations) * REPETITIONS;
+    Result result;
+    result.nsPerOp = samples[samples.size() / 2];
+    result.bytesPerOp = static_cast<double>(bytes) / ops;
+    result.allocsPerOp = static_cast<double>(allocs) / ops;
+    return result;
+}
+
+void printHeader(const std::string& title);
+void report(const std::string& name, const Result& result);
+
+void runProtocolBench();
+void runHelpersBench();
+void runCompressionBench();
+void runRelayBench();
+void runTransportBench();
+void runTcpServerBench();
+
+} // namespace bench
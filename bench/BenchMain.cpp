@@ -0,0 +1,92 @@
+#include "Bench.h"
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <new>
+
+namespace bench {
+
+AllocCounters& allocCounters() {
+    static AllocCounters counters;
+    return counters;
+}
+
+void printHeader(const std::string& title) {
+    std::cout << std::endl << "=== " << title << " ===" << std::endl;
+    std::cout << std::left << std::setw(34) << "benchmark"
+              << std::right << std::setw(12) << "ns/op"
+              << std::setw(12) << "B/op"
+              << std::setw(12) << "allocs/op" << std::endl;
+}
+
+void report(const std::string& name, const Result& result) {
+    std::cout << std::left << std::setw(34) << name
+              << std::right << std::fixed
+              << std::setw(12) << std::setprecision(1) << result.nsPerOp
+              << std::setw(12) << std::setprecision(1) << result.bytesPerOp
+              << std::setw(12) << std::setprecision(2) << result.allocsPerOp << std::endl;
+}
+
+}
+
+void* operator new(std::size_t size) {
+    auto& counters = bench::allocCounters();
+    counters.count.fetch_add(1, std::memory_order_relaxed);
+    counters.bytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+int main(int argc, char* argv[]) {
+    struct Group {
+        const char* name;
+        std::function<void()> run;
+    };
+    const Group groups[] = {
+        {"protocol", bench::runProtocolBench},
+        {"helpers", bench::runHelpersBench},
+        {"compression", bench::runCompressionBench},
+        {"relay", bench::runRelayBench},
+        {"transport", bench::runTransportBench},
+        {"tcp", bench::runTcpServerBench},
+    };
+
+    std::string filter = argc > 1 ? argv[1] : "";
+    bool ran = false;
+    for (const auto& group : groups) {
+        if (filter.empty() || filter == group.name) {
+            group.run();
+            ran = true;
+        }
+    }
+
+    if (!ran) {
+        std::cerr << "Usage: " << argv[0] << " [protocol|helpers|compression|relay|transport|tcp]" << std::endl;
+        return 1;
+    }
+    std::cout << std::endl << "B/op and allocs/op count heap allocations made by the operation." << std::endl;
+    return 0;
+}
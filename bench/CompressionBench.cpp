@@ -0,0 +1,123 @@
+#include "Bench.h"
+#include "core/protocol/Compression.h"
+#include "core/protocol/MessageTypes.h"
+#include "core/protocol/MessageView.h"
+#include "utils/Base64.h"
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace echo;
+
+namespace {
+
+struct Sample {
+    std::string name;
+    std::vector<uint8_t> payload;
+};
+
+std::vector<uint8_t> textPayload(const std::string& content, bool isGlobal) {
+    TextMessage msg;
+    msg.senderUsername = "SwiftFox";
+    msg.senderFingerprint = "3f9a1c0b7e2d4a5f8c6b1e0d9a7f3c2b";
+    msg.recipientUsername = isGlobal ? "" : "QuietOwl";
+    msg.content = content;
+    msg.timestamp = std::chrono::system_clock::now();
+    msg.isGlobal = isGlobal;
+    return msg.serialize();
+}
+
+std::vector<Sample> buildSamples() {
+    std::vector<Sample> samples;
+
+    samples.push_back({"chat short", textPayload("ok, see you at the lab in 5", true)});
+    samples.push_back({"chat line", textPayload(
+        "Has anyone seen the projector remote? It was on the desk next to the window this "
+        "morning and now it is gone. We need it for the 2pm standup in room B.", true)});
+
+    std::string paragraph;
+    const char* sentences[] = {
+        "The build on the relay box finished without errors. ",
+        "I pushed the new config to the shared folder. ",
+        "Please check that your node shows up in the device list before the meeting. ",
+        "If it does not, restart the advertiser and run scan again. "
+    };
+    for (int i = 0; i < 8; ++i) paragraph += sentences[i % 4];
+    samples.push_back({"chat paragraph", textPayload(paragraph, false)});
+
+    std::string source;
+    for (int i = 0; i < 200; ++i) {
+        source += "    if (device.isEchoDevice && device.rssi > -80) { connect(device.address); }\n";
+    }
+    std::vector<uint8_t> textFile(source.begin(), source.end());
+    textFile.resize(12000);
+    samples.push_back({"file text/b64", textPayload("::FILE::0011223344556677::notes.cpp::12000::" + base64Encode(textFile), true)});
+
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> dist(0, 255);
+    std::vector<uint8_t> binFile(12000);
+    for (auto& b : binFile) b = static_cast<uint8_t>(dist(gen));
+    samples.push_back({"file random/b64", textPayload("::FILE::8899aabbccddeeff::photo.jpg::12000::" + base64Encode(binFile), true)});
+
+    return samples;
+}
+
+}
+
+namespace bench {
+
+void runCompressionBench() {
+    if (!PayloadCompressor::isAvailable()) {
+        std::cout << std::endl << "LZ4 support not built in; payloads are sent uncompressed" << std::endl;
+        return;
+    }
+
+    std::cout << std::endl << "=== LZ4 payload compression ===" << std::endl;
+    std::cout << std::left << std::setw(18) << "payload"
+              << std::right << std::setw(10) << "raw B"
+              << std::setw(10) << "wire B"
+              << std::setw(9) << "saved"
+              << std::setw(14) << "compress ns"
+              << std::setw(14) << "expand ns" << std::endl;
+
+    for (const auto& sample : buildSamples()) {
+        std::vector<uint8_t> compressed;
+        bool used = PayloadCompressor::compress(sample.payload, compressed);
+
+        Message msg;
+        msg.header.type = MessageType::GLOBAL_MESSAGE;
+        msg.header.messageId = 1;
+        msg.header.timestamp = 0;
+        msg.payload = sample.payload;
+        MessageFactory::compressPayload(msg);
+        auto frame = msg.serialize();
+        size_t rawFrame = MessageHeader::SIZE + sample.payload.size();
+
+        double compressNs = measure([&]() {
+            std::vector<uint8_t> out;
+            keep(PayloadCompressor::compress(sample.payload, out));
+        }).nsPerOp;
+
+        double expandNs = 0.0;
+        if (used) {
+            auto view = MessageView::parse(frame);
+            std::vector<uint8_t> storage;
+            expandNs = measure([&]() { keep(view.decodedPayload(storage).size); }).nsPerOp;
+        }
+
+        double saved = 100.0 * (1.0 - static_cast<double>(frame.size()) / static_cast<double>(rawFrame));
+        std::cout << std::left << std::setw(18) << sample.name
+                  << std::right << std::setw(10) << rawFrame
+                  << std::setw(10) << frame.size()
+                  << std::setw(8) << std::fixed << std::setprecision(1) << saved << "%"
+                  << std::setw(14) << std::setprecision(0) << compressNs
+                  << std::setw(14) << (used ? std::to_string(static_cast<long>(expandNs)) : std::string("-"))
+                  << std::endl;
+    }
+}
+
+} // namespace bench
@@ -0,0 +1,51 @@
+#include "Bench.h"
+#include "core/network/WifiBeacon.h"
+#include "utils/Base64.h"
+#include "utils/Crc32.h"
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace echo;
+
+namespace bench {
+
+void runHelpersBench() {
+    printHeader("Base64");
+
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> dist(0, 255);
+    std::vector<uint8_t> file(12000);
+    for (auto& b : file) b = static_cast<uint8_t>(dist(gen));
+    std::string encoded = base64Encode(file);
+
+    report("base64Encode 12 KB", measure([&]() { keep(base64Encode(file).size()); }));
+    report("base64Decode 12 KB", measure([&]() { keep(base64Decode(encoded).size()); }));
+
+    printHeader("CRC32");
+
+    std::vector<uint8_t> chunk(file.begin(), file.begin() + 8192);
+    report("crc32 8 KB chunk", measure([&]() { keep(crc32(chunk.data(), chunk.size())); }));
+
+    printHeader("WiFi beacon");
+
+    WifiBeacon beacon;
+    beacon.username = "SwiftFox";
+    beacon.fingerprint = "3f9a1c0b7e2d4a5f8c6b1e0d9a7f3c2b";
+    beacon.port = 48271;
+    std::vector<uint8_t> packet = beacon.serialize();
+
+    report("WifiBeacon::serialize", measure([&]() { keep(beacon.serialize().size()); }));
+    report("WifiBeacon::parse", measure([&]() {
+        WifiBeacon parsed;
+        keep(WifiBeacon::parse(packet.data(), packet.size(), parsed));
+    }));
+
+    std::vector<uint8_t> truncated(packet.begin(), packet.begin() + 6);
+    report("WifiBeacon::parse (truncated)", measure([&]() {
+        WifiBeacon parsed;
+        keep(WifiBeacon::parse(truncated.data(), truncated.size(), parsed));
+    }));
+}
+
+} // namespace bench
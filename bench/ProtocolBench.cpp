@@ -0,0 +1,75 @@
+#include "Bench.h"
+#include "core/protocol/DuplicateFilter.h"
+#include "core/protocol/MessageId.h"
+#include "core/protocol/MessageTypes.h"
+#include "core/protocol/MessageView.h"
+#include <string>
+#include <vector>
+
+using namespace echo;
+
+namespace bench {
+
+void runProtocolBench() {
+    const std::string content =
+        "Has anyone seen the projector remote? It was on the desk next to the window this morning.";
+
+    printHeader("Message framing");
+
+    Message text = MessageFactory::createTextMessage(content, "SwiftFox", "3f9a1c0b7e2d4a5f8c6b1e0d9a7f3c2b", "", true);
+    std::vector<uint8_t> frame = text.serialize();
+    report("Message::serialize", measure([&]() { keep(text.serialize().size()); }));
+    report("Message::deserialize", measure([&]() { keep(Message::deserialize(frame).payload.size()); }));
+    report("MessageView::parse", measure([&]() { keep(MessageView::parse(frame).length()); }));
+
+    Message compact = MessageFactory::createCompactTextMessage(content, 0x5eed1234, "", true);
+    std::vector<uint8_t> compactFrame = compact.serialize();
+    report("Message::serialize (v2)", measure([&]() { keep(compact.serialize().size()); }));
+    report("Message::deserialize (v2)", measure([&]() { keep(Message::deserialize(compactFrame).payload.size()); }));
+
+    printHeader("Payload round-trips");
+
+    TextMessage textMsg;
+    textMsg.senderUsername = "SwiftFox";
+    textMsg.senderFingerprint = "3f9a1c0b7e2d4a5f8c6b1e0d9a7f3c2b";
+    textMsg.recipientUsername = "QuietOwl";
+    textMsg.content = content;
+    textMsg.timestamp = std::chrono::system_clock::now();
+    std::vector<uint8_t> textPayload = textMsg.serialize();
+    report("TextMessage::serialize", measure([&]() { keep(textMsg.serialize().size()); }));
+    report("TextMessage::deserialize", measure([&]() { keep(TextMessage::deserialize(textPayload).content.size()); }));
+    report("TextMessage round-trip", measure([&]() {
+        keep(TextMessage::deserialize(textMsg.serialize()).content.size());
+    }));
+    report("TextMessageView::parse", measure([&]() { keep(TextMessageView::parse(textPayload).content().size()); }));
+
+    AnnounceMessage announce;
+    announce.username = "SwiftFox";
+    announce.fingerprint = "3f9a1c0b7e2d4a5f8c6b1e0d9a7f3c2b";
+    announce.osType = "Linux";
+    announce.protocolVersion = MessageHeader::VERSION_COMPACT;
+    announce.senderId = 0x5eed1234;
+    report("AnnounceMessage round-trip", measure([&]() {
+        keep(AnnounceMessage::deserialize(announce.serialize()).username.size());
+    }));
+
+    printHeader("Message IDs");
+
+    report("MessageIdGenerator::next", measure([&]() { keep(MessageIdGenerator::next()); }));
+    report("MessageIdGenerator::next64", measure([&]() { keep(MessageIdGenerator::next64()); }));
+
+    printHeader("Duplicate filter");
+
+    const uint64_t sender = DuplicateFilter::senderKey(MessageView::parse(frame));
+    DuplicateFilter fresh;
+    uint32_t nextId = 0;
+    report("DuplicateFilter new id", measure([&]() { keep(fresh.markSeen(sender, nextId++)); }));
+
+    DuplicateFilter repeated;
+    repeated.markSeen(sender, 42);
+    report("DuplicateFilter duplicate", measure([&]() { keep(repeated.markSeen(sender, 42)); }));
+
+    report("DuplicateFilter::senderKey", measure([&]() { keep(DuplicateFilter::senderKey(MessageView::parse(frame))); }));
+}
+
+} // namespace bench
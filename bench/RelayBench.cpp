@@ -0,0 +1,246 @@
+#include "Bench.h"
+#include "core/mesh/MeshNetwork.h"
+#include "core/mesh/MessageRouter.h"
+#include "core/protocol/DuplicateFilter.h"
+#include "core/protocol/MessageTypes.h"
+#include "core/protocol/MessageView.h"
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace echo;
+
+namespace {
+
+using Clock = MessageRouter::Clock;
+
+constexpr std::chrono::milliseconds HOP_LATENCY{3};
+constexpr std::chrono::seconds WARMUP{25};
+constexpr size_t MESSAGES = 20;
+
+enum class Mode {
+    FLOOD,
+    GOSSIP,
+    RELAYS,
+    ROUTED
+};
+
+struct Room {
+    size_t nodes = 0;
+    double degree = 0.0;
+    std::vector<std::vector<size_t>> adjacency;
+};
+
+Room buildRoom(size_t nodes, double targetDegree, uint32_t seed) {
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<double> pos(0.0, 1.0);
+    std::vector<std::pair<double, double>> points(nodes);
+    for (auto& p : points) p = {pos(gen), pos(gen)};
+
+    double radius = std::sqrt(targetDegree / (M_PI * static_cast<double>(nodes)));
+    Room room;
+    room.nodes = nodes;
+    room.adjacency.resize(nodes);
+    size_t edges = 0;
+    for (size_t a = 0; a < nodes; ++a) {
+        for (size_t b = a + 1; b < nodes; ++b) {
+            double dx = points[a].first - points[b].first;
+            double dy = points[a].second - points[b].second;
+            if (dx * dx + dy * dy <= radius * radius) {
+                room.adjacency[a].push_back(b);
+                room.adjacency[b].push_back(a);
+                edges++;
+            }
+        }
+    }
+    room.degree = 2.0 * static_cast<double>(edges) / static_cast<double>(nodes);
+    return room;
+}
+
+struct Outcome {
+    double delivery = 0.0;
+    double sendsPerMessage = 0.0;
+    double controlKbps = 0.0;
+};
+
+Outcome simulate(const Room& room, Mode mode) {
+    struct Delivery {
+        size_t to;
+        size_t from;
+        std::vector<uint8_t> frame;
+    };
+
+    const Clock::time_point start = Clock::time_point{} + std::chrono::hours(1);
+    Clock::time_point now = start;
+    std::multimap<Clock::time_point, Delivery> inFlight;
+    size_t sends = 0;
+    size_t controlBytes = 0;
+
+    auto linksOf = [&](size_t i) {
+        std::vector<RelayLink> links;
+        for (size_t n : room.adjacency[i]) links.push_back(RelayLink{std::to_string(n), 1});
+        return links;
+    };
+
+    std::vector<std::unique_ptr<MessageRouter>> routers;
+    std::vector<std::unique_ptr<MeshNetwork>> meshes;
+    std::vector<std::unique_ptr<DuplicateFilter>> seen;
+    GossipConfig config;
+    config.enabled = mode != Mode::FLOOD;
+    for (size_t i = 0; i < room.nodes; ++i) {
+        routers.push_back(std::make_unique<MessageRouter>(
+            [&, i](const std::string& link, std::vector<uint8_t> frame) {
+                inFlight.emplace(now + HOP_LATENCY, Delivery{std::stoul(link), i, std::move(frame)});
+                sends++;
+            },
+            [&, i]() { return linksOf(i); },
+            static_cast<uint32_t>(i + 1)));
+        routers.back()->setGossip(config);
+        seen.push_back(std::make_unique<DuplicateFilter>());
+
+        if (mode == Mode::RELAYS || mode == Mode::ROUTED) {
+            meshes.push_back(std::make_unique<MeshNetwork>(
+                [&, i](const NextHop& hop, std::vector<uint8_t> frame) {
+                    controlBytes += frame.size();
+                    inFlight.emplace(now + HOP_LATENCY, Delivery{std::stoul(hop.link), i, std::move(frame)});
+                },
+                [&, i]() {
+                    std::vector<MeshNeighbor> neighbors;
+                    for (size_t n : room.adjacency[i]) neighbors.push_back(MeshNeighbor{std::to_string(n), std::to_string(n)});
+                    return neighbors;
+                }));
+            meshes.back()->setLocalName(std::to_string(i));
+            MeshNetwork* mesh = meshes.back().get();
+            routers.back()->setRoleCallback([mesh](const std::string& ingress) { return mesh->roleFor(ingress); });
+            routers.back()->setUnicast(
+                [mesh](const std::string& destination, NextHop& hop) { return mesh->nextHop(destination, hop); },
+                [&, i](const NextHop& hop, std::vector<uint8_t> frame) {
+                    inFlight.emplace(now + HOP_LATENCY, Delivery{std::stoul(hop.link), i, std::move(frame)});
+                    sends++;
+                });
+        }
+    }
+
+    auto deliverDue = [&](size_t& delivered) {
+        while (!inFlight.empty() && inFlight.begin()->first <= now) {
+            Delivery d = std::move(inFlight.begin()->second);
+            inFlight.erase(inFlight.begin());
+            auto view = MessageView::parse(d.frame);
+            std::string ingress = std::to_string(d.from);
+            std::vector<uint8_t> expanded;
+            if (view.type() == MessageType::NEIGHBOR_LIST) {
+                meshes[d.to]->handleNeighborList(NeighborListMessage::deserialize(view.decodedPayload(expanded)), ingress, now);
+            } else if (view.type() == MessageType::PING) {
+                meshes[d.to]->handlePing(ProbeMessage::deserialize(view.decodedPayload(expanded)), ingress);
+            } else if (view.type() == MessageType::PONG) {
+                meshes[d.to]->handlePong(ProbeMessage::deserialize(view.decodedPayload(expanded)), ingress, now);
+            } else if (view.type() == MessageType::PRIVATE_MESSAGE) {
+                std::string recipient(TextMessageView::parse(view, view.decodedPayload(expanded)).recipientUsername());
+                if (recipient == std::to_string(d.to)) {
+                    delivered++;
+                } else {
+                    routers[d.to]->forwardUnicast(view, recipient);
+                }
+            } else if (seen[d.to]->markSeen(view)) {
+                delivered++;
+                routers[d.to]->relay(view, ingress, now);
+            } else {
+                routers[d.to]->overheard(view, ingress);
+            }
+        }
+    };
+
+    size_t delivered = 0;
+    if (!meshes.empty()) {
+        for (auto end = now + WARMUP; now < end; now += std::chrono::milliseconds(100)) {
+            deliverDue(delivered);
+            for (auto& mesh : meshes) mesh->tick(now);
+        }
+    }
+
+    for (size_t m = 0; m < MESSAGES; ++m) {
+        size_t origin = (m * 7919) % room.nodes;
+        if (mode == Mode::ROUTED) {
+            std::string recipient = std::to_string((origin + room.nodes / 2) % room.nodes);
+            routers[origin]->sendUnicast(MessageFactory::createTextMessage("status check " + std::to_string(m),
+                                                                           std::to_string(origin), "", recipient,
+                                                                           false).serialize(),
+                                         recipient);
+        } else {
+            auto frame = MessageFactory::createTextMessage("status check " + std::to_string(m),
+                                                           "node" + std::to_string(origin), "", "", true).serialize();
+            seen[origin]->markSeen(MessageView::parse(frame));
+            for (size_t n : room.adjacency[origin]) {
+                inFlight.emplace(now + HOP_LATENCY, Delivery{n, origin, frame});
+                sends++;
+            }
+        }
+
+        bool busy = true;
+        while (busy) {
+            now += std::chrono::milliseconds(1);
+            deliverDue(delivered);
+            busy = !inFlight.empty();
+            for (auto& router : routers) {
+                router->tick(now);
+                busy = busy || router->stats().pending > 0;
+            }
+        }
+    }
+
+    Outcome outcome;
+    size_t expected = mode == Mode::ROUTED ? MESSAGES : MESSAGES * (room.nodes - 1);
+    outcome.delivery = static_cast<double>(delivered) / static_cast<double>(expected);
+    outcome.sendsPerMessage = static_cast<double>(sends) / static_cast<double>(MESSAGES);
+    double seconds = std::chrono::duration<double>(now - start).count();
+    outcome.controlKbps = seconds > 0.0
+        ? static_cast<double>(controlBytes) * 8.0 / 1000.0 / seconds / static_cast<double>(room.nodes)
+        : 0.0;
+    return outcome;
+}
+
+}
+
+namespace bench {
+
+void runRelayBench() {
+    std::cout << std::endl << "=== Global relay: flooding vs adaptive gossip vs multipoint relays ===" << std::endl;
+    std::cout << std::left << std::setw(8) << "nodes"
+              << std::right << std::setw(8) << "degree"
+              << std::left << "  " << std::setw(9) << "mode"
+              << std::right << std::setw(11) << "delivery"
+              << std::setw(13) << "sends/msg"
+              << std::setw(9) << "saved"
+              << std::setw(16) << "ctl kbit/s/node" << std::endl;
+
+    const std::pair<size_t, double> rooms[] = {{20, 10}, {50, 12}, {50, 30}, {100, 20}, {100, 50}};
+    const std::pair<Mode, const char*> modes[] = {{Mode::FLOOD, "flood"}, {Mode::GOSSIP, "gossip"}, {Mode::RELAYS, "mpr"},
+                                                {Mode::ROUTED, "routed"}};
+    for (const auto& spec : rooms) {
+        Room room = buildRoom(spec.first, spec.second, 7);
+        double floodSends = 0.0;
+        for (const auto& mode : modes) {
+            Outcome outcome = simulate(room, mode.first);
+            if (mode.first == Mode::FLOOD) floodSends = outcome.sendsPerMessage;
+            double saved = 100.0 * (1.0 - outcome.sendsPerMessage / floodSends);
+            std::cout << std::left << std::setw(8) << room.nodes
+                      << std::right << std::fixed << std::setprecision(1) << std::setw(8) << room.degree
+                      << std::left << "  " << std::setw(9) << mode.second
+                      << std::right << std::setw(10) << outcome.delivery * 100.0 << "%"
+                      << std::setw(13) << outcome.sendsPerMessage
+                      << std::setw(8) << saved << "%"
+                      << std::setw(16) << std::setprecision(2) << outcome.controlKbps << std::endl;
+        }
+    }
+    std::cout << "Delivery is the share of other nodes that received each message; sends count data link writes per message." << std::endl;
+    std::cout << "routed sends private messages to a node across the room along the cheapest path; delivery is the share that arrived." << std::endl;
+    std::cout << "mpr and routed run " << WARMUP.count() << " s of neighbor-list exchange and probing first. Sends leave that"
+              << " traffic out; ctl is the neighbor-list and probe bytes each node sent, averaged over the whole run." << std::endl;
+}
+
+} // namespace bench
@@ -0,0 +1,259 @@
+#include "Bench.h"
+#include "core/network/TcpFrameServer.h"
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+using namespace echo;
+
+namespace {
+
+#ifdef __linux__
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t PEERS = 256;
+constexpr size_t CLIENT_THREADS = 8;
+constexpr size_t CONNECTS_PER_PEER = 8;
+constexpr size_t FRAMES_PER_PEER = 400;
+constexpr size_t FRAME_SIZE = 128;
+constexpr size_t MAX_FRAME = 65536;
+constexpr auto DEADLINE = std::chrono::seconds(10);
+
+// The accept loop WifiDirect used before the reactor: a non-blocking accept polled every 100 ms
+// and a thread per connection. Threads are joined instead of detached so the bench can shut down.
+// It counts its accept and recv calls the way the reactor counts its own.
+class ThreadPerConnectionServer {
+public:
+    explicit ThreadPerConnectionServer(std::atomic<size_t>& received) : received_(received) {}
+
+    ~ThreadPerConnectionServer() {
+        running_ = false;
+        if (acceptor_.joinable()) acceptor_.join();
+        for (auto& reader : readers_) reader.join();
+        if (fd_ >= 0) close(fd_);
+    }
+
+    bool start() {
+        fd_ = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{}; addr.sin_family = AF_INET; addr.sin_port = 0; addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t len = sizeof(addr);
+        if (fd_ < 0 || bind(fd_, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd_, 4) < 0 ||
+            getsockname(fd_, (sockaddr*)&addr, &len) < 0) {
+            return false;
+        }
+        port_ = ntohs(addr.sin_port);
+        int flags = fcntl(fd_, F_GETFL, 0);
+        fcntl(fd_, F_SETFL, flags | O_NONBLOCK);
+        acceptor_ = std::thread([this]() { run(); });
+        return true;
+    }
+
+    uint16_t port() const { return port_; }
+    size_t threads() const { return threads_.load(); }
+    uint64_t syscalls() const { return syscalls_.load(); }
+
+private:
+    void run() {
+        while (running_) {
+            int c = accept(fd_, nullptr, nullptr);
+            syscalls_++;
+            if (c < 0) { std::this_thread::sleep_for(std::chrono::milliseconds(100)); continue; }
+            threads_++;
+            readers_.emplace_back([this, c]() {
+                uint8_t lenbuf[4];
+                while (true) {
+                    syscalls_++;
+                    if (recv(c, lenbuf, 4, MSG_WAITALL) != 4) break;
+                    uint32_t len = ((uint32_t)lenbuf[0] << 24) | ((uint32_t)lenbuf[1] << 16) | ((uint32_t)lenbuf[2] << 8) | (uint32_t)lenbuf[3];
+                    if (len == 0 || len > MAX_FRAME) break;
+                    std::vector<uint8_t> buf(len);
+                    syscalls_++;
+                    if (recv(c, buf.data(), len, MSG_WAITALL) != (ssize_t)len) break;
+                    received_.fetch_add(1, std::memory_order_relaxed);
+                }
+                close(c);
+            });
+        }
+    }
+
+    std::atomic<size_t>& received_;
+    std::atomic<bool> running_{true};
+    std::atomic<size_t> threads_{0};
+    std::atomic<uint64_t> syscalls_{0};
+    int fd_ = -1;
+    uint16_t port_ = 0;
+    std::thread acceptor_;
+    std::vector<std::thread> readers_;
+};
+
+int connectTo(uint16_t port) {
+    int s = socket(AF_INET, SOCK_STREAM, 0);
+    if (s < 0) return -1;
+    sockaddr_in addr{}; addr.sin_family = AF_INET; addr.sin_port = htons(port); addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(s, (sockaddr*)&addr, sizeof(addr)) < 0) { close(s); return -1; }
+    return s;
+}
+
+bool sendAll(int s, const std::vector<uint8_t>& data) {
+    size_t off = 0;
+    while (off < data.size()) {
+        ssize_t n = send(s, data.data() + off, data.size() - off, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        off += (size_t)n;
+    }
+    return true;
+}
+
+std::vector<uint8_t> framed() {
+    std::vector<uint8_t> out = {0, 0, (uint8_t)(FRAME_SIZE >> 8), (uint8_t)FRAME_SIZE};
+    out.resize(4 + FRAME_SIZE, 0xAB);
+    return out;
+}
+
+struct Outcome {
+    double perSecond = 0.0;
+    size_t received = 0;
+    size_t expected = 0;
+    size_t serverThreads = 0;
+    uint64_t syscalls = 0;
+};
+
+// Each simulated peer connects, sends one frame and closes, the way WifiDirect sent before it pooled connections.
+// Clients stop starting connections at the deadline, so a slow server is measured on fewer of them.
+void churn(uint16_t port, Clock::time_point start, std::atomic<size_t>& attempted, std::atomic<size_t>& failed) {
+    std::vector<std::thread> clients;
+    auto frame = framed();
+    for (size_t t = 0; t < CLIENT_THREADS; ++t) {
+        clients.emplace_back([&, t]() {
+            for (size_t round = 0; round < CONNECTS_PER_PEER; ++round) {
+                for (size_t peer = t; peer < PEERS; peer += CLIENT_THREADS) {
+                    if (Clock::now() - start > DEADLINE) return;
+                    attempted++;
+                    int s = connectTo(port);
+                    if (s < 0 || !sendAll(s, frame)) failed++;
+                    if (s >= 0) close(s);
+                }
+            }
+        });
+    }
+    for (auto& client : clients) client.join();
+}
+
+// Every simulated peer holds one connection open and streams frames over it.
+void stream(uint16_t port, std::atomic<size_t>& attempted, std::atomic<size_t>& failed) {
+    std::vector<std::thread> clients;
+    auto frame = framed();
+    for (size_t t = 0; t < CLIENT_THREADS; ++t) {
+        clients.emplace_back([&, t]() {
+            std::vector<int> sockets;
+            for (size_t peer = t; peer < PEERS; peer += CLIENT_THREADS) sockets.push_back(connectTo(port));
+            for (size_t m = 0; m < FRAMES_PER_PEER; ++m) {
+                for (int s : sockets) {
+                    attempted++;
+                    if (s < 0 || !sendAll(s, frame)) failed++;
+                }
+            }
+            for (int s : sockets) {
+                if (s >= 0) close(s);
+            }
+        });
+    }
+    for (auto& client : clients) client.join();
+}
+
+Outcome run(uint16_t port, std::atomic<size_t>& received, bool persistent) {
+    Outcome outcome;
+    std::atomic<size_t> attempted{0};
+    std::atomic<size_t> failed{0};
+    auto start = Clock::now();
+    if (persistent) {
+        stream(port, attempted, failed);
+    } else {
+        churn(port, start, attempted, failed);
+    }
+    auto drained = Clock::now() + DEADLINE;
+    while (received.load() + failed.load() < attempted.load() && Clock::now() < drained) {
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    outcome.expected = attempted.load();
+    outcome.received = received.load();
+    outcome.perSecond = static_cast<double>(outcome.received) / elapsed;
+    return outcome;
+}
+
+Outcome runReactor(bool persistent, TcpBackend backend) {
+    std::atomic<size_t> received{0};
+    TcpFrameServer server(MAX_FRAME, [&](const std::vector<uint8_t>&) { received.fetch_add(1, std::memory_order_relaxed); },
+                          TcpFrameServer::DEFAULT_WORKERS, backend);
+    if (!server.start(0)) return Outcome{};
+    Outcome outcome = run(server.port(), received, persistent);
+    outcome.serverThreads = 1 + TcpFrameServer::DEFAULT_WORKERS;
+    outcome.syscalls = server.stats().syscalls;
+    server.stop();
+    return outcome;
+}
+
+Outcome runThreadPerConnection(bool persistent) {
+    std::atomic<size_t> received{0};
+    ThreadPerConnectionServer server(received);
+    if (!server.start()) return Outcome{};
+    Outcome outcome = run(server.port(), received, persistent);
+    outcome.serverThreads = 1 + server.threads();
+    outcome.syscalls = server.syscalls();
+    return outcome;
+}
+
+#endif
+
+}
+
+namespace bench {
+
+void runTcpServerBench() {
+#ifdef __linux__
+    std::cout << std::endl << "=== WiFi TCP server on localhost (" << PEERS << " peers, " << FRAME_SIZE
+              << " byte frames) ===" << std::endl;
+    std::cout << std::left << std::setw(26) << "scenario"
+              << std::setw(22) << "server"
+              << std::right << std::setw(12) << "per sec"
+              << std::setw(14) << "received"
+              << std::setw(10) << "threads"
+              << std::setw(12) << "sys/frame" << std::endl;
+    bool uring = IoUring::available();
+    const char* servers[] = {"thread per connection", "epoll reactor", "io_uring reactor"};
+    for (bool persistent : {false, true}) {
+        const char* scenario = persistent ? "frames on open conns" : "connect + frame + close";
+        for (int server = 0; server < 3; ++server) {
+            if (server == 2 && !uring) continue;
+            Outcome outcome = server == 0 ? runThreadPerConnection(persistent)
+                                          : runReactor(persistent, server == 1 ? TcpBackend::Epoll : TcpBackend::Uring);
+            double perFrame = outcome.received ? static_cast<double>(outcome.syscalls) / static_cast<double>(outcome.received) : 0.0;
+            std::cout << std::left << std::setw(26) << scenario
+                      << std::setw(22) << servers[server]
+                      << std::right << std::fixed << std::setprecision(0) << std::setw(12) << outcome.perSecond
+                      << std::setw(14) << (std::to_string(outcome.received) + "/" + std::to_string(outcome.expected))
+                      << std::setw(10) << outcome.serverThreads
+                      << std::setprecision(4) << std::setw(12) << perFrame << std::endl;
+        }
+    }
+    std::cout << "per sec is connections/s for connect + frame + close and frames/s on open connections." << std::endl;
+    std::cout << "threads counts the server threads started, including one per accepted connection." << std::endl;
+    std::cout << "sys/frame counts the server's accept, recv, epoll and io_uring_enter calls per frame received." << std::endl;
+    if (!uring) std::cout << "io_uring is not available in this build or kernel, so its rows are skipped." << std::endl;
+#else
+    std::cout << std::endl << "=== WiFi TCP server: the epoll reactor is Linux only, skipped ===" << std::endl;
+#endif
+}
+
+} // namespace bench
@@ -0,0 +1,224 @@
+#include "Bench.h"
+#include "core/mesh/MessageRouter.h"
+#include "core/protocol/DuplicateFilter.h"
+#include "core/protocol/MessageTypes.h"
+#include "core/protocol/MessageView.h"
+#include "core/protocol/ReliableDelivery.h"
+#include "core/transport/LoopbackTransport.h"
+#include "core/transport/TransportSet.h"
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace echo;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t MESSAGES = 2000;
+constexpr auto DEADLINE = std::chrono::seconds(30);
+
+// One node's stack over a loopback link: dedup, relay, routing and end-to-end ACKs, wired like ConsoleUI.
+class Node {
+public:
+    Node(LoopbackHub& hub, const std::string& name, std::vector<Clock::time_point>& sent)
+        : name_(name), sent_(sent),
+          router_([this](const std::string& link, std::vector<uint8_t> frame) { links_.sendOnLink(link, std::move(frame)); },
+                  [this]() { return links_.relayLinks(); }),
+          reliable_([this](const std::string& peer, std::vector<uint8_t> frame) {
+              return router_.sendUnicast(std::move(frame), peer);
+          }),
+          link_(hub, name) {
+        links_.add(link_);
+        GossipConfig gossip;
+        gossip.enabled = false;
+        router_.setGossip(gossip);
+        router_.setUnicast(
+            [this](const std::string& destination, NextHop& hop) {
+                auto it = routes_.find(destination);
+                if (it == routes_.end()) return false;
+                hop = NextHop{it->second, LoopbackTransport::addressOf(it->second)};
+                return true;
+            },
+            [this](const NextHop& hop, std::vector<uint8_t> frame) { links_.sendToHop(hop, std::move(frame)); });
+        reliable_.setLocalName(name);
+        link_.setOnData([this](const std::string& link, const std::vector<uint8_t>& data) { receive(link, data); });
+        router_.start();
+        reliable_.start();
+    }
+
+    ~Node() {
+        reliable_.stop();
+        router_.stop();
+    }
+
+    void route(const std::string& destination, const std::string& nextHop) { routes_[destination] = nextHop; }
+
+    void broadcast(size_t index) {
+        auto frame = MessageFactory::createTextMessage(std::to_string(index), name_, "", "", true).serialize();
+        seen_.markSeen(MessageView::parse(frame));
+        links_.broadcast(frame);
+    }
+
+    void sendTo(const std::string& peer, size_t index) {
+        uint32_t sequence = reliable_.nextSequence(peer);
+        auto frame = MessageFactory::createTextMessage(std::to_string(index), name_, "", peer, false, sequence).serialize();
+        reliable_.send(peer, sequence, std::move(frame));
+    }
+
+    size_t received() const { return received_.load(std::memory_order_acquire); }
+    const std::vector<double>& latencies() const { return latencies_; }
+    ReliabilityStats reliability() const { return reliable_.stats(); }
+
+private:
+    void receive(const std::string& link, const std::vector<uint8_t>& data) {
+        auto msg = MessageView::parse(data);
+        std::vector<uint8_t> expanded;
+        if (msg.type() == MessageType::ACK) {
+            auto ack = AckMessage::deserialize(msg.decodedPayload(expanded));
+            if (ack.recipientUsername == name_) {
+                reliable_.handleAck(ack);
+            } else {
+                router_.forwardUnicast(msg, ack.recipientUsername);
+            }
+            return;
+        }
+        auto text = TextMessageView::parse(msg, msg.decodedPayload(expanded));
+        if (!text.isGlobal()) {
+            if (text.recipientUsername() != name_) {
+                router_.forwardUnicast(msg, std::string(text.recipientUsername()));
+            } else if (reliable_.receive(std::string(text.senderUsername()), text.sequence())) {
+                record(text);
+            }
+            return;
+        }
+        if (!seen_.markSeen(msg)) {
+            router_.overheard(msg, link);
+            return;
+        }
+        record(text);
+        router_.relay(msg, link);
+    }
+
+    void record(const TextMessageView& text) {
+        size_t index = std::stoul(std::string(text.content()));
+        latencies_.push_back(std::chrono::duration<double, std::micro>(Clock::now() - sent_[index]).count());
+        received_.fetch_add(1, std::memory_order_release);
+    }
+
+    std::string name_;
+    TransportSet links_;
+    std::vector<Clock::time_point>& sent_;
+    DuplicateFilter seen_;
+    MessageRouter router_;
+    ReliableDelivery reliable_;
+    std::map<std::string, std::string> routes_;
+    std::vector<double> latencies_;
+    std::atomic<size_t> received_{0};
+    // Declared last so it detaches from the hub before the layers it delivers into are destroyed.
+    LoopbackTransport link_;
+};
+
+struct Outcome {
+    double messagesPerSecond = 0.0;
+    double p50Us = 0.0;
+    double p99Us = 0.0;
+    double framesPerMessage = 0.0;
+    double retransmits = 0.0;
+    bool complete = false;
+};
+
+double percentile(std::vector<double> values, double p) {
+    if (values.empty()) return 0.0;
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, static_cast<size_t>(p * static_cast<double>(values.size())))];
+}
+
+// A chain of hops + 1 nodes; node 0 sends to the far end, either reliably or as global broadcast.
+Outcome runChain(size_t hops, bool reliable) {
+    LoopbackHub hub;
+    std::vector<Clock::time_point> sent(MESSAGES);
+    std::vector<std::unique_ptr<Node>> nodes;
+    for (size_t i = 0; i <= hops; ++i) {
+        nodes.push_back(std::make_unique<Node>(hub, "n" + std::to_string(i), sent));
+    }
+    for (size_t i = 0; i <= hops; ++i) {
+        if (i > 0) hub.connect("n" + std::to_string(i - 1), "n" + std::to_string(i));
+        for (size_t j = 0; j <= hops; ++j) {
+            if (j == i) continue;
+            nodes[i]->route("n" + std::to_string(j), "n" + std::to_string(j > i ? i + 1 : i - 1));
+        }
+    }
+
+    Node& origin = *nodes.front();
+    Node& target = *nodes.back();
+    std::string targetName = "n" + std::to_string(hops);
+    auto start = Clock::now();
+    for (size_t m = 0; m < MESSAGES; ++m) {
+        sent[m] = Clock::now();
+        if (reliable) {
+            origin.sendTo(targetName, m);
+        } else {
+            origin.broadcast(m);
+        }
+    }
+
+    Outcome outcome;
+    auto finished = [&]() {
+        return target.received() >= MESSAGES && (!reliable || origin.reliability().delivered >= MESSAGES);
+    };
+    while (!finished() && Clock::now() - start < DEADLINE) {
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    auto elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    hub.drain();
+
+    outcome.complete = finished();
+    outcome.messagesPerSecond = static_cast<double>(target.received()) / elapsed;
+    outcome.p50Us = percentile(target.latencies(), 0.50);
+    outcome.p99Us = percentile(target.latencies(), 0.99);
+    outcome.framesPerMessage = static_cast<double>(hub.stats().frames) / static_cast<double>(MESSAGES);
+    outcome.retransmits = static_cast<double>(origin.reliability().retransmits);
+    nodes.clear();
+    return outcome;
+}
+
+}
+
+namespace bench {
+
+void runTransportBench() {
+    std::cout << std::endl << "=== End-to-end over loopback transport (" << MESSAGES << " messages) ===" << std::endl;
+    std::cout << std::left << std::setw(20) << "scenario"
+              << std::right << std::setw(6) << "hops"
+              << std::setw(12) << "msgs/s"
+              << std::setw(12) << "p50 us"
+              << std::setw(12) << "p99 us"
+              << std::setw(12) << "frames/msg"
+              << std::setw(10) << "resent" << std::endl;
+
+    const size_t chains[] = {1, 3, 7};
+    for (bool reliable : {false, true}) {
+        for (size_t hops : chains) {
+            Outcome outcome = runChain(hops, reliable);
+            std::cout << std::left << std::setw(20) << (reliable ? "private + ACK" : "global flood")
+                      << std::right << std::setw(6) << hops << std::fixed
+                      << std::setw(12) << std::setprecision(0) << outcome.messagesPerSecond
+                      << std::setw(12) << std::setprecision(1) << outcome.p50Us
+                      << std::setw(12) << outcome.p99Us
+                      << std::setw(12) << std::setprecision(2) << outcome.framesPerMessage
+                      << std::setw(10) << std::setprecision(0) << outcome.retransmits
+                      << (outcome.complete ? "" : "  (incomplete)") << std::endl;
+        }
+    }
+    std::cout << "Each node runs the real codec, duplicate filter, router and ACK layer; the hub delivers on one thread." << std::endl;
+    std::cout << "Messages go out back to back, so latency is from send to receipt at the far end including queueing;" << std::endl;
+    std::cout << "private messages also wait for the first one to be acknowledged. frames/msg includes relays and ACKs." << std::endl;
+}
+
+} // namespace bench
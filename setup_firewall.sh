@@ -45,6 +45,13 @@ if [ "$FIREWALL" = "firewalld" ]; then
         echo "[FAIL] TCP 48271"
     fi
 
+    sudo firewall-cmd --permanent --add-port=48271/udp
+    if [ $? -eq 0 ]; then
+        echo "[OK] UDP 48271 - Datagrams"
+    else
+        echo "[FAIL] UDP 48271"
+    fi
+
     echo ""
     echo "Reloading firewall..."
     sudo firewall-cmd --reload
@@ -70,6 +77,13 @@ elif [ "$FIREWALL" = "ufw" ]; then
         echo "[FAIL] TCP 48271"
     fi
 
+    sudo ufw allow 48271/udp comment "Echo WiFi Datagrams"
+    if [ $? -eq 0 ]; then
+        echo "[OK] UDP 48271 - Datagrams"
+    else
+        echo "[FAIL] UDP 48271"
+    fi
+
     echo ""
     echo "Current firewall status:"
     sudo ufw status
@@ -91,6 +105,13 @@ else
         echo "[FAIL] TCP 48271"
     fi
 
+    sudo iptables -A INPUT -p udp --dport 48271 -j ACCEPT
+    if [ $? -eq 0 ]; then
+        echo "[OK] UDP 48271 - Datagrams"
+    else
+        echo "[FAIL] UDP 48271"
+    fi
+
     echo ""
     echo "Saving iptables rules..."
 
@@ -121,6 +142,7 @@ echo ""
 echo "Ports configured:"
 echo "  UDP 48270 - WiFi Discovery (broadcast)"
 echo "  TCP 48271 - WiFi Messaging (direct)"
+echo "  UDP 48271 - WiFi Messaging (small frames)"
 echo ""
 echo "You can now run Echo and use WiFi messaging"
 echo ""
\ No newline at end of file
@@ -0,0 +1,467 @@
+#include "MeshSim.h"
+#include "core/protocol/MessageTypes.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <queue>
+#include <random>
+#include <stdexcept>
+#include <unordered_map>
+
+#ifdef __linux__
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+using namespace echo;
+
+namespace sim {
+
+namespace {
+
+size_t residentBytes() {
+#ifdef __linux__
+    std::ifstream statm("/proc/self/statm");
+    size_t pages = 0;
+    size_t resident = 0;
+    statm >> pages >> resident;
+    return resident * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#else
+    return 0;
+#endif
+}
+
+size_t peakResidentBytes() {
+#ifdef __linux__
+    struct rusage usage {};
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#else
+    return 0;
+#endif
+}
+
+void link(Topology& topology, uint32_t a, uint32_t b) {
+    topology.adjacency[a].push_back(b);
+    topology.adjacency[b].push_back(a);
+}
+
+void buildGeometric(Topology& topology, size_t nodes, double degree, std::mt19937& rng) {
+    std::uniform_real_distribution<double> pos(0.0, 1.0);
+    std::vector<std::pair<double, double>> points(nodes);
+    for (auto& p : points) p = {pos(rng), pos(rng)};
+
+    // Bucket points into cells one radio range wide so only adjacent cells are compared.
+    double radius = std::sqrt(degree / (M_PI * static_cast<double>(nodes)));
+    size_t cells = std::max<size_t>(1, static_cast<size_t>(1.0 / radius));
+    auto cellOf = [cells](double v) { return std::min(cells - 1, static_cast<size_t>(v * static_cast<double>(cells))); };
+    std::vector<std::vector<uint32_t>> grid(cells * cells);
+    for (uint32_t i = 0; i < nodes; ++i) {
+        grid[cellOf(points[i].second) * cells + cellOf(points[i].first)].push_back(i);
+    }
+
+    for (uint32_t a = 0; a < nodes; ++a) {
+        size_t cx = cellOf(points[a].first);
+        size_t cy = cellOf(points[a].second);
+        for (size_t y = cy > 0 ? cy - 1 : 0; y <= std::min(cells - 1, cy + 1); ++y) {
+            for (size_t x = cx > 0 ? cx - 1 : 0; x <= std::min(cells - 1, cx + 1); ++x) {
+                for (uint32_t b : grid[y * cells + x]) {
+                    if (b <= a) continue;
+                    double dx = points[a].first - points[b].first;
+                    double dy = points[a].second - points[b].second;
+                    if (dx * dx + dy * dy <= radius * radius) link(topology, a, b);
+                }
+            }
+        }
+    }
+}
+
+void buildGrid(Topology& topology, size_t nodes, double degree) {
+    size_t side = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(nodes))));
+    bool diagonal = degree >= 6.0;
+    for (uint32_t i = 0; i < nodes; ++i) {
+        size_t x = i % side;
+        size_t y = i / side;
+        auto connect = [&](size_t nx, size_t ny) {
+            size_t j = ny * side + nx;
+            if (nx < side && j < nodes) link(topology, i, static_cast<uint32_t>(j));
+        };
+        connect(x + 1, y);
+        connect(x, y + 1);
+        if (diagonal) {
+            connect(x + 1, y + 1);
+            if (x > 0) connect(x - 1, y + 1);
+        }
+    }
+}
+
+void buildRandom(Topology& topology, size_t nodes, double degree, std::mt19937& rng) {
+    std::uniform_int_distribution<uint32_t> pick(0, static_cast<uint32_t>(nodes - 1));
+    size_t edges = static_cast<size_t>(degree * static_cast<double>(nodes) / 2.0);
+    for (size_t e = 0; e < edges; ++e) {
+        uint32_t a = pick(rng);
+        uint32_t b = pick(rng);
+        if (a != b) link(topology, a, b);
+    }
+    for (auto& neighbors : topology.adjacency) {
+        std::sort(neighbors.begin(), neighbors.end());
+        neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+    }
+}
+
+void labelComponents(Topology& topology) {
+    size_t nodes = topology.adjacency.size();
+    topology.component.assign(nodes, UINT32_MAX);
+    topology.componentSize.clear();
+    std::vector<uint32_t> stack;
+    for (uint32_t start = 0; start < nodes; ++start) {
+        if (topology.component[start] != UINT32_MAX) continue;
+        uint32_t label = static_cast<uint32_t>(topology.componentSize.size());
+        size_t size = 0;
+        topology.component[start] = label;
+        stack.push_back(start);
+        while (!stack.empty()) {
+            uint32_t n = stack.back();
+            stack.pop_back();
+            size++;
+            for (uint32_t m : topology.adjacency[n]) {
+                if (topology.component[m] == UINT32_MAX) {
+                    topology.component[m] = label;
+                    stack.push_back(m);
+                }
+            }
+        }
+        topology.componentSize.push_back(size);
+    }
+}
+
+double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) return 0.0;
+    size_t index = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+enum class EventKind : uint8_t {
+    DELIVER,
+    TICK,
+    MAINTAIN,
+    ORIGINATE
+};
+
+struct Event {
+    Clock::time_point at;
+    uint64_t seq;
+    EventKind kind;
+    uint32_t node;
+    uint32_t from;
+    uint32_t slot;
+};
+
+struct Later {
+    bool operator()(const Event& a, const Event& b) const {
+        return a.at != b.at ? a.at > b.at : a.seq > b.seq;
+    }
+};
+
+class Simulator {
+public:
+    Simulator(const Config& config, const Topology& topology)
+        : config_(config), topology_(topology), rng_(config.seed) {
+        names_.reserve(config.nodes);
+        for (size_t i = 0; i < config.nodes; ++i) names_.push_back(std::to_string(i));
+    }
+
+    Report run();
+
+private:
+    class Node : public NodeContext {
+    public:
+        Node(Simulator& sim, uint32_t id) : sim_(sim), id_(id) {}
+
+        uint32_t id() const override { return id_; }
+        const std::string& name(uint32_t node) const override { return sim_.names_[node]; }
+        const std::vector<uint32_t>& neighbors() const override { return sim_.topology_.adjacency[id_]; }
+        void transmit(uint32_t neighbor, std::vector<uint8_t> frame) override {
+            sim_.transmit(id_, neighbor, std::move(frame));
+        }
+
+        std::unique_ptr<RelayPolicy> policy;
+        Clock::time_point radioFree{};
+        Clock::time_point tickAt = Clock::time_point::max();
+
+    private:
+        Simulator& sim_;
+        uint32_t id_;
+    };
+
+    void push(Clock::time_point at, EventKind kind, uint32_t node, uint32_t from = 0, uint32_t slot = 0) {
+        queue_.push(Event{at, seq_++, kind, node, from, slot});
+    }
+
+    uint32_t store(std::vector<uint8_t> frame) {
+        if (freeSlots_.empty()) {
+            frames_.push_back(std::move(frame));
+            return static_cast<uint32_t>(frames_.size() - 1);
+        }
+        uint32_t slot = freeSlots_.back();
+        freeSlots_.pop_back();
+        frames_[slot] = std::move(frame);
+        return slot;
+    }
+
+    void transmit(uint32_t from, uint32_t to, std::vector<uint8_t> frame);
+    void deliver(const Event& event);
+    void originate(size_t index);
+    void scheduleTick(uint32_t node);
+
+    const Config& config_;
+    const Topology& topology_;
+    std::mt19937 rng_;
+    std::vector<std::string> names_;
+    std::vector<std::unique_ptr<Node>> nodes_;
+    std::priority_queue<Event, std::vector<Event>, Later> queue_;
+    std::vector<std::vector<uint8_t>> frames_;
+    std::vector<uint32_t> freeSlots_;
+    uint64_t seq_ = 0;
+    Clock::time_point now_ = Clock::time_point{} + std::chrono::hours(1);
+    Clock::time_point measureFrom_;
+
+    std::unordered_map<uint32_t, size_t> messageIndex_;
+    std::vector<Clock::time_point> originated_;
+    std::vector<std::vector<bool>> reached_;
+    std::vector<double> latencies_;
+    Report report_;
+};
+
+void Simulator::transmit(uint32_t from, uint32_t to, std::vector<uint8_t> frame) {
+    MessageType type = MessageView::parse(frame).type();
+    bool data = type == MessageType::GLOBAL_MESSAGE || type == MessageType::PRIVATE_MESSAGE;
+    if (now_ >= measureFrom_) {
+        (data ? report_.dataSends : report_.controlSends)++;
+        (data ? report_.dataBytes : report_.controlBytes) += frame.size();
+    }
+
+    // Each node has one radio: frames queue behind each other for their airtime.
+    Node& sender = *nodes_[from];
+    auto airtime = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(static_cast<double>(frame.size()) * 8.0 / (config_.bandwidthKbps * 1000.0)));
+    sender.radioFree = std::max(sender.radioFree, now_) + airtime;
+
+    if (std::uniform_real_distribution<double>(0.0, 1.0)(rng_) < config_.loss) {
+        if (data && now_ >= measureFrom_) report_.lostSends++;
+        return;
+    }
+    auto jitter = std::chrono::microseconds(
+        std::uniform_int_distribution<int64_t>(0, std::max<int64_t>(0, config_.jitter.count()))(rng_));
+    push(sender.radioFree + config_.latency + jitter, EventKind::DELIVER, to, from, store(std::move(frame)));
+}
+
+void Simulator::deliver(const Event& event) {
+    std::vector<uint8_t> frame = std::move(frames_[event.slot]);
+    freeSlots_.push_back(event.slot);
+
+    Node& node = *nodes_[event.node];
+    MessageView view;
+    try {
+        view = MessageView::parse(frame);
+    } catch (const std::exception&) {
+        return;
+    }
+    if (node.policy->receive(view, event.from, now_)) {
+        auto it = messageIndex_.find(view.messageId());
+        if (it != messageIndex_.end() && !reached_[it->second][event.node]) {
+            reached_[it->second][event.node] = true;
+            report_.delivered++;
+            latencies_.push_back(std::chrono::duration<double, std::milli>(now_ - originated_[it->second]).count());
+        }
+    }
+    scheduleTick(event.node);
+}
+
+void Simulator::originate(size_t index) {
+    std::uniform_int_distribution<uint32_t> pick(0, static_cast<uint32_t>(config_.nodes - 1));
+    uint32_t origin = pick(rng_);
+    for (int tries = 0; tries < 64 && topology_.componentSize[topology_.component[origin]] < 2; ++tries) {
+        origin = pick(rng_);
+    }
+    size_t reachable = topology_.componentSize[topology_.component[origin]];
+
+    std::string destination;
+    if (config_.traffic == Traffic::UNICAST && reachable > 1) {
+        uint32_t target = origin;
+        while (target == origin || topology_.component[target] != topology_.component[origin]) {
+            target = pick(rng_);
+        }
+        destination = names_[target];
+        report_.expected++;
+    } else if (config_.traffic == Traffic::BROADCAST) {
+        report_.expected += reachable - 1;
+    }
+
+    auto msg = MessageFactory::createTextMessage("sim message " + std::to_string(index), names_[origin], "",
+                                                 destination, destination.empty());
+    msg.header.ttl = config_.ttl;
+    auto frame = msg.serialize();
+    messageIndex_[MessageView::parse(frame).messageId()] = index;
+    originated_[index] = now_;
+    nodes_[origin]->policy->originate(std::move(frame), destination, now_);
+    scheduleTick(origin);
+}
+
+void Simulator::scheduleTick(uint32_t node) {
+    Node& n = *nodes_[node];
+    Clock::time_point due = n.policy->nextDeadline();
+    if (due < n.tickAt) {
+        n.tickAt = due;
+        push(std::max(due, now_), EventKind::TICK, node);
+    }
+}
+
+Report Simulator::run() {
+    auto wallStart = std::chrono::steady_clock::now();
+    size_t baseline = residentBytes();
+
+    const auto& registry = policies();
+    auto factory = registry.find(config_.policy);
+    if (factory == registry.end()) {
+        throw std::runtime_error("unknown policy: " + config_.policy);
+    }
+    for (uint32_t i = 0; i < config_.nodes; ++i) {
+        nodes_.push_back(std::make_unique<Node>(*this, i));
+        nodes_.back()->policy = factory->second(*nodes_.back(), config_);
+    }
+    if (config_.traffic == Traffic::UNICAST && !nodes_.empty() && !nodes_.front()->policy->routesUnicast()) {
+        throw std::runtime_error("policy " + config_.policy + " does not route private messages");
+    }
+
+    // Maintenance (neighbor lists, probes) runs with a random phase so nodes do not all fire together.
+    bool maintained = false;
+    for (uint32_t i = 0; i < config_.nodes; ++i) {
+        auto interval = nodes_[i]->policy->maintenanceInterval();
+        if (interval.count() <= 0) continue;
+        maintained = true;
+        auto phase = std::chrono::milliseconds(std::uniform_int_distribution<int64_t>(0, interval.count())(rng_));
+        push(now_ + phase, EventKind::MAINTAIN, i);
+    }
+
+    measureFrom_ = now_ + (maintained ? std::chrono::duration_cast<Clock::duration>(config_.warmup) : Clock::duration(0));
+    originated_.resize(config_.messages);
+    reached_.assign(config_.messages, std::vector<bool>(config_.nodes, false));
+    for (size_t m = 0; m < config_.messages; ++m) {
+        push(measureFrom_ + config_.interval * m, EventKind::ORIGINATE, 0, 0, static_cast<uint32_t>(m));
+    }
+    Clock::time_point end = measureFrom_ + config_.interval * config_.messages + config_.drain;
+
+    while (!queue_.empty() && queue_.top().at <= end) {
+        Event event = queue_.top();
+        queue_.pop();
+        now_ = event.at;
+        report_.events++;
+        switch (event.kind) {
+        case EventKind::DELIVER:
+            deliver(event);
+            break;
+        case EventKind::TICK: {
+            Node& node = *nodes_[event.node];
+            if (node.tickAt > now_) break;
+            node.tickAt = Clock::time_point::max();
+            node.policy->tick(now_);
+            scheduleTick(event.node);
+            break;
+        }
+        case EventKind::MAINTAIN: {
+            Node& node = *nodes_[event.node];
+            node.policy->maintain(now_);
+            push(now_ + node.policy->maintenanceInterval(), EventKind::MAINTAIN, event.node);
+            scheduleTick(event.node);
+            break;
+        }
+        case EventKind::ORIGINATE:
+            originate(event.slot);
+            break;
+        }
+    }
+
+    report_.bytesPerNode = static_cast<double>(residentBytes() > baseline ? residentBytes() - baseline : 0) /
+                           static_cast<double>(config_.nodes);
+    size_t peak = peakResidentBytes();
+    report_.peakBytesPerNode = static_cast<double>(peak > baseline ? peak - baseline : 0) /
+                               static_cast<double>(config_.nodes);
+
+    std::sort(latencies_.begin(), latencies_.end());
+    report_.p50Ms = percentile(latencies_, 0.50);
+    report_.p90Ms = percentile(latencies_, 0.90);
+    report_.p99Ms = percentile(latencies_, 0.99);
+    report_.maxMs = latencies_.empty() ? 0.0 : latencies_.back();
+    report_.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    return report_;
+}
+
+}
+
+Topology buildTopology(const Config& config) {
+    Topology topology;
+    topology.adjacency.resize(config.nodes);
+    std::mt19937 rng(config.seed);
+    switch (config.topology) {
+    case TopologyKind::GEOMETRIC:
+        buildGeometric(topology, config.nodes, config.degree, rng);
+        break;
+    case TopologyKind::GRID:
+        buildGrid(topology, config.nodes, config.degree);
+        break;
+    case TopologyKind::RANDOM:
+        buildRandom(topology, config.nodes, config.degree, rng);
+        break;
+    }
+
+    size_t ends = 0;
+    for (const auto& neighbors : topology.adjacency) ends += neighbors.size();
+    topology.degree = config.nodes ? static_cast<double>(ends) / static_cast<double>(config.nodes) : 0.0;
+    labelComponents(topology);
+    return topology;
+}
+
+Report simulate(const Config& config) {
+    if (config.nodes < 2) {
+        throw std::runtime_error("need at least 2 nodes");
+    }
+    Topology topology = buildTopology(config);
+    Report report = Simulator(config, topology).run();
+    report.degree = topology.degree;
+    report.components = topology.componentSize.size();
+    return report;
+}
+
+void printReport(const Config& config, const Report& report, std::ostream& out) {
+    static const char* topologies[] = {"geometric", "grid", "random"};
+    double delivered = static_cast<double>(report.delivered);
+    out << "nodes " << config.nodes << ", " << topologies[static_cast<int>(config.topology)] << " topology, mean degree "
+        << std::fixed << std::setprecision(1) << report.degree << ", " << report.components << " component(s)" << std::endl;
+    out << "policy " << config.policy << ", " << (config.traffic == Traffic::BROADCAST ? "broadcast" : "unicast")
+        << " traffic, " << config.messages << " messages, ttl " << static_cast<int>(config.ttl) << ", loss " << config.loss * 100.0 << "%, latency "
+        << config.latency.count() / 1000.0 << " ms + up to " << config.jitter.count() / 1000.0 << " ms, "
+        << config.bandwidthKbps << " kbit/s per radio" << std::endl;
+    out << std::endl;
+    out << "delivery ratio        " << std::setprecision(2)
+        << (report.expected ? 100.0 * delivered / static_cast<double>(report.expected) : 0.0) << "% ("
+        << report.delivered << " of " << report.expected << " reachable)" << std::endl;
+    out << "latency ms            p50 " << std::setprecision(1) << report.p50Ms << "  p90 " << report.p90Ms
+        << "  p99 " << report.p99Ms << "  max " << report.maxMs << std::endl;
+    out << "sends per delivery    " << std::setprecision(2)
+        << (report.delivered ? static_cast<double>(report.dataSends) / delivered : 0.0) << " (" << report.dataSends
+        << " data sends, " << report.lostSends << " lost on air)" << std::endl;
+    double seconds = std::chrono::duration<double>(config.interval * config.messages + config.drain).count();
+    out << "control sends         " << report.controlSends << " (" << std::setprecision(1)
+        << static_cast<double>(report.controlBytes) / 1024.0 << " KiB, "
+        << static_cast<double>(report.controlBytes) * 8.0 / 1000.0 / seconds / static_cast<double>(config.nodes)
+        << " kbit/s per node; data " << static_cast<double>(report.dataBytes) * 8.0 / 1000.0 / seconds / static_cast<double>(config.nodes)
+        << " kbit/s per node)" << std::endl;
+    out << "memory per node       " << std::setprecision(1) << report.bytesPerNode / 1024.0 << " KiB resident, "
+        << report.peakBytesPerNode / 1024.0 << " KiB peak" << std::endl;
+    out << "simulated in          " << std::setprecision(2) << report.wallSeconds << " s wall, " << report.events
+        << " events" << std::endl;
+}
+
+} // namespace sim
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "core/mesh/MessageRouter.h"
+#include "core/protocol/MessageView.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace sim {
+
+using Clock = echo::MessageRouter::Clock;
+
+enum class TopologyKind {
+    GEOMETRIC,
+    GRID,
+    RANDOM
+};
+
+enum class Traffic {
+    BROADCAST,
+    UNICAST
+};
+
+struct Config {
+    size_t nodes = 1000;
+    TopologyKind topology = TopologyKind::GEOMETRIC;
+    double degree = 10.0;
+    double loss = 0.02;
+    std::chrono::microseconds latency{5000};
+    std::chrono::microseconds jitter{2000};
+    double bandwidthKbps = 250.0;
+    size_t messages = 50;
+    uint8_t ttl = 7;
+    std::chrono::milliseconds interval{200};
+    Traffic traffic = Traffic::BROADCAST;
+    std::string policy = "gossip";
+    size_t dedupCapacity = 1024;
+    std::chrono::seconds warmup{25};
+    std::chrono::seconds drain{10};
+    uint32_t seed = 1;
+};
+
+struct Topology {
+    std::vector<std::vector<uint32_t>> adjacency;
+    std::vector<uint32_t> component;
+    std::vector<size_t> componentSize;
+    double degree = 0.0;
+};
+
+struct Report {
+    size_t expected = 0;
+    size_t delivered = 0;
+    double p50Ms = 0.0;
+    double p90Ms = 0.0;
+    double p99Ms = 0.0;
+    double maxMs = 0.0;
+    uint64_t dataSends = 0;
+    uint64_t controlSends = 0;
+    uint64_t dataBytes = 0;
+    uint64_t controlBytes = 0;
+    uint64_t lostSends = 0;
+    uint64_t events = 0;
+    size_t components = 0;
+    double degree = 0.0;
+    double bytesPerNode = 0.0;
+    double peakBytesPerNode = 0.0;
+    double wallSeconds = 0.0;
+};
+
+// What a node's relay policy may see and do; implemented by the simulator.
+class NodeContext {
+public:
+    virtual ~NodeContext() = default;
+    virtual uint32_t id() const = 0;
+    virtual const std::string& name(uint32_t node) const = 0;
+    virtual const std::vector<uint32_t>& neighbors() const = 0;
+    virtual void transmit(uint32_t neighbor, std::vector<uint8_t> frame) = 0;
+};
+
+// Relay and duplicate suppression for one virtual node. receive() returns true when the
+// frame is a data message seen by this node's application for the first time.
+class RelayPolicy {
+public:
+    virtual ~RelayPolicy() = default;
+    virtual void originate(std::vector<uint8_t> frame, const std::string& destination, Clock::time_point now) = 0;
+    virtual bool receive(const echo::MessageView& msg, uint32_t from, Clock::time_point now) = 0;
+    virtual void tick(Clock::time_point now) = 0;
+    virtual Clock::time_point nextDeadline() const = 0;
+    virtual void maintain(Clock::time_point) {}
+    virtual std::chrono::milliseconds maintenanceInterval() const { return std::chrono::milliseconds(0); }
+    virtual bool routesUnicast() const { return false; }
+};
+
+using PolicyFactory = std::function<std::unique_ptr<RelayPolicy>(NodeContext& node, const Config& config)>;
+
+const std::map<std::string, PolicyFactory>& policies();
+
+Topology buildTopology(const Config& config);
+Report simulate(const Config& config);
+void printReport(const Config& config, const Report& report, std::ostream& out);
+
+} // namespace sim
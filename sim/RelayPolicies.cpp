@@ -0,0 +1,141 @@
+#include "MeshSim.h"
+#include "core/mesh/MeshNetwork.h"
+#include "core/protocol/DuplicateFilter.h"
+#include "core/protocol/MessageTypes.h"
+#include <string>
+
+using namespace echo;
+
+namespace sim {
+
+namespace {
+
+uint32_t linkIndex(const std::string& link) {
+    return static_cast<uint32_t>(std::stoul(link));
+}
+
+// Drives the production MessageRouter, optionally with MeshNetwork relay selection and routing.
+class RouterPolicy : public RelayPolicy {
+public:
+    RouterPolicy(NodeContext& node, const Config& config, bool gossip, bool mesh)
+        : node_(node), name_(node.name(node.id())), seen_(config.dedupCapacity) {
+        router_ = std::make_unique<MessageRouter>(
+            [this](const std::string& link, std::vector<uint8_t> frame) { node_.transmit(linkIndex(link), std::move(frame)); },
+            [this]() { return links(); },
+            config.seed ^ (node.id() * 2654435761u));
+        GossipConfig gossipConfig;
+        gossipConfig.enabled = gossip;
+        router_->setGossip(gossipConfig);
+
+        if (!mesh) return;
+        mesh_ = std::make_unique<MeshNetwork>(
+            [this](const NextHop& hop, std::vector<uint8_t> frame) { node_.transmit(linkIndex(hop.link), std::move(frame)); },
+            [this]() {
+                std::vector<MeshNeighbor> neighbors;
+                neighbors.reserve(node_.neighbors().size());
+                for (uint32_t n : node_.neighbors()) {
+                    neighbors.push_back(MeshNeighbor{node_.name(n), node_.name(n)});
+                }
+                return neighbors;
+            });
+        mesh_->setLocalName(name_);
+        mesh_->setMaxHops(config.ttl);
+        MeshNetwork* network = mesh_.get();
+        router_->setRoleCallback([network](const std::string& ingress) { return network->roleFor(ingress); });
+        router_->setUnicast(
+            [network](const std::string& destination, NextHop& hop) { return network->nextHop(destination, hop); },
+            [this](const NextHop& hop, std::vector<uint8_t> frame) { node_.transmit(linkIndex(hop.link), std::move(frame)); });
+    }
+
+    void originate(std::vector<uint8_t> frame, const std::string& destination, Clock::time_point now) override {
+        if (!destination.empty()) {
+            router_->sendUnicast(std::move(frame), destination);
+            return;
+        }
+        MessageView view = MessageView::parse(frame);
+        seen_.markSeen(DuplicateFilter::senderKey(view), view.messageId(), now);
+        for (uint32_t n : node_.neighbors()) {
+            node_.transmit(n, frame);
+        }
+    }
+
+    bool receive(const MessageView& msg, uint32_t from, Clock::time_point now) override {
+        const std::string& ingress = node_.name(from);
+        std::vector<uint8_t> expanded;
+        switch (msg.type()) {
+        case MessageType::NEIGHBOR_LIST:
+            if (mesh_) mesh_->handleNeighborList(NeighborListMessage::deserialize(msg.decodedPayload(expanded)), ingress, now);
+            return false;
+        case MessageType::PING:
+            if (mesh_) mesh_->handlePing(ProbeMessage::deserialize(msg.decodedPayload(expanded)), ingress);
+            return false;
+        case MessageType::PONG:
+            if (mesh_) mesh_->handlePong(ProbeMessage::deserialize(msg.decodedPayload(expanded)), ingress, now);
+            return false;
+        case MessageType::PRIVATE_MESSAGE: {
+            auto text = TextMessageView::parse(msg, msg.decodedPayload(expanded));
+            if (text.recipientUsername() == name_) {
+                return seen_.markSeen(DuplicateFilter::senderKey(msg), msg.messageId(), now);
+            }
+            router_->forwardUnicast(msg, std::string(text.recipientUsername()));
+            return false;
+        }
+        default:
+            if (!seen_.markSeen(DuplicateFilter::senderKey(msg), msg.messageId(), now)) {
+                router_->overheard(msg, ingress);
+                return false;
+            }
+            router_->relay(msg, ingress, now);
+            return true;
+        }
+    }
+
+    void tick(Clock::time_point now) override { router_->tick(now); }
+    Clock::time_point nextDeadline() const override { return router_->nextDeadline(); }
+
+    void maintain(Clock::time_point now) override {
+        if (mesh_) mesh_->tick(now);
+    }
+
+    // Same cadence as the MeshNetwork worker thread.
+    std::chrono::milliseconds maintenanceInterval() const override {
+        return mesh_ ? std::chrono::milliseconds(1000) : std::chrono::milliseconds(0);
+    }
+
+    bool routesUnicast() const override { return mesh_ != nullptr; }
+
+private:
+    std::vector<RelayLink> links() const {
+        std::vector<RelayLink> out;
+        out.reserve(node_.neighbors().size());
+        for (uint32_t n : node_.neighbors()) {
+            out.push_back(RelayLink{node_.name(n), 1});
+        }
+        return out;
+    }
+
+    NodeContext& node_;
+    std::string name_;
+    DuplicateFilter seen_;
+    std::unique_ptr<MessageRouter> router_;
+    std::unique_ptr<MeshNetwork> mesh_;
+};
+
+}
+
+const std::map<std::string, PolicyFactory>& policies() {
+    static const std::map<std::string, PolicyFactory> registry = {
+        {"flood", [](NodeContext& node, const Config& config) -> std::unique_ptr<RelayPolicy> {
+             return std::make_unique<RouterPolicy>(node, config, false, false);
+         }},
+        {"gossip", [](NodeContext& node, const Config& config) -> std::unique_ptr<RelayPolicy> {
+             return std::make_unique<RouterPolicy>(node, config, true, false);
+         }},
+        {"mpr", [](NodeContext& node, const Config& config) -> std::unique_ptr<RelayPolicy> {
+             return std::make_unique<RouterPolicy>(node, config, true, true);
+         }},
+    };
+    return registry;
+}
+
+} // namespace sim
@@ -0,0 +1,99 @@
+#include "MeshSim.h"
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [options]" << std::endl
+              << "  --nodes N            virtual nodes (default 1000)" << std::endl
+              << "  --topology KIND      geometric | grid | random (default geometric)" << std::endl
+              << "  --degree D           target mean neighbor count (default 10)" << std::endl
+              << "  --policy NAME        flood | gossip | mpr (default gossip)" << std::endl
+              << "  --traffic KIND       broadcast | unicast (default broadcast; unicast needs mpr)" << std::endl
+              << "  --messages M         messages to originate (default 50)" << std::endl
+              << "  --ttl HOPS           hop limit of originated messages (default 7, as sent by echo)" << std::endl
+              << "  --interval MS        time between messages (default 200)" << std::endl
+              << "  --loss P             per-transmission loss, 0..1 (default 0.02)" << std::endl
+              << "  --latency MS         propagation latency (default 5)" << std::endl
+              << "  --jitter MS          extra random latency, up to (default 2)" << std::endl
+              << "  --bandwidth KBPS     radio bit rate per node (default 250)" << std::endl
+              << "  --dedup N            duplicate filter capacity per node (default 1024)" << std::endl
+              << "  --warmup S           neighbor discovery time before traffic, mpr only (default 25)" << std::endl
+              << "  --seed S             random seed (default 1)" << std::endl;
+}
+
+std::chrono::microseconds millis(const std::string& value) {
+    return std::chrono::microseconds(static_cast<int64_t>(std::stod(value) * 1000.0));
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    sim::Config config;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string option = argv[i];
+            if (option == "--help" || option == "-h") {
+                printUsage(argv[0]);
+                return 0;
+            }
+            if (i + 1 >= argc) {
+                throw std::invalid_argument("missing value for " + option);
+            }
+            std::string value = argv[++i];
+            if (option == "--nodes") {
+                config.nodes = std::stoul(value);
+            } else if (option == "--topology") {
+                if (value == "geometric") config.topology = sim::TopologyKind::GEOMETRIC;
+                else if (value == "grid") config.topology = sim::TopologyKind::GRID;
+                else if (value == "random") config.topology = sim::TopologyKind::RANDOM;
+                else throw std::invalid_argument("unknown topology: " + value);
+            } else if (option == "--degree") {
+                config.degree = std::stod(value);
+            } else if (option == "--policy") {
+                config.policy = value;
+            } else if (option == "--traffic") {
+                if (value == "broadcast") config.traffic = sim::Traffic::BROADCAST;
+                else if (value == "unicast") config.traffic = sim::Traffic::UNICAST;
+                else throw std::invalid_argument("unknown traffic: " + value);
+            } else if (option == "--messages") {
+                config.messages = std::stoul(value);
+            } else if (option == "--ttl") {
+                config.ttl = static_cast<uint8_t>(std::min(255ul, std::stoul(value)));
+            } else if (option == "--interval") {
+                config.interval = std::chrono::duration_cast<std::chrono::milliseconds>(millis(value));
+            } else if (option == "--loss") {
+                config.loss = std::stod(value);
+            } else if (option == "--latency") {
+                config.latency = millis(value);
+            } else if (option == "--jitter") {
+                config.jitter = millis(value);
+            } else if (option == "--bandwidth") {
+                config.bandwidthKbps = std::stod(value);
+            } else if (option == "--dedup") {
+                config.dedupCapacity = std::stoul(value);
+            } else if (option == "--warmup") {
+                config.warmup = std::chrono::seconds(std::stol(value));
+            } else if (option == "--seed") {
+                config.seed = static_cast<uint32_t>(std::stoul(value));
+            } else {
+                throw std::invalid_argument("unknown option: " + option);
+            }
+        }
+        if (config.bandwidthKbps <= 0.0 || config.loss < 0.0 || config.loss > 1.0) {
+            throw std::invalid_argument("bandwidth must be positive and loss within 0..1");
+        }
+
+        sim::Report report = sim::simulate(config);
+        sim::printReport(config, report, std::cout);
+    } catch (const std::exception& e) {
+        std::cerr << "echo_meshsim: " << e.what() << std::endl;
+        printUsage(argv[0]);
+        return 1;
+    }
+    return 0;
+}
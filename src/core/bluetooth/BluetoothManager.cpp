@@ -9,8 +9,16 @@
 namespace echo {
 
 BluetoothManager::BluetoothManager() 
-    : isScanning_(false), isAdvertising_(false) {
+    : isScanning_(false), isAdvertising_(false),
+      pacer_([this](const std::string& address, const std::vector<uint8_t>& data) {
+          return sendData(address, data);
+      }, PacerConfig{}),
+      batcher_([this](const std::string& address, const std::vector<uint8_t>& data) {
+          return pacer_.enqueue(address, data);
+      }) {
     initializeAdapter();
+    pacer_.start();
+    batcher_.start();
     
 #ifdef _WIN32
     windowsAdvertiser_ = std::make_unique<WindowsAdvertiser>();
@@ -24,6 +32,8 @@ BluetoothManager::BluetoothManager()
 }
 
 BluetoothManager::~BluetoothManager() {
+    batcher_.stop();
+    pacer_.stop();
     stopScanning();
     stopBitChatAdvertising();
     
@@ -392,6 +402,7 @@ void BluetoothManager::onPeripheralConnected(SimpleBLE::Peripheral peripheral) {
 }
 
 void BluetoothManager::onPeripheralDisconnected(SimpleBLE::Peripheral peripheral) {
+    reassembler_.clear(peripheral.address());
     if (deviceDisconnectedCallback_) {
         deviceDisconnectedCallback_(peripheral.address());
     }
@@ -418,9 +429,7 @@ void BluetoothManager::prepareMessagingForPeripheral(SimpleBLE::Peripheral& peri
                     if (characteristic.can_notify()) {
                         peripheral.notify(service.uuid(), characteristic.uuid(), [this, addr = peripheral.address()](SimpleBLE::ByteArray payload) {
                             std::vector<uint8_t> data(payload.begin(), payload.end());
-                            if (dataReceivedCallback_) {
-                                dataReceivedCallback_(addr, data);
-                            }
+                            deliverIncoming(addr, data);
                         });
                     }
                 }
@@ -506,14 +515,20 @@ void BluetoothManager::startLinuxInbox() {
         }
         if (rc < 0) { close(s); inboxRunning_ = false; return; }
         inboxSocket_ = s;
-        std::vector<uint8_t> buf(512);
+        uint8_t lenbuf[2];
+        std::string source;
+        std::vector<uint8_t> data;
         while (inboxRunning_) {
-            ssize_t n = recv(s, buf.data(), buf.size(), 0);
-            if (n <= 0) break;
-            std::vector<uint8_t> data(buf.begin(), buf.begin()+n);
-            if (dataReceivedCallback_) {
-                dataReceivedCallback_("local", data);
-            }
+            if (recv(s, lenbuf, 2, MSG_WAITALL) != 2) break;
+            uint16_t alen = (static_cast<uint16_t>(lenbuf[0]) << 8) | lenbuf[1];
+            source.resize(alen);
+            if (alen > 0 && recv(s, &source[0], alen, MSG_WAITALL) != (ssize_t)alen) break;
+            if (recv(s, lenbuf, 2, MSG_WAITALL) != 2) break;
+            uint16_t len = (static_cast<uint16_t>(lenbuf[0]) << 8) | lenbuf[1];
+            data.resize(len);
+            if (len > 0 && recv(s, data.data(), len, MSG_WAITALL) != (ssize_t)len) break;
+            if (source.empty()) source = "local";
+            deliverIncoming(source, data);
         }
         close(s);
         inboxSocket_ = -1; inboxRunning_ = false;
@@ -582,6 +597,23 @@ bool BluetoothManager::sendData(const std::string& address, const std::vector<ui
         }
     }
 
+    auto writeFragments = [&](const std::string& serviceUuid, const std::string& charUuid) {
+        auto fragments = fragmenter_.split(data, attPayloadSize(*peripheral));
+        if (fragments.empty()) {
+            std::cerr << "[SEND FAILED] Frame of " << data.size() << " bytes is too large to fragment" << std::endl;
+            return false;
+        }
+        for (const auto& fragment : fragments) {
+            peripheral->write_request(serviceUuid, charUuid, fragment);
+        }
+        std::cout << "[SENT] " << data.size() << " bytes to " << address;
+        if (fragments.size() > 1) {
+            std::cout << " in " << fragments.size() << " fragments";
+        }
+        std::cout << std::endl;
+        return true;
+    };
+
     try {
         auto toUpper = [](std::string s){ std::transform(s.begin(), s.end(), s.begin(), ::toupper); return s; };
         auto services = peripheral->services();
@@ -591,17 +623,13 @@ bool BluetoothManager::sendData(const std::string& address, const std::vector<ui
                 for (auto& characteristic : characteristics) {
                     std::string cu = toUpper(characteristic.uuid());
                     if (cu == toUpper(BITCHAT_TX_CHAR_UUID) && characteristic.can_write_request()) {
-                        peripheral->write_request(service.uuid(), characteristic.uuid(), data);
-                        std::cout << "[SENT] " << data.size() << " bytes to " << address << std::endl;
-                        return true;
+                        return writeFragments(service.uuid(), characteristic.uuid());
                     }
                 }
                 for (auto& characteristic : characteristics) {
                     std::string cu = toUpper(characteristic.uuid());
                     if (cu == toUpper(BITCHAT_RX_CHAR_UUID) && characteristic.can_write_request()) {
-                        peripheral->write_request(service.uuid(), characteristic.uuid(), data);
-                        std::cout << "[SENT] " << data.size() << " bytes to " << address << std::endl;
-                        return true;
+                        return writeFragments(service.uuid(), characteristic.uuid());
                     }
                 }
             }
@@ -623,6 +651,52 @@ bool BluetoothManager::sendData(const std::string& address, const std::vector<ui
     return false;
 }
 
+size_t BluetoothManager::attPayloadSize(SimpleBLE::Peripheral& peripheral) const {
+    try {
+        size_t mtu = peripheral.mtu();
+        if (mtu > 3) {
+            return std::max(mtu - 3, Fragmenter::MIN_MTU);
+        }
+    } catch (const std::exception&) {
+    }
+    return Fragmenter::MIN_MTU;
+}
+
+size_t BluetoothManager::getLinkMtu() {
+    std::lock_guard<std::mutex> lock(devicesMutex_);
+    size_t smallest = 0;
+    for (auto& peripheral : connectedPeripherals_) {
+        size_t size = attPayloadSize(peripheral);
+        if (smallest == 0 || size < smallest) smallest = size;
+    }
+    return smallest == 0 ? Fragmenter::MIN_MTU : smallest;
+}
+
+void BluetoothManager::deliverIncoming(const std::string& address, const std::vector<uint8_t>& data) {
+    if (!Fragmenter::isFragment(data)) {
+        if (dataReceivedCallback_) {
+            dataReceivedCallback_(address, data);
+        }
+        return;
+    }
+
+    std::vector<uint8_t> frame;
+    if (reassembler_.accept(address, data, frame) && dataReceivedCallback_) {
+        dataReceivedCallback_(address, frame);
+    }
+}
+
+void BluetoothManager::queueData(const std::string& address, std::vector<uint8_t> data) {
+    batcher_.enqueue(address, std::move(data));
+}
+
+FragmentationStats BluetoothManager::getFragmentationStats() const {
+    FragmentationStats stats = reassembler_.stats();
+    stats.framesSplit = fragmenter_.framesSplit();
+    stats.fragmentsSent = fragmenter_.fragmentsSent();
+    return stats;
+}
+
 void BluetoothManager::debugPrintServices(const std::string& address) {
     std::lock_guard<std::mutex> lock(devicesMutex_);
     auto* peripheral = findConnectedPeripheral(address);
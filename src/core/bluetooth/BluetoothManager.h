@@ -1,6 +1,9 @@
 #pragma once
 
 #include <simpleble/SimpleBLE.h>
+#include "core/protocol/Fragmentation.h"
+#include "core/protocol/FrameBatch.h"
+#include "core/protocol/LinkPacer.h"
 #include <vector>
 #include <memory>
 #include <functional>
@@ -74,6 +77,13 @@ public:
     
     bool sendData(const std::string& address, const std::vector<uint8_t>& data);
     void debugPrintServices(const std::string& address);
+    void queueData(const std::string& address, std::vector<uint8_t> data);
+    size_t getLinkMtu();
+    FragmentationStats getFragmentationStats() const;
+    BatchStats getBatchStats() const { return batcher_.stats(); }
+    PacerStats getPacerStats() const { return pacer_.stats(); }
+    std::vector<LinkRate> getLinkRates() const { return pacer_.links(); }
+    double getConfiguredRate() const { return pacer_.config().bytesPerSecond; }
     
 private:
     std::shared_ptr<SimpleBLE::Adapter> adapter_;
@@ -90,6 +100,11 @@ private:
     
     std::atomic<bool> isScanning_;
     std::atomic<bool> isAdvertising_;
+
+    Fragmenter fragmenter_;
+    Reassembler reassembler_;
+    LinkPacer pacer_;
+    FrameBatcher batcher_;
     
 #ifdef _WIN32
     std::unique_ptr<WindowsAdvertiser> windowsAdvertiser_;
@@ -118,6 +133,8 @@ private:
     bool parseEchoDevice(const SimpleBLE::Peripheral& peripheral, DiscoveredDevice& device);
     SimpleBLE::Peripheral* findConnectedPeripheral(const std::string& address);
     void prepareMessagingForPeripheral(SimpleBLE::Peripheral& peripheral);
+    void deliverIncoming(const std::string& address, const std::vector<uint8_t>& data);
+    size_t attPayloadSize(SimpleBLE::Peripheral& peripheral) const;
     bool ensureAdapterReady();
 };
 
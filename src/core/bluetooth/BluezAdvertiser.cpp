@@ -137,7 +137,9 @@ class TxCharacteristic(dbus.service.Object):
         dbus.service.Object.__init__(self,bus,CHRC_TX_PATH)
     @dbus.service.method(GATT_CHRC_IFACE,in_signature='aya{sv}',out_signature='')
     def WriteValue(self,value,options):
-        try:self.socket_sender(bytes(value))
+        try:
+            d=str(options.get('device',''));a=d.split('dev_')[-1].replace('_',':').encode() if 'dev_' in d else b''
+            self.socket_sender(a,bytes(value))
         except:pass
     @dbus.service.method(GATT_CHRC_IFACE,in_signature='a{sv}',out_signature='ay')
     def ReadValue(self,options):return dbus.Array([],signature='y')
@@ -152,9 +154,9 @@ def main():
         except: pass
     server=socket.socket(socket.AF_UNIX,socket.SOCK_STREAM);server.bind(SOCK_PATH);server.listen(1)
     conn=[None]
-    def socket_sender(data):
+    def socket_sender(addr,data):
         if conn[0]:
-            try:conn[0].sendall(data)
+            try:conn[0].sendall(len(addr).to_bytes(2,'big')+addr+len(data).to_bytes(2,'big')+data)
             except:pass
     def accept_conn():
         try:c,_=server.accept();conn[0]=c
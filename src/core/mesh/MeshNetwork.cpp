@@ -0,0 +1,639 @@
+#include "MeshNetwork.h"
+#include <algorithm>
+#include <cstdlib>
+#include <iterator>
+
+namespace echo {
+
+namespace {
+
+constexpr std::chrono::seconds MIN_HELLO_GAP{1};
+constexpr double RSSI_ALPHA = 0.25;
+constexpr double RTT_ALPHA = 0.125;
+constexpr double LOSS_ALPHA = 0.2;
+constexpr double STRONG_RSSI = -60.0;
+constexpr double WEAK_RSSI = -95.0;
+constexpr double RTT_SCALE_MS = 200.0;
+
+}
+
+MeshNetwork::MeshNetwork(SendCallback send, NeighborsCallback neighbors)
+    : send_(std::move(send)), neighbors_(std::move(neighbors)) {
+}
+
+MeshNetwork::~MeshNetwork() {
+    stop();
+}
+
+void MeshNetwork::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_) return;
+    running_ = true;
+    worker_ = std::thread([this]() { run(); });
+}
+
+void MeshNetwork::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) return;
+        running_ = false;
+    }
+    cv_.notify_all();
+    if (worker_.joinable()) worker_.join();
+}
+
+void MeshNetwork::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (running_) {
+        cv_.wait_for(lock, MIN_HELLO_GAP, [this]() { return !running_; });
+        if (!running_) break;
+        lock.unlock();
+        tick(Clock::now());
+        lock.lock();
+    }
+}
+
+void MeshNetwork::setLocalName(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (name != localName_) {
+        // Offers recorded whether they lead back through the old name; neighbors resend them within a hello.
+        adverts_.clear();
+    }
+    localName_ = name;
+    dirty_ = true;
+    stale_ = true;
+}
+
+void MeshNetwork::setMaxHops(uint8_t hops) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    maxHops_ = std::max<uint8_t>(1, hops);
+    stale_ = true;
+}
+
+void MeshNetwork::handleNeighborList(const NeighborListMessage& msg, const std::string& link) {
+    handleNeighborList(msg, link, Clock::now());
+}
+
+void MeshNetwork::handleNeighborList(const NeighborListMessage& msg, const std::string& link, Clock::time_point now) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (msg.username.empty() || msg.username == localName_) {
+        return;
+    }
+    auto found = adverts_.find(msg.username);
+    bool fresh = found == adverts_.end();
+    Advert& advert = fresh ? adverts_[msg.username] : found->second;
+    std::set<std::string> neighbors(msg.neighbors.begin(), msg.neighbors.end());
+    // Periodic hellos mostly repeat what was heard; only a change makes the next tick recompute.
+    if (fresh || advert.link != link || advert.neighbors != neighbors) {
+        stale_ = true;
+    }
+    advert.link = link;
+    advert.neighbors = std::move(neighbors);
+    advert.relays = std::set<std::string>(msg.relays.begin(), msg.relays.end());
+    if (msg.routeMode == NeighborListMessage::ROUTES_FULL) {
+        std::map<std::string, Offer> routes;
+        for (const auto& r : msg.routes) {
+            if (r.cost != NeighborListMessage::WITHDRAWN) {
+                routes[r.destination] = Offer{r.cost, r.hops, r.nextHop == localName_};
+            }
+        }
+        if (advert.routes != routes) {
+            advert.routes = std::move(routes);
+            stale_ = true;
+        }
+    } else if (msg.routeMode == NeighborListMessage::ROUTES_DELTA) {
+        for (const auto& r : msg.routes) {
+            if (r.cost == NeighborListMessage::WITHDRAWN) {
+                if (advert.routes.erase(r.destination)) staleRoutes_.insert(r.destination);
+                continue;
+            }
+            Offer offer{r.cost, r.hops, r.nextHop == localName_};
+            Offer& known = advert.routes[r.destination];
+            if (known != offer) {
+                known = offer;
+                staleRoutes_.insert(r.destination);
+            }
+        }
+    }
+    advert.heard = now;
+    auto it = links_.find(LinkKey(msg.username, link));
+    if (it != links_.end()) {
+        it->second.heard = now;
+    }
+    stats_.neighborListsReceived++;
+}
+
+void MeshNetwork::handlePing(const ProbeMessage& msg, const std::string& link) {
+    std::vector<uint8_t> frame;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (msg.username.empty() || localName_.empty() || msg.username == localName_) {
+            return;
+        }
+        ProbeMessage pong;
+        pong.probeId = msg.probeId;
+        pong.username = localName_;
+        frame = MessageFactory::createPongMessage(pong).serialize();
+    }
+    send_(NextHop{msg.username, link}, std::move(frame));
+}
+
+void MeshNetwork::handlePong(const ProbeMessage& msg, const std::string& link) {
+    handlePong(msg, link, Clock::now());
+}
+
+void MeshNetwork::handlePong(const ProbeMessage& msg, const std::string&, Clock::time_point now) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto probe = probes_.find(msg.probeId);
+    if (probe == probes_.end() || probe->second.name != msg.username) {
+        return;
+    }
+    auto it = links_.find(LinkKey(probe->second.name, probe->second.link));
+    if (it != links_.end()) {
+        LinkQuality& q = it->second.quality;
+        uint16_t cost = linkCost(q);
+        double rtt = std::chrono::duration<double, std::milli>(now - probe->second.sent).count();
+        q.rttMs = q.hasRtt ? q.rttMs + RTT_ALPHA * (rtt - q.rttMs) : rtt;
+        q.hasRtt = true;
+        sampleLoss(it->second, 0.0);
+        if (linkCost(q) != cost) stale_ = true;
+        it->second.heard = now;
+    }
+    probes_.erase(probe);
+    stats_.probesAnswered++;
+}
+
+void MeshNetwork::sampleLoss(Link& link, double lost) {
+    link.quality.loss += LOSS_ALPHA * (lost - link.quality.loss);
+}
+
+uint16_t MeshNetwork::linkCost(const LinkQuality& quality) {
+    double etx = 1.0 / std::max(0.1, 1.0 - quality.loss);
+    double signal = 1.0;
+    if (quality.hasRssi) {
+        signal += 2.0 * std::min(1.0, std::max(0.0, (STRONG_RSSI - quality.rssi) / (STRONG_RSSI - WEAK_RSSI)));
+    }
+    double latency = quality.hasRtt ? 1.0 + quality.rttMs / RTT_SCALE_MS : 1.0;
+    double cost = 100.0 * etx * signal * latency;
+    return static_cast<uint16_t>(std::min<double>(MAX_COST, std::max(1.0, cost)));
+}
+
+std::set<std::string> MeshNetwork::selectRelays(const std::set<std::string>& oneHop,
+                                                const std::map<std::string, std::set<std::string>>& reach) {
+    std::set<std::string> uncovered;
+    for (const auto& kv : reach) {
+        if (oneHop.count(kv.first)) {
+            uncovered.insert(kv.second.begin(), kv.second.end());
+        }
+    }
+
+    std::set<std::string> selected;
+    auto take = [&](const std::string& relay) {
+        selected.insert(relay);
+        for (const auto& node : reach.at(relay)) {
+            uncovered.erase(node);
+        }
+    };
+
+    for (const auto& node : std::set<std::string>(uncovered)) {
+        if (!uncovered.count(node)) continue;
+        const std::string* only = nullptr;
+        size_t covering = 0;
+        for (const auto& kv : reach) {
+            if (oneHop.count(kv.first) && kv.second.count(node)) {
+                only = &kv.first;
+                covering++;
+            }
+        }
+        if (covering == 1) {
+            take(*only);
+        }
+    }
+
+    while (!uncovered.empty()) {
+        const std::string* best = nullptr;
+        size_t bestCover = 0;
+        for (const auto& kv : reach) {
+            if (!oneHop.count(kv.first) || selected.count(kv.first)) continue;
+            size_t cover = 0;
+            for (const auto& node : kv.second) {
+                cover += uncovered.count(node);
+            }
+            if (cover > bestCover) {
+                best = &kv.first;
+                bestCover = cover;
+            }
+        }
+        if (!best) break;
+        take(*best);
+    }
+    return selected;
+}
+
+void MeshNetwork::refreshLocked(Clock::time_point now) {
+    for (auto it = adverts_.begin(); it != adverts_.end();) {
+        if (now - it->second.heard > NEIGHBOR_HOLD) {
+            it = adverts_.erase(it);
+            stale_ = true;
+        } else {
+            ++it;
+        }
+    }
+    if (!stale_) {
+        if (!staleRoutes_.empty()) {
+            rerouteLocked();
+        }
+        return;
+    }
+    stale_ = false;
+
+    std::set<std::string> oneHop;
+    for (const auto& n : direct_) {
+        if (!n.name.empty() && n.name != localName_) {
+            oneHop.insert(n.name);
+        }
+    }
+
+    std::map<std::string, std::set<std::string>> reach;
+    std::set<std::string> twoHop;
+    for (const auto& name : oneHop) {
+        auto it = adverts_.find(name);
+        if (it == adverts_.end()) continue;
+        auto& covered = reach[name];
+        for (const auto& node : it->second.neighbors) {
+            if (node != localName_ && !oneHop.count(node)) {
+                covered.insert(node);
+                twoHop.insert(node);
+            }
+        }
+    }
+
+    std::set<std::string> relays = selectRelays(oneHop, reach);
+    if (relays != relays_) {
+        relays_ = std::move(relays);
+        stats_.relaySelections++;
+        dirty_ = true;
+    }
+    if (oneHop != oneHop_) {
+        oneHop_ = std::move(oneHop);
+        dirty_ = true;
+    }
+    twoHop_ = std::move(twoHop);
+    routeLocked();
+}
+
+std::map<std::string, MeshRoute> MeshNetwork::firstHopsLocked() const {
+    std::map<std::string, MeshRoute> table;
+    for (const auto& n : direct_) {
+        if (n.name.empty() || n.name == localName_) continue;
+        auto it = links_.find(LinkKey(n.name, n.link));
+        uint16_t cost = linkCost(it != links_.end() ? it->second.quality : LinkQuality{});
+        auto best = table.find(n.name);
+        if (best == table.end() || cost < best->second.cost) {
+            table[n.name] = MeshRoute{n.name, n.name, n.link, cost, 1};
+        }
+    }
+    return table;
+}
+
+bool MeshNetwork::usableLocked(const std::string& destination, const Offer& offer) const {
+    return !destination.empty() && destination != localName_ && !offer.viaUs && offer.hops < maxHops_ &&
+           offer.cost < MAX_COST;
+}
+
+void MeshNetwork::routeLocked() {
+    std::map<std::string, MeshRoute> table = firstHopsLocked();
+    const std::map<std::string, MeshRoute> firstHops = table;
+    for (const auto& kv : adverts_) {
+        auto hop = firstHops.find(kv.first);
+        if (hop == firstHops.end()) continue;
+        for (const auto& entry : kv.second.routes) {
+            const std::string& destination = entry.first;
+            const Offer& r = entry.second;
+            if (!usableLocked(destination, r)) {
+                continue;
+            }
+            uint16_t cost = static_cast<uint16_t>(std::min<uint32_t>(MAX_COST, hop->second.cost + r.cost));
+            auto it = table.find(destination);
+            if (it == table.end() || cost < it->second.cost) {
+                table[destination] = MeshRoute{destination, kv.first, hop->second.link, cost,
+                                               static_cast<uint8_t>(r.hops + 1)};
+            }
+        }
+    }
+
+    routes_ = std::move(table);
+    staleRoutes_.clear();
+    routesChanged_ = true;
+}
+
+void MeshNetwork::rerouteLocked() {
+    // Same choice as routeLocked, made only for the destinations that neighbors' deltas touched.
+    const std::map<std::string, MeshRoute> firstHops = firstHopsLocked();
+    for (const auto& destination : staleRoutes_) {
+        MeshRoute best;
+        auto direct = firstHops.find(destination);
+        bool found = direct != firstHops.end();
+        if (found) {
+            best = direct->second;
+        }
+        for (const auto& kv : adverts_) {
+            auto hop = firstHops.find(kv.first);
+            if (hop == firstHops.end()) continue;
+            auto entry = kv.second.routes.find(destination);
+            if (entry == kv.second.routes.end() || !usableLocked(destination, entry->second)) continue;
+            const Offer& r = entry->second;
+            uint16_t cost = static_cast<uint16_t>(std::min<uint32_t>(MAX_COST, hop->second.cost + r.cost));
+            if (!found || cost < best.cost) {
+                best = MeshRoute{destination, kv.first, hop->second.link, cost, static_cast<uint8_t>(r.hops + 1)};
+                found = true;
+            }
+        }
+
+        auto current = routes_.find(destination);
+        if (!found) {
+            if (current != routes_.end()) {
+                routes_.erase(current);
+                routesChanged_ = true;
+            }
+            continue;
+        }
+        if (current == routes_.end() || current->second.nextHop != best.nextHop || current->second.link != best.link ||
+            current->second.cost != best.cost || current->second.hops != best.hops) {
+            routes_[destination] = std::move(best);
+            routesChanged_ = true;
+        }
+    }
+    staleRoutes_.clear();
+}
+
+std::vector<RouteAdvert> MeshNetwork::routeDeltaLocked() {
+    std::vector<RouteAdvert> delta;
+    for (const auto& kv : routes_) {
+        const MeshRoute& route = kv.second;
+        auto it = advertised_.find(kv.first);
+        // Cost drift within half of the advertised cost is left for the next full table.
+        if (it != advertised_.end() && it->second.nextHop == route.nextHop && it->second.hops == route.hops &&
+            2 * std::abs(static_cast<int>(route.cost) - static_cast<int>(it->second.cost)) <= it->second.cost) {
+            continue;
+        }
+        RouteAdvert advert{kv.first, route.nextHop, route.cost, route.hops};
+        advertised_[kv.first] = advert;
+        delta.push_back(std::move(advert));
+    }
+    for (auto it = advertised_.begin(); it != advertised_.end();) {
+        if (routes_.count(it->first)) {
+            ++it;
+            continue;
+        }
+        delta.push_back(RouteAdvert{it->first, it->second.nextHop, NeighborListMessage::WITHDRAWN, it->second.hops});
+        it = advertised_.erase(it);
+    }
+    return delta;
+}
+
+std::vector<NeighborListMessage> MeshNetwork::helloLocked(std::vector<RouteAdvert> routes, uint8_t mode) const {
+    NeighborListMessage hello;
+    hello.username = localName_;
+    hello.neighbors.assign(oneHop_.begin(), oneHop_.end());
+    hello.relays.assign(relays_.begin(), relays_.end());
+    hello.routeMode = mode;
+
+    std::vector<NeighborListMessage> lists;
+    size_t next = 0;
+    do {
+        size_t count = std::min(NeighborListMessage::MAX_ROUTES, routes.size() - next);
+        lists.push_back(hello);
+        lists.back().routes.assign(std::make_move_iterator(routes.begin() + next),
+                                   std::make_move_iterator(routes.begin() + next + count));
+        next += count;
+        // A table longer than one list continues as deltas, so the later lists add to the first.
+        if (hello.routeMode == NeighborListMessage::ROUTES_FULL) {
+            hello.routeMode = NeighborListMessage::ROUTES_DELTA;
+        }
+    } while (next < routes.size());
+    return lists;
+}
+
+void MeshNetwork::tick(Clock::time_point now) {
+    std::vector<MeshNeighbor> neighbors = neighbors_();
+    std::vector<std::pair<NextHop, std::vector<uint8_t>>> out;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<MeshNeighbor> direct;
+        direct.reserve(neighbors.size());
+        for (auto& kv : links_) {
+            kv.second.listed = false;
+        }
+        for (auto& n : neighbors) {
+            if (n.name.empty()) {
+                direct.push_back(std::move(n));
+                continue;
+            }
+            LinkKey key(n.name, n.link);
+            auto it = links_.find(key);
+            if (it == links_.end()) {
+                it = links_.emplace(std::move(key), Link{}).first;
+            }
+            Link& link = it->second;
+            if (link.carried) {
+                link.used = now;
+                link.carried = false;
+            }
+            if (n.lastSeen != Clock::time_point{} && now - std::max(n.lastSeen, link.heard) > NEIGHBOR_HOLD) {
+                continue;
+            }
+            if (n.rssi != 0 && (n.lastSeen == Clock::time_point{} || n.lastSeen != link.rssiSeen)) {
+                LinkQuality& q = link.quality;
+                uint16_t cost = linkCost(q);
+                q.rssi = q.hasRssi ? q.rssi + RSSI_ALPHA * (n.rssi - q.rssi) : n.rssi;
+                q.hasRssi = true;
+                link.rssiSeen = n.lastSeen;
+                if (linkCost(q) != cost) stale_ = true;
+            }
+            link.listed = true;
+            direct.push_back(std::move(n));
+        }
+        for (auto it = links_.begin(); it != links_.end();) {
+            it = it->second.listed ? std::next(it) : links_.erase(it);
+        }
+        auto sameHop = [](const MeshNeighbor& a, const MeshNeighbor& b) { return a.name == b.name && a.link == b.link; };
+        if (direct.size() != direct_.size() || !std::equal(direct.begin(), direct.end(), direct_.begin(), sameHop)) {
+            stale_ = true;
+        }
+        direct_ = std::move(direct);
+
+        for (auto it = probes_.begin(); it != probes_.end();) {
+            if (now - it->second.sent < PROBE_TIMEOUT) {
+                ++it;
+                continue;
+            }
+            auto link = links_.find(LinkKey(it->second.name, it->second.link));
+            if (link != links_.end()) {
+                uint16_t cost = linkCost(link->second.quality);
+                sampleLoss(link->second, 1.0);
+                if (linkCost(link->second.quality) != cost) stale_ = true;
+            }
+            stats_.probesLost++;
+            it = probes_.erase(it);
+        }
+
+        refreshLocked(now);
+        if (localName_.empty() || direct_.empty()) {
+            return;
+        }
+
+        // Links that carried private messages recently are probed often; idle ones only keep a rough cost.
+        for (auto& kv : links_) {
+            Link& link = kv.second;
+            auto interval = now - link.used < ACTIVE_LINK ? PROBE_INTERVAL : IDLE_PROBE_INTERVAL;
+            if (now - link.probed < interval) {
+                continue;
+            }
+            ProbeMessage ping;
+            ping.probeId = nextProbe_++;
+            ping.username = localName_;
+            probes_[ping.probeId] = Probe{kv.first.first, kv.first.second, now};
+            out.emplace_back(NextHop{kv.first.first, kv.first.second},
+                             MessageFactory::createPingMessage(ping).serialize());
+            link.probed = now;
+            stats_.probesSent++;
+        }
+
+        // Route changes go out as deltas at most once per gap. A neighbor gets the whole table on its
+        // own when it first appears, and again every refresh period in case it missed a delta.
+        std::vector<RouteAdvert> delta;
+        std::vector<NextHop> tables;
+        for (auto it = tableSent_.begin(); it != tableSent_.end();) {
+            it = oneHop_.count(it->first) ? std::next(it) : tableSent_.erase(it);
+        }
+        if (now - lastRoutes_ >= ROUTE_UPDATE_GAP) {
+            // The delta only differs from the last one when the routes were recomputed since.
+            if (routesChanged_) {
+                delta = routeDeltaLocked();
+                routesChanged_ = false;
+            }
+            bool refreshed = false;
+            for (const auto& n : direct_) {
+                if (!oneHop_.count(n.name)) continue;
+                auto sent = tableSent_.find(n.name);
+                if (sent == tableSent_.end()) {
+                    tableSent_[n.name] = now;
+                    if (!advertised_.empty()) tables.push_back(NextHop{n.name, n.link});
+                } else if (!refreshed && now - sent->second >= ROUTE_REFRESH) {
+                    sent->second = now;
+                    tables.push_back(NextHop{n.name, n.link});
+                    refreshed = true;
+                }
+            }
+            if (!delta.empty() || !tables.empty()) {
+                lastRoutes_ = now;
+            }
+        }
+
+        bool due = now - lastHello_ >= HELLO_INTERVAL;
+        bool triggered = dirty_ && now - lastHello_ >= MIN_HELLO_GAP;
+        if (due || triggered || !delta.empty()) {
+            if (!delta.empty()) {
+                stats_.routeUpdatesSent++;
+                stats_.routesAdvertised += delta.size();
+            }
+            uint8_t mode = delta.empty() ? NeighborListMessage::ROUTES_NONE : NeighborListMessage::ROUTES_DELTA;
+            for (const auto& list : helloLocked(std::move(delta), mode)) {
+                std::vector<uint8_t> frame = MessageFactory::createNeighborListMessage(list).serialize();
+                std::vector<std::string> sent;
+                for (const auto& n : direct_) {
+                    if (std::find(sent.begin(), sent.end(), n.link) == sent.end()) {
+                        sent.push_back(n.link);
+                        out.emplace_back(NextHop{"", n.link}, frame);
+                    }
+                }
+            }
+            lastHello_ = now;
+            dirty_ = false;
+            stats_.neighborListsSent++;
+        }
+
+        if (!tables.empty()) {
+            std::vector<RouteAdvert> table;
+            table.reserve(advertised_.size());
+            for (const auto& kv : advertised_) {
+                table.push_back(kv.second);
+            }
+            for (const auto& hop : tables) {
+                for (const auto& list : helloLocked(table, NeighborListMessage::ROUTES_FULL)) {
+                    out.emplace_back(hop, MessageFactory::createNeighborListMessage(list).serialize());
+                }
+                stats_.routeTablesSent++;
+                stats_.routesAdvertised += table.size();
+            }
+        }
+    }
+    for (auto& item : out) {
+        send_(item.first, std::move(item.second));
+    }
+}
+
+RelayRole MeshNetwork::roleFor(const std::string& link) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& kv : adverts_) {
+        if (kv.second.link == link && kv.second.relays.count(localName_)) {
+            return RelayRole::RELAY;
+        }
+    }
+    bool any = false;
+    for (const auto& n : direct_) {
+        if (n.link != link) continue;
+        if (!adverts_.count(n.name)) {
+            return RelayRole::UNKNOWN;
+        }
+        any = true;
+    }
+    return any ? RelayRole::NOT_RELAY : RelayRole::UNKNOWN;
+}
+
+std::vector<std::string> MeshNetwork::relays() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return std::vector<std::string>(relays_.begin(), relays_.end());
+}
+
+bool MeshNetwork::nextHop(const std::string& destination, NextHop& hop) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = routes_.find(destination);
+    if (it == routes_.end()) {
+        return false;
+    }
+    hop.name = it->second.nextHop;
+    hop.link = it->second.link;
+    auto link = links_.find(LinkKey(hop.name, hop.link));
+    if (link != links_.end()) {
+        link->second.carried = true;
+    }
+    return true;
+}
+
+std::vector<MeshRoute> MeshNetwork::routes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<MeshRoute> out;
+    out.reserve(routes_.size());
+    for (const auto& kv : routes_) {
+        out.push_back(kv.second);
+    }
+    return out;
+}
+
+MeshStats MeshNetwork::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    MeshStats s = stats_;
+    s.oneHop = oneHop_.size();
+    s.twoHop = twoHop_.size();
+    s.relays = relays_.size();
+    s.routes = routes_.size();
+    s.selectors = 0;
+    for (const auto& kv : adverts_) {
+        s.selectors += kv.second.relays.count(localName_);
+    }
+    return s;
+}
+
+} // namespace echo
@@ -0,0 +1,184 @@
+#pragma once
+
+#include "MessageRouter.h"
+#include "core/protocol/MessageTypes.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace echo {
+
+struct MeshNeighbor {
+    std::string name;
+    std::string link;
+    int16_t rssi = 0;
+    std::chrono::steady_clock::time_point lastSeen{};
+};
+
+struct LinkQuality {
+    double rssi = 0.0;
+    double rttMs = 0.0;
+    double loss = 0.0;
+    bool hasRssi = false;
+    bool hasRtt = false;
+};
+
+struct MeshRoute {
+    std::string destination;
+    std::string nextHop;
+    std::string link;
+    uint16_t cost = 0;
+    uint8_t hops = 0;
+};
+
+struct MeshStats {
+    uint64_t neighborListsSent = 0;
+    uint64_t neighborListsReceived = 0;
+    uint64_t routeUpdatesSent = 0;
+    uint64_t routeTablesSent = 0;
+    uint64_t routesAdvertised = 0;
+    uint64_t relaySelections = 0;
+    uint64_t probesSent = 0;
+    uint64_t probesAnswered = 0;
+    uint64_t probesLost = 0;
+    size_t oneHop = 0;
+    size_t twoHop = 0;
+    size_t relays = 0;
+    size_t selectors = 0;
+    size_t routes = 0;
+};
+
+class MeshNetwork {
+public:
+    static constexpr std::chrono::seconds HELLO_INTERVAL{10};
+    static constexpr std::chrono::seconds NEIGHBOR_HOLD{35};
+    static constexpr std::chrono::seconds ROUTE_UPDATE_GAP{2};
+    static constexpr std::chrono::seconds ROUTE_REFRESH{300};
+    static constexpr std::chrono::seconds PROBE_INTERVAL{5};
+    static constexpr std::chrono::seconds IDLE_PROBE_INTERVAL{60};
+    static constexpr std::chrono::seconds ACTIVE_LINK{30};
+    static constexpr std::chrono::seconds PROBE_TIMEOUT{3};
+    static constexpr uint16_t MAX_COST = 0xFFFE;
+
+    using Clock = std::chrono::steady_clock;
+    using SendCallback = std::function<void(const NextHop& hop, std::vector<uint8_t> frame)>;
+    using NeighborsCallback = std::function<std::vector<MeshNeighbor>()>;
+
+    MeshNetwork(SendCallback send, NeighborsCallback neighbors);
+    ~MeshNetwork();
+
+    void start();
+    void stop();
+
+    void setLocalName(const std::string& name);
+    // Routes longer than the TTL messages are sent with could never be followed to the end.
+    void setMaxHops(uint8_t hops);
+    void handleNeighborList(const NeighborListMessage& msg, const std::string& link, Clock::time_point now);
+    void handleNeighborList(const NeighborListMessage& msg, const std::string& link);
+    void handlePing(const ProbeMessage& msg, const std::string& link);
+    void handlePong(const ProbeMessage& msg, const std::string& link, Clock::time_point now);
+    void handlePong(const ProbeMessage& msg, const std::string& link);
+    void tick(Clock::time_point now);
+
+    RelayRole roleFor(const std::string& link) const;
+    std::vector<std::string> relays() const;
+    // Also marks the link as carrying traffic, so it is probed at the active rate.
+    bool nextHop(const std::string& destination, NextHop& hop);
+    std::vector<MeshRoute> routes() const;
+    MeshStats stats() const;
+
+    static std::set<std::string> selectRelays(const std::set<std::string>& oneHop,
+                                              const std::map<std::string, std::set<std::string>>& reach);
+    static uint16_t linkCost(const LinkQuality& quality);
+
+private:
+    // A neighbor's route to one destination. Its next hop only matters when it is this node.
+    struct Offer {
+        uint16_t cost = 0;
+        uint8_t hops = 0;
+        bool viaUs = false;
+
+        bool operator==(const Offer& other) const {
+            return cost == other.cost && hops == other.hops && viaUs == other.viaUs;
+        }
+        bool operator!=(const Offer& other) const { return !(*this == other); }
+    };
+
+    struct Advert {
+        std::string link;
+        std::set<std::string> neighbors;
+        std::set<std::string> relays;
+        std::map<std::string, Offer> routes;
+        Clock::time_point heard;
+    };
+
+    struct Link {
+        LinkQuality quality;
+        Clock::time_point rssiSeen{};
+        Clock::time_point heard{};
+        Clock::time_point probed{};
+        Clock::time_point used{};
+        bool carried = false;
+        bool listed = false;
+    };
+
+    struct Probe {
+        std::string name;
+        std::string link;
+        Clock::time_point sent;
+    };
+
+    using LinkKey = std::pair<std::string, std::string>;
+
+    void refreshLocked(Clock::time_point now);
+    std::map<std::string, MeshRoute> firstHopsLocked() const;
+    bool usableLocked(const std::string& destination, const Offer& offer) const;
+    void routeLocked();
+    void rerouteLocked();
+    void sampleLoss(Link& link, double lost);
+    std::vector<RouteAdvert> routeDeltaLocked();
+    std::vector<NeighborListMessage> helloLocked(std::vector<RouteAdvert> routes, uint8_t mode) const;
+    void run();
+
+    SendCallback send_;
+    NeighborsCallback neighbors_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::thread worker_;
+    bool running_ = false;
+    bool dirty_ = true;
+    // Neighbors, adverts or link costs changed since relays and routes were last computed.
+    bool stale_ = true;
+    // Destinations whose advertised routes changed; only these are reconsidered when nothing else did.
+    std::set<std::string> staleRoutes_;
+    // Routes were recomputed since the last delta was taken.
+    bool routesChanged_ = false;
+    std::string localName_;
+    std::vector<MeshNeighbor> direct_;
+    std::set<std::string> oneHop_;
+    std::map<std::string, Advert> adverts_;
+    std::set<std::string> relays_;
+    std::set<std::string> twoHop_;
+    std::map<LinkKey, Link> links_;
+    std::map<std::string, MeshRoute> routes_;
+    // The routing table as the neighbors last heard it; full tables are sent from this copy.
+    std::map<std::string, RouteAdvert> advertised_;
+    std::map<std::string, Clock::time_point> tableSent_;
+    std::map<uint32_t, Probe> probes_;
+    uint32_t nextProbe_ = 1;
+    uint8_t maxHops_ = MessageHeader::DEFAULT_TTL;
+    Clock::time_point lastHello_{};
+    Clock::time_point lastRoutes_{};
+    MeshStats stats_;
+};
+
+} // namespace echo
@@ -0,0 +1,265 @@
+#include "MessageRouter.h"
+#include "core/protocol/DuplicateFilter.h"
+#include <algorithm>
+
+namespace echo {
+
+MessageRouter::MessageRouter(SendCallback send, LinksCallback links, uint32_t seed)
+    : send_(std::move(send)), links_(std::move(links)), rng_(seed) {
+}
+
+MessageRouter::~MessageRouter() {
+    stop();
+}
+
+void MessageRouter::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_) return;
+    running_ = true;
+    worker_ = std::thread([this]() { run(); });
+}
+
+void MessageRouter::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) return;
+        running_ = false;
+    }
+    cv_.notify_all();
+    if (worker_.joinable()) worker_.join();
+}
+
+void MessageRouter::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (running_) {
+        auto wake = Clock::now() + std::chrono::seconds(1);
+        for (const auto& kv : pending_) {
+            wake = std::min(wake, kv.second.deadline);
+        }
+        cv_.wait_until(lock, wake);
+        if (!running_) break;
+        lock.unlock();
+        tick(Clock::now());
+        lock.lock();
+    }
+}
+
+void MessageRouter::setGossip(const GossipConfig& config) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    config_ = config;
+}
+
+GossipConfig MessageRouter::gossip() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return config_;
+}
+
+bool MessageRouter::isRelayed(MessageType type) {
+    return type == MessageType::GLOBAL_MESSAGE;
+}
+
+std::vector<uint8_t> MessageRouter::forwardCopy(const MessageView& msg) {
+    std::vector<uint8_t> copy = msg.frame().toVector();
+    // TTL is the last header byte in both header versions, so the payload is forwarded untouched.
+    copy[msg.headerSize() - 1] = static_cast<uint8_t>(msg.ttl() - 1);
+    return copy;
+}
+
+uint64_t MessageRouter::relayKey(const MessageView& msg) {
+    return DuplicateFilter::senderKey(msg) ^ (static_cast<uint64_t>(msg.messageId()) * 0x9E3779B97F4A7C15ull);
+}
+
+double MessageRouter::forwardProbability(const GossipConfig& config, size_t density) {
+    if (density <= config.sparseNeighbors) {
+        return 1.0;
+    }
+    return std::max(config.minProbability, std::min(1.0, config.fanout / static_cast<double>(density)));
+}
+
+std::chrono::milliseconds MessageRouter::delayWindow(const GossipConfig& config, size_t density) {
+    return std::min(config.maxDelay, config.baseDelay + config.delayPerNeighbor * static_cast<long>(density));
+}
+
+std::vector<std::string> MessageRouter::targets(const std::vector<RelayLink>& links,
+                                                const std::vector<std::string>& exclude) const {
+    std::vector<std::string> out;
+    for (const auto& link : links) {
+        if (std::find(exclude.begin(), exclude.end(), link.id) == exclude.end()) {
+            out.push_back(link.id);
+        }
+    }
+    return out;
+}
+
+void MessageRouter::forward(std::vector<uint8_t> frame, const std::vector<std::string>& targets) {
+    for (size_t i = 0; i < targets.size(); ++i) {
+        send_(targets[i], i + 1 == targets.size() ? std::move(frame) : frame);
+    }
+    relayed_.fetch_add(1, std::memory_order_relaxed);
+    framesForwarded_.fetch_add(targets.size(), std::memory_order_relaxed);
+}
+
+bool MessageRouter::relay(const MessageView& msg, const std::string& ingress) {
+    return relay(msg, ingress, Clock::now());
+}
+
+bool MessageRouter::relay(const MessageView& msg, const std::string& ingress, Clock::time_point now) {
+    if (!isRelayed(msg.type())) {
+        return false;
+    }
+    if (msg.ttl() <= 1) {
+        expired_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    std::vector<RelayLink> links = links_();
+    std::vector<std::string> out = targets(links, {ingress});
+    if (out.empty()) {
+        noNeighbors_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    RelayRole role = role_ ? role_(ingress) : RelayRole::UNKNOWN;
+    if (role == RelayRole::NOT_RELAY) {
+        relaySuppressed_.fetch_add(1, std::memory_order_relaxed);
+        sendsSaved_.fetch_add(out.size(), std::memory_order_relaxed);
+        return false;
+    }
+    if (role == RelayRole::RELAY) {
+        relayForwarded_.fetch_add(1, std::memory_order_relaxed);
+        forward(forwardCopy(msg), out);
+        return true;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!config_.enabled) {
+        lock.unlock();
+        forward(forwardCopy(msg), out);
+        return true;
+    }
+
+    size_t density = 0;
+    for (const auto& link : links) {
+        density += link.neighbors;
+    }
+    if (std::uniform_real_distribution<double>(0.0, 1.0)(rng_) >= forwardProbability(config_, density)) {
+        skipped_.fetch_add(1, std::memory_order_relaxed);
+        sendsSaved_.fetch_add(out.size(), std::memory_order_relaxed);
+        return false;
+    }
+
+    auto window = delayWindow(config_, density);
+    std::uniform_int_distribution<long> delay(0, std::max<long>(0, static_cast<long>(window.count())));
+    Pending& entry = pending_[relayKey(msg)];
+    entry.frame = forwardCopy(msg);
+    entry.heardFrom = {ingress};
+    entry.copies = 1;
+    entry.targets = out.size();
+    entry.deadline = now + std::chrono::milliseconds(delay(rng_));
+    scheduled_.fetch_add(1, std::memory_order_relaxed);
+    lock.unlock();
+    cv_.notify_all();
+    return true;
+}
+
+void MessageRouter::overheard(const MessageView& msg, const std::string& ingress) {
+    if (!isRelayed(msg.type())) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = pending_.find(relayKey(msg));
+    if (it == pending_.end()) {
+        return;
+    }
+    Pending& entry = it->second;
+    entry.heardFrom.push_back(ingress);
+    if (++entry.copies >= config_.duplicateThreshold) {
+        suppressed_.fetch_add(1, std::memory_order_relaxed);
+        sendsSaved_.fetch_add(entry.targets, std::memory_order_relaxed);
+        pending_.erase(it);
+    }
+}
+
+bool MessageRouter::sendUnicast(std::vector<uint8_t> frame, const std::string& destination) {
+    NextHop hop;
+    if (!route_ || !unicast_ || !route_(destination, hop)) {
+        noRoute_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    unicast_(hop, std::move(frame));
+    unicastSent_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool MessageRouter::forwardUnicast(const MessageView& msg, const std::string& destination) {
+    if (msg.ttl() <= 1) {
+        expired_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    if (!sendUnicast(forwardCopy(msg), destination)) {
+        return false;
+    }
+    unicastForwarded_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void MessageRouter::tick(Clock::time_point now) {
+    std::vector<Pending> due;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto it = pending_.begin(); it != pending_.end();) {
+            if (it->second.deadline <= now) {
+                due.push_back(std::move(it->second));
+                it = pending_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    if (due.empty()) {
+        return;
+    }
+
+    std::vector<RelayLink> links = links_();
+    for (auto& entry : due) {
+        std::vector<std::string> out = targets(links, entry.heardFrom);
+        if (entry.targets > out.size()) {
+            sendsSaved_.fetch_add(entry.targets - out.size(), std::memory_order_relaxed);
+        }
+        if (out.empty()) {
+            continue;
+        }
+        forward(std::move(entry.frame), out);
+    }
+}
+
+MessageRouter::Clock::time_point MessageRouter::nextDeadline() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Clock::time_point next = Clock::time_point::max();
+    for (const auto& kv : pending_) {
+        next = std::min(next, kv.second.deadline);
+    }
+    return next;
+}
+
+RouterStats MessageRouter::stats() const {
+    RouterStats s;
+    s.relayed = relayed_.load(std::memory_order_relaxed);
+    s.framesForwarded = framesForwarded_.load(std::memory_order_relaxed);
+    s.expired = expired_.load(std::memory_order_relaxed);
+    s.noNeighbors = noNeighbors_.load(std::memory_order_relaxed);
+    s.scheduled = scheduled_.load(std::memory_order_relaxed);
+    s.suppressed = suppressed_.load(std::memory_order_relaxed);
+    s.skipped = skipped_.load(std::memory_order_relaxed);
+    s.sendsSaved = sendsSaved_.load(std::memory_order_relaxed);
+    s.relayForwarded = relayForwarded_.load(std::memory_order_relaxed);
+    s.relaySuppressed = relaySuppressed_.load(std::memory_order_relaxed);
+    s.unicastSent = unicastSent_.load(std::memory_order_relaxed);
+    s.unicastForwarded = unicastForwarded_.load(std::memory_order_relaxed);
+    s.noRoute = noRoute_.load(std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(mutex_);
+    s.pending = pending_.size();
+    return s;
+}
+
+} // namespace echo
@@ -0,0 +1,147 @@
+#pragma once
+
+#include "core/protocol/MessageView.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace echo {
+
+enum class RelayRole {
+    UNKNOWN,
+    RELAY,
+    NOT_RELAY
+};
+
+struct NextHop {
+    std::string name;
+    std::string link;
+};
+
+struct RelayLink {
+    std::string id;
+    size_t neighbors = 1;
+};
+
+struct GossipConfig {
+    bool enabled = true;
+    size_t sparseNeighbors = 6;
+    double fanout = 8.0;
+    double minProbability = 0.5;
+    uint32_t duplicateThreshold = 4;
+    std::chrono::milliseconds baseDelay{5};
+    std::chrono::milliseconds delayPerNeighbor{8};
+    std::chrono::milliseconds maxDelay{200};
+};
+
+struct RouterStats {
+    uint64_t relayed = 0;
+    uint64_t framesForwarded = 0;
+    uint64_t expired = 0;
+    uint64_t noNeighbors = 0;
+    uint64_t scheduled = 0;
+    uint64_t suppressed = 0;
+    uint64_t skipped = 0;
+    uint64_t sendsSaved = 0;
+    uint64_t relayForwarded = 0;
+    uint64_t relaySuppressed = 0;
+    uint64_t unicastSent = 0;
+    uint64_t unicastForwarded = 0;
+    uint64_t noRoute = 0;
+    size_t pending = 0;
+};
+
+class MessageRouter {
+public:
+    static constexpr const char* WIFI_LINK = "wifi";
+
+    using Clock = std::chrono::steady_clock;
+    using SendCallback = std::function<void(const std::string& link, std::vector<uint8_t> frame)>;
+    using LinksCallback = std::function<std::vector<RelayLink>()>;
+    using RoleCallback = std::function<RelayRole(const std::string& ingress)>;
+    using RouteCallback = std::function<bool(const std::string& destination, NextHop& hop)>;
+    using UnicastCallback = std::function<void(const NextHop& hop, std::vector<uint8_t> frame)>;
+
+    MessageRouter(SendCallback send, LinksCallback links, uint32_t seed = std::random_device{}());
+    ~MessageRouter();
+
+    void start();
+    void stop();
+
+    void setRoleCallback(RoleCallback cb) { role_ = std::move(cb); }
+    void setUnicast(RouteCallback route, UnicastCallback send) {
+        route_ = std::move(route);
+        unicast_ = std::move(send);
+    }
+    void setGossip(const GossipConfig& config);
+    GossipConfig gossip() const;
+
+    bool relay(const MessageView& msg, const std::string& ingress);
+    bool relay(const MessageView& msg, const std::string& ingress, Clock::time_point now);
+    void overheard(const MessageView& msg, const std::string& ingress);
+    bool sendUnicast(std::vector<uint8_t> frame, const std::string& destination);
+    bool forwardUnicast(const MessageView& msg, const std::string& destination);
+    void tick(Clock::time_point now);
+    Clock::time_point nextDeadline() const;
+
+    static double forwardProbability(const GossipConfig& config, size_t density);
+    static std::chrono::milliseconds delayWindow(const GossipConfig& config, size_t density);
+
+    static bool isRelayed(MessageType type);
+    static std::vector<uint8_t> forwardCopy(const MessageView& msg);
+
+    RouterStats stats() const;
+
+private:
+    struct Pending {
+        std::vector<uint8_t> frame;
+        std::vector<std::string> heardFrom;
+        uint32_t copies = 1;
+        size_t targets = 0;
+        Clock::time_point deadline;
+    };
+
+    static uint64_t relayKey(const MessageView& msg);
+    std::vector<std::string> targets(const std::vector<RelayLink>& links,
+                                     const std::vector<std::string>& exclude) const;
+    void forward(std::vector<uint8_t> frame, const std::vector<std::string>& targets);
+    void run();
+
+    SendCallback send_;
+    LinksCallback links_;
+    RoleCallback role_;
+    RouteCallback route_;
+    UnicastCallback unicast_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::thread worker_;
+    bool running_ = false;
+    GossipConfig config_;
+    std::mt19937 rng_;
+    std::unordered_map<uint64_t, Pending> pending_;
+
+    std::atomic<uint64_t> relayed_{0};
+    std::atomic<uint64_t> framesForwarded_{0};
+    std::atomic<uint64_t> expired_{0};
+    std::atomic<uint64_t> noNeighbors_{0};
+    std::atomic<uint64_t> scheduled_{0};
+    std::atomic<uint64_t> suppressed_{0};
+    std::atomic<uint64_t> skipped_{0};
+    std::atomic<uint64_t> sendsSaved_{0};
+    std::atomic<uint64_t> relayForwarded_{0};
+    std::atomic<uint64_t> relaySuppressed_{0};
+    std::atomic<uint64_t> unicastSent_{0};
+    std::atomic<uint64_t> unicastForwarded_{0};
+    std::atomic<uint64_t> noRoute_{0};
+};
+
+} // namespace echo
@@ -0,0 +1,395 @@
+#include "MessageStore.h"
+#include "core/protocol/Codec.h"
+#include "utils/Crc32.h"
+#include <algorithm>
+#include <charconv>
+#include <filesystem>
+#include <set>
+
+namespace echo {
+
+namespace {
+
+// Record: [body_len (4)][crc32 (4)] body: [expires (8)][flags (1)][recipient_len (2)][recipient][frame]
+constexpr size_t RECORD_PREFIX = 8;
+constexpr size_t BODY_FIXED = 11;
+constexpr uint8_t FLAG_RELAYED = 0x01;
+
+uint64_t toSeconds(MessageStore::Clock::time_point t) {
+    auto s = std::chrono::duration_cast<std::chrono::seconds>(t.time_since_epoch()).count();
+    return s > 0 ? static_cast<uint64_t>(s) : 0;
+}
+
+}
+
+MessageStore::MessageStore(std::string directory, StoreLimits limits)
+    : directory_(std::move(directory)), limits_(limits) {
+}
+
+MessageStore::~MessageStore() {
+    close();
+}
+
+std::string MessageStore::segmentPath(uint32_t id, const char* extension) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%08u.%s", id, extension);
+    return (std::filesystem::path(directory_) / name).string();
+}
+
+bool MessageStore::open() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (open_) return true;
+
+    std::error_code ec;
+    std::filesystem::create_directories(directory_, ec);
+    if (ec) return false;
+
+    std::vector<uint32_t> ids;
+    for (const auto& item : std::filesystem::directory_iterator(directory_, ec)) {
+        const auto& path = item.path();
+        std::string stem = path.stem().string();
+        if (stem.empty() || !std::all_of(stem.begin(), stem.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+            continue;
+        }
+        uint32_t id = 0;
+        auto parsed = std::from_chars(stem.data(), stem.data() + stem.size(), id);
+        if (parsed.ec != std::errc() || parsed.ptr != stem.data() + stem.size()) continue;
+        if (path.extension() == ".seg") {
+            ids.push_back(id);
+        } else if (path.extension() == ".del" && !std::filesystem::exists(segmentPath(id, "seg"))) {
+            std::filesystem::remove(path, ec);
+        }
+    }
+    if (ec) return false;
+
+    std::sort(ids.begin(), ids.end());
+    uint64_t now = toSeconds(Clock::now());
+    for (uint32_t id : ids) {
+        scanSegment(id, now);
+    }
+    activeId_ = ids.empty() ? 0 : ids.back();
+    open_ = true;
+    return true;
+}
+
+void MessageStore::close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (active_) {
+        std::fclose(active_);
+        active_ = nullptr;
+    }
+    open_ = false;
+    queues_.clear();
+    segments_.clear();
+    nextExpiry_ = UINT64_MAX;
+}
+
+void MessageStore::scanSegment(uint32_t id, uint64_t now) {
+    std::string path = segmentPath(id, "seg");
+    std::error_code ec;
+    uint64_t fileSize = std::filesystem::file_size(path, ec);
+    std::FILE* f = ec ? nullptr : std::fopen(path.c_str(), "rb");
+    if (!f) return;
+
+    std::set<uint32_t> dead;
+    if (std::FILE* del = std::fopen(segmentPath(id, "del").c_str(), "rb")) {
+        uint8_t buf[4];
+        while (std::fread(buf, 1, sizeof(buf), del) == sizeof(buf)) {
+            dead.insert(codec::loadU32(buf));
+        }
+        std::fclose(del);
+    }
+
+    Segment segment;
+    uint8_t head[RECORD_PREFIX + BODY_FIXED];
+    uint64_t offset = 0;
+    while (std::fread(head, 1, sizeof(head), f) == sizeof(head)) {
+        uint32_t bodyLen = codec::loadU32(head);
+        uint64_t expires = (static_cast<uint64_t>(codec::loadU32(head + 8)) << 32) | codec::loadU32(head + 12);
+        bool relayed = (head[16] & FLAG_RELAYED) != 0;
+        uint16_t nameLen = codec::loadU16(head + 17);
+        uint64_t next = offset + RECORD_PREFIX + bodyLen;
+        if (bodyLen < BODY_FIXED + nameLen || next > fileSize) break;
+
+        std::string recipient(nameLen, '\0');
+        if (nameLen != 0 && std::fread(&recipient[0], 1, nameLen, f) != nameLen) break;
+        if (std::fseek(f, static_cast<long>(next), SEEK_SET) != 0) break;
+
+        if (!dead.count(static_cast<uint32_t>(offset)) && expires > now && !recipient.empty()) {
+            Entry entry{id, static_cast<uint32_t>(offset), static_cast<uint32_t>(next - offset), expires, relayed};
+            queues_[recipient].push_back(entry);
+            segment.live++;
+            stats_.bytes += entry.size;
+            if (relayed) stats_.relayBytes += entry.size;
+            nextExpiry_ = std::min(nextExpiry_, expires);
+        }
+        offset = next;
+    }
+    std::fclose(f);
+
+    segment.bytes = offset;
+    if (segment.live == 0) {
+        std::filesystem::remove(path, ec);
+        std::filesystem::remove(segmentPath(id, "del"), ec);
+        return;
+    }
+    segments_[id] = segment;
+}
+
+bool MessageStore::rotateLocked() {
+    if (active_) {
+        std::fclose(active_);
+    }
+    activeId_++;
+    active_ = std::fopen(segmentPath(activeId_, "seg").c_str(), "wb");
+    if (!active_) return false;
+    segments_[activeId_] = Segment{};
+    return true;
+}
+
+bool MessageStore::enqueue(const std::string& recipient, const std::vector<uint8_t>& frame, bool relayed) {
+    return enqueue(recipient, frame, relayed, Clock::now());
+}
+
+bool MessageStore::enqueue(const std::string& recipient, const std::vector<uint8_t>& frame, bool relayed,
+                           Clock::time_point now) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!open_ || recipient.empty() || recipient.size() > 0xFFFF || frame.empty() || frame.size() > MAX_FRAME_BYTES) {
+        stats_.rejected++;
+        return false;
+    }
+    uint64_t t = toSeconds(now);
+    if (t >= nextExpiry_) {
+        expireLocked(t);
+    }
+
+    uint32_t size = static_cast<uint32_t>(RECORD_PREFIX + BODY_FIXED + recipient.size() + frame.size());
+    auto queue = queues_.find(recipient);
+    size_t queued = queue != queues_.end() ? queue->second.size() : 0;
+    size_t relayQueued = 0;
+    if (relayed && queue != queues_.end()) {
+        for (const auto& entry : queue->second) relayQueued += entry.relayed;
+    }
+    if (stats_.bytes + size > limits_.maxBytes || queued >= limits_.maxPerRecipient ||
+        (relayed && (stats_.relayBytes + size > limits_.relayBytes || relayQueued >= limits_.relayPerRecipient))) {
+        stats_.rejected++;
+        return false;
+    }
+    if ((!active_ || segments_[activeId_].bytes + size > SEGMENT_BYTES) && !rotateLocked()) {
+        stats_.rejected++;
+        return false;
+    }
+
+    uint64_t expires = t + static_cast<uint64_t>((relayed ? limits_.relayTtl : limits_.ttl).count());
+    std::vector<uint8_t> record(size);
+    uint8_t* p = record.data() + RECORD_PREFIX;
+    codec::storeU32(p, static_cast<uint32_t>(expires >> 32));
+    codec::storeU32(p, static_cast<uint32_t>(expires));
+    *p++ = relayed ? FLAG_RELAYED : 0;
+    codec::storeU16(p, static_cast<uint16_t>(recipient.size()));
+    std::copy(recipient.begin(), recipient.end(), p);
+    p += recipient.size();
+    std::copy(frame.begin(), frame.end(), p);
+    p = record.data();
+    codec::storeU32(p, static_cast<uint32_t>(size - RECORD_PREFIX));
+    codec::storeU32(p, crc32(record.data() + RECORD_PREFIX, size - RECORD_PREFIX));
+
+    Segment& segment = segments_[activeId_];
+    if (std::fwrite(record.data(), 1, size, active_) != size || std::fflush(active_) != 0) {
+        // The tail of this segment is now unknown; later records go to a fresh one.
+        std::fclose(active_);
+        active_ = nullptr;
+        if (segment.live == 0) {
+            segments_.erase(activeId_);
+            std::error_code ec;
+            std::filesystem::remove(segmentPath(activeId_, "seg"), ec);
+        }
+        stats_.rejected++;
+        return false;
+    }
+
+    queues_[recipient].push_back(Entry{activeId_, static_cast<uint32_t>(segment.bytes), size, expires, relayed});
+    segment.bytes += size;
+    segment.live++;
+    stats_.bytes += size;
+    if (relayed) stats_.relayBytes += size;
+    stats_.enqueued++;
+    nextExpiry_ = std::min(nextExpiry_, expires);
+    return true;
+}
+
+bool MessageStore::readFrame(const Entry& entry, std::FILE*& file, uint32_t& fileSegment,
+                             std::vector<uint8_t>& frame) const {
+    if (!file || fileSegment != entry.segment) {
+        if (file) std::fclose(file);
+        file = std::fopen(segmentPath(entry.segment, "seg").c_str(), "rb");
+        fileSegment = entry.segment;
+        if (!file) return false;
+    }
+    std::vector<uint8_t> record(entry.size);
+    if (std::fseek(file, static_cast<long>(entry.offset), SEEK_SET) != 0 ||
+        std::fread(record.data(), 1, record.size(), file) != record.size()) {
+        return false;
+    }
+    uint32_t bodyLen = codec::loadU32(record.data());
+    if (RECORD_PREFIX + bodyLen != record.size() ||
+        crc32(record.data() + RECORD_PREFIX, bodyLen) != codec::loadU32(record.data() + 4)) {
+        return false;
+    }
+    size_t frameAt = RECORD_PREFIX + BODY_FIXED + codec::loadU16(record.data() + 17);
+    if (frameAt > record.size()) return false;
+    frame.assign(record.begin() + static_cast<std::ptrdiff_t>(frameAt), record.end());
+    return true;
+}
+
+void MessageStore::removeLocked(const Entry& entry) {
+    stats_.bytes -= entry.size;
+    if (entry.relayed) stats_.relayBytes -= entry.size;
+
+    auto segment = segments_.find(entry.segment);
+    if (segment == segments_.end()) return;
+    if (--segment->second.live == 0) {
+        if (entry.segment == activeId_ && active_) {
+            std::fclose(active_);
+            active_ = nullptr;
+        }
+        std::error_code ec;
+        std::filesystem::remove(segmentPath(entry.segment, "seg"), ec);
+        std::filesystem::remove(segmentPath(entry.segment, "del"), ec);
+        segments_.erase(segment);
+        return;
+    }
+    if (std::FILE* del = std::fopen(segmentPath(entry.segment, "del").c_str(), "ab")) {
+        uint8_t buf[4];
+        uint8_t* p = buf;
+        codec::storeU32(p, entry.offset);
+        std::fwrite(buf, 1, sizeof(buf), del);
+        std::fclose(del);
+    }
+}
+
+size_t MessageStore::drain(const std::string& recipient, const SendCallback& send) {
+    return drain(recipient, send, Clock::now());
+}
+
+size_t MessageStore::drain(const std::string& recipient, const SendCallback& send, Clock::time_point now) {
+    // Frames are read under the lock and sent outside it, so a send that re-enqueues or blocks cannot deadlock.
+    // An entry is removed only once its frame was accepted; a failed send leaves it and everything after it queued.
+    std::vector<std::pair<Entry, std::vector<uint8_t>>> batch;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = queues_.find(recipient);
+        if (!open_ || it == queues_.end() || !draining_.insert(recipient).second) return 0;
+
+        uint64_t t = toSeconds(now);
+        std::FILE* file = nullptr;
+        uint32_t fileSegment = 0;
+        auto& queue = it->second;
+        for (auto entry = queue.begin(); entry != queue.end();) {
+            std::vector<uint8_t> frame;
+            if (entry->expires > t && readFrame(*entry, file, fileSegment, frame)) {
+                batch.emplace_back(*entry, std::move(frame));
+                ++entry;
+                continue;
+            }
+            if (entry->expires <= t) {
+                stats_.expired++;
+            } else {
+                stats_.corrupt++;
+            }
+            auto segment = segments_.find(entry->segment);
+            if (file && fileSegment == entry->segment && segment != segments_.end() && segment->second.live <= 1) {
+                std::fclose(file);
+                file = nullptr;
+            }
+            removeLocked(*entry);
+            entry = queue.erase(entry);
+        }
+        if (file) std::fclose(file);
+        if (queue.empty()) queues_.erase(it);
+    }
+
+    size_t sent = 0;
+    for (auto& item : batch) {
+        if (!send(std::move(item.second), item.first.relayed)) break;
+        sent++;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    draining_.erase(recipient);
+    auto it = queues_.find(recipient);
+    if (it == queues_.end()) return sent;
+    // Expiry or close() may have removed entries while the lock was released.
+    auto& queue = it->second;
+    for (size_t i = 0; i < sent; ++i) {
+        const Entry& done = batch[i].first;
+        auto entry = std::find_if(queue.begin(), queue.end(), [&done](const Entry& e) {
+            return e.segment == done.segment && e.offset == done.offset;
+        });
+        if (entry == queue.end()) continue;
+        stats_.delivered++;
+        removeLocked(*entry);
+        queue.erase(entry);
+    }
+    if (queue.empty()) queues_.erase(it);
+    return sent;
+}
+
+void MessageStore::expire(Clock::time_point now) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    expireLocked(toSeconds(now));
+}
+
+void MessageStore::expireLocked(uint64_t now) {
+    nextExpiry_ = UINT64_MAX;
+    for (auto it = queues_.begin(); it != queues_.end();) {
+        std::deque<Entry> kept;
+        for (const auto& entry : it->second) {
+            if (entry.expires <= now) {
+                removeLocked(entry);
+                stats_.expired++;
+            } else {
+                kept.push_back(entry);
+                nextExpiry_ = std::min(nextExpiry_, entry.expires);
+            }
+        }
+        if (kept.empty()) {
+            it = queues_.erase(it);
+        } else {
+            it->second = std::move(kept);
+            ++it;
+        }
+    }
+}
+
+size_t MessageStore::pending(const std::string& recipient) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = queues_.find(recipient);
+    return it != queues_.end() ? it->second.size() : 0;
+}
+
+std::vector<std::string> MessageStore::recipients() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<std::string> out;
+    out.reserve(queues_.size());
+    for (const auto& kv : queues_) {
+        out.push_back(kv.first);
+    }
+    return out;
+}
+
+StoreStats MessageStore::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    StoreStats s = stats_;
+    s.recipients = queues_.size();
+    s.segments = segments_.size();
+    for (const auto& kv : queues_) {
+        s.queued += kv.second.size();
+        for (const auto& entry : kv.second) {
+            s.relayQueued += entry.relayed;
+        }
+    }
+    return s;
+}
+
+} // namespace echo
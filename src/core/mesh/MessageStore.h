@@ -0,0 +1,102 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace echo {
+
+struct StoreLimits {
+    uint64_t maxBytes = 32ull * 1024 * 1024;
+    uint64_t relayBytes = 4ull * 1024 * 1024;
+    size_t maxPerRecipient = 5000;
+    size_t relayPerRecipient = 200;
+    std::chrono::seconds ttl{std::chrono::hours(72)};
+    std::chrono::seconds relayTtl{std::chrono::hours(24)};
+};
+
+struct StoreStats {
+    size_t queued = 0;
+    size_t relayQueued = 0;
+    size_t recipients = 0;
+    size_t segments = 0;
+    uint64_t bytes = 0;
+    uint64_t relayBytes = 0;
+    uint64_t enqueued = 0;
+    uint64_t delivered = 0;
+    uint64_t expired = 0;
+    uint64_t rejected = 0;
+    uint64_t corrupt = 0;
+};
+
+class MessageStore {
+public:
+    static constexpr uint64_t SEGMENT_BYTES = 1024 * 1024;
+    static constexpr size_t MAX_FRAME_BYTES = 64 * 1024;
+
+    using Clock = std::chrono::system_clock;
+    using SendCallback = std::function<bool(std::vector<uint8_t> frame, bool relayed)>;
+
+    explicit MessageStore(std::string directory, StoreLimits limits = {});
+    ~MessageStore();
+
+    MessageStore(const MessageStore&) = delete;
+    MessageStore& operator=(const MessageStore&) = delete;
+
+    bool open();
+    void close();
+
+    bool enqueue(const std::string& recipient, const std::vector<uint8_t>& frame, bool relayed, Clock::time_point now);
+    bool enqueue(const std::string& recipient, const std::vector<uint8_t>& frame, bool relayed = false);
+    size_t drain(const std::string& recipient, const SendCallback& send, Clock::time_point now);
+    size_t drain(const std::string& recipient, const SendCallback& send);
+    void expire(Clock::time_point now);
+
+    size_t pending(const std::string& recipient) const;
+    std::vector<std::string> recipients() const;
+    StoreStats stats() const;
+
+private:
+    struct Entry {
+        uint32_t segment = 0;
+        uint32_t offset = 0;
+        uint32_t size = 0;
+        uint64_t expires = 0;
+        bool relayed = false;
+    };
+
+    struct Segment {
+        uint64_t bytes = 0;
+        size_t live = 0;
+    };
+
+    std::string segmentPath(uint32_t id, const char* extension) const;
+    void scanSegment(uint32_t id, uint64_t now);
+    bool rotateLocked();
+    bool readFrame(const Entry& entry, std::FILE*& file, uint32_t& fileSegment, std::vector<uint8_t>& frame) const;
+    void removeLocked(const Entry& entry);
+    void expireLocked(uint64_t now);
+
+    std::string directory_;
+    StoreLimits limits_;
+
+    mutable std::mutex mutex_;
+    bool open_ = false;
+    std::map<std::string, std::deque<Entry>> queues_;
+    std::set<std::string> draining_;
+    std::map<uint32_t, Segment> segments_;
+    std::FILE* active_ = nullptr;
+    uint32_t activeId_ = 0;
+    uint64_t nextExpiry_ = UINT64_MAX;
+    StoreStats stats_;
+};
+
+} // namespace echo
@@ -0,0 +1,499 @@
+#include "DatagramChannel.h"
+#include <algorithm>
+#include <array>
+#include <random>
+
+#ifdef __linux__
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace echo {
+
+DatagramChannel::DatagramChannel(FrameCallback onFrame, ExpiredCallback onExpired, AckedCallback onAcked)
+    : onFrame_(std::move(onFrame)), onExpired_(std::move(onExpired)), onAcked_(std::move(onAcked)) {
+}
+
+DatagramChannel::~DatagramChannel() {
+    stop();
+}
+
+DatagramStats DatagramChannel::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    DatagramStats out = stats_;
+    out.inFlight = 0;
+    for (const auto& kv : remotes_) out.inFlight += kv.second.outstanding.size();
+    return out;
+}
+
+#ifdef __linux__
+
+namespace {
+
+// [magic][type][session (4)][sequence (4)][oldest outstanding (4)][frame] for data, and
+// [magic][type][session (4)][next expected (4)][received bitmap (8)] for ACKs.
+constexpr uint8_t MAGIC = 0xEC;
+constexpr uint8_t DATA = 1;
+constexpr uint8_t ACK = 2;
+constexpr size_t ACK_SIZE = 18;
+constexpr size_t RECEIVE_SIZE = 2048;
+
+void put32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24); p[1] = (uint8_t)(v >> 16); p[2] = (uint8_t)(v >> 8); p[3] = (uint8_t)v;
+}
+
+uint32_t get32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+// Moves past next, which arrived or was abandoned by its sender, and past the run received after it.
+void advance(uint32_t& next, uint64_t& bits) {
+    next++;
+    while (bits & 1) {
+        bits >>= 1;
+        next++;
+    }
+    bits >>= 1;
+}
+
+std::string keyOf(const sockaddr_in& addr) {
+    char ip[INET_ADDRSTRLEN] = {0};
+    inet_ntop(AF_INET, &addr.sin_addr, ip, sizeof(ip));
+    return std::string(ip) + ":" + std::to_string(ntohs(addr.sin_port));
+}
+
+// Messages are prepared with their iovec and address in place. One failing destination does not
+// stop the rest of the batch; a full socket buffer does, and the retransmit timer covers it.
+uint64_t transmit(int fd, std::vector<mmsghdr>& messages) {
+    uint64_t calls = 0;
+    size_t offset = 0;
+    while (offset < messages.size()) {
+        int n = sendmmsg(fd, messages.data() + offset, (unsigned)(messages.size() - offset), MSG_DONTWAIT | MSG_NOSIGNAL);
+        calls++;
+        if (n > 0) {
+            offset += (size_t)n;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            break;
+        } else if (errno != EINTR) {
+            offset++;
+        }
+    }
+    return calls;
+}
+
+struct Batch {
+    std::vector<mmsghdr> messages;
+    std::vector<iovec> iovs;
+    std::vector<sockaddr_in> addrs;
+
+    explicit Batch(size_t capacity) {
+        messages.reserve(capacity);
+        iovs.reserve(capacity);
+        addrs.reserve(capacity);
+    }
+
+    void add(const sockaddr_in& addr, const uint8_t* data, size_t size) {
+        addrs.push_back(addr);
+        iovs.push_back(iovec{const_cast<uint8_t*>(data), size});
+        mmsghdr message{};
+        message.msg_hdr.msg_name = &addrs.back();
+        message.msg_hdr.msg_namelen = sizeof(sockaddr_in);
+        message.msg_hdr.msg_iov = &iovs.back();
+        message.msg_hdr.msg_iovlen = 1;
+        messages.push_back(message);
+    }
+};
+
+sockaddr_in addressOf(const std::string& ip, uint16_t port) {
+    sockaddr_in addr{}; addr.sin_family = AF_INET; addr.sin_port = htons(port); inet_aton(ip.c_str(), &addr.sin_addr);
+    return addr;
+}
+
+}
+
+bool DatagramChannel::start(uint16_t port) {
+    if (running_) return true;
+    fd_ = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd_ < 0) return false;
+    int buffer = 1 << 20;
+    setsockopt(fd_, SOL_SOCKET, SO_RCVBUF, &buffer, sizeof(buffer));
+    setsockopt(fd_, SOL_SOCKET, SO_SNDBUF, &buffer, sizeof(buffer));
+    sockaddr_in addr{}; addr.sin_family = AF_INET; addr.sin_port = htons(port); addr.sin_addr.s_addr = INADDR_ANY;
+    socklen_t len = sizeof(addr);
+    wakeFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeFd_ < 0 || bind(fd_, (sockaddr*)&addr, sizeof(addr)) < 0 || getsockname(fd_, (sockaddr*)&addr, &len) < 0) {
+        ::close(fd_);
+        if (wakeFd_ >= 0) ::close(wakeFd_);
+        fd_ = wakeFd_ = -1;
+        return false;
+    }
+    port_ = ntohs(addr.sin_port);
+
+    // A fresh session on every start tells receivers that sequence numbers begin again.
+    std::random_device random;
+    std::lock_guard<std::mutex> lock(mutex_);
+    do { session_ = random(); } while (session_ == 0);
+    remotes_.clear();
+    sources_.clear();
+    wakeAt_ = Clock::now() + IDLE_WAKE;
+    running_ = true;
+    worker_ = std::thread([this]() { run(); });
+    return true;
+}
+
+void DatagramChannel::stop() {
+    if (!running_.exchange(false)) return;
+    wake();
+    if (worker_.joinable()) worker_.join();
+    ::close(fd_);
+    ::close(wakeFd_);
+    fd_ = wakeFd_ = -1;
+    std::lock_guard<std::mutex> lock(mutex_);
+    remotes_.clear();
+    sources_.clear();
+}
+
+void DatagramChannel::wake() {
+    uint64_t one = 1;
+    ssize_t woken = write(wakeFd_, &one, sizeof(one));
+    (void)woken;
+}
+
+std::vector<bool> DatagramChannel::send(const std::vector<Datagram>& datagrams) {
+    std::vector<bool> taken(datagrams.size(), false);
+    if (!running_ || datagrams.empty()) return taken;
+    Batch batch(datagrams.size());
+    auto now = Clock::now();
+    bool sooner = false;
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < datagrams.size(); ++i) {
+        const Datagram& d = datagrams[i];
+        if (!d.frame || d.frame->size() > MAX_PAYLOAD) {
+            stats_.refused++;
+            continue;
+        }
+        Remote& remote = remotes_[d.ip + ":" + std::to_string(d.port)];
+        remote.link = d.link;
+        remote.ip = d.ip;
+        remote.port = d.port;
+        // The receiver's bitmap reaches WINDOW past the oldest frame it is missing.
+        if (!remote.outstanding.empty() && remote.nextSequence - remote.outstanding.begin()->first >= WINDOW) {
+            stats_.refused++;
+            continue;
+        }
+        uint32_t sequence = remote.nextSequence++;
+        Outstanding& out = remote.outstanding[sequence];
+        out.datagram.resize(HEADER + d.frame->size());
+        out.datagram[0] = MAGIC;
+        out.datagram[1] = DATA;
+        put32(out.datagram.data() + 2, session_);
+        put32(out.datagram.data() + 6, sequence);
+        put32(out.datagram.data() + 10, remote.outstanding.begin()->first);
+        std::copy(d.frame->begin(), d.frame->end(), out.datagram.begin() + HEADER);
+        out.first = now;
+        out.sent = now;
+        batch.add(addressOf(d.ip, d.port), out.datagram.data(), out.datagram.size());
+        taken[i] = true;
+        stats_.sent++;
+        auto due = now + remote.rtt.rto();
+        if (due < wakeAt_) {
+            wakeAt_ = due;
+            sooner = true;
+        }
+    }
+    stats_.syscalls += transmit(fd_, batch.messages);
+    if (sooner) {
+        wake();
+        stats_.syscalls++;
+    }
+    return taken;
+}
+
+void DatagramChannel::run() {
+    std::vector<uint8_t> buffers(BATCH * RECEIVE_SIZE);
+    std::vector<mmsghdr> messages(BATCH);
+    std::vector<iovec> iovs(BATCH);
+    std::vector<sockaddr_in> addrs(BATCH);
+    pollfd fds[2] = {{fd_, POLLIN, 0}, {wakeFd_, POLLIN, 0}};
+
+    while (running_) {
+        std::vector<std::pair<std::string, std::vector<uint8_t>>> expired;
+        Clock::time_point next;
+        auto now = Clock::now();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            next = retransmit(now, expired);
+            wakeAt_ = next;
+            stats_.syscalls++;
+        }
+        for (auto& entry : expired) {
+            if (onExpired_) onExpired_(entry.first, std::move(entry.second));
+        }
+
+        auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(next - now).count() + 1;
+        if (poll(fds, 2, (int)std::max<long long>(0, wait)) <= 0) continue;
+        if (fds[1].revents & POLLIN) {
+            uint64_t count;
+            ssize_t drained = read(wakeFd_, &count, sizeof(count));
+            (void)drained;
+        }
+        if (!(fds[0].revents & POLLIN)) continue;
+
+        for (size_t i = 0; i < BATCH; ++i) {
+            iovs[i] = iovec{buffers.data() + i * RECEIVE_SIZE, RECEIVE_SIZE};
+            messages[i] = mmsghdr{};
+            messages[i].msg_hdr.msg_name = &addrs[i];
+            messages[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+            messages[i].msg_hdr.msg_iov = &iovs[i];
+            messages[i].msg_hdr.msg_iovlen = 1;
+        }
+        int count = recvmmsg(fd_, messages.data(), BATCH, MSG_DONTWAIT, nullptr);
+        if (count <= 0) continue;
+
+        // ACKs go out before the frames are handed up, so delivery work never delays them.
+        std::vector<std::vector<uint8_t>> frames;
+        std::vector<Delivery> delivered;
+        now = Clock::now();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stats_.syscalls++;
+            for (int i = 0; i < count; ++i) {
+                const uint8_t* data = buffers.data() + (size_t)i * RECEIVE_SIZE;
+                size_t size = messages[i].msg_len;
+                if (size < HEADER || data[0] != MAGIC || (messages[i].msg_hdr.msg_flags & MSG_TRUNC)) continue;
+                std::string key = keyOf(addrs[i]);
+                if (data[1] == DATA) {
+                    handleData(key, addrs[i].sin_addr.s_addr, addrs[i].sin_port, data, size, now, frames);
+                } else if (data[1] == ACK) {
+                    handleAck(key, data, size, now, delivered);
+                }
+            }
+            flushAcks();
+        }
+        for (const auto& delivery : delivered) {
+            if (onAcked_) onAcked_(delivery.link, delivery.bytes, delivery.took);
+        }
+        for (const auto& frame : frames) {
+            if (onFrame_) onFrame_(frame);
+        }
+    }
+}
+
+void DatagramChannel::handleData(const std::string& key, uint32_t ip, uint16_t port, const uint8_t* data, size_t size,
+                                 Clock::time_point now, std::vector<std::vector<uint8_t>>& frames) {
+    uint32_t session = get32(data + 2);
+    uint32_t sequence = get32(data + 6);
+    uint32_t oldest = get32(data + 10);
+    // A sender never has a frame outstanding WINDOW or more past its oldest one.
+    if (session == 0 || sequence - oldest >= WINDOW) return;
+    auto it = sources_.find(key);
+    if (it == sources_.end()) {
+        if (sources_.size() >= MAX_SOURCES) evictSource(now);
+        it = sources_.emplace(key, Source{}).first;
+    }
+    Source& source = it->second;
+    if (source.session != session) {
+        // A sender restarting on the same address shows up with a new session. While the current
+        // session is still heard, a datagram claiming another one is dropped rather than resetting it.
+        if (source.session != 0 && now - source.heard < SESSION_HOLD) return;
+        source.session = session;
+        source.next = oldest;
+        source.bits = 0;
+    }
+    source.ip = ip;
+    source.port = port;
+    source.heard = now;
+    source.ackDue = true;
+    // Everything before the sender's oldest outstanding frame was acknowledged or given up on.
+    if (oldest - source.next > WINDOW && oldest > source.next) {
+        source.next = oldest;
+        source.bits = 0;
+    }
+    while (source.next < oldest) advance(source.next, source.bits);
+    if (sequence < source.next) {
+        stats_.duplicates++;
+        return;
+    }
+    uint32_t offset = sequence - source.next;
+    if (offset > WINDOW) return;
+    if (offset == 0) {
+        advance(source.next, source.bits);
+    } else {
+        uint64_t bit = uint64_t{1} << (offset - 1);
+        if (source.bits & bit) {
+            stats_.duplicates++;
+            return;
+        }
+        source.bits |= bit;
+    }
+    stats_.received++;
+    frames.emplace_back(data + HEADER, data + size);
+}
+
+void DatagramChannel::evictSource(Clock::time_point now) {
+    auto quietest = sources_.end();
+    for (auto it = sources_.begin(); it != sources_.end();) {
+        if (now - it->second.heard > SOURCE_TIMEOUT) {
+            it = sources_.erase(it);
+            continue;
+        }
+        if (quietest == sources_.end() || it->second.heard < quietest->second.heard) quietest = it;
+        ++it;
+    }
+    if (sources_.size() >= MAX_SOURCES && quietest != sources_.end()) sources_.erase(quietest);
+}
+
+void DatagramChannel::handleAck(const std::string& key, const uint8_t* data, size_t size, Clock::time_point now,
+                                std::vector<Delivery>& delivered) {
+    if (size < ACK_SIZE || get32(data + 2) != session_) return;
+    auto it = remotes_.find(key);
+    if (it == remotes_.end()) return;
+    Remote& remote = it->second;
+    stats_.acksReceived++;
+    uint32_t next = get32(data + 6);
+    uint64_t bits = 0;
+    for (int i = 0; i < 8; ++i) bits = (bits << 8) | data[10 + i];
+
+    // Karn: only frames sent once give an RTT sample, and one sample per ACK is enough.
+    bool sampled = false;
+    for (auto out = remote.outstanding.begin(); out != remote.outstanding.end();) {
+        uint32_t sequence = out->first;
+        bool acked = sequence < next;
+        if (!acked) {
+            uint32_t offset = sequence - next;
+            if (offset > WINDOW) break;
+            acked = offset > 0 && ((bits >> (offset - 1)) & 1);
+        }
+        if (!acked) {
+            ++out;
+            continue;
+        }
+        if (!sampled && out->second.retries == 0) {
+            remote.rtt.sample(now - out->second.sent);
+            sampled = true;
+        }
+        stats_.acked++;
+        delivered.push_back(Delivery{remote.link, out->second.datagram.size() - HEADER, now - out->second.first});
+        out = remote.outstanding.erase(out);
+    }
+}
+
+DatagramChannel::Clock::time_point DatagramChannel::retransmit(Clock::time_point now,
+                                                               std::vector<std::pair<std::string, std::vector<uint8_t>>>& expired) {
+    auto next = now + IDLE_WAKE;
+    size_t total = 0;
+    for (const auto& kv : remotes_) total += kv.second.outstanding.size();
+    if (total == 0) return next;
+
+    Batch batch(total);
+    for (auto& kv : remotes_) {
+        Remote& remote = kv.second;
+        bool resent = false;
+        auto rto = remote.rtt.rto();
+        for (auto out = remote.outstanding.begin(); out != remote.outstanding.end();) {
+            auto due = out->second.sent + rto;
+            if (due > now) {
+                next = std::min(next, due);
+                ++out;
+                continue;
+            }
+            if (out->second.retries >= MAX_RETRIES) {
+                expired.emplace_back(remote.link, std::vector<uint8_t>(out->second.datagram.begin() + HEADER, out->second.datagram.end()));
+                stats_.expired++;
+                out = remote.outstanding.erase(out);
+                continue;
+            }
+            out->second.retries++;
+            out->second.sent = now;
+            put32(out->second.datagram.data() + 10, remote.outstanding.begin()->first);
+            batch.add(addressOf(remote.ip, remote.port), out->second.datagram.data(), out->second.datagram.size());
+            stats_.retransmits++;
+            resent = true;
+            ++out;
+        }
+        if (resent) {
+            remote.rtt.backoff();
+            next = std::min(next, now + remote.rtt.rto());
+        }
+    }
+    stats_.syscalls += transmit(fd_, batch.messages);
+    return next;
+}
+
+void DatagramChannel::flushAcks() {
+    std::vector<std::array<uint8_t, ACK_SIZE>> acks;
+    std::vector<sockaddr_in> to;
+    for (auto& kv : sources_) {
+        Source& source = kv.second;
+        if (!source.ackDue) continue;
+        source.ackDue = false;
+        std::array<uint8_t, ACK_SIZE> ack{};
+        ack[0] = MAGIC;
+        ack[1] = ACK;
+        put32(ack.data() + 2, source.session);
+        put32(ack.data() + 6, source.next);
+        for (int i = 0; i < 8; ++i) ack[10 + i] = (uint8_t)(source.bits >> (56 - 8 * i));
+        acks.push_back(ack);
+        sockaddr_in addr{}; addr.sin_family = AF_INET; addr.sin_port = source.port; addr.sin_addr.s_addr = source.ip;
+        to.push_back(addr);
+    }
+    if (acks.empty()) return;
+    Batch batch(acks.size());
+    for (size_t i = 0; i < acks.size(); ++i) batch.add(to[i], acks[i].data(), acks[i].size());
+    stats_.acksSent += acks.size();
+    stats_.syscalls += transmit(fd_, batch.messages);
+}
+
+#else
+
+bool DatagramChannel::start(uint16_t port) {
+    (void)port;
+    return false;
+}
+
+void DatagramChannel::stop() {
+}
+
+void DatagramChannel::wake() {
+}
+
+std::vector<bool> DatagramChannel::send(const std::vector<Datagram>& datagrams) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.refused += datagrams.size();
+    return std::vector<bool>(datagrams.size(), false);
+}
+
+void DatagramChannel::run() {
+}
+
+void DatagramChannel::handleData(const std::string& key, uint32_t ip, uint16_t port, const uint8_t* data, size_t size,
+                                 Clock::time_point now, std::vector<std::vector<uint8_t>>& frames) {
+    (void)key; (void)ip; (void)port; (void)data; (void)size; (void)now; (void)frames;
+}
+
+void DatagramChannel::evictSource(Clock::time_point now) {
+    (void)now;
+}
+
+void DatagramChannel::handleAck(const std::string& key, const uint8_t* data, size_t size, Clock::time_point now,
+                                std::vector<Delivery>& delivered) {
+    (void)key; (void)data; (void)size; (void)now; (void)delivered;
+}
+
+DatagramChannel::Clock::time_point DatagramChannel::retransmit(Clock::time_point now,
+                                                               std::vector<std::pair<std::string, std::vector<uint8_t>>>& expired) {
+    (void)expired;
+    return now;
+}
+
+void DatagramChannel::flushAcks() {
+}
+
+#endif
+
+} // namespace echo
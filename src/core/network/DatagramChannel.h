@@ -0,0 +1,148 @@
+#pragma once
+
+#include "core/protocol/RttEstimator.h"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace echo {
+
+struct DatagramStats {
+    uint64_t sent = 0;
+    uint64_t acked = 0;
+    uint64_t retransmits = 0;
+    uint64_t expired = 0;
+    uint64_t refused = 0;
+    uint64_t received = 0;
+    uint64_t duplicates = 0;
+    uint64_t acksSent = 0;
+    uint64_t acksReceived = 0;
+    uint64_t syscalls = 0;
+    size_t inFlight = 0;
+};
+
+// Carries small frames to LAN peers as single UDP datagrams, without TCP's connection setup.
+// Each datagram has a per-peer sequence number under a random session id, and the oldest sequence
+// its sender still has outstanding. The receiver answers every batch it reads with one ACK per
+// sender: the next sequence it expects plus a bitmap of the 64 after it. Unacknowledged datagrams
+// are resent on an RTT-based timeout and handed back through the expired callback after
+// MAX_RETRIES, so the caller can deliver them another way; the receiver then moves past them.
+// Frames are delivered as they arrive, duplicates dropped, not reordered. Sends and receives go
+// through sendmmsg and recvmmsg, so a round of frames or a burst of arrivals costs one call.
+// Linux only; start() fails elsewhere.
+class DatagramChannel {
+public:
+    using Clock = std::chrono::steady_clock;
+    using FrameCallback = std::function<void(const std::vector<uint8_t>& frame)>;
+    using ExpiredCallback = std::function<void(const std::string& link, std::vector<uint8_t> frame)>;
+    // Reports an acknowledged frame with the time from its first send to the ACK.
+    using AckedCallback = std::function<void(const std::string& link, size_t bytes, Clock::duration took)>;
+
+    struct Datagram {
+        std::string link;
+        std::string ip;
+        uint16_t port = 0;
+        const std::vector<uint8_t>* frame = nullptr;
+    };
+
+    static constexpr size_t MAX_PAYLOAD = 1200;
+    static constexpr size_t HEADER = 14;
+    static constexpr uint32_t WINDOW = 64;
+    static constexpr int MAX_RETRIES = 5;
+    static constexpr size_t BATCH = 32;
+    static constexpr std::chrono::milliseconds INITIAL_RTO{50};
+    static constexpr std::chrono::milliseconds MIN_RTO{5};
+    static constexpr std::chrono::milliseconds IDLE_WAKE{200};
+    static constexpr size_t MAX_SOURCES = 256;
+    static constexpr std::chrono::seconds SOURCE_TIMEOUT{60};
+    static constexpr std::chrono::seconds SESSION_HOLD{2};
+
+    DatagramChannel(FrameCallback onFrame, ExpiredCallback onExpired, AckedCallback onAcked = nullptr);
+    ~DatagramChannel();
+
+    // Port 0 binds an ephemeral port; port() reports the one bound.
+    bool start(uint16_t port);
+    void stop();
+    bool running() const { return running_; }
+    uint16_t port() const { return port_; }
+
+    // Sends the frames with one sendmmsg. An entry is false when its frame was not taken: too
+    // large, the peer's window is full, or the channel is not running.
+    std::vector<bool> send(const std::vector<Datagram>& datagrams);
+
+    DatagramStats stats() const;
+
+private:
+    struct Outstanding {
+        std::vector<uint8_t> datagram;
+        Clock::time_point first;
+        Clock::time_point sent;
+        int retries = 0;
+    };
+
+    struct Delivery {
+        std::string link;
+        size_t bytes = 0;
+        Clock::duration took{};
+    };
+
+    // Sender side, one per destination address.
+    struct Remote {
+        std::string link;
+        std::string ip;
+        uint16_t port = 0;
+        uint32_t nextSequence = 0;
+        std::map<uint32_t, Outstanding> outstanding;
+        RttEstimator rtt{INITIAL_RTO, MIN_RTO};
+    };
+
+    // Receiver side, one per source address. bits holds which of next + 1 .. next + 64 arrived.
+    // At most MAX_SOURCES are kept; a new one replaces those silent for SOURCE_TIMEOUT, or else the quietest.
+    // A different session replaces the current one only after SESSION_HOLD without hearing it.
+    struct Source {
+        uint32_t session = 0;
+        uint32_t next = 0;
+        uint64_t bits = 0;
+        bool ackDue = false;
+        uint32_t ip = 0;
+        uint16_t port = 0;
+        Clock::time_point heard;
+    };
+
+    void run();
+    void handleData(const std::string& key, uint32_t ip, uint16_t port, const uint8_t* data, size_t size,
+                    Clock::time_point now, std::vector<std::vector<uint8_t>>& frames);
+    void handleAck(const std::string& key, const uint8_t* data, size_t size, Clock::time_point now,
+                   std::vector<Delivery>& delivered);
+    void evictSource(Clock::time_point now);
+    Clock::time_point retransmit(Clock::time_point now, std::vector<std::pair<std::string, std::vector<uint8_t>>>& expired);
+    void flushAcks();
+    void wake();
+
+    FrameCallback onFrame_;
+    ExpiredCallback onExpired_;
+    AckedCallback onAcked_;
+
+    int fd_ = -1;
+    int wakeFd_ = -1;
+    uint16_t port_ = 0;
+    uint32_t session_ = 0;
+    std::atomic<bool> running_{false};
+    std::thread worker_;
+
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, Remote> remotes_;
+    std::unordered_map<std::string, Source> sources_;
+    Clock::time_point wakeAt_;
+    DatagramStats stats_;
+};
+
+} // namespace echo
@@ -0,0 +1,349 @@
+#include "IoUring.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__linux__) && defined(ECHO_HAVE_IO_URING)
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace echo {
+
+IoUring::~IoUring() {
+    close();
+}
+
+#if defined(__linux__) && defined(ECHO_HAVE_IO_URING)
+
+namespace {
+
+int setup(unsigned entries, io_uring_params* params) {
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+int registerRing(int fd, unsigned opcode, void* arg, unsigned count) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, count);
+}
+
+}
+
+bool IoUring::available() {
+    static const bool supported = []() {
+        IoUring ring;
+        if (!ring.init(4) || !ring.provideBuffers(1, 64)) return false;
+        std::vector<uint8_t> memory(sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op), 0);
+        auto* probe = reinterpret_cast<io_uring_probe*>(memory.data());
+        if (registerRing(ring.fd_, IORING_REGISTER_PROBE, probe, 256) < 0) return false;
+        for (int op : {IORING_OP_ACCEPT, IORING_OP_RECV, IORING_OP_SEND, IORING_OP_POLL_ADD, IORING_OP_ASYNC_CANCEL}) {
+            if (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED)) return false;
+        }
+        // Multishot receive came last (6.0, after multishot accept in 5.19). Older kernels reject the
+        // flag, so one armed on a socket pair shows whether it works: the read must leave it armed.
+        int pair[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, pair) < 0) return false;
+        std::vector<Completion> done;
+        bool multishot = ring.recvMultishot(pair[0], 1) && ::write(pair[1], "x", 1) == 1 &&
+                         ring.submitAndWait(1, done) && !done.empty() && done[0].res == 1 && done[0].more;
+        ring.close();
+        ::close(pair[0]);
+        ::close(pair[1]);
+        return multishot;
+    }();
+    return supported;
+}
+
+bool IoUring::init(unsigned entries) {
+    close();
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    // Multishot requests post many completions each, so the completion queue is sized well past the submissions.
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = entries * 8;
+    fd_ = setup(entries, &params);
+    if (fd_ < 0) return false;
+
+    sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single) sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+    sqRing_ = mmap(nullptr, sqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+    if (sqRing_ == MAP_FAILED) {
+        sqRing_ = nullptr;
+        close();
+        return false;
+    }
+    cqRing_ = single ? sqRing_ : mmap(nullptr, cqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING);
+    sqesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+    sqes_ = mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+    if (cqRing_ == MAP_FAILED || sqes_ == MAP_FAILED) {
+        if (cqRing_ == MAP_FAILED) cqRing_ = nullptr;
+        if (sqes_ == MAP_FAILED) sqes_ = nullptr;
+        close();
+        return false;
+    }
+
+    auto* sq = static_cast<uint8_t*>(sqRing_);
+    auto* cq = static_cast<uint8_t*>(cqRing_);
+    sqHead_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sqTail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sqArray_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    sqMask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    cqHead_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cqTail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cqMask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes_ = cq + params.cq_off.cqes;
+    entries_ = params.sq_entries;
+    sqLocalTail_ = *sqTail_;
+    pending_ = 0;
+    return true;
+}
+
+void IoUring::close() {
+    if (bufRing_) munmap(bufRing_, bufRingSize_);
+    if (sqes_) munmap(sqes_, sqesSize_);
+    if (cqRing_ && cqRing_ != sqRing_) munmap(cqRing_, cqRingSize_);
+    if (sqRing_) munmap(sqRing_, sqRingSize_);
+    if (fd_ >= 0) ::close(fd_);
+    fd_ = -1;
+    bufRing_ = sqes_ = cqRing_ = sqRing_ = nullptr;
+    buffers_.clear();
+    bufferCount_ = 0;
+    bufTail_ = 0;
+}
+
+bool IoUring::provideBuffers(unsigned count, size_t size) {
+    if (fd_ < 0 || bufRing_ || count == 0 || (count & (count - 1)) != 0) return false;
+    bufRingSize_ = count * sizeof(io_uring_buf);
+    bufRing_ = mmap(nullptr, bufRingSize_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (bufRing_ == MAP_FAILED) {
+        bufRing_ = nullptr;
+        return false;
+    }
+    io_uring_buf_reg reg;
+    std::memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = reinterpret_cast<uint64_t>(bufRing_);
+    reg.ring_entries = count;
+    reg.bgid = 0;
+    if (registerRing(fd_, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        munmap(bufRing_, bufRingSize_);
+        bufRing_ = nullptr;
+        return false;
+    }
+    buffers_.assign(count * size, 0);
+    bufferSize_ = size;
+    bufferCount_ = count;
+    bufTail_ = 0;
+    for (unsigned id = 0; id < count; ++id) recycle((int)id);
+    return true;
+}
+
+const uint8_t* IoUring::buffer(int id) const {
+    return buffers_.data() + (size_t)id * bufferSize_;
+}
+
+void IoUring::recycle(int id) {
+    // Indexed by hand: io_uring_buf_ring's flexible array gains an offset when the uapi header is
+    // compiled as C++. The ring tail overlays the reserved field of the first entry.
+    auto* entries = static_cast<io_uring_buf*>(bufRing_);
+    io_uring_buf& entry = entries[bufTail_ & (bufferCount_ - 1)];
+    entry.addr = reinterpret_cast<uint64_t>(buffers_.data() + (size_t)id * bufferSize_);
+    entry.len = (uint32_t)bufferSize_;
+    entry.bid = (uint16_t)id;
+    bufTail_++;
+    __atomic_store_n(&entries[0].resv, bufTail_, __ATOMIC_RELEASE);
+}
+
+void* IoUring::prepare(uint8_t opcode, int fd, uint64_t userData) {
+    if (fd_ < 0) return nullptr;
+    if (sqLocalTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE) >= entries_) {
+        if (enter(pending_, 0) < 0 || sqLocalTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE) >= entries_) return nullptr;
+    }
+    unsigned index = sqLocalTail_ & sqMask_;
+    auto* sqe = static_cast<io_uring_sqe*>(sqes_) + index;
+    std::memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = opcode;
+    sqe->fd = fd;
+    sqe->user_data = userData;
+    sqArray_[index] = index;
+    sqLocalTail_++;
+    pending_++;
+    return sqe;
+}
+
+bool IoUring::acceptMultishot(int fd, uint64_t userData) {
+    auto* sqe = static_cast<io_uring_sqe*>(prepare(IORING_OP_ACCEPT, fd, userData));
+    if (!sqe) return false;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+    return true;
+}
+
+bool IoUring::recvMultishot(int fd, uint64_t userData) {
+    auto* sqe = static_cast<io_uring_sqe*>(prepare(IORING_OP_RECV, fd, userData));
+    if (!sqe) return false;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = 0;
+    return true;
+}
+
+bool IoUring::send(int fd, const void* data, size_t len, uint64_t userData) {
+    auto* sqe = static_cast<io_uring_sqe*>(prepare(IORING_OP_SEND, fd, userData));
+    if (!sqe) return false;
+    sqe->addr = reinterpret_cast<uint64_t>(data);
+    sqe->len = (uint32_t)len;
+    sqe->msg_flags = MSG_NOSIGNAL | MSG_DONTWAIT;
+    return true;
+}
+
+bool IoUring::pollIn(int fd, uint64_t userData) {
+    auto* sqe = static_cast<io_uring_sqe*>(prepare(IORING_OP_POLL_ADD, fd, userData));
+    if (!sqe) return false;
+    sqe->poll32_events = POLLIN;
+    return true;
+}
+
+bool IoUring::cancel(uint64_t target, uint64_t userData) {
+    auto* sqe = static_cast<io_uring_sqe*>(prepare(IORING_OP_ASYNC_CANCEL, -1, userData));
+    if (!sqe) return false;
+    sqe->addr = target;
+    return true;
+}
+
+int IoUring::enter(unsigned toSubmit, unsigned minComplete) {
+    // Prepared entries become visible to the kernel here, after the callers have filled them in.
+    __atomic_store_n(sqTail_, sqLocalTail_, __ATOMIC_RELEASE);
+    while (true) {
+        enters_++;
+        int n = (int)syscall(__NR_io_uring_enter, fd_, toSubmit, minComplete, minComplete > 0 ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+        if (n >= 0) {
+            pending_ -= std::min<unsigned>(pending_, (unsigned)n);
+            return n;
+        }
+        if (errno == EINTR) continue;
+        // A full completion queue refuses new work until it is drained; the caller reaps and retries.
+        return errno == EBUSY || errno == EAGAIN ? 0 : -1;
+    }
+}
+
+size_t IoUring::reap(std::vector<Completion>& out) {
+    unsigned head = *cqHead_;
+    unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+    auto* cqes = static_cast<io_uring_cqe*>(cqes_);
+    size_t count = 0;
+    for (; head != tail; ++head, ++count) {
+        const io_uring_cqe& cqe = cqes[head & cqMask_];
+        Completion completion;
+        completion.userData = cqe.user_data;
+        completion.res = cqe.res;
+        completion.more = (cqe.flags & IORING_CQE_F_MORE) != 0;
+        if (cqe.flags & IORING_CQE_F_BUFFER) completion.buffer = (int)(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+        out.push_back(completion);
+    }
+    __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+    return count;
+}
+
+bool IoUring::submitAndWait(unsigned minComplete, std::vector<Completion>& out) {
+    if (fd_ < 0) return false;
+    // Every prepared entry reaches the kernel before this returns. A busy ring is drained and
+    // entered again, so callers never keep buffers that a request still queued points into.
+    size_t reaped = 0;
+    int stalls = 0;
+    while (true) {
+        size_t got = reap(out);
+        reaped += got;
+        unsigned wanted = reaped < minComplete ? minComplete - (unsigned)reaped : 0;
+        if (pending_ == 0 && wanted == 0) return true;
+        unsigned before = pending_;
+        int n = enter(pending_, wanted);
+        if (n < 0) return false;
+        if (got == 0 && pending_ == before && n == 0 && ++stalls > MAX_STALLS) return false;
+        if (got > 0 || pending_ != before) stalls = 0;
+    }
+}
+
+#else
+
+bool IoUring::available() {
+    return false;
+}
+
+bool IoUring::init(unsigned entries) {
+    (void)entries;
+    return false;
+}
+
+void IoUring::close() {
+}
+
+bool IoUring::provideBuffers(unsigned count, size_t size) {
+    (void)count;
+    (void)size;
+    return false;
+}
+
+const uint8_t* IoUring::buffer(int id) const {
+    (void)id;
+    return nullptr;
+}
+
+void IoUring::recycle(int id) {
+    (void)id;
+}
+
+void* IoUring::prepare(uint8_t opcode, int fd, uint64_t userData) {
+    (void)opcode;
+    (void)fd;
+    (void)userData;
+    return nullptr;
+}
+
+bool IoUring::acceptMultishot(int fd, uint64_t userData) {
+    return prepare(0, fd, userData) != nullptr;
+}
+
+bool IoUring::recvMultishot(int fd, uint64_t userData) {
+    return prepare(0, fd, userData) != nullptr;
+}
+
+bool IoUring::send(int fd, const void* data, size_t len, uint64_t userData) {
+    (void)data;
+    (void)len;
+    return prepare(0, fd, userData) != nullptr;
+}
+
+bool IoUring::pollIn(int fd, uint64_t userData) {
+    return prepare(0, fd, userData) != nullptr;
+}
+
+bool IoUring::cancel(uint64_t target, uint64_t userData) {
+    (void)target;
+    return prepare(0, -1, userData) != nullptr;
+}
+
+int IoUring::enter(unsigned toSubmit, unsigned minComplete) {
+    (void)toSubmit;
+    (void)minComplete;
+    return -1;
+}
+
+size_t IoUring::reap(std::vector<Completion>& out) {
+    (void)out;
+    return 0;
+}
+
+bool IoUring::submitAndWait(unsigned minComplete, std::vector<Completion>& out) {
+    (void)minComplete;
+    (void)out;
+    return false;
+}
+
+#endif
+
+} // namespace echo
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace echo {
+
+// A minimal io_uring instance driven through the raw system calls, so liburing is not needed.
+// It covers what the WiFi TCP path uses: multishot accept, multishot receive into a ring of
+// buffers registered with the kernel, sends, a readiness poll and cancellation. Requests are
+// queued by the prepare calls and go to the kernel together on the next submitAndWait().
+// Built only on Linux with ECHO_HAVE_IO_URING; elsewhere available() is false and init() fails.
+class IoUring {
+public:
+    struct Completion {
+        uint64_t userData = 0;
+        int32_t res = 0;
+        bool more = false;
+        int buffer = -1;
+    };
+
+    IoUring() = default;
+    ~IoUring();
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    // True when the running kernel supports everything above. Probed once per process.
+    static bool available();
+
+    bool init(unsigned entries);
+    void close();
+    bool ready() const { return fd_ >= 0; }
+
+    // Registers count buffers of size bytes each (count a power of two) for multishot receives.
+    bool provideBuffers(unsigned count, size_t size);
+    const uint8_t* buffer(int id) const;
+    void recycle(int id);
+
+    bool acceptMultishot(int fd, uint64_t userData);
+    bool recvMultishot(int fd, uint64_t userData);
+    bool send(int fd, const void* data, size_t len, uint64_t userData);
+    bool pollIn(int fd, uint64_t userData);
+    bool cancel(uint64_t target, uint64_t userData);
+
+    // Submits everything prepared, waits until at least minComplete completions are ready and
+    // appends all ready completions to out. False when the ring itself fails or stays busy; some
+    // requests may then still be queued, and the caller cancels them before freeing their buffers.
+    bool submitAndWait(unsigned minComplete, std::vector<Completion>& out);
+
+    // io_uring_enter calls made so far, the ring's only system call once it is set up.
+    uint64_t enters() const { return enters_; }
+
+private:
+    static constexpr int MAX_STALLS = 64;
+
+    void* prepare(uint8_t opcode, int fd, uint64_t userData);
+    // Requests submitted, 0 when the ring is busy, -1 when it failed.
+    int enter(unsigned toSubmit, unsigned minComplete);
+    size_t reap(std::vector<Completion>& out);
+
+    int fd_ = -1;
+    unsigned entries_ = 0;
+    void* sqRing_ = nullptr;
+    size_t sqRingSize_ = 0;
+    void* cqRing_ = nullptr;
+    size_t cqRingSize_ = 0;
+    void* sqes_ = nullptr;
+    size_t sqesSize_ = 0;
+    unsigned* sqHead_ = nullptr;
+    unsigned* sqTail_ = nullptr;
+    unsigned* sqArray_ = nullptr;
+    unsigned sqMask_ = 0;
+    unsigned sqLocalTail_ = 0;
+    unsigned pending_ = 0;
+    unsigned* cqHead_ = nullptr;
+    unsigned* cqTail_ = nullptr;
+    unsigned cqMask_ = 0;
+    void* cqes_ = nullptr;
+
+    void* bufRing_ = nullptr;
+    size_t bufRingSize_ = 0;
+    std::vector<uint8_t> buffers_;
+    size_t bufferSize_ = 0;
+    unsigned bufferCount_ = 0;
+    uint16_t bufTail_ = 0;
+
+    uint64_t enters_ = 0;
+};
+
+} // namespace echo
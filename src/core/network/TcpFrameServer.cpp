@@ -0,0 +1,432 @@
+#include "TcpFrameServer.h"
+#include <algorithm>
+#include <cstring>
+
+#ifdef __linux__
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace echo {
+
+const char* backendName(TcpBackend backend) {
+    switch (backend) {
+        case TcpBackend::Auto: return "auto";
+        case TcpBackend::Epoll: return "epoll";
+        case TcpBackend::Uring: return "io_uring";
+    }
+    return "unknown";
+}
+
+TcpFrameServer::TcpFrameServer(size_t maxFrame, FrameCallback onFrame, size_t workers, TcpBackend backend)
+    : maxFrame_(maxFrame), onFrame_(std::move(onFrame)), workerCount_(std::max<size_t>(1, workers)), requested_(backend) {
+}
+
+TcpFrameServer::~TcpFrameServer() {
+    stop();
+}
+
+TcpServerStats TcpFrameServer::stats() const {
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    TcpServerStats out = stats_;
+    out.syscalls = syscalls_.load(std::memory_order_relaxed);
+    return out;
+}
+
+#ifdef __linux__
+
+namespace {
+
+enum : uint64_t { WAKE_EVENT = 1, ACCEPT_EVENT = 2, RECV_EVENT = 3, CANCEL_EVENT = 4 };
+
+uint64_t tag(uint64_t kind, int fd) {
+    return (kind << 32) | (uint32_t)fd;
+}
+
+}
+
+bool TcpFrameServer::start(uint16_t port) {
+    if (running_) return true;
+
+    listenFd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listenFd_ < 0) return false;
+    int yes = 1;
+    setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+    sockaddr_in addr{}; addr.sin_family = AF_INET; addr.sin_port = htons(port); addr.sin_addr.s_addr = INADDR_ANY;
+    socklen_t len = sizeof(addr);
+    if (bind(listenFd_, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(listenFd_, SOMAXCONN) < 0 ||
+        getsockname(listenFd_, (sockaddr*)&addr, &len) < 0) {
+        ::close(listenFd_);
+        listenFd_ = -1;
+        return false;
+    }
+    port_ = ntohs(addr.sin_port);
+
+    backend_ = TcpBackend::Epoll;
+    if (requested_ != TcpBackend::Epoll) {
+        if (IoUring::available() && ring_.init(RING_ENTRIES) && ring_.provideBuffers(RING_BUFFERS, RING_BUFFER_SIZE)) {
+            backend_ = TcpBackend::Uring;
+        } else {
+            ring_.close();
+            if (requested_ == TcpBackend::Uring) {
+                ::close(listenFd_);
+                listenFd_ = -1;
+                return false;
+            }
+        }
+    }
+
+    wakeFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    bool ready = wakeFd_ >= 0;
+    if (ready && backend_ == TcpBackend::Epoll) {
+        epollFd_ = epoll_create1(EPOLL_CLOEXEC);
+        epoll_event listenEvent{}; listenEvent.events = EPOLLIN; listenEvent.data.fd = listenFd_;
+        epoll_event wakeEvent{}; wakeEvent.events = EPOLLIN; wakeEvent.data.fd = wakeFd_;
+        ready = epollFd_ >= 0 && epoll_ctl(epollFd_, EPOLL_CTL_ADD, listenFd_, &listenEvent) == 0 &&
+                epoll_ctl(epollFd_, EPOLL_CTL_ADD, wakeFd_, &wakeEvent) == 0;
+    }
+    if (!ready) {
+        if (epollFd_ >= 0) ::close(epollFd_);
+        if (wakeFd_ >= 0) ::close(wakeFd_);
+        ::close(listenFd_);
+        ring_.close();
+        epollFd_ = wakeFd_ = listenFd_ = -1;
+        return false;
+    }
+
+    scratch_.resize(READ_CHUNK);
+    syscalls_ = 0;
+    listening_ = true;
+    running_ = true;
+    for (size_t i = 0; i < workerCount_; ++i) {
+        workers_.push_back(std::make_unique<Worker>());
+        Worker& worker = *workers_.back();
+        worker.thread = std::thread([this, &worker]() { work(worker); });
+    }
+    reactor_ = std::thread([this]() { run(); });
+    return true;
+}
+
+void TcpFrameServer::stop() {
+    if (!running_.exchange(false)) return;
+    uint64_t one = 1;
+    ssize_t woken = write(wakeFd_, &one, sizeof(one));
+    (void)woken;
+    for (auto& worker : workers_) {
+        { std::lock_guard<std::mutex> lock(worker->mutex); }
+        worker->ready.notify_all();
+        worker->space.notify_all();
+    }
+    if (reactor_.joinable()) reactor_.join();
+    for (auto& worker : workers_) {
+        if (worker->thread.joinable()) worker->thread.join();
+    }
+    workers_.clear();
+
+    // Closing the ring cancels whatever accept and receive requests are still armed.
+    ring_.close();
+    for (auto& kv : connections_) ::close(kv.first);
+    connections_.clear();
+    ::close(listenFd_);
+    if (epollFd_ >= 0) ::close(epollFd_);
+    ::close(wakeFd_);
+    listenFd_ = epollFd_ = wakeFd_ = -1;
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    stats_.active = 0;
+}
+
+void TcpFrameServer::run() {
+    if (backend_ == TcpBackend::Uring) {
+        runUring();
+        return;
+    }
+    epoll_event events[64];
+    while (running_) {
+        int n = epoll_wait(epollFd_, events, 64, -1);
+        syscalls_.fetch_add(1, std::memory_order_relaxed);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        for (int i = 0; i < n && running_; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == wakeFd_) continue;
+            if (fd == listenFd_) {
+                acceptAll();
+                continue;
+            }
+            auto it = connections_.find(fd);
+            if (it == connections_.end()) continue;
+            if (!readFrom(it->second)) drop(fd);
+        }
+    }
+}
+
+void TcpFrameServer::acceptAll() {
+    // At the connection limit the listener leaves epoll, so further peers wait in the kernel backlog
+    // until a connection closes instead of being accepted and dropped.
+    for (size_t i = 0; i < ACCEPT_BATCH; ++i) {
+        if (connections_.size() >= MAX_CONNECTIONS) {
+            epoll_ctl(epollFd_, EPOLL_CTL_DEL, listenFd_, nullptr);
+            syscalls_.fetch_add(1, std::memory_order_relaxed);
+            listening_ = false;
+            std::lock_guard<std::mutex> lock(statsMutex_);
+            stats_.acceptPauses++;
+            return;
+        }
+        int fd = accept4(listenFd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        syscalls_.fetch_add(1, std::memory_order_relaxed);
+        if (fd < 0) return;
+        epoll_event event{}; event.events = EPOLLIN | EPOLLRDHUP; event.data.fd = fd;
+        syscalls_.fetch_add(1, std::memory_order_relaxed);
+        if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &event) < 0) {
+            ::close(fd);
+            continue;
+        }
+        adopt(fd);
+    }
+}
+
+void TcpFrameServer::adopt(int fd) {
+    // Senders keep their connection open between messages; keepalive reaps the ones whose peer vanished.
+    int yes = 1;
+    setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &yes, sizeof(yes));
+    Connection& connection = connections_[fd];
+    connection.fd = fd;
+    connection.worker = nextWorker_++ % workerCount_;
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    stats_.accepted++;
+    stats_.active = connections_.size();
+}
+
+void TcpFrameServer::runUring() {
+    std::vector<IoUring::Completion> done;
+    ring_.pollIn(wakeFd_, tag(WAKE_EVENT, wakeFd_));
+    acceptArmed_ = ring_.acceptMultishot(listenFd_, tag(ACCEPT_EVENT, listenFd_));
+    while (running_) {
+        done.clear();
+        bool ok = ring_.submitAndWait(1, done);
+        syscalls_.store(ring_.enters(), std::memory_order_relaxed);
+        if (!ok) break;
+        for (const auto& completion : done) {
+            if (!running_) break;
+            switch (completion.userData >> 32) {
+                case ACCEPT_EVENT: accepted(completion); break;
+                case RECV_EVENT: received(completion); break;
+                default: break;
+            }
+        }
+    }
+}
+
+void TcpFrameServer::accepted(const IoUring::Completion& completion) {
+    if (completion.res >= 0) {
+        int fd = completion.res;
+        adopt(fd);
+        if (!ring_.recvMultishot(fd, tag(RECV_EVENT, fd))) drop(fd);
+        // The same pause as epoll: cancel the accept and let peers wait in the backlog. Accepts the
+        // kernel completed before the cancel landed are still served.
+        if (listening_ && connections_.size() >= MAX_CONNECTIONS) {
+            listening_ = false;
+            ring_.cancel(tag(ACCEPT_EVENT, listenFd_), tag(CANCEL_EVENT, listenFd_));
+            std::lock_guard<std::mutex> lock(statsMutex_);
+            stats_.acceptPauses++;
+        }
+    }
+    if (completion.more) return;
+    acceptArmed_ = listening_ && ring_.acceptMultishot(listenFd_, tag(ACCEPT_EVENT, listenFd_));
+}
+
+void TcpFrameServer::received(const IoUring::Completion& completion) {
+    int fd = (int)(uint32_t)completion.userData;
+    auto it = connections_.find(fd);
+    if (it == connections_.end()) {
+        if (completion.buffer >= 0) ring_.recycle(completion.buffer);
+        return;
+    }
+    Connection& connection = it->second;
+    if (completion.buffer >= 0) {
+        if (completion.res > 0 && !connection.closing &&
+            !consume(connection, ring_.buffer(completion.buffer), static_cast<size_t>(completion.res))) {
+            // The receive is still armed, so the socket is shut down rather than closed; its final
+            // completion closes it once the kernel no longer refers to it.
+            connection.closing = true;
+            shutdown(fd, SHUT_RDWR);
+        }
+        ring_.recycle(completion.buffer);
+    }
+    if (completion.more) return;
+    // Running out of buffers ends a multishot receive without ending the connection.
+    bool open = !connection.closing && (completion.res > 0 || completion.res == -ENOBUFS);
+    if (open && ring_.recvMultishot(fd, tag(RECV_EVENT, fd))) return;
+    drop(fd);
+}
+
+bool TcpFrameServer::readFrom(Connection& connection) {
+    // One read per wakeup: epoll is level-triggered, so a busy sender cannot starve the others.
+    ssize_t n = recv(connection.fd, scratch_.data(), scratch_.size(), 0);
+    syscalls_.fetch_add(1, std::memory_order_relaxed);
+    if (n < 0) return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    if (n == 0) return false;
+    return consume(connection, scratch_.data(), static_cast<size_t>(n));
+}
+
+bool TcpFrameServer::consume(Connection& connection, const uint8_t* data, size_t available) {
+    size_t offset = 0;
+    uint64_t frames = 0;
+    uint64_t bytes = 0;
+    while (offset < available) {
+        if (connection.headerFill < sizeof(connection.header)) {
+            size_t take = std::min(sizeof(connection.header) - connection.headerFill, available - offset);
+            std::memcpy(connection.header + connection.headerFill, data + offset, take);
+            connection.headerFill += take;
+            offset += take;
+            if (connection.headerFill < sizeof(connection.header)) break;
+            uint32_t len = ((uint32_t)connection.header[0] << 24) | ((uint32_t)connection.header[1] << 16) |
+                           ((uint32_t)connection.header[2] << 8) | (uint32_t)connection.header[3];
+            if (len == 0 || len > maxFrame_) {
+                std::lock_guard<std::mutex> lock(statsMutex_);
+                stats_.malformed++;
+                return false;
+            }
+            connection.frame.resize(len);
+            connection.frameFill = 0;
+            continue;
+        }
+        size_t take = std::min(connection.frame.size() - connection.frameFill, available - offset);
+        std::memcpy(connection.frame.data() + connection.frameFill, data + offset, take);
+        connection.frameFill += take;
+        offset += take;
+        if (connection.frameFill == connection.frame.size()) {
+            frames++;
+            bytes += connection.frame.size();
+            dispatch(connection.worker, std::move(connection.frame));
+            connection.frame = std::vector<uint8_t>();
+            connection.headerFill = 0;
+            connection.frameFill = 0;
+        }
+    }
+    if (frames > 0) {
+        std::lock_guard<std::mutex> lock(statsMutex_);
+        stats_.frames += frames;
+        stats_.bytes += bytes;
+    }
+    return true;
+}
+
+void TcpFrameServer::drop(int fd) {
+    if (backend_ == TcpBackend::Epoll) {
+        epoll_ctl(epollFd_, EPOLL_CTL_DEL, fd, nullptr);
+        syscalls_.fetch_add(1, std::memory_order_relaxed);
+    }
+    ::close(fd);
+    connections_.erase(fd);
+    if (!listening_ && connections_.size() < MAX_CONNECTIONS) {
+        if (backend_ == TcpBackend::Uring) {
+            listening_ = true;
+            if (!acceptArmed_) acceptArmed_ = ring_.acceptMultishot(listenFd_, tag(ACCEPT_EVENT, listenFd_));
+        } else {
+            epoll_event event{}; event.events = EPOLLIN; event.data.fd = listenFd_;
+            listening_ = epoll_ctl(epollFd_, EPOLL_CTL_ADD, listenFd_, &event) == 0;
+            syscalls_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    stats_.closed++;
+    stats_.active = connections_.size();
+}
+
+void TcpFrameServer::dispatch(size_t index, std::vector<uint8_t> frame) {
+    Worker& worker = *workers_[index];
+    std::unique_lock<std::mutex> lock(worker.mutex);
+    if (worker.frames.size() >= MAX_QUEUED) {
+        {
+            std::lock_guard<std::mutex> statsLock(statsMutex_);
+            stats_.stalls++;
+        }
+        worker.space.wait(lock, [&]() { return worker.frames.size() < MAX_QUEUED || !running_; });
+        if (!running_) return;
+    }
+    worker.frames.push_back(std::move(frame));
+    lock.unlock();
+    worker.ready.notify_one();
+}
+
+void TcpFrameServer::work(Worker& worker) {
+    std::unique_lock<std::mutex> lock(worker.mutex);
+    while (true) {
+        worker.ready.wait(lock, [&]() { return !worker.frames.empty() || !running_; });
+        if (worker.frames.empty()) return;
+        std::vector<uint8_t> frame = std::move(worker.frames.front());
+        worker.frames.pop_front();
+        lock.unlock();
+        worker.space.notify_one();
+        if (onFrame_) onFrame_(frame);
+        lock.lock();
+    }
+}
+
+#else
+
+bool TcpFrameServer::start(uint16_t port) {
+    (void)port;
+    return false;
+}
+
+void TcpFrameServer::stop() {
+}
+
+void TcpFrameServer::run() {
+}
+
+void TcpFrameServer::runUring() {
+}
+
+void TcpFrameServer::acceptAll() {
+}
+
+void TcpFrameServer::adopt(int fd) {
+    (void)fd;
+}
+
+void TcpFrameServer::accepted(const IoUring::Completion& completion) {
+    (void)completion;
+}
+
+void TcpFrameServer::received(const IoUring::Completion& completion) {
+    (void)completion;
+}
+
+bool TcpFrameServer::readFrom(Connection& connection) {
+    (void)connection;
+    return false;
+}
+
+bool TcpFrameServer::consume(Connection& connection, const uint8_t* data, size_t size) {
+    (void)connection;
+    (void)data;
+    (void)size;
+    return false;
+}
+
+void TcpFrameServer::drop(int fd) {
+    (void)fd;
+}
+
+void TcpFrameServer::dispatch(size_t index, std::vector<uint8_t> frame) {
+    (void)index;
+    (void)frame;
+}
+
+void TcpFrameServer::work(Worker& worker) {
+    (void)worker;
+}
+
+#endif
+
+} // namespace echo
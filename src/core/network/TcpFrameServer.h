@@ -0,0 +1,124 @@
+#pragma once
+
+#include "IoUring.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace echo {
+
+struct TcpServerStats {
+    uint64_t accepted = 0;
+    uint64_t acceptPauses = 0;
+    uint64_t closed = 0;
+    uint64_t malformed = 0;
+    uint64_t frames = 0;
+    uint64_t bytes = 0;
+    uint64_t stalls = 0;
+    uint64_t syscalls = 0;
+    size_t active = 0;
+};
+
+// Auto uses io_uring when the kernel supports it and epoll otherwise.
+enum class TcpBackend { Auto, Epoll, Uring };
+
+const char* backendName(TcpBackend backend);
+
+// Receives length-prefixed frames ([len (4, big endian)][frame]) from any number of TCP
+// connections on one epoll thread. Complete frames are handed to a fixed pool of workers; every
+// frame from one connection goes to the same worker, so per-connection order is kept. When a
+// worker's queue is full the reactor waits, which pushes back on senders through TCP flow control.
+// The io_uring backend accepts and reads through multishot requests into kernel-registered
+// buffers, so a busy reactor makes one system call per batch of completions rather than one per
+// read. Linux only; start() fails elsewhere and callers keep their own accept loop.
+class TcpFrameServer {
+public:
+    using FrameCallback = std::function<void(const std::vector<uint8_t>& frame)>;
+
+    static constexpr size_t MAX_CONNECTIONS = 1024;
+    static constexpr size_t ACCEPT_BATCH = 64;
+    static constexpr size_t DEFAULT_WORKERS = 2;
+    static constexpr size_t MAX_QUEUED = 256;
+    static constexpr size_t READ_CHUNK = 64 * 1024;
+    static constexpr unsigned RING_ENTRIES = 256;
+    static constexpr unsigned RING_BUFFERS = 256;
+    static constexpr size_t RING_BUFFER_SIZE = 16 * 1024;
+
+    TcpFrameServer(size_t maxFrame, FrameCallback onFrame, size_t workers = DEFAULT_WORKERS,
+                   TcpBackend backend = TcpBackend::Auto);
+    ~TcpFrameServer();
+
+    // Port 0 binds an ephemeral port; port() reports the one bound. Asking for Uring fails when the
+    // kernel lacks it; Auto falls back to epoll.
+    bool start(uint16_t port);
+    void stop();
+    uint16_t port() const { return port_; }
+    // The backend in use once started.
+    TcpBackend backend() const { return backend_; }
+    TcpServerStats stats() const;
+
+private:
+    struct Connection {
+        int fd = -1;
+        size_t worker = 0;
+        uint8_t header[4] = {0, 0, 0, 0};
+        size_t headerFill = 0;
+        std::vector<uint8_t> frame;
+        size_t frameFill = 0;
+        bool closing = false;
+    };
+
+    struct Worker {
+        std::mutex mutex;
+        std::condition_variable ready;
+        std::condition_variable space;
+        std::deque<std::vector<uint8_t>> frames;
+        std::thread thread;
+    };
+
+    void run();
+    void runUring();
+    void acceptAll();
+    void adopt(int fd);
+    void accepted(const IoUring::Completion& completion);
+    void received(const IoUring::Completion& completion);
+    bool readFrom(Connection& connection);
+    bool consume(Connection& connection, const uint8_t* data, size_t size);
+    void drop(int fd);
+    void dispatch(size_t worker, std::vector<uint8_t> frame);
+    void work(Worker& worker);
+
+    size_t maxFrame_;
+    FrameCallback onFrame_;
+    size_t workerCount_;
+    TcpBackend requested_;
+    TcpBackend backend_ = TcpBackend::Epoll;
+    std::vector<std::unique_ptr<Worker>> workers_;
+
+    int listenFd_ = -1;
+    int epollFd_ = -1;
+    int wakeFd_ = -1;
+    uint16_t port_ = 0;
+    bool listening_ = false;
+    bool acceptArmed_ = false;
+    std::atomic<bool> running_{false};
+    std::thread reactor_;
+    std::unordered_map<int, Connection> connections_;
+    std::vector<uint8_t> scratch_;
+    size_t nextWorker_ = 0;
+    IoUring ring_;
+    std::atomic<uint64_t> syscalls_{0};
+
+    mutable std::mutex statsMutex_;
+    TcpServerStats stats_;
+};
+
+} // namespace echo
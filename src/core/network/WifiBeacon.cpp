@@ -0,0 +1,55 @@
+#include "WifiBeacon.h"
+#include <algorithm>
+
+namespace echo {
+
+std::vector<uint8_t> WifiBeacon::serialize() const {
+    size_t ulen = std::min<size_t>(username.size(), 0xFF);
+    size_t flen = std::min<size_t>(fingerprint.size(), 0xFF);
+
+    // The trailing flags byte is optional; version 1 parsers stop after the port and ignore it.
+    std::vector<uint8_t> buf(1 + 1 + ulen + 1 + flen + 2 + 1);
+    uint8_t* p = buf.data();
+    *p++ = VERSION;
+    *p++ = static_cast<uint8_t>(ulen);
+    p = std::copy_n(username.begin(), ulen, p);
+    *p++ = static_cast<uint8_t>(flen);
+    p = std::copy_n(fingerprint.begin(), flen, p);
+    *p++ = static_cast<uint8_t>(port >> 8);
+    *p++ = static_cast<uint8_t>(port & 0xFF);
+    *p = datagrams ? FLAG_DATAGRAMS : 0;
+    return buf;
+}
+
+bool WifiBeacon::parse(const uint8_t* data, size_t size, WifiBeacon& out, std::string* error) {
+    auto fail = [error](const char* message) {
+        if (error) *error = message;
+        return false;
+    };
+
+    if (size < 1) return fail("Empty beacon");
+    if (data[0] != VERSION) {
+        if (error) *error = "Invalid version: " + std::to_string(data[0]);
+        return false;
+    }
+
+    size_t i = 1;
+    if (i >= size) return fail("Truncated beacon");
+    uint8_t ulen = data[i++];
+    if (i + ulen > size) return fail("Invalid username length");
+    out.username.assign(reinterpret_cast<const char*>(data + i), ulen);
+    i += ulen;
+
+    if (i >= size) return fail("Truncated beacon");
+    uint8_t flen = data[i++];
+    if (i + flen + 2 > size) return fail("Invalid fingerprint length");
+    out.fingerprint.assign(reinterpret_cast<const char*>(data + i), flen);
+    i += flen;
+
+    out.port = static_cast<uint16_t>((static_cast<uint16_t>(data[i]) << 8) | data[i + 1]);
+    i += 2;
+    out.datagrams = i < size && (data[i] & FLAG_DATAGRAMS) != 0;
+    return true;
+}
+
+} // namespace echo
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace echo {
+
+struct WifiBeacon {
+    std::string username;
+    std::string fingerprint;
+    uint16_t port = 0;
+    // The sender also takes datagrams on UDP at the same port number (see DatagramChannel).
+    bool datagrams = false;
+
+    static constexpr uint8_t VERSION = 1;
+    static constexpr uint8_t FLAG_DATAGRAMS = 0x01;
+
+    std::vector<uint8_t> serialize() const;
+    static bool parse(const uint8_t* data, size_t size, WifiBeacon& out, std::string* error = nullptr);
+};
+
+} // namespace echo
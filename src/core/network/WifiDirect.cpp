@@ -1,16 +1,21 @@
 #include "WifiDirect.h"
+#include "WifiBeacon.h"
 #include <chrono>
 #include <cstring>
 #include <algorithm>
+#include <condition_variable>
 #include <iostream>
 
 #ifdef __linux__
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <poll.h>
+#include <sys/eventfd.h>
 #elif defined(_WIN32)
 #include <winsock2.h>
 #include <ws2tcpip.h>
@@ -19,7 +24,38 @@
 
 namespace echo {
 
-WifiDirect::WifiDirect() {}
+static const char* BROADCAST_PEER = "*";
+
+WifiDirect::WifiDirect()
+    : pacer_([this](std::vector<LinkPacer::PacedWrite> round, const LinkPacer::Done& done) { submit(std::move(round), done); },
+             PacerConfig{PACING_RATE, MAX_FRAME, 16 * MAX_FRAME}),
+      batcher_([this](const std::string& peer, const std::vector<uint8_t>& data) {
+          return peer == BROADCAST_PEER ? paceBroadcast(data) : pacer_.enqueue(peer, data);
+      }),
+      tcpServer_(MAX_FRAME, [this](const std::vector<uint8_t>& frame) {
+          auto cb = onData_;
+          if (cb) cb("wifi", frame);
+          if (verbose_) std::cout << "[WIFI] rx bytes=" << frame.size() << std::endl;
+      }),
+      datagrams_([this](const std::vector<uint8_t>& frame) {
+                     auto cb = onData_;
+                     if (cb) cb("wifi", frame);
+                     if (verbose_) std::cout << "[WIFI] rx datagram bytes=" << frame.size() << std::endl;
+                 },
+                 [this](const std::string& link, std::vector<uint8_t> frame) {
+                     // The peer stops getting datagrams until its next beacon, and the frame goes again over TCP.
+                     {
+                         std::lock_guard<std::mutex> lock(mtx_);
+                         auto it = peers_.find(link);
+                         if (it != peers_.end()) it->second.datagrams = false;
+                     }
+                     if (verbose_) std::cout << "[WIFI] datagram expired to=" << link << " bytes=" << frame.size() << std::endl;
+                     pacer_.feedback(link, frame.size(), false, {});
+                     pacer_.enqueue(link, std::move(frame));
+                 },
+                 [this](const std::string& link, size_t bytes, DatagramChannel::Clock::duration took) {
+                     pacer_.feedback(link, bytes, true, took);
+                 }) {}
 WifiDirect::~WifiDirect() { stop(); }
 
 bool WifiDirect::start(const std::string& username, const std::string& fingerprint, uint16_t tcpPort) {
@@ -29,9 +65,32 @@ bool WifiDirect::start(const std::string& username, const std::string& fingerpri
     if (running_) return true;
     running_ = true;
     if (verbose_) std::cout << "[WIFI] start username=" << username_ << " port=" << tcpPort_ << std::endl;
+#ifdef __linux__
+    if (tcpServer_.start(tcpPort_)) {
+        if (verbose_) std::cout << "[WIFI] tcp listen port=" << tcpPort_ << std::endl;
+    } else if (verbose_) {
+        std::cout << "[WIFI] tcp bind fail" << std::endl;
+    }
+    if (datagrams_.start(tcpPort_)) {
+        if (verbose_) std::cout << "[WIFI] udp data port=" << tcpPort_ << std::endl;
+    } else if (verbose_) {
+        std::cout << "[WIFI] udp data bind fail" << std::endl;
+    }
+#else
+    tcpServerThread_ = std::thread([this]() { runTcpServer(); });
+#endif
+    // Beacons go out once the listeners are up, so the first one already advertises the datagram channel.
     udpTxThread_ = std::thread([this]() { runUdpTx(); });
     udpRxThread_ = std::thread([this]() { runUdpRx(); });
-    tcpServerThread_ = std::thread([this]() { runTcpServer(); });
+#ifdef __linux__
+    senderWakeFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (senderWakeFd_ >= 0) {
+        senderRunning_ = true;
+        senderThread_ = std::thread([this]() { runSender(); });
+    }
+#endif
+    pacer_.start();
+    batcher_.start();
     return true;
 }
 
@@ -39,6 +98,28 @@ void WifiDirect::stop() {
     if (!running_) return;
     running_ = false;
     if (verbose_) std::cout << "[WIFI] stop" << std::endl;
+    batcher_.stop();
+    pacer_.stop();
+#ifdef __linux__
+    {
+        std::lock_guard<std::mutex> lock(submitMutex_);
+        senderRunning_ = false;
+    }
+    if (senderWakeFd_ >= 0) {
+        uint64_t one = 1;
+        ssize_t n = ::write(senderWakeFd_, &one, sizeof(one));
+        (void)n;
+    }
+    if (senderThread_.joinable()) senderThread_.join();
+    if (senderWakeFd_ >= 0) close(senderWakeFd_);
+    senderWakeFd_ = -1;
+#endif
+    datagrams_.stop();
+    tcpServer_.stop();
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        for (auto& kv : peers_) closeConnection(kv.second);
+    }
     try { if (udpTxThread_.joinable()) udpTxThread_.join(); } catch (...) {}
     try { if (udpRxThread_.joinable()) udpRxThread_.join(); } catch (...) {}
     try { if (tcpServerThread_.joinable()) tcpServerThread_.join(); } catch (...) {}
@@ -46,6 +127,10 @@ void WifiDirect::stop() {
 
 void WifiDirect::setOnData(std::function<void(const std::string&, const std::vector<uint8_t>&)> cb) { onData_ = std::move(cb); }
 
+void WifiDirect::setOnPeerSeen(std::function<void(const std::string&)> cb) { onPeerSeen_ = std::move(cb); }
+
+void WifiDirect::setOnPeerGone(std::function<void(const std::string&)> cb) { onPeerGone_ = std::move(cb); }
+
 std::string WifiDirect::getLocalIp() const {
 #ifdef __linux__
     int s = socket(AF_INET, SOCK_DGRAM, 0);
@@ -78,29 +163,133 @@ std::string WifiDirect::getLocalIp() const {
 }
 
 bool WifiDirect::sendTo(const std::string& username, const std::vector<uint8_t>& data) {
+    auto result = fanOut({Send(username, &data)}).front();
+    if (verbose_) {
+        std::cout << (result.ok ? "[WIFI] sendTo ok " : result.skipped ? "[WIFI] sendTo skipped " : "[WIFI] sendTo fail ")
+                  << username << " bytes=" << data.size() << " us=" << result.latency.count() << std::endl;
+    }
+    return result.ok;
+}
+
+std::vector<FanoutResult> WifiDirect::sendBroadcast(const std::vector<uint8_t>& data) {
+    std::vector<Send> sends;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        for (auto& kv : peers_) sends.emplace_back(kv.first, &data);
+    }
+    auto results = fanOut(sends);
+    if (verbose_) {
+        size_t ok = 0, skipped = 0;
+        std::chrono::microseconds slowest{0};
+        for (const auto& r : results) {
+            if (r.ok) ok++;
+            if (r.skipped) skipped++;
+            slowest = std::max(slowest, r.latency);
+        }
+        std::cout << "[WIFI] broadcast peers=" << results.size() << " ok=" << ok << " skipped=" << skipped
+                  << " failed=" << results.size() - ok - skipped << " slowest_us=" << slowest.count()
+                  << " bytes=" << data.size() << std::endl;
+    }
+    return results;
+}
+
+TcpPoolStats WifiDirect::getPoolStats() {
     std::lock_guard<std::mutex> lock(mtx_);
-    auto it = peers_.find(username);
-    if (it == peers_.end()) {
-    if (verbose_) std::cout << "[WIFI] sendTo no peer " << username << std::endl;
-        return false;
-    }
-    bool ok = sendTcp(it->second.ip, it->second.port, data);
-    if (verbose_) std::cout << (ok ? "[WIFI] sendTo ok " : "[WIFI] sendTo fail ") << username << " " << it->second.ip << ":" << it->second.port << " bytes=" << data.size() << std::endl;
-    return ok;
+    TcpPoolStats stats = pool_;
+    stats.open = 0;
+    for (auto& kv : peers_) {
+        if (kv.second.fd >= 0) stats.open++;
+        if (kv.second.broken) stats.broken++;
+    }
+    return stats;
+}
+
+void WifiDirect::seen(const std::string& username, const std::string& ip, uint16_t port, bool datagrams) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    Peer& peer = peers_[username];
+    if (peer.ip != ip || peer.port != port) {
+        closeConnection(peer);
+    }
+    peer.ip = ip;
+    peer.port = port;
+    peer.lastSeen = std::chrono::steady_clock::now();
+    peer.datagrams = datagrams;
+    if (peer.broken && peer.lastSeen >= peer.retryAt) {
+        // Half open: the peer gets one more try, and a single failure breaks it again.
+        peer.broken = false;
+        peer.failures = BREAKER_THRESHOLD - 1;
+    }
 }
 
-bool WifiDirect::sendBroadcast(const std::vector<uint8_t>& data) {
-    std::vector<std::pair<std::string,uint16_t>> targets;
+// Waits until every write has finished. The pacer's rounds go through submit() and never wait.
+std::vector<FanoutResult> WifiDirect::fanOut(const std::vector<Send>& sends) {
+    std::vector<FanoutResult> results(sends.size());
+    std::vector<bool> filled(sends.size(), false);
+    std::vector<LinkPacer::PacedWrite> writes;
     {
         std::lock_guard<std::mutex> lock(mtx_);
-        for (auto& kv : peers_) targets.emplace_back(kv.second.ip, kv.second.port);
+        for (size_t i = 0; i < sends.size(); ++i) {
+            results[i].peer = sends[i].first;
+            auto it = peers_.find(sends[i].first);
+            if (it != peers_.end() && it->second.broken) {
+                results[i].skipped = true;
+                filled[i] = true;
+                pool_.skipped++;
+                continue;
+            }
+            writes.push_back(LinkPacer::PacedWrite{sends[i].first, *sends[i].second, false, {}});
+        }
+    }
+    std::mutex m;
+    std::condition_variable cv;
+    size_t remaining = writes.size();
+    submit(std::move(writes), [&](const LinkPacer::PacedWrite& write) {
+        std::lock_guard<std::mutex> lock(m);
+        for (size_t i = 0; i < results.size(); ++i) {
+            if (filled[i] || results[i].peer != write.link) continue;
+            filled[i] = true;
+            results[i].ok = write.ok;
+            results[i].latency = std::chrono::duration_cast<std::chrono::microseconds>(write.took);
+            break;
+        }
+        remaining--;
+        cv.notify_all();
+    });
+    std::unique_lock<std::mutex> lock(m);
+    cv.wait(lock, [&remaining] { return remaining == 0; });
+    return results;
+}
+
+bool WifiDirect::paceBroadcast(const std::vector<uint8_t>& data) {
+    std::vector<std::string> targets;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        for (auto& kv : peers_) targets.push_back(kv.first);
     }
-    if (verbose_) std::cout << "[WIFI] broadcast peers=" << targets.size() << " bytes=" << data.size() << std::endl;
     bool any = false;
-    for (auto& t : targets) any |= sendTcp(t.first, t.second, data);
+    for (auto& username : targets) any |= pacer_.enqueue(username, data);
     return any;
 }
 
+bool WifiDirect::queueTo(const std::string& username, std::vector<uint8_t> data) {
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        auto it = peers_.find(username);
+        if (it == peers_.end()) return false;
+        if (it->second.broken) {
+            pool_.skipped++;
+            return false;
+        }
+    }
+    if (!pacer_.hasRoom(username, data.size(), LinkPacer::isBulk(data))) return false;
+    batcher_.enqueue(username, std::move(data));
+    return true;
+}
+
+void WifiDirect::queueBroadcast(std::vector<uint8_t> data) {
+    batcher_.enqueue(BROADCAST_PEER, std::move(data));
+}
+
 std::vector<std::pair<std::string,std::string>> WifiDirect::listPeers() {
     std::vector<std::pair<std::string,std::string>> out;
     std::lock_guard<std::mutex> lock(mtx_);
@@ -108,6 +297,13 @@ std::vector<std::pair<std::string,std::string>> WifiDirect::listPeers() {
     return out;
 }
 
+std::vector<std::pair<std::string,std::chrono::steady_clock::time_point>> WifiDirect::peerLastSeen() {
+    std::vector<std::pair<std::string,std::chrono::steady_clock::time_point>> out;
+    std::lock_guard<std::mutex> lock(mtx_);
+    for (auto& kv : peers_) out.emplace_back(kv.first, kv.second.lastSeen);
+    return out;
+}
+
 void WifiDirect::runUdpTx() {
 #ifdef __linux__
     int s = socket(AF_INET, SOCK_DGRAM, 0);
@@ -125,20 +321,18 @@ void WifiDirect::runUdpTx() {
     sockaddr_in addr{}; addr.sin_family = AF_INET; addr.sin_port = htons(48270); addr.sin_addr.s_addr = INADDR_BROADCAST;
     if (verbose_) std::cout << "[WIFI] UDP TX broadcasting to 255.255.255.255:48270 from " << localIp << std::endl;
     while (running_) {
-        std::string u = username_;
-        std::string f = fingerprint_;
-        uint16_t port = tcpPort_;
-        std::vector<uint8_t> buf;
-        buf.push_back(1);
-        buf.push_back((uint8_t)u.size());
-        buf.insert(buf.end(), u.begin(), u.end());
-        buf.push_back((uint8_t)f.size());
-        buf.insert(buf.end(), f.begin(), f.end());
-        buf.push_back((uint8_t)(port >> 8));
-        buf.push_back((uint8_t)(port & 0xFF));
+        WifiBeacon beacon;
+        beacon.username = username_;
+        beacon.fingerprint = fingerprint_;
+        beacon.port = tcpPort_;
+        beacon.datagrams = datagrams_.running();
+        const std::string& u = beacon.username;
+        std::vector<uint8_t> buf = beacon.serialize();
         ssize_t sent = sendto(s, buf.data(), buf.size(), 0, (sockaddr*)&addr, sizeof(addr));
         if (verbose_) std::cout << "[WIFI] TX broadcast " << u << " (" << sent << "/" << buf.size() << " bytes)" << std::endl;
-        std::this_thread::sleep_for(std::chrono::seconds(2));
+        closeIdle();
+        expireSilent();
+        std::this_thread::sleep_for(BEACON_INTERVAL);
     }
     close(s);
 #elif defined(_WIN32)
@@ -158,17 +352,13 @@ void WifiDirect::runUdpTx() {
     sockaddr_in addr{}; addr.sin_family = AF_INET; addr.sin_port = htons(48270); addr.sin_addr.s_addr = INADDR_BROADCAST;
     if (verbose_) std::cout << "[WIFI] UDP TX broadcasting to 255.255.255.255:48270 from " << localIp << std::endl;
     while (running_) {
-        std::string u = username_;
-        std::string f = fingerprint_;
-        uint16_t port = tcpPort_;
-        std::vector<uint8_t> buf;
-        buf.push_back(1);
-        buf.push_back((uint8_t)u.size());
-        buf.insert(buf.end(), u.begin(), u.end());
-        buf.push_back((uint8_t)f.size());
-        buf.insert(buf.end(), f.begin(), f.end());
-        buf.push_back((uint8_t)(port >> 8));
-        buf.push_back((uint8_t)(port & 0xFF));
+        WifiBeacon beacon;
+        beacon.username = username_;
+        beacon.fingerprint = fingerprint_;
+        beacon.port = tcpPort_;
+        beacon.datagrams = datagrams_.running();
+        const std::string& u = beacon.username;
+        std::vector<uint8_t> buf = beacon.serialize();
         int sent = sendto(s, (const char*)buf.data(), (int)buf.size(), 0, (sockaddr*)&addr, sizeof(addr));
         if (verbose_) {
             if (sent == SOCKET_ERROR) {
@@ -177,7 +367,8 @@ void WifiDirect::runUdpTx() {
                 std::cout << "[WIFI] TX broadcast " << u << " (" << sent << "/" << buf.size() << " bytes)" << std::endl;
             }
         }
-        std::this_thread::sleep_for(std::chrono::seconds(2));
+        expireSilent();
+        std::this_thread::sleep_for(BEACON_INTERVAL);
     }
     closesocket(s);
     WSACleanup();
@@ -204,24 +395,15 @@ void WifiDirect::runUdpRx() {
         ssize_t n = recvfrom(s, buf.data(), buf.size(), 0, (sockaddr*)&src, &sl);
         if (n <= 0) continue;
         if (verbose_) { std::string srcIp = inet_ntoa(src.sin_addr); std::cout << "[WIFI] RX packet from " << srcIp << " size=" << n << std::endl; }
-        if (buf[0] != 1) { if (verbose_) std::cout << "[WIFI] Invalid version: " << (int)buf[0] << std::endl; continue; }
-        size_t i = 1;
-        if (i >= (size_t)n) continue;
-        uint8_t ulen = buf[i++];
-        if (i + ulen > (size_t)n) { if (verbose_) std::cout << "[WIFI] Invalid username length" << std::endl; continue; }
-        std::string u((char*)&buf[i], (char*)&buf[i+ulen]); i += ulen;
-        if (i >= (size_t)n) continue;
-        uint8_t flen = buf[i++];
-        if (i + flen + 2 > (size_t)n) { if (verbose_) std::cout << "[WIFI] Invalid fingerprint length" << std::endl; continue; }
-        std::string f((char*)&buf[i], (char*)&buf[i+flen]); i += flen;
-        uint16_t port = ((uint16_t)buf[i] << 8) | buf[i+1];
+        WifiBeacon beacon;
+        std::string error;
+        if (!WifiBeacon::parse(buf.data(), (size_t)n, beacon, &error)) { if (verbose_) std::cout << "[WIFI] " << error << std::endl; continue; }
+        const std::string& u = beacon.username;
+        uint16_t port = beacon.port;
         std::string ip = inet_ntoa(src.sin_addr);
         if (u == username_) { if (verbose_) std::cout << "[WIFI] Ignoring own broadcast" << std::endl; continue; }
-        Peer p; p.ip = ip; p.port = port; p.lastSeen = std::chrono::steady_clock::now();
-        {
-            std::lock_guard<std::mutex> lock(mtx_);
-            peers_[u] = p;
-        }
+        seen(u, ip, port, beacon.datagrams);
+        if (onPeerSeen_) onPeerSeen_(u);
     if (verbose_) std::cout << "[WIFI] ✓ Discovered peer: " << u << " at " << ip << ":" << port << std::endl;
     }
     close(s);
@@ -244,24 +426,15 @@ void WifiDirect::runUdpRx() {
         char ipstr[INET_ADDRSTRLEN] = {0}; inet_ntop(AF_INET, &src.sin_addr, ipstr, INET_ADDRSTRLEN);
         std::string srcIp = ipstr[0] ? ipstr : "";
         if (verbose_) std::cout << "[WIFI] RX packet from " << srcIp << " size=" << n << std::endl;
-        if (buf[0] != 1) { if (verbose_) std::cout << "[WIFI] Invalid version: " << (int)buf[0] << std::endl; continue; }
-        size_t i = 1;
-        if (i >= (size_t)n) continue;
-        uint8_t ulen = buf[i++];
-        if (i + ulen > (size_t)n) { if (verbose_) std::cout << "[WIFI] Invalid username length" << std::endl; continue; }
-        std::string u((char*)&buf[i], (char*)&buf[i+ulen]); i += ulen;
-        if (i >= (size_t)n) continue;
-        uint8_t flen = buf[i++];
-        if (i + flen + 2 > (size_t)n) { if (verbose_) std::cout << "[WIFI] Invalid fingerprint length" << std::endl; continue; }
-        std::string f((char*)&buf[i], (char*)&buf[i+flen]); i += flen;
-        uint16_t port = ((uint16_t)buf[i] << 8) | buf[i+1];
+        WifiBeacon beacon;
+        std::string error;
+        if (!WifiBeacon::parse(buf.data(), (size_t)n, beacon, &error)) { if (verbose_) std::cout << "[WIFI] " << error << std::endl; continue; }
+        const std::string& u = beacon.username;
+        uint16_t port = beacon.port;
         std::string ip = srcIp;
         if (u == username_) { if (verbose_) std::cout << "[WIFI] Ignoring own broadcast" << std::endl; continue; }
-        Peer p; p.ip = ip; p.port = port; p.lastSeen = std::chrono::steady_clock::now();
-        {
-            std::lock_guard<std::mutex> lock(mtx_);
-            peers_[u] = p;
-        }
+        seen(u, ip, port, beacon.datagrams);
+        if (onPeerSeen_) onPeerSeen_(u);
         if (verbose_) std::cout << "[WIFI] ✓ Discovered peer: " << u << " at " << ip << ":" << port << std::endl;
     }
     closesocket(s);
@@ -273,39 +446,7 @@ void WifiDirect::runUdpRx() {
 }
 
 void WifiDirect::runTcpServer() {
-#ifdef __linux__
-    int s = socket(AF_INET, SOCK_STREAM, 0);
-    if (s < 0) { if (verbose_) std::cout << "[WIFI] tcp socket fail" << std::endl; while (running_) std::this_thread::sleep_for(std::chrono::seconds(1)); return; }
-    int yes = 1;
-    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
-    sockaddr_in addr{}; addr.sin_family = AF_INET; addr.sin_port = htons(tcpPort_); addr.sin_addr.s_addr = INADDR_ANY;
-    if (bind(s, (sockaddr*)&addr, sizeof(addr)) < 0) { if (verbose_) std::cout << "[WIFI] tcp bind fail" << std::endl; close(s); while (running_) std::this_thread::sleep_for(std::chrono::seconds(1)); return; }
-    listen(s, 4);
-    int flags = fcntl(s, F_GETFL, 0); if (flags != -1) fcntl(s, F_SETFL, flags | O_NONBLOCK);
-    if (verbose_) std::cout << "[WIFI] tcp listen port=" << tcpPort_ << std::endl;
-    while (running_) {
-        sockaddr_in caddr{}; socklen_t cl = sizeof(caddr);
-        int c = accept(s, (sockaddr*)&caddr, &cl);
-        if (c < 0) { std::this_thread::sleep_for(std::chrono::milliseconds(100)); continue; }
-        std::thread([this,c]() {
-            std::vector<uint8_t> lenbuf(4);
-            while (true) {
-                ssize_t r = recv(c, lenbuf.data(), 4, MSG_WAITALL);
-                if (r != 4) break;
-                uint32_t len = ((uint32_t)lenbuf[0] << 24) | ((uint32_t)lenbuf[1] << 16) | ((uint32_t)lenbuf[2] << 8) | (uint32_t)lenbuf[3];
-                if (len == 0 || len > 65536) break;
-                std::vector<uint8_t> buf(len);
-                ssize_t rr = recv(c, buf.data(), len, MSG_WAITALL);
-                if (rr != (ssize_t)len) break;
-                auto cb = onData_;
-                if (cb) cb("wifi", buf);
-                if (verbose_) std::cout << "[WIFI] rx bytes=" << buf.size() << std::endl;
-            }
-            close(c);
-        }).detach();
-    }
-    close(s);
-#elif defined(_WIN32)
+#if defined(_WIN32)
     WSADATA wsa; if (WSAStartup(MAKEWORD(2,2), &wsa) != 0) { if (verbose_) std::cout << "[WIFI] WSAStartup fail" << std::endl; return; }
     SOCKET s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
     if (s == INVALID_SOCKET) { if (verbose_) std::cout << "[WIFI] tcp socket fail" << std::endl; WSACleanup(); return; }
@@ -326,7 +467,7 @@ void WifiDirect::runTcpServer() {
                 int r = recv(c, (char*)lenbuf.data(), 4, 0);
                 if (r != 4) break;
                 uint32_t len = ((uint32_t)lenbuf[0] << 24) | ((uint32_t)lenbuf[1] << 16) | ((uint32_t)lenbuf[2] << 8) | (uint32_t)lenbuf[3];
-                if (len == 0 || len > 65536) break;
+                if (len == 0 || len > MAX_FRAME) break;
                 std::vector<uint8_t> buf(len);
                 int rr = 0; int need = (int)len;
                 while (rr < need) { int n = recv(c, (char*)buf.data()+rr, need-rr, 0); if (n <= 0) { rr = -1; break; } rr += n; }
@@ -346,23 +487,469 @@ void WifiDirect::runTcpServer() {
 #endif
 }
 
-bool WifiDirect::sendTcp(const std::string& ip, uint16_t port, const std::vector<uint8_t>& data) {
+void WifiDirect::closeConnection(Peer& peer) {
 #ifdef __linux__
-    int s = socket(AF_INET, SOCK_STREAM, 0);
-    if (s < 0) return false;
-    sockaddr_in addr{}; addr.sin_family = AF_INET; addr.sin_port = htons(port); inet_aton(ip.c_str(), &addr.sin_addr);
-    if (connect(s, (sockaddr*)&addr, sizeof(addr)) < 0) { close(s); return false; }
-    uint32_t len = (uint32_t)data.size();
-    uint8_t lenbuf[4] = { (uint8_t)(len >> 24), (uint8_t)(len >> 16), (uint8_t)(len >> 8), (uint8_t)len };
-    if (send(s, lenbuf, 4, 0) != 4) { close(s); return false; }
-    size_t off = 0; while (off < data.size()) { ssize_t n = send(s, data.data() + off, data.size() - off, 0); if (n <= 0) { close(s); return false; } off += (size_t)n; }
-    close(s);
-    return true;
-#elif defined(_WIN32)
+    if (peer.fd >= 0) close(peer.fd);
+#endif
+    peer.fd = -1;
+}
+
+void WifiDirect::closeIdle() {
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(mtx_);
+    for (auto& kv : peers_) {
+        if (kv.second.fd >= 0 && now - kv.second.lastUsed > IDLE_TIMEOUT) {
+            closeConnection(kv.second);
+            pool_.idleClosed++;
+        }
+    }
+}
+
+void WifiDirect::expireSilent() {
+    auto now = std::chrono::steady_clock::now();
+    std::vector<std::string> gone;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        for (auto it = peers_.begin(); it != peers_.end();) {
+            if (now - it->second.lastSeen <= PEER_TIMEOUT) {
+                ++it;
+                continue;
+            }
+            closeConnection(it->second);
+            gone.push_back(it->first);
+            it = peers_.erase(it);
+        }
+    }
+    for (const auto& username : gone) {
+        if (verbose_) std::cout << "[WIFI] peer gone: " << username << std::endl;
+        if (onPeerGone_) onPeerGone_(username);
+    }
+}
+
+#ifdef __linux__
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+void configure(int s) {
+    int yes = 1;
+    setsockopt(s, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+    setsockopt(s, SOL_SOCKET, SO_KEEPALIVE, &yes, sizeof(yes));
+    int idle = WifiDirect::KEEPALIVE_IDLE_S, interval = WifiDirect::KEEPALIVE_INTERVAL_S, probes = WifiDirect::KEEPALIVE_PROBES;
+    setsockopt(s, IPPROTO_TCP, TCP_KEEPIDLE, &idle, sizeof(idle));
+    setsockopt(s, IPPROTO_TCP, TCP_KEEPINTVL, &interval, sizeof(interval));
+    setsockopt(s, IPPROTO_TCP, TCP_KEEPCNT, &probes, sizeof(probes));
+}
+
+// The receiver never writes back, so a readable socket means it closed or reset the connection.
+bool stillOpen(int s) {
+    char byte;
+    ssize_t n = recv(s, &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+    return n > 0 || (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK));
+}
+
+}
+
+// One paced write in flight: a non-blocking connect if the peer has no pooled connection, then one
+// framed write, both bounded by deadlines. Every job finishes on its own, so a peer that is slow or
+// unreachable holds up only its own link.
+struct WifiDirect::SendJob {
+    LinkPacer::PacedWrite write;
+    LinkPacer::Done done;
+    std::string ip;
+    uint16_t port = 0;
+    std::vector<uint8_t> framed;
+    size_t written = 0;
+    int fd = -1;
+    bool fresh = false;
+    bool connecting = false;
+    bool retried = false;
+    bool finished = false;
+    unsigned connects = 0;
+    unsigned reconnects = 0;
+    Clock::time_point started;
+    Clock::time_point deadline;
+
+    bool open(Clock::time_point now) {
+        fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0) return false;
+        sockaddr_in addr{}; addr.sin_family = AF_INET; addr.sin_port = htons(port); inet_aton(ip.c_str(), &addr.sin_addr);
+        fresh = true;
+        written = 0;
+        connects++;
+        deadline = now + CONNECT_TIMEOUT;
+        if (connect(fd, (sockaddr*)&addr, sizeof(addr)) == 0) {
+            connecting = false;
+            configure(fd);
+            deadline = now + SEND_TIMEOUT;
+            return true;
+        }
+        connecting = errno == EINPROGRESS;
+        return connecting;
+    }
+
+    void finish(bool ok, Clock::time_point now) {
+        finished = true;
+        write.ok = ok;
+        write.took = now - started;
+    }
+
+    void fail(Clock::time_point now) {
+        if (fd >= 0) close(fd);
+        fd = -1;
+        finish(false, now);
+    }
+};
+
+void WifiDirect::submit(std::vector<LinkPacer::PacedWrite> writes, const LinkPacer::Done& done) {
+    std::vector<Submission> intake;
+    for (auto& paced : writes) intake.push_back(Submission{std::move(paced), done});
+    {
+        std::lock_guard<std::mutex> lock(submitMutex_);
+        if (senderRunning_) {
+            for (auto& entry : intake) submitted_.push_back(std::move(entry));
+            uint64_t one = 1;
+            ssize_t n = ::write(senderWakeFd_, &one, sizeof(one));
+            (void)n;
+            return;
+        }
+    }
+    // Before start() and after stop() the writes run on the caller's thread.
+    std::vector<SendJob> jobs;
+    while (!intake.empty() || !jobs.empty()) {
+        startJobs(intake, jobs);
+        pump(jobs, -1);
+    }
+}
+
+void WifiDirect::runSender() {
+    std::vector<SendJob> jobs;
+    std::vector<Submission> intake;
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(submitMutex_);
+            for (auto& entry : submitted_) intake.push_back(std::move(entry));
+            submitted_.clear();
+            // Writes already handed over still finish after stop(), within their own deadlines.
+            if (!senderRunning_ && intake.empty() && jobs.empty()) break;
+        }
+        startJobs(intake, jobs);
+        pump(jobs, senderWakeFd_);
+    }
+}
+
+// Small frames go to peers that take datagrams over the UDP channel, everything else over TCP.
+// File data stays on TCP, where the connection's flow control and the pacer's bulk queue apply.
+// A link has at most one write in flight; later ones stay in intake until it finishes, so they leave in order.
+void WifiDirect::startJobs(std::vector<Submission>& intake, std::vector<SendJob>& jobs) {
+    if (intake.empty()) return;
+    auto now = Clock::now();
+    size_t first = jobs.size();
+    std::vector<Submission> waiting;
+    // Writes that finish here without a TCP job: unknown or broken peers, and datagrams the channel took.
+    std::vector<Submission> answered;
+    std::vector<Submission> viaDatagram;
+    std::vector<DatagramChannel::Datagram> datagrams;
+    auto overTcp = [&](Submission& entry, Peer& peer) {
+        SendJob job;
+        job.ip = peer.ip;
+        job.port = peer.port;
+        job.fd = peer.fd;
+        peer.fd = -1;
+        const auto& data = entry.write.data;
+        uint32_t len = (uint32_t)data.size();
+        job.framed.reserve(4 + data.size());
+        job.framed.insert(job.framed.end(), { (uint8_t)(len >> 24), (uint8_t)(len >> 16), (uint8_t)(len >> 8), (uint8_t)len });
+        job.framed.insert(job.framed.end(), data.begin(), data.end());
+        job.write = std::move(entry.write);
+        job.done = std::move(entry.done);
+        job.started = now;
+        jobs.push_back(std::move(job));
+    };
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        for (auto& entry : intake) {
+            const std::string& link = entry.write.link;
+            bool busy = std::any_of(jobs.begin(), jobs.end(), [&link](const SendJob& job) { return job.write.link == link; }) ||
+                        std::any_of(viaDatagram.begin(), viaDatagram.end(), [&link](const Submission& s) { return s.write.link == link; });
+            if (busy) {
+                waiting.push_back(std::move(entry));
+                continue;
+            }
+            auto it = peers_.find(link);
+            if (it == peers_.end() || it->second.broken) {
+                if (it != peers_.end()) pool_.skipped++;
+                answered.push_back(std::move(entry));
+                continue;
+            }
+            Peer& peer = it->second;
+            const auto& data = entry.write.data;
+            if (datagrams_.running() && peer.datagrams && data.size() <= DatagramChannel::MAX_PAYLOAD && !LinkPacer::isBulk(data)) {
+                datagrams.push_back({link, peer.ip, peer.port, nullptr});
+                viaDatagram.push_back(std::move(entry));
+                continue;
+            }
+            overTcp(entry, peer);
+        }
+    }
+    intake = std::move(waiting);
+
+    if (!datagrams.empty()) {
+        for (size_t j = 0; j < datagrams.size(); ++j) datagrams[j].frame = &viaDatagram[j].write.data;
+        auto taken = datagrams_.send(datagrams);
+        auto took = Clock::now() - now;
+        std::lock_guard<std::mutex> lock(mtx_);
+        for (size_t j = 0; j < viaDatagram.size(); ++j) {
+            if (taken[j]) {
+                // Handed off only: the pacer hears about delivery from the ACK or the expiry.
+                viaDatagram[j].write.ok = true;
+                viaDatagram[j].write.took = took;
+                viaDatagram[j].write.sampled = false;
+                answered.push_back(std::move(viaDatagram[j]));
+                continue;
+            }
+            // The peer's datagram window is full, so this frame goes over TCP.
+            auto it = peers_.find(viaDatagram[j].write.link);
+            if (it == peers_.end()) {
+                answered.push_back(std::move(viaDatagram[j]));
+            } else {
+                overTcp(viaDatagram[j], it->second);
+            }
+        }
+    }
+    for (auto& entry : answered) entry.done(entry.write);
+
+    for (size_t i = first; i < jobs.size(); ++i) {
+        SendJob& job = jobs[i];
+        if (job.fd >= 0 && !stillOpen(job.fd)) {
+            close(job.fd);
+            job.fd = -1;
+            job.reconnects++;
+        }
+        if (job.fd >= 0) {
+            job.deadline = now + SEND_TIMEOUT;
+        } else if (!job.open(now)) {
+            job.fail(now);
+        }
+    }
+
+    // Where io_uring is available, the first write to every peer already connected goes to the
+    // kernel as one batch; whatever it leaves unsent is finished by pump(). A single write gains
+    // nothing from the ring and goes straight to send().
+    std::lock_guard<std::mutex> ring(sendMutex_);
+    if (!sendRingTried_) {
+        sendRingTried_ = true;
+        if (IoUring::available()) sendRing_.init(SEND_RING_ENTRIES);
+    }
+    std::vector<size_t> writable;
+    for (size_t i = first; i < jobs.size(); ++i) {
+        if (!jobs[i].finished && !jobs[i].connecting && jobs[i].fd >= 0) writable.push_back(i);
+    }
+    if (!sendRing_.ready() || writable.size() < 2) return;
+    std::vector<bool> inRing(jobs.size(), false);
+    unsigned queued = 0;
+    for (size_t i : writable) {
+        if (!sendRing_.send(jobs[i].fd, jobs[i].framed.data(), jobs[i].framed.size(), i)) continue;
+        inRing[i] = true;
+        queued++;
+    }
+    if (queued == 0) return;
+    unsigned outstanding = queued;
+    std::vector<IoUring::Completion> sent;
+    auto take = [&]() {
+        for (const auto& completion : sent) {
+            if (completion.userData >= inRing.size() || !inRing[completion.userData]) continue;
+            inRing[completion.userData] = false;
+            outstanding--;
+            if (completion.res > 0) jobs[completion.userData].written += (size_t)completion.res;
+        }
+        sent.clear();
+    };
+    bool ok = sendRing_.submitAndWait(queued, sent);
+    take();
+    if (outstanding > 0) {
+        // The ring gave up part way, and sends still queued point into these jobs' buffers. They are
+        // cancelled and waited out before pump() writes the rest or the jobs go away.
+        for (size_t i = 0; i < inRing.size(); ++i) {
+            if (inRing[i]) sendRing_.cancel(i, RING_CANCEL);
+        }
+        while (outstanding > 0 && (ok = sendRing_.submitAndWait(1, sent))) take();
+    }
+    if (outstanding > 0) {
+        // Last resort: the ring is dropped for good, and the buffers it may still read are kept
+        // alive with it. Those connections may hold part of a frame, so they are closed.
+        sendRing_.close();
+        for (size_t i = 0; i < inRing.size(); ++i) {
+            if (!inRing[i]) continue;
+            ringOrphans_.push_back(std::move(jobs[i].framed));
+            jobs[i].fail(now);
+        }
+    }
+    std::lock_guard<std::mutex> lock(mtx_);
+    pool_.batched += queued - outstanding;
+}
+
+// Moves every job as far as it goes without blocking, reports the finished ones, then waits for
+// the next socket event, deadline or, with wakeFd, new submission.
+void WifiDirect::pump(std::vector<SendJob>& jobs, int wakeFd) {
+    auto now = Clock::now();
+    auto wake = now + SEND_TIMEOUT;
+    std::vector<pollfd> polls;
+    std::vector<size_t> polled;
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        SendJob& job = jobs[i];
+        if (job.finished) continue;
+        if (!job.connecting) {
+            while (job.written < job.framed.size()) {
+                ssize_t n = send(job.fd, job.framed.data() + job.written, job.framed.size() - job.written, MSG_NOSIGNAL | MSG_DONTWAIT);
+                if (n <= 0) break;
+                job.written += (size_t)n;
+            }
+            if (job.written == job.framed.size()) {
+                job.finish(true, now);
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                // A pooled connection that broke is replaced once; a fresh one that breaks means the peer is unreachable.
+                close(job.fd);
+                job.fd = -1;
+                if (job.fresh || job.retried) {
+                    job.fail(now);
+                    continue;
+                }
+                job.retried = true;
+                job.reconnects++;
+                if (!job.open(now)) {
+                    job.fail(now);
+                    continue;
+                }
+            }
+        }
+        if (now >= job.deadline) {
+            job.fail(now);
+            continue;
+        }
+        wake = std::min(wake, job.deadline);
+        polls.push_back(pollfd{job.fd, POLLOUT, 0});
+        polled.push_back(i);
+    }
+    size_t before = jobs.size();
+    settle(jobs);
+    // Finished links may have writes waiting in intake; let the caller start them before sleeping.
+    if (jobs.size() != before) return;
+
+    if (wakeFd >= 0) polls.push_back(pollfd{wakeFd, POLLIN, 0});
+    if (polls.empty()) return;
+    auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(wake - now).count() + 1;
+    if (poll(polls.data(), polls.size(), (int)wait) < 0) return;
+    now = Clock::now();
+    for (size_t p = 0; p < polled.size(); ++p) {
+        SendJob& job = jobs[polled[p]];
+        if (!job.connecting || polls[p].revents == 0) continue;
+        int error = 0;
+        socklen_t len = sizeof(error);
+        if (getsockopt(job.fd, SOL_SOCKET, SO_ERROR, &error, &len) < 0 || error != 0) {
+            job.fail(now);
+            continue;
+        }
+        job.connecting = false;
+        configure(job.fd);
+        job.deadline = now + SEND_TIMEOUT;
+    }
+    if (wakeFd >= 0 && polls.back().revents != 0) {
+        uint64_t count;
+        ssize_t n = read(wakeFd, &count, sizeof(count));
+        (void)n;
+    }
+}
+
+// Returns the connections of finished jobs to the pool, runs the circuit breaker and reports them.
+void WifiDirect::settle(std::vector<SendJob>& jobs) {
+    std::vector<SendJob> finished;
+    {
+        auto now = Clock::now();
+        std::lock_guard<std::mutex> lock(mtx_);
+        for (auto it = jobs.begin(); it != jobs.end();) {
+            if (!it->finished) {
+                ++it;
+                continue;
+            }
+            SendJob& job = *it;
+            pool_.connects += job.connects;
+            pool_.reconnects += job.reconnects;
+            auto peer = peers_.find(job.write.link);
+            bool current = peer != peers_.end() && peer->second.ip == job.ip && peer->second.port == job.port && peer->second.fd < 0;
+            if (!current) {
+                if (job.fd >= 0) close(job.fd);
+            } else {
+                Peer& state = peer->second;
+                state.fd = job.fd;
+                if (job.write.ok) {
+                    if (!job.fresh) pool_.reused++;
+                    state.lastUsed = now;
+                    state.failures = 0;
+                    state.cooldown = std::chrono::seconds(0);
+                } else {
+                    pool_.failures++;
+                    if (++state.failures >= BREAKER_THRESHOLD && !state.broken) {
+                        state.broken = true;
+                        state.cooldown = state.cooldown.count() == 0 ? BREAKER_COOLDOWN : std::min(2 * state.cooldown, MAX_BREAKER_COOLDOWN);
+                        state.retryAt = now + state.cooldown;
+                        pool_.breakerTrips++;
+                    }
+                }
+            }
+            finished.push_back(std::move(job));
+            it = jobs.erase(it);
+        }
+    }
+    for (auto& job : finished) job.done(job.write);
+}
+#else
+void WifiDirect::submit(std::vector<LinkPacer::PacedWrite> writes, const LinkPacer::Done& done) {
+    std::vector<Send> sends;
+    for (const auto& paced : writes) sends.emplace_back(paced.link, &paced.data);
+    auto results = fanOutTcp(sends);
+    for (size_t i = 0; i < writes.size(); ++i) {
+        writes[i].ok = results[i].ok;
+        writes[i].took = results[i].latency;
+        done(writes[i]);
+    }
+}
+
+std::vector<FanoutResult> WifiDirect::fanOutTcp(const std::vector<Send>& sends) {
+    std::lock_guard<std::mutex> sending(sendMutex_);
+    std::vector<FanoutResult> results;
+    for (const auto& entry : sends) {
+        FanoutResult result;
+        result.peer = entry.first;
+        auto start = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> lock(mtx_);
+        auto it = peers_.find(entry.first);
+        if (it != peers_.end() && it->second.broken) {
+            result.skipped = true;
+            pool_.skipped++;
+        } else if (it != peers_.end()) {
+            result.ok = sendTcp(it->second, *entry.second);
+            if (result.ok) {
+                it->second.failures = 0;
+            } else if (++it->second.failures >= BREAKER_THRESHOLD && !it->second.broken) {
+                it->second.broken = true;
+                pool_.breakerTrips++;
+            }
+        }
+        result.latency = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+        results.push_back(result);
+    }
+    return results;
+}
+
+bool WifiDirect::sendTcp(Peer& peer, const std::vector<uint8_t>& data) {
+#if defined(_WIN32)
     WSADATA wsa; if (WSAStartup(MAKEWORD(2,2), &wsa) != 0) { return false; }
     SOCKET s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
     if (s == INVALID_SOCKET) { WSACleanup(); return false; }
-    sockaddr_in addr{}; addr.sin_family = AF_INET; addr.sin_port = htons(port); inet_pton(AF_INET, ip.c_str(), &addr.sin_addr);
+    sockaddr_in addr{}; addr.sin_family = AF_INET; addr.sin_port = htons(peer.port); inet_pton(AF_INET, peer.ip.c_str(), &addr.sin_addr);
     if (connect(s, (sockaddr*)&addr, sizeof(addr)) == SOCKET_ERROR) { closesocket(s); WSACleanup(); return false; }
     uint32_t len = (uint32_t)data.size();
     uint8_t lenbuf[4] = { (uint8_t)(len >> 24), (uint8_t)(len >> 16), (uint8_t)(len >> 8), (uint8_t)len };
@@ -372,8 +959,9 @@ bool WifiDirect::sendTcp(const std::string& ip, uint16_t port, const std::vector
     WSACleanup();
     return true;
 #else
-    (void)ip; (void)port; (void)data; return false;
+    (void)peer; (void)data; return false;
 #endif
 }
+#endif
 
 }
\ No newline at end of file
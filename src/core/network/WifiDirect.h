@@ -1,5 +1,9 @@
 #pragma once
 
+#include "core/protocol/FrameBatch.h"
+#include "core/protocol/LinkPacer.h"
+#include "DatagramChannel.h"
+#include "TcpFrameServer.h"
 #include <string>
 #include <vector>
 #include <functional>
@@ -12,38 +16,142 @@
 
 namespace echo {
 
+struct TcpPoolStats {
+    uint64_t connects = 0;
+    uint64_t reused = 0;
+    uint64_t reconnects = 0;
+    uint64_t failures = 0;
+    uint64_t idleClosed = 0;
+    uint64_t breakerTrips = 0;
+    uint64_t skipped = 0;
+    uint64_t batched = 0;
+    size_t open = 0;
+    size_t broken = 0;
+};
+
+struct FanoutResult {
+    std::string peer;
+    bool ok = false;
+    bool skipped = false;
+    std::chrono::microseconds latency{0};
+};
+
 class WifiDirect {
 public:
+    static constexpr size_t MAX_FRAME = 65536;
+    static constexpr double PACING_RATE = 2e6;
+    static constexpr std::chrono::seconds BEACON_INTERVAL{2};
+    // A peer that misses three beacons in a row has left.
+    static constexpr std::chrono::seconds PEER_TIMEOUT{7};
+    static constexpr std::chrono::seconds IDLE_TIMEOUT{120};
+    static constexpr std::chrono::seconds SEND_TIMEOUT{2};
+    static constexpr std::chrono::milliseconds CONNECT_TIMEOUT{1000};
+    static constexpr int BREAKER_THRESHOLD = 3;
+    static constexpr std::chrono::seconds BREAKER_COOLDOWN{4};
+    static constexpr std::chrono::seconds MAX_BREAKER_COOLDOWN{64};
+    static constexpr int KEEPALIVE_IDLE_S = 30;
+    static constexpr int KEEPALIVE_INTERVAL_S = 10;
+    static constexpr int KEEPALIVE_PROBES = 3;
+    static constexpr unsigned SEND_RING_ENTRIES = 64;
+    static constexpr uint64_t RING_CANCEL = UINT64_MAX;
+
     WifiDirect();
     ~WifiDirect();
     bool start(const std::string& username, const std::string& fingerprint, uint16_t tcpPort = 48271);
     void stop();
     void setOnData(std::function<void(const std::string&, const std::vector<uint8_t>&)> cb);
+    void setOnPeerSeen(std::function<void(const std::string&)> cb);
+    void setOnPeerGone(std::function<void(const std::string&)> cb);
     bool sendTo(const std::string& username, const std::vector<uint8_t>& data);
-    bool sendBroadcast(const std::vector<uint8_t>& data);
+    std::vector<FanoutResult> sendBroadcast(const std::vector<uint8_t>& data);
+    // False when the peer is unknown, its breaker is open, or its pacing queue is full.
+    bool queueTo(const std::string& username, std::vector<uint8_t> data);
+    void queueBroadcast(std::vector<uint8_t> data);
+    BatchStats getBatchStats() const { return batcher_.stats(); }
+    PacerStats getPacerStats() const { return pacer_.stats(); }
+    std::vector<LinkRate> getLinkRates() const { return pacer_.links(); }
+    double getConfiguredRate() const { return pacer_.config().bytesPerSecond; }
+    TcpServerStats getServerStats() const { return tcpServer_.stats(); }
+    TcpBackend getServerBackend() const { return tcpServer_.backend(); }
+    DatagramStats getDatagramStats() const { return datagrams_.stats(); }
+    TcpPoolStats getPoolStats();
     std::vector<std::pair<std::string,std::string>> listPeers();
+    std::vector<std::pair<std::string,std::chrono::steady_clock::time_point>> peerLastSeen();
     void setVerbose(bool enabled) { verbose_ = enabled; }
     std::string getLocalIp() const;
     uint16_t getPort() const { return tcpPort_; }
 
 private:
-    struct Peer { std::string ip; uint16_t port; std::chrono::steady_clock::time_point lastSeen; };
+    // fd is the pooled outbound connection to the peer, opened on first send and kept while it is used.
+    // After BREAKER_THRESHOLD failed sends in a row the peer is broken and skipped. The first beacon after
+    // retryAt half-opens it; each trip in a row doubles the cooldown, up to MAX_BREAKER_COOLDOWN.
+    // datagrams is set while the peer's beacon advertises the UDP channel and nothing sent over it expired.
+    struct Peer {
+        std::string ip;
+        uint16_t port = 0;
+        std::chrono::steady_clock::time_point lastSeen;
+        int fd = -1;
+        std::chrono::steady_clock::time_point lastUsed;
+        int failures = 0;
+        bool broken = false;
+        std::chrono::seconds cooldown{0};
+        std::chrono::steady_clock::time_point retryAt;
+        bool datagrams = false;
+    };
+    // A paced write waiting for the sender loop, with where to report it.
+    struct Submission {
+        LinkPacer::PacedWrite write;
+        LinkPacer::Done done;
+    };
+    struct SendJob;
+    using Send = std::pair<std::string, const std::vector<uint8_t>*>;
     std::unordered_map<std::string, Peer> peers_;
     std::mutex mtx_;
+    std::mutex submitMutex_;
+    std::vector<Submission> submitted_;
+    bool senderRunning_ = false;
+    int senderWakeFd_ = -1;
+    std::thread senderThread_;
+    // Guards sendRing_, which the sender thread and callers writing inline both use.
+    std::mutex sendMutex_;
+    IoUring sendRing_;
+    // Frames a failed ring may still read from, kept for as long as this object lives.
+    std::vector<std::vector<uint8_t>> ringOrphans_;
+    bool sendRingTried_ = false;
     std::string username_;
     std::string fingerprint_;
     uint16_t tcpPort_ = 48271;
     std::function<void(const std::string&, const std::vector<uint8_t>&)> onData_;
+    std::function<void(const std::string&)> onPeerSeen_;
+    std::function<void(const std::string&)> onPeerGone_;
     std::atomic<bool> running_{false};
     std::atomic<bool> verbose_{false};
     std::thread udpTxThread_;
     std::thread udpRxThread_;
     std::thread tcpServerThread_;
+    LinkPacer pacer_;
+    FrameBatcher batcher_;
+    TcpFrameServer tcpServer_;
+    DatagramChannel datagrams_;
 
+    bool paceBroadcast(const std::vector<uint8_t>& data);
     void runUdpTx();
     void runUdpRx();
     void runTcpServer();
-    bool sendTcp(const std::string& ip, uint16_t port, const std::vector<uint8_t>& data);
+    TcpPoolStats pool_;
+
+    void seen(const std::string& username, const std::string& ip, uint16_t port, bool datagrams);
+    std::vector<FanoutResult> fanOut(const std::vector<Send>& sends);
+    void submit(std::vector<LinkPacer::PacedWrite> writes, const LinkPacer::Done& done);
+    void runSender();
+    void startJobs(std::vector<Submission>& intake, std::vector<SendJob>& jobs);
+    void pump(std::vector<SendJob>& jobs, int wakeFd);
+    void settle(std::vector<SendJob>& jobs);
+    std::vector<FanoutResult> fanOutTcp(const std::vector<Send>& sends);
+    bool sendTcp(Peer& peer, const std::vector<uint8_t>& data);
+    void closeConnection(Peer& peer);
+    void closeIdle();
+    void expireSilent();
 };
 
 }
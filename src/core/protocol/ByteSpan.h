@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace echo {
+
+struct ByteSpan {
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+
+    ByteSpan() = default;
+    ByteSpan(const uint8_t* d, size_t n) : data(d), size(n) {}
+    ByteSpan(const std::vector<uint8_t>& v) : data(v.data()), size(v.size()) {}
+
+    const uint8_t& operator[](size_t i) const { return data[i]; }
+    const uint8_t* begin() const { return data; }
+    const uint8_t* end() const { return data + size; }
+    bool empty() const { return size == 0; }
+    ByteSpan subspan(size_t offset, size_t count) const { return ByteSpan(data + offset, count); }
+    ByteSpan subspan(size_t offset) const { return ByteSpan(data + offset, size - offset); }
+    std::vector<uint8_t> toVector() const { return std::vector<uint8_t>(begin(), end()); }
+};
+
+} // namespace echo
@@ -0,0 +1,309 @@
+#pragma once
+
+#include "ByteSpan.h"
+#include "Varint.h"
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace echo {
+namespace codec {
+
+class Reader {
+public:
+    explicit Reader(ByteSpan data, const char* error = "Invalid message data")
+        : data_(data), error_(error) {}
+
+    const uint8_t* take(size_t n) {
+        if (n > remaining()) {
+            throw std::runtime_error(error_);
+        }
+        const uint8_t* p = data_.data + offset_;
+        offset_ += n;
+        return p;
+    }
+
+    uint32_t varint() {
+        uint32_t value = 0;
+        if (!readVarint(data_.data, data_.size, offset_, value)) {
+            throw std::runtime_error(error_);
+        }
+        return value;
+    }
+
+    void require(size_t n) const {
+        if (n > remaining()) {
+            throw std::runtime_error(error_);
+        }
+    }
+
+    size_t offset() const { return offset_; }
+    size_t remaining() const { return data_.size - offset_; }
+
+private:
+    ByteSpan data_;
+    size_t offset_ = 0;
+    const char* error_;
+};
+
+inline uint16_t loadU16(const uint8_t* p) {
+    return static_cast<uint16_t>((static_cast<uint16_t>(p[0]) << 8) | p[1]);
+}
+
+inline uint32_t loadU32(const uint8_t* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) |
+           (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) |
+           p[3];
+}
+
+inline void storeU16(uint8_t*& p, uint16_t v) {
+    *p++ = static_cast<uint8_t>(v >> 8);
+    *p++ = static_cast<uint8_t>(v);
+}
+
+inline void storeU32(uint8_t*& p, uint32_t v) {
+    *p++ = static_cast<uint8_t>(v >> 24);
+    *p++ = static_cast<uint8_t>(v >> 16);
+    *p++ = static_cast<uint8_t>(v >> 8);
+    *p++ = static_cast<uint8_t>(v);
+}
+
+inline void assignString(std::string& out, const uint8_t* p, size_t n) {
+    out.assign(reinterpret_cast<const char*>(p), n);
+}
+
+inline void assignString(std::string_view& out, const uint8_t* p, size_t n) {
+    out = std::string_view(reinterpret_cast<const char*>(p), n);
+}
+
+inline void assignString(std::vector<uint8_t>& out, const uint8_t* p, size_t n) {
+    out.assign(p, p + n);
+}
+
+struct U8 {
+    static constexpr size_t MIN_SIZE = 1;
+    template <typename T> static size_t size(const T&) { return 1; }
+    template <typename T> static void write(uint8_t*& p, const T& v) { *p++ = static_cast<uint8_t>(v); }
+    template <typename T> static void read(Reader& r, T& v) { v = static_cast<T>(*r.take(1)); }
+};
+
+struct U16 {
+    static constexpr size_t MIN_SIZE = 2;
+    template <typename T> static size_t size(const T&) { return 2; }
+    template <typename T> static void write(uint8_t*& p, const T& v) { storeU16(p, static_cast<uint16_t>(v)); }
+    template <typename T> static void read(Reader& r, T& v) { v = static_cast<T>(loadU16(r.take(2))); }
+};
+
+struct U32 {
+    static constexpr size_t MIN_SIZE = 4;
+    template <typename T> static size_t size(const T&) { return 4; }
+    template <typename T> static void write(uint8_t*& p, const T& v) { storeU32(p, static_cast<uint32_t>(v)); }
+    template <typename T> static void read(Reader& r, T& v) { v = static_cast<T>(loadU32(r.take(4))); }
+};
+
+struct U64 {
+    static constexpr size_t MIN_SIZE = 8;
+    static size_t size(uint64_t) { return 8; }
+    static void write(uint8_t*& p, uint64_t v) {
+        storeU32(p, static_cast<uint32_t>(v >> 32));
+        storeU32(p, static_cast<uint32_t>(v));
+    }
+    static void read(Reader& r, uint64_t& v) {
+        const uint8_t* p = r.take(8);
+        v = (static_cast<uint64_t>(loadU32(p)) << 32) | loadU32(p + 4);
+    }
+};
+
+struct VarU16 {
+    static constexpr size_t MIN_SIZE = 1;
+    static size_t size(uint16_t v) { return varintSize(v); }
+    static void write(uint8_t*& p, uint16_t v) { writeVarint(p, v); }
+    static void read(Reader& r, uint16_t& v) {
+        uint32_t value = r.varint();
+        if (value > 0xFFFF) {
+            throw std::runtime_error("Invalid message header length");
+        }
+        v = static_cast<uint16_t>(value);
+    }
+};
+
+struct UnixTime32 {
+    using TimePoint = std::chrono::system_clock::time_point;
+    static constexpr size_t MIN_SIZE = 4;
+    static size_t size(const TimePoint&) { return 4; }
+    static void write(uint8_t*& p, const TimePoint& v) {
+        storeU32(p, static_cast<uint32_t>(std::chrono::system_clock::to_time_t(v)));
+    }
+    static void read(Reader& r, TimePoint& v) {
+        v = std::chrono::system_clock::from_time_t(static_cast<std::time_t>(loadU32(r.take(4))));
+    }
+};
+
+struct Str16 {
+    static constexpr size_t MIN_SIZE = 2;
+    template <typename S> static size_t length(const S& v) { return std::min<size_t>(v.size(), 0xFFFF); }
+    template <typename S> static size_t size(const S& v) { return 2 + length(v); }
+    template <typename S> static void write(uint8_t*& p, const S& v) {
+        size_t n = length(v);
+        storeU16(p, static_cast<uint16_t>(n));
+        if (n != 0) {
+            std::memcpy(p, v.data(), n);
+            p += n;
+        }
+    }
+    template <typename S> static void read(Reader& r, S& v) {
+        uint16_t n = loadU16(r.take(2));
+        if (n > r.remaining()) {
+            throw std::runtime_error("Invalid string length");
+        }
+        assignString(v, r.take(n), n);
+    }
+};
+
+using Bytes16 = Str16;
+
+struct VarStr {
+    static constexpr size_t MIN_SIZE = 1;
+    template <typename S> static size_t size(const S& v) {
+        return varintSize(static_cast<uint32_t>(v.size())) + v.size();
+    }
+    template <typename S> static void write(uint8_t*& p, const S& v) {
+        writeVarint(p, static_cast<uint32_t>(v.size()));
+        if (!v.empty()) {
+            std::memcpy(p, v.data(), v.size());
+            p += v.size();
+        }
+    }
+    template <typename S> static void read(Reader& r, S& v) {
+        uint32_t n = r.varint();
+        if (n > r.remaining()) {
+            throw std::runtime_error("Invalid string length");
+        }
+        assignString(v, r.take(n), n);
+    }
+};
+
+template <typename Element>
+struct List8 {
+    static constexpr size_t MIN_SIZE = 1;
+    template <typename V> static size_t count(const V& v) { return std::min<size_t>(v.size(), 0xFF); }
+    template <typename V> static size_t size(const V& v) {
+        size_t n = 1;
+        for (size_t i = 0; i < count(v); ++i) {
+            n += Element::size(v[i]);
+        }
+        return n;
+    }
+    template <typename V> static void write(uint8_t*& p, const V& v) {
+        size_t n = count(v);
+        *p++ = static_cast<uint8_t>(n);
+        for (size_t i = 0; i < n; ++i) {
+            Element::write(p, v[i]);
+        }
+    }
+    template <typename V> static void read(Reader& r, V& v) {
+        uint8_t n = *r.take(1);
+        v.clear();
+        v.resize(n);
+        for (auto& element : v) {
+            Element::read(r, element);
+        }
+    }
+};
+
+struct TrailingU32 {
+    static constexpr size_t MIN_SIZE = 0;
+    static size_t size(uint32_t v) { return v != 0 ? 4 : 0; }
+    static void write(uint8_t*& p, uint32_t v) {
+        if (v != 0) {
+            storeU32(p, v);
+        }
+    }
+    static void read(Reader& r, uint32_t& v) {
+        v = r.remaining() >= 4 ? loadU32(r.take(4)) : 0;
+    }
+};
+
+template <typename Encoding>
+struct Trailing {
+    static constexpr size_t MIN_SIZE = 0;
+    template <typename T> static size_t size(const T& v) { return Encoding::size(v); }
+    template <typename T> static void write(uint8_t*& p, const T& v) { Encoding::write(p, v); }
+    template <typename T> static void read(Reader& r, T& v) {
+        if (r.remaining() > 0) {
+            Encoding::read(r, v);
+        }
+    }
+};
+
+template <typename Encoding, auto Member>
+struct Field {
+    static constexpr size_t MIN_SIZE = Encoding::MIN_SIZE;
+    template <typename T> static size_t size(const T& obj) { return Encoding::size(obj.*Member); }
+    template <typename T> static void write(uint8_t*& p, const T& obj) { Encoding::write(p, obj.*Member); }
+    template <typename T> static void read(Reader& r, T& obj) { Encoding::read(r, obj.*Member); }
+};
+
+template <typename... Fields>
+struct Schema {
+    static constexpr size_t MIN_SIZE = (size_t{0} + ... + Fields::MIN_SIZE);
+
+    template <typename T> static size_t size(const T& obj) {
+        return (size_t{0} + ... + Fields::size(obj));
+    }
+
+    template <typename T> static uint8_t* write(uint8_t* p, const T& obj) {
+        (Fields::write(p, obj), ...);
+        return p;
+    }
+
+    template <typename T> static void appendTo(std::vector<uint8_t>& out, const T& obj) {
+        size_t base = out.size();
+        out.resize(base + size(obj));
+        write(out.data() + base, obj);
+    }
+
+    template <typename T> static std::vector<uint8_t> encode(const T& obj) {
+        std::vector<uint8_t> out(size(obj));
+        write(out.data(), obj);
+        return out;
+    }
+
+    template <typename T> static void read(Reader& r, T& obj) {
+        r.require(MIN_SIZE);
+        (Fields::read(r, obj), ...);
+    }
+
+    template <typename T> static T decode(ByteSpan data) {
+        T obj;
+        Reader r(data);
+        read(r, obj);
+        return obj;
+    }
+};
+
+template <typename RecordSchema>
+struct Record {
+    static constexpr size_t MIN_SIZE = RecordSchema::MIN_SIZE;
+    template <typename T> static size_t size(const T& v) { return RecordSchema::size(v); }
+    template <typename T> static void write(uint8_t*& p, const T& v) { p = RecordSchema::write(p, v); }
+    template <typename T> static void read(Reader& r, T& v) { RecordSchema::read(r, v); }
+};
+
+template <typename T>
+struct Encodable {
+    size_t encodedSize() const { return T::Schema::size(static_cast<const T&>(*this)); }
+    std::vector<uint8_t> serialize() const { return T::Schema::encode(static_cast<const T&>(*this)); }
+    static T deserialize(ByteSpan data) { return T::Schema::template decode<T>(data); }
+};
+
+} // namespace codec
+} // namespace echo
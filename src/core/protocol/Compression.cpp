@@ -0,0 +1,86 @@
+#include "Compression.h"
+#include <stdexcept>
+
+#ifdef ECHO_HAVE_LZ4
+#include <lz4.h>
+#endif
+
+namespace echo {
+
+bool PayloadCompressor::isAvailable() {
+#ifdef ECHO_HAVE_LZ4
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool PayloadCompressor::compress(const std::vector<uint8_t>& input, std::vector<uint8_t>& output) {
+#ifdef ECHO_HAVE_LZ4
+    if (input.size() < MIN_COMPRESS_SIZE || input.size() > MAX_DECOMPRESSED_SIZE) {
+        return false;
+    }
+
+    int bound = LZ4_compressBound(static_cast<int>(input.size()));
+    output.resize(SIZE_PREFIX + static_cast<size_t>(bound));
+
+    uint32_t originalSize = static_cast<uint32_t>(input.size());
+    output[0] = (originalSize >> 24) & 0xFF;
+    output[1] = (originalSize >> 16) & 0xFF;
+    output[2] = (originalSize >> 8) & 0xFF;
+    output[3] = originalSize & 0xFF;
+
+    int written = LZ4_compress_default(reinterpret_cast<const char*>(input.data()),
+                                       reinterpret_cast<char*>(output.data() + SIZE_PREFIX),
+                                       static_cast<int>(input.size()),
+                                       bound);
+    if (written <= 0 || SIZE_PREFIX + static_cast<size_t>(written) >= input.size()) {
+        output.clear();
+        return false;
+    }
+
+    output.resize(SIZE_PREFIX + static_cast<size_t>(written));
+    return true;
+#else
+    (void)input;
+    (void)output;
+    return false;
+#endif
+}
+
+std::vector<uint8_t> PayloadCompressor::decompress(ByteSpan input) {
+    std::vector<uint8_t> output;
+    decompress(input, output);
+    return output;
+}
+
+void PayloadCompressor::decompress(ByteSpan input, std::vector<uint8_t>& output) {
+#ifdef ECHO_HAVE_LZ4
+    if (input.size < SIZE_PREFIX) {
+        throw std::runtime_error("Compressed payload too small");
+    }
+
+    uint32_t originalSize = (static_cast<uint32_t>(input[0]) << 24) |
+                            (static_cast<uint32_t>(input[1]) << 16) |
+                            (static_cast<uint32_t>(input[2]) << 8) |
+                            input[3];
+    if (originalSize > MAX_DECOMPRESSED_SIZE) {
+        throw std::runtime_error("Compressed payload too large");
+    }
+
+    output.resize(originalSize);
+    int read = LZ4_decompress_safe(reinterpret_cast<const char*>(input.data + SIZE_PREFIX),
+                                   reinterpret_cast<char*>(output.data()),
+                                   static_cast<int>(input.size - SIZE_PREFIX),
+                                   static_cast<int>(originalSize));
+    if (read < 0 || static_cast<uint32_t>(read) != originalSize) {
+        throw std::runtime_error("Corrupt compressed payload");
+    }
+#else
+    (void)input;
+    (void)output;
+    throw std::runtime_error("Compressed payload received but LZ4 support is not built in");
+#endif
+}
+
+} // namespace echo
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "MessageView.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace echo {
+
+class PayloadCompressor {
+public:
+    static constexpr size_t MIN_COMPRESS_SIZE = 128;
+    static constexpr size_t SIZE_PREFIX = 4;
+    static constexpr size_t MAX_DECOMPRESSED_SIZE = 1024 * 1024;
+
+    static bool isAvailable();
+    static bool compress(const std::vector<uint8_t>& input, std::vector<uint8_t>& output);
+    static std::vector<uint8_t> decompress(ByteSpan input);
+    static void decompress(ByteSpan input, std::vector<uint8_t>& output);
+};
+
+} // namespace echo
@@ -0,0 +1,143 @@
+#include "DuplicateFilter.h"
+#include <algorithm>
+
+namespace echo {
+
+namespace {
+
+uint64_t mixId(uint32_t messageId) {
+    uint64_t x = messageId + 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+uint64_t fnv1a(ByteSpan data) {
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (uint8_t b : data) {
+        hash ^= b;
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
+
+}
+
+DuplicateFilter::DuplicateFilter(size_t capacity, std::chrono::milliseconds window)
+    : window_(window), generationSpan_(window / GENERATIONS) {
+    generationCapacity_ = std::max<size_t>(16, capacity / (SHARDS * GENERATIONS));
+    size_t slots = 1;
+    while (slots < generationCapacity_ * 2) {
+        slots <<= 1;
+    }
+    slotMask_ = slots - 1;
+}
+
+bool DuplicateFilter::markSeen(const MessageView& msg) {
+    return markSeen(senderKey(msg), msg.messageId(), std::chrono::steady_clock::now());
+}
+
+bool DuplicateFilter::markSeen(uint64_t senderKey, uint32_t messageId) {
+    return markSeen(senderKey, messageId, std::chrono::steady_clock::now());
+}
+
+bool DuplicateFilter::markSeen(uint64_t senderKey, uint32_t messageId, std::chrono::steady_clock::time_point now) {
+    uint64_t h = mixId(messageId);
+    Shard& shard = shards_[(h >> 32) % SHARDS];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    Generation* active = &shard.generations[shard.current];
+    if (active->slots.empty()) {
+        resetGeneration(*active, now);
+    } else if (active->count >= generationCapacity_ ||
+               (active->count > 0 && now - active->started >= generationSpan_)) {
+        shard.current = (shard.current + 1) % GENERATIONS;
+        active = &shard.generations[shard.current];
+        expired_.fetch_add(active->count, std::memory_order_relaxed);
+        resetGeneration(*active, now);
+        rotations_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    bool collision = false;
+    for (auto& gen : shard.generations) {
+        if (gen.count == 0) {
+            continue;
+        }
+        if (&gen != active && now - gen.started >= window_) {
+            expired_.fetch_add(gen.count, std::memory_order_relaxed);
+            resetGeneration(gen, now);
+            continue;
+        }
+        for (size_t i = h & slotMask_; gen.slots[i].used; i = (i + 1) & slotMask_) {
+            const Entry& entry = gen.slots[i];
+            if (entry.messageId != messageId) {
+                continue;
+            }
+            if (entry.sender == senderKey) {
+                hits_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            collision = true;
+        }
+    }
+
+    size_t i = h & slotMask_;
+    while (active->slots[i].used) {
+        i = (i + 1) & slotMask_;
+    }
+    active->slots[i] = Entry{senderKey, messageId, true};
+    active->count++;
+
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    if (collision) {
+        idCollisions_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return true;
+}
+
+void DuplicateFilter::resetGeneration(Generation& gen, std::chrono::steady_clock::time_point now) {
+    gen.slots.assign(slotMask_ + 1, Entry{});
+    gen.count = 0;
+    gen.started = now;
+}
+
+uint64_t DuplicateFilter::senderKey(const MessageView& msg) {
+    ByteSpan payload = msg.payload();
+    // Compressed frames are relayed byte-for-byte, so their leading bytes identify the sender as well.
+    ByteSpan sender = payload.subspan(0, std::min<size_t>(payload.size, 32));
+    if (!msg.isCompressed()) {
+        if (msg.isCompact() && msg.isText()) {
+            sender = payload.subspan(0, std::min<size_t>(payload.size, 4));
+        } else if (payload.size >= 2) {
+            size_t len = codec::loadU16(payload.data);
+            if (2 + len <= payload.size) {
+                sender = payload.subspan(2, len);
+            }
+        }
+    }
+    return fnv1a(sender);
+}
+
+DedupStats DuplicateFilter::stats() const {
+    DedupStats s;
+    s.hits = hits_.load(std::memory_order_relaxed);
+    s.misses = misses_.load(std::memory_order_relaxed);
+    s.idCollisions = idCollisions_.load(std::memory_order_relaxed);
+    s.rotations = rotations_.load(std::memory_order_relaxed);
+    s.expired = expired_.load(std::memory_order_relaxed);
+    s.entries = size();
+    return s;
+}
+
+size_t DuplicateFilter::size() const {
+    size_t total = 0;
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        for (const auto& gen : shard.generations) {
+            total += gen.count;
+        }
+    }
+    return total;
+}
+
+} // namespace echo
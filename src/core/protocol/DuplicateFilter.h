@@ -0,0 +1,74 @@
+#pragma once
+
+#include "MessageView.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace echo {
+
+struct DedupStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t idCollisions = 0;
+    uint64_t rotations = 0;
+    uint64_t expired = 0;
+    size_t entries = 0;
+};
+
+class DuplicateFilter {
+public:
+    static constexpr size_t SHARDS = 8;
+    static constexpr size_t GENERATIONS = 4;
+
+    explicit DuplicateFilter(size_t capacity = 8192,
+                             std::chrono::milliseconds window = std::chrono::minutes(5));
+
+    bool markSeen(const MessageView& msg);
+    bool markSeen(uint64_t senderKey, uint32_t messageId);
+    bool markSeen(uint64_t senderKey, uint32_t messageId, std::chrono::steady_clock::time_point now);
+
+    static uint64_t senderKey(const MessageView& msg);
+
+    DedupStats stats() const;
+    size_t size() const;
+
+private:
+    struct Entry {
+        uint64_t sender = 0;
+        uint32_t messageId = 0;
+        bool used = false;
+    };
+
+    struct Generation {
+        std::vector<Entry> slots;
+        size_t count = 0;
+        std::chrono::steady_clock::time_point started;
+    };
+
+    struct Shard {
+        mutable std::mutex mutex;
+        std::array<Generation, GENERATIONS> generations;
+        size_t current = 0;
+    };
+
+    void resetGeneration(Generation& gen, std::chrono::steady_clock::time_point now);
+
+    std::array<Shard, SHARDS> shards_;
+    size_t generationCapacity_;
+    size_t slotMask_;
+    std::chrono::milliseconds window_;
+    std::chrono::milliseconds generationSpan_;
+
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+    std::atomic<uint64_t> idCollisions_{0};
+    std::atomic<uint64_t> rotations_{0};
+    std::atomic<uint64_t> expired_{0};
+};
+
+} // namespace echo
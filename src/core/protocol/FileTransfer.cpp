@@ -0,0 +1,501 @@
+#include "FileTransfer.h"
+#include "MessageId.h"
+#include "utils/Crc32.h"
+#include <openssl/sha.h>
+#include <algorithm>
+#include <iterator>
+
+namespace echo {
+
+namespace {
+
+std::vector<uint8_t> sha256(const std::vector<uint8_t>& data) {
+    std::vector<uint8_t> digest(SHA256_DIGEST_LENGTH);
+    SHA256(data.data(), data.size(), digest.data());
+    return digest;
+}
+
+}
+
+FileTransferManager::FileTransferManager(SendCallback send,
+                                         std::chrono::milliseconds retryTimeout,
+                                         std::chrono::milliseconds idleTimeout)
+    : send_(std::move(send)), retryTimeout_(retryTimeout), idleTimeout_(idleTimeout) {
+}
+
+FileTransferManager::~FileTransferManager() {
+    stop();
+}
+
+void FileTransferManager::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_) return;
+    running_ = true;
+    worker_ = std::thread([this]() { run(); });
+}
+
+void FileTransferManager::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) return;
+        running_ = false;
+    }
+    cv_.notify_all();
+    if (worker_.joinable()) worker_.join();
+}
+
+void FileTransferManager::run() {
+    auto interval = std::min(RttEstimator::MIN_RTO, retryTimeout_) / 4;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (running_) {
+        cv_.wait_for(lock, interval, [this]() { return !running_; });
+        if (!running_) break;
+        lock.unlock();
+        tick(std::chrono::steady_clock::now());
+        lock.lock();
+    }
+}
+
+void FileTransferManager::setLocalUsername(const std::string& username) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    localUsername_ = username;
+}
+
+uint32_t FileTransferManager::chunkCount(size_t size, uint16_t chunkSize) {
+    return static_cast<uint32_t>((size + chunkSize - 1) / chunkSize);
+}
+
+uint64_t FileTransferManager::offer(const std::string& peer, const std::string& filename, std::vector<uint8_t> data) {
+    if (data.empty() || data.size() > MAX_FILE_BYTES) {
+        return 0;
+    }
+
+    Outgoing file;
+    file.peer = peer;
+    file.filename = filename;
+    file.sha256 = sha256(data);
+    file.chunkCount = chunkCount(data.size(), CHUNK_SIZE);
+    file.data = std::move(data);
+    file.offeredAt = std::chrono::steady_clock::now();
+
+    uint64_t fileId = MessageIdGenerator::next64();
+    Actions actions;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        FileRequestMessage request;
+        request.fileId = fileId;
+        request.control = FileControl::OFFER;
+        request.senderUsername = localUsername_;
+        request.recipientUsername = peer == BROADCAST_PEER ? "" : peer;
+        request.filename = file.filename;
+        request.sizeBytes = static_cast<uint32_t>(file.data.size());
+        request.chunkSize = CHUNK_SIZE;
+        request.window = WINDOW;
+        request.sha256 = file.sha256;
+        actions.frames.emplace_back(peer, MessageFactory::createFileRequestMessage(request).serialize());
+
+        outgoing_[fileId] = std::move(file);
+        stats_.offersSent++;
+    }
+    execute(actions);
+    return fileId;
+}
+
+bool FileTransferManager::accept(uint64_t fileId) {
+    Actions actions;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = incoming_.find(fileId);
+        if (it == incoming_.end() || it->second.accepted) {
+            return false;
+        }
+        Incoming& in = it->second;
+        in.accepted = true;
+        in.data.resize(in.offer.sizeBytes);
+        in.have.assign(in.chunkCount, false);
+        in.lastActivity = std::chrono::steady_clock::now();
+        sendControlLocked(fileId, FileControl::ACCEPT, in.offer.peer, actions);
+    }
+    execute(actions);
+    return true;
+}
+
+bool FileTransferManager::decline(uint64_t fileId) {
+    Actions actions;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = incoming_.find(fileId);
+        if (it == incoming_.end()) {
+            return false;
+        }
+        sendControlLocked(fileId, it->second.accepted ? FileControl::CANCEL : FileControl::DECLINE,
+                          it->second.offer.peer, actions);
+        incoming_.erase(it);
+    }
+    execute(actions);
+    return true;
+}
+
+void FileTransferManager::handleRequest(const FileRequestMessage& request) {
+    Actions actions;
+    auto now = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (request.senderUsername.empty() || request.senderUsername == localUsername_) return;
+        if (!request.recipientUsername.empty() && request.recipientUsername != localUsername_) return;
+
+        const std::string& from = request.senderUsername;
+        auto out = outgoing_.find(request.fileId);
+
+        switch (request.control) {
+        case FileControl::OFFER: {
+            if (incoming_.count(request.fileId)) return;
+            if (request.sizeBytes == 0 || request.sizeBytes > MAX_FILE_BYTES ||
+                request.chunkSize == 0 || request.sha256.size() != SHA256_DIGEST_LENGTH) {
+                return;
+            }
+            Incoming in;
+            in.offer.fileId = request.fileId;
+            in.offer.peer = from;
+            in.offer.filename = request.filename;
+            in.offer.sizeBytes = request.sizeBytes;
+            in.sha256 = request.sha256;
+            in.chunkSize = request.chunkSize;
+            in.chunkCount = chunkCount(request.sizeBytes, request.chunkSize);
+            in.lastActivity = now;
+            stats_.offersReceived++;
+            if (onOffer_) {
+                actions.events.push_back([cb = onOffer_, offer = in.offer]() { cb(offer); });
+            }
+            incoming_.emplace(request.fileId, std::move(in));
+            break;
+        }
+        case FileControl::ACCEPT: {
+            if (out == outgoing_.end() || out->second.sessions.count(from)) return;
+            if (out->second.peer != BROADCAST_PEER && out->second.peer != from) return;
+            Session& session = out->second.sessions[from];
+            session.window = std::max<uint16_t>(1, std::min<uint16_t>(request.window, WINDOW));
+            session.rtt = RttEstimator(retryTimeout_);
+            session.lastProgress = now;
+            pumpLocked(request.fileId, out->second, from, session, actions);
+            break;
+        }
+        case FileControl::ACK: {
+            if (out == outgoing_.end()) return;
+            auto s = out->second.sessions.find(from);
+            if (s == out->second.sessions.end()) return;
+            Session& session = s->second;
+            uint32_t k = std::min(request.nextChunk, out->second.chunkCount);
+            for (const auto& range : request.received) {
+                for (uint32_t i = std::max(range.first, k); i <= range.last && i < session.sent; ++i) {
+                    if (session.sacked.insert(i).second) stats_.chunksSacked++;
+                }
+            }
+            if (k > session.acked) {
+                // The newest chunk this ACK covers gives the sample; resent chunks carry none (Karn's rule).
+                auto end = session.firstSent.lower_bound(k);
+                if (end != session.firstSent.begin() && std::prev(end)->first >= session.acked) {
+                    session.rtt.sample(now - std::prev(end)->second);
+                }
+                session.firstSent.erase(session.firstSent.begin(), end);
+                session.sacked.erase(session.sacked.begin(), session.sacked.lower_bound(k));
+                session.acked = k;
+                session.next = std::max(session.next, k);
+                session.repaired = std::max(session.repaired, k);
+                session.retries = 0;
+                session.lastProgress = now;
+            }
+            repairLocked(request.fileId, out->second, from, session, actions);
+            pumpLocked(request.fileId, out->second, from, session, actions);
+            break;
+        }
+        case FileControl::DECLINE:
+        case FileControl::COMPLETE:
+        case FileControl::CANCEL: {
+            if (out != outgoing_.end() && (out->second.sessions.count(from) || request.control == FileControl::DECLINE)) {
+                Outgoing& file = out->second;
+                file.sessions.erase(from);
+                bool ok = request.control == FileControl::COMPLETE;
+                if (ok) {
+                    stats_.filesSent++;
+                } else if (request.control == FileControl::CANCEL) {
+                    stats_.transfersFailed++;
+                }
+                FileOffer offer{request.fileId, from, file.filename, static_cast<uint32_t>(file.data.size())};
+                notifyFinishedLocked(offer, ok, ok ? "" : request.control == FileControl::DECLINE ? "declined" : "cancelled by peer", actions);
+                if (file.peer != BROADCAST_PEER && file.sessions.empty()) {
+                    outgoing_.erase(out);
+                }
+            } else if (request.control == FileControl::CANCEL) {
+                auto in = incoming_.find(request.fileId);
+                if (in == incoming_.end() || in->second.offer.peer != from) return;
+                if (in->second.accepted) {
+                    stats_.transfersFailed++;
+                    notifyFinishedLocked(in->second.offer, false, "cancelled by sender", actions);
+                }
+                incoming_.erase(in);
+            }
+            break;
+        }
+        }
+    }
+    execute(actions);
+}
+
+void FileTransferManager::handleChunk(const FileChunkMessage& chunk) {
+    Actions actions;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = incoming_.find(chunk.fileId);
+        if (it == incoming_.end()) {
+            // The sender is still resending a file we finished, so our COMPLETE was lost.
+            auto done = completed_.find(chunk.fileId);
+            if (done == completed_.end()) return;
+            stats_.duplicateChunks++;
+            sendControlLocked(chunk.fileId, FileControl::COMPLETE, done->second.peer, actions, done->second.chunkCount);
+        } else {
+            Incoming& in = it->second;
+            if (!in.accepted || chunk.index >= in.chunkCount) return;
+
+            in.lastActivity = std::chrono::steady_clock::now();
+            stats_.chunksReceived++;
+
+            size_t offset = static_cast<size_t>(chunk.index) * in.chunkSize;
+            size_t expected = std::min<size_t>(in.chunkSize, in.offer.sizeBytes - offset);
+            if (chunk.data.size() != expected || crc32(chunk.data.data(), chunk.data.size()) != chunk.crc32) {
+                stats_.crcFailures++;
+                sendAckLocked(chunk.fileId, in, actions);
+            } else if (in.have[chunk.index]) {
+                stats_.duplicateChunks++;
+                // A resent chunk means our last ACK was lost; selective resends can be any chunk, so always answer.
+                sendAckLocked(chunk.fileId, in, actions);
+            } else {
+                std::copy(chunk.data.begin(), chunk.data.end(), in.data.begin() + offset);
+                in.have[chunk.index] = true;
+                bool inOrder = chunk.index == in.nextExpected;
+                while (in.nextExpected < in.chunkCount && in.have[in.nextExpected]) {
+                    in.nextExpected++;
+                }
+
+                if (in.nextExpected == in.chunkCount) {
+                    finishIncomingLocked(chunk.fileId, in, actions);
+                    incoming_.erase(it);
+                } else if (!inOrder || ++in.sinceAck >= ACK_EVERY) {
+                    in.sinceAck = 0;
+                    sendAckLocked(chunk.fileId, in, actions);
+                }
+            }
+        }
+    }
+    execute(actions);
+}
+
+void FileTransferManager::tick(std::chrono::steady_clock::time_point now) {
+    Actions actions;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto out = outgoing_.begin(); out != outgoing_.end();) {
+            Outgoing& file = out->second;
+            for (auto s = file.sessions.begin(); s != file.sessions.end();) {
+                Session& session = s->second;
+                if (now - session.lastProgress < session.rtt.rto()) {
+                    ++s;
+                    continue;
+                }
+                if (++session.retries > MAX_RETRIES) {
+                    stats_.transfersFailed++;
+                    sendControlLocked(out->first, FileControl::CANCEL, s->first, actions);
+                    notifyFinishedLocked(FileOffer{out->first, s->first, file.filename, static_cast<uint32_t>(file.data.size())},
+                                         false, "timed out", actions);
+                    s = file.sessions.erase(s);
+                    continue;
+                }
+                session.rtt.backoff();
+                session.next = session.acked;
+                session.repaired = session.acked;
+                session.lastProgress = now;
+                pumpLocked(out->first, file, s->first, session, actions);
+                ++s;
+            }
+
+            if (file.sessions.empty() && now - file.offeredAt > OFFER_TTL) {
+                out = outgoing_.erase(out);
+            } else {
+                ++out;
+            }
+        }
+
+        for (auto it = completed_.begin(); it != completed_.end();) {
+            if (now - it->second.at > OFFER_TTL) {
+                it = completed_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        for (auto it = incoming_.begin(); it != incoming_.end();) {
+            Incoming& in = it->second;
+            if (in.accepted && now - in.lastActivity > idleTimeout_) {
+                stats_.transfersFailed++;
+                sendControlLocked(it->first, FileControl::CANCEL, in.offer.peer, actions);
+                notifyFinishedLocked(in.offer, false, "stalled", actions);
+                it = incoming_.erase(it);
+            } else if (!in.accepted && now - in.lastActivity > OFFER_TTL) {
+                it = incoming_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    execute(actions);
+}
+
+void FileTransferManager::pumpLocked(uint64_t fileId, Outgoing& file, const std::string& receiver,
+                                     Session& session, Actions& actions) {
+    while (session.next < file.chunkCount && session.next < session.acked + session.window) {
+        if (session.sacked.count(session.next)) {
+            session.next++;
+            continue;
+        }
+        if (session.next < session.sent) {
+            stats_.chunksRetransmitted++;
+            session.firstSent.erase(session.next);
+        } else {
+            session.sent = session.next + 1;
+            session.firstSent[session.next] = std::chrono::steady_clock::now();
+        }
+        sendChunkLocked(fileId, file, receiver, session.next, actions);
+        session.next++;
+    }
+}
+
+void FileTransferManager::repairLocked(uint64_t fileId, Outgoing& file, const std::string& receiver,
+                                       Session& session, Actions& actions) {
+    if (session.sacked.empty()) return;
+    // Holes below the highest selectively acknowledged chunk are resent once per ACK that reveals them.
+    uint32_t highest = *session.sacked.rbegin();
+    for (uint32_t i = std::max(session.repaired, session.acked); i < highest && i < session.next; ++i) {
+        if (session.sacked.count(i)) continue;
+        stats_.chunksRetransmitted++;
+        session.firstSent.erase(i);
+        sendChunkLocked(fileId, file, receiver, i, actions);
+    }
+    session.repaired = std::max(session.repaired, highest);
+}
+
+void FileTransferManager::sendChunkLocked(uint64_t fileId, const Outgoing& file, const std::string& receiver,
+                                          uint32_t index, Actions& actions) {
+    size_t offset = static_cast<size_t>(index) * CHUNK_SIZE;
+    size_t len = std::min<size_t>(CHUNK_SIZE, file.data.size() - offset);
+
+    FileChunkMessage chunk;
+    chunk.fileId = fileId;
+    chunk.index = index;
+    chunk.data.assign(file.data.begin() + offset, file.data.begin() + offset + len);
+    chunk.crc32 = crc32(chunk.data.data(), chunk.data.size());
+    actions.frames.emplace_back(receiver, MessageFactory::createFileChunkMessage(chunk).serialize());
+    stats_.chunksSent++;
+}
+
+void FileTransferManager::sendControlLocked(uint64_t fileId, FileControl control, const std::string& peer,
+                                            Actions& actions, uint32_t nextChunk) {
+    FileRequestMessage request;
+    request.fileId = fileId;
+    request.control = control;
+    request.senderUsername = localUsername_;
+    request.recipientUsername = peer;
+    request.nextChunk = nextChunk;
+    if (control == FileControl::ACCEPT) {
+        request.window = WINDOW;
+    }
+    actions.frames.emplace_back(peer, MessageFactory::createFileRequestMessage(request).serialize());
+}
+
+void FileTransferManager::sendAckLocked(uint64_t fileId, const Incoming& in, Actions& actions) {
+    FileRequestMessage request;
+    request.fileId = fileId;
+    request.control = FileControl::ACK;
+    request.senderUsername = localUsername_;
+    request.recipientUsername = in.offer.peer;
+    request.nextChunk = in.nextExpected;
+    request.received = receivedRanges(in.have, in.nextExpected, MAX_ACK_RANGES);
+    actions.frames.emplace_back(in.offer.peer, MessageFactory::createFileRequestMessage(request).serialize());
+}
+
+std::vector<AckRange> FileTransferManager::receivedRanges(const std::vector<bool>& have, uint32_t from, size_t limit) {
+    std::vector<AckRange> out;
+    uint32_t count = static_cast<uint32_t>(have.size());
+    for (uint32_t i = from; i < count && out.size() < limit; ++i) {
+        if (!have[i]) continue;
+        uint32_t last = i;
+        while (last + 1 < count && have[last + 1]) last++;
+        out.push_back(AckRange{i, last});
+        i = last;
+    }
+    return out;
+}
+
+void FileTransferManager::finishIncomingLocked(uint64_t fileId, Incoming& in, Actions& actions) {
+    if (sha256(in.data) != in.sha256) {
+        stats_.hashFailures++;
+        stats_.transfersFailed++;
+        sendControlLocked(fileId, FileControl::CANCEL, in.offer.peer, actions);
+        notifyFinishedLocked(in.offer, false, "hash mismatch", actions);
+        return;
+    }
+
+    stats_.filesReceived++;
+    sendControlLocked(fileId, FileControl::COMPLETE, in.offer.peer, actions, in.chunkCount);
+    completed_[fileId] = Completed{in.offer.peer, in.chunkCount, std::chrono::steady_clock::now()};
+    if (onReceived_) {
+        actions.events.push_back([cb = onReceived_, offer = in.offer, data = std::move(in.data)]() { cb(offer, data); });
+    }
+}
+
+void FileTransferManager::notifyFinishedLocked(const FileOffer& offer, bool ok, const std::string& reason, Actions& actions) {
+    if (onFinished_) {
+        actions.events.push_back([cb = onFinished_, offer, ok, reason]() { cb(offer, ok, reason); });
+    }
+}
+
+void FileTransferManager::execute(Actions& actions) {
+    for (auto& frame : actions.frames) {
+        send_(frame.first, std::move(frame.second));
+    }
+    for (auto& event : actions.events) {
+        event();
+    }
+}
+
+FileTransferStats FileTransferManager::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    FileTransferStats s = stats_;
+    s.activeTransfers = 0;
+    for (const auto& kv : outgoing_) s.activeTransfers += kv.second.sessions.size();
+    for (const auto& kv : incoming_) s.activeTransfers += kv.second.accepted ? 1 : 0;
+    return s;
+}
+
+std::string FileTransferManager::formatId(uint64_t fileId) {
+    static const char* hexd = "0123456789abcdef";
+    std::string out(16, '0');
+    for (int i = 0; i < 16; ++i) out[i] = hexd[(fileId >> ((15 - i) * 4)) & 0xF];
+    return out;
+}
+
+bool FileTransferManager::parseId(const std::string& text, uint64_t& fileId) {
+    if (text.empty() || text.size() > 16) return false;
+    uint64_t value = 0;
+    for (char c : text) {
+        int digit;
+        if (c >= '0' && c <= '9') digit = c - '0';
+        else if (c >= 'a' && c <= 'f') digit = c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') digit = c - 'A' + 10;
+        else return false;
+        value = (value << 4) | static_cast<uint64_t>(digit);
+    }
+    fileId = value;
+    return true;
+}
+
+} // namespace echo
@@ -0,0 +1,166 @@
+#pragma once
+
+#include "MessageTypes.h"
+#include "RttEstimator.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace echo {
+
+struct FileOffer {
+    uint64_t fileId = 0;
+    std::string peer;
+    std::string filename;
+    uint32_t sizeBytes = 0;
+};
+
+struct FileTransferStats {
+    uint64_t offersSent = 0;
+    uint64_t offersReceived = 0;
+    uint64_t chunksSent = 0;
+    uint64_t chunksRetransmitted = 0;
+    uint64_t chunksSacked = 0;
+    uint64_t chunksReceived = 0;
+    uint64_t duplicateChunks = 0;
+    uint64_t crcFailures = 0;
+    uint64_t hashFailures = 0;
+    uint64_t filesSent = 0;
+    uint64_t filesReceived = 0;
+    uint64_t transfersFailed = 0;
+    size_t activeTransfers = 0;
+};
+
+class FileTransferManager {
+public:
+    static constexpr size_t MAX_FILE_BYTES = 64 * 1024 * 1024;
+    static constexpr uint16_t CHUNK_SIZE = 8192;
+    static constexpr uint16_t WINDOW = 16;
+    static constexpr uint32_t ACK_EVERY = 4;
+    static constexpr size_t MAX_ACK_RANGES = 8;
+    static constexpr int MAX_RETRIES = 8;
+    static constexpr std::chrono::minutes OFFER_TTL{10};
+    static constexpr const char* BROADCAST_PEER = "*";
+
+    using SendCallback = std::function<void(const std::string& peer, std::vector<uint8_t> frame)>;
+    using OfferCallback = std::function<void(const FileOffer& offer)>;
+    using ReceivedCallback = std::function<void(const FileOffer& offer, const std::vector<uint8_t>& data)>;
+    using FinishedCallback = std::function<void(const FileOffer& offer, bool ok, const std::string& reason)>;
+
+    explicit FileTransferManager(SendCallback send,
+                                 std::chrono::milliseconds retryTimeout = std::chrono::milliseconds(1500),
+                                 std::chrono::milliseconds idleTimeout = std::chrono::seconds(60));
+    ~FileTransferManager();
+
+    void start();
+    void stop();
+
+    void setLocalUsername(const std::string& username);
+    void setOnOffer(OfferCallback cb) { onOffer_ = std::move(cb); }
+    void setOnReceived(ReceivedCallback cb) { onReceived_ = std::move(cb); }
+    void setOnFinished(FinishedCallback cb) { onFinished_ = std::move(cb); }
+
+    uint64_t offer(const std::string& peer, const std::string& filename, std::vector<uint8_t> data);
+    bool accept(uint64_t fileId);
+    bool decline(uint64_t fileId);
+
+    void handleRequest(const FileRequestMessage& request);
+    void handleChunk(const FileChunkMessage& chunk);
+    void tick(std::chrono::steady_clock::time_point now);
+
+    FileTransferStats stats() const;
+
+    static std::string formatId(uint64_t fileId);
+    static bool parseId(const std::string& text, uint64_t& fileId);
+
+private:
+    struct Session {
+        uint32_t acked = 0;
+        uint32_t next = 0;
+        uint32_t sent = 0;
+        uint32_t repaired = 0;
+        uint16_t window = WINDOW;
+        int retries = 0;
+        std::chrono::steady_clock::time_point lastProgress;
+        RttEstimator rtt;
+        std::map<uint32_t, std::chrono::steady_clock::time_point> firstSent;
+        std::set<uint32_t> sacked;
+    };
+
+    struct Outgoing {
+        std::string peer;
+        std::string filename;
+        std::vector<uint8_t> data;
+        std::vector<uint8_t> sha256;
+        uint32_t chunkCount = 0;
+        std::map<std::string, Session> sessions;
+        std::chrono::steady_clock::time_point offeredAt;
+    };
+
+    struct Incoming {
+        FileOffer offer;
+        std::vector<uint8_t> sha256;
+        uint16_t chunkSize = 0;
+        uint32_t chunkCount = 0;
+        std::vector<uint8_t> data;
+        std::vector<bool> have;
+        uint32_t nextExpected = 0;
+        uint32_t sinceAck = 0;
+        bool accepted = false;
+        std::chrono::steady_clock::time_point lastActivity;
+    };
+
+    // A received file, kept for OFFER_TTL so chunks resent after a lost COMPLETE get it again.
+    struct Completed {
+        std::string peer;
+        uint32_t chunkCount = 0;
+        std::chrono::steady_clock::time_point at;
+    };
+
+    struct Actions {
+        std::vector<std::pair<std::string, std::vector<uint8_t>>> frames;
+        std::vector<std::function<void()>> events;
+    };
+
+    void run();
+    void pumpLocked(uint64_t fileId, Outgoing& file, const std::string& receiver, Session& session, Actions& actions);
+    void sendChunkLocked(uint64_t fileId, const Outgoing& file, const std::string& receiver, uint32_t index, Actions& actions);
+    void sendControlLocked(uint64_t fileId, FileControl control, const std::string& peer, Actions& actions,
+                           uint32_t nextChunk = 0);
+    void sendAckLocked(uint64_t fileId, const Incoming& in, Actions& actions);
+    void repairLocked(uint64_t fileId, Outgoing& file, const std::string& receiver, Session& session, Actions& actions);
+    void finishIncomingLocked(uint64_t fileId, Incoming& in, Actions& actions);
+    void notifyFinishedLocked(const FileOffer& offer, bool ok, const std::string& reason, Actions& actions);
+    void execute(Actions& actions);
+
+    static uint32_t chunkCount(size_t size, uint16_t chunkSize);
+    static std::vector<AckRange> receivedRanges(const std::vector<bool>& have, uint32_t from, size_t limit);
+
+    SendCallback send_;
+    OfferCallback onOffer_;
+    ReceivedCallback onReceived_;
+    FinishedCallback onFinished_;
+    std::chrono::milliseconds retryTimeout_;
+    std::chrono::milliseconds idleTimeout_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::thread worker_;
+    bool running_ = false;
+    std::string localUsername_;
+    std::unordered_map<uint64_t, Outgoing> outgoing_;
+    std::unordered_map<uint64_t, Incoming> incoming_;
+    std::unordered_map<uint64_t, Completed> completed_;
+    FileTransferStats stats_;
+};
+
+} // namespace echo
@@ -0,0 +1,205 @@
+#include "Fragmentation.h"
+#include <algorithm>
+
+namespace echo {
+
+namespace {
+
+std::string pendingKey(const std::string& source, uint32_t frameId) {
+    return source + "#" + std::to_string(frameId);
+}
+
+}
+
+bool Fragmenter::isFragment(ByteSpan data) {
+    return data.size >= HEADER_SIZE && data[0] == MARKER;
+}
+
+std::vector<std::vector<uint8_t>> Fragmenter::split(const std::vector<uint8_t>& frame, size_t mtu) {
+    std::vector<std::vector<uint8_t>> fragments;
+    mtu = std::max(mtu, MIN_MTU);
+
+    if (frame.size() <= mtu) {
+        fragments.push_back(frame);
+        return fragments;
+    }
+
+    size_t chunk = mtu - HEADER_SIZE;
+    size_t count = (frame.size() + chunk - 1) / chunk;
+    if (count > MAX_FRAGMENTS) {
+        return fragments;
+    }
+
+    uint32_t frameId = nextFrameId_++;
+    fragments.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        size_t offset = i * chunk;
+        size_t len = std::min(chunk, frame.size() - offset);
+
+        std::vector<uint8_t> fragment(HEADER_SIZE + len);
+        fragment[0] = MARKER;
+        fragment[1] = (frameId >> 24) & 0xFF;
+        fragment[2] = (frameId >> 16) & 0xFF;
+        fragment[3] = (frameId >> 8) & 0xFF;
+        fragment[4] = frameId & 0xFF;
+        fragment[5] = (i >> 8) & 0xFF;
+        fragment[6] = i & 0xFF;
+        fragment[7] = (count >> 8) & 0xFF;
+        fragment[8] = count & 0xFF;
+        std::copy(frame.begin() + offset, frame.begin() + offset + len, fragment.begin() + HEADER_SIZE);
+        fragments.push_back(std::move(fragment));
+    }
+
+    framesSplit_++;
+    fragmentsSent_ += count;
+    return fragments;
+}
+
+Reassembler::Reassembler(size_t maxPendingBytes, std::chrono::milliseconds timeout)
+    : maxPendingBytes_(maxPendingBytes), timeout_(timeout), lastSweep_(std::chrono::steady_clock::now()) {
+}
+
+bool Reassembler::accept(const std::string& source, ByteSpan fragment, std::vector<uint8_t>& frame) {
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (now - lastSweep_ > std::chrono::seconds(1)) {
+        expireLocked(now);
+    }
+
+    if (!Fragmenter::isFragment(fragment)) {
+        stats_.malformed++;
+        return false;
+    }
+
+    uint32_t frameId = (static_cast<uint32_t>(fragment[1]) << 24) |
+                       (static_cast<uint32_t>(fragment[2]) << 16) |
+                       (static_cast<uint32_t>(fragment[3]) << 8) |
+                       fragment[4];
+    uint16_t index = (static_cast<uint16_t>(fragment[5]) << 8) | fragment[6];
+    uint16_t count = (static_cast<uint16_t>(fragment[7]) << 8) | fragment[8];
+    ByteSpan data = fragment.subspan(Fragmenter::HEADER_SIZE);
+
+    // The Fragmenter never sends an empty part.
+    size_t slots = count * sizeof(std::vector<uint8_t>);
+    if (count == 0 || count > Fragmenter::MAX_FRAGMENTS || index >= count || data.size == 0 ||
+        slots + data.size > maxPendingBytes_) {
+        stats_.malformed++;
+        return false;
+    }
+
+    stats_.fragmentsReceived++;
+
+    std::string key = pendingKey(source, frameId);
+    auto it = pending_.find(key);
+    if (it != pending_.end() && it->second.parts.size() != count) {
+        stats_.malformed++;
+        dropLocked(it);
+        return false;
+    }
+    if (it != pending_.end() && it->second.have[index]) {
+        stats_.duplicateFragments++;
+        return false;
+    }
+
+    size_t charge = data.size + (it == pending_.end() ? slots : 0);
+    while (pendingBytes_ + charge > maxPendingBytes_ && !pending_.empty()) {
+        if (it != pending_.end() && pending_.size() == 1) break;
+        evictOldestLocked();
+        if (it != pending_.end()) {
+            it = pending_.find(key);
+            if (it == pending_.end()) {
+                return false;
+            }
+        }
+    }
+    if (pendingBytes_ + charge > maxPendingBytes_) {
+        stats_.evicted++;
+        if (it != pending_.end()) dropLocked(it);
+        return false;
+    }
+
+    if (it == pending_.end()) {
+        Pending p;
+        p.parts.resize(count);
+        p.have.resize(count, false);
+        p.bytes = slots;
+        p.firstSeen = now;
+        pendingBytes_ += slots;
+        it = pending_.emplace(std::move(key), std::move(p)).first;
+    }
+
+    Pending& slot = it->second;
+    slot.parts[index] = data.toVector();
+    slot.have[index] = true;
+    slot.received++;
+    slot.bytes += data.size;
+    slot.lastUpdate = now;
+    pendingBytes_ += data.size;
+
+    if (slot.received < count) {
+        return false;
+    }
+
+    frame.clear();
+    frame.reserve(slot.bytes - slots);
+    for (const auto& part : slot.parts) {
+        frame.insert(frame.end(), part.begin(), part.end());
+    }
+    stats_.framesReassembled++;
+    dropLocked(it);
+    return true;
+}
+
+void Reassembler::expire(std::chrono::steady_clock::time_point now) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    expireLocked(now);
+}
+
+void Reassembler::expireLocked(std::chrono::steady_clock::time_point now) {
+    lastSweep_ = now;
+    for (auto it = pending_.begin(); it != pending_.end();) {
+        auto next = std::next(it);
+        if (now - it->second.lastUpdate > timeout_) {
+            stats_.timedOut++;
+            dropLocked(it);
+        }
+        it = next;
+    }
+}
+
+void Reassembler::clear(const std::string& source) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::string prefix = source + "#";
+    for (auto it = pending_.begin(); it != pending_.end();) {
+        auto next = std::next(it);
+        if (it->first.compare(0, prefix.size(), prefix) == 0) {
+            dropLocked(it);
+        }
+        it = next;
+    }
+}
+
+FragmentationStats Reassembler::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    FragmentationStats s = stats_;
+    s.pendingFrames = pending_.size();
+    s.pendingBytes = pendingBytes_;
+    return s;
+}
+
+void Reassembler::dropLocked(std::unordered_map<std::string, Pending>::iterator it) {
+    pendingBytes_ -= it->second.bytes;
+    pending_.erase(it);
+}
+
+void Reassembler::evictOldestLocked() {
+    auto oldest = std::min_element(pending_.begin(), pending_.end(),
+        [](const auto& a, const auto& b) { return a.second.firstSeen < b.second.firstSeen; });
+    if (oldest != pending_.end()) {
+        stats_.evicted++;
+        dropLocked(oldest);
+    }
+}
+
+} // namespace echo
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "MessageView.h"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace echo {
+
+struct FragmentationStats {
+    uint64_t framesSplit = 0;
+    uint64_t fragmentsSent = 0;
+    uint64_t fragmentsReceived = 0;
+    uint64_t framesReassembled = 0;
+    uint64_t duplicateFragments = 0;
+    uint64_t timedOut = 0;
+    uint64_t evicted = 0;
+    uint64_t malformed = 0;
+    size_t pendingFrames = 0;
+    size_t pendingBytes = 0;
+};
+
+class Fragmenter {
+public:
+    static constexpr uint8_t MARKER = 0xF0;
+    static constexpr size_t HEADER_SIZE = 9;
+    static constexpr size_t MIN_MTU = 20;
+    static constexpr size_t MAX_FRAGMENTS = 4096;
+
+    static bool isFragment(ByteSpan data);
+
+    std::vector<std::vector<uint8_t>> split(const std::vector<uint8_t>& frame, size_t mtu);
+
+    uint64_t framesSplit() const { return framesSplit_; }
+    uint64_t fragmentsSent() const { return fragmentsSent_; }
+
+private:
+    std::atomic<uint32_t> nextFrameId_{1};
+    std::atomic<uint64_t> framesSplit_{0};
+    std::atomic<uint64_t> fragmentsSent_{0};
+};
+
+class Reassembler {
+public:
+    explicit Reassembler(size_t maxPendingBytes = 256 * 1024,
+                         std::chrono::milliseconds timeout = std::chrono::seconds(10));
+
+    bool accept(const std::string& source, ByteSpan fragment, std::vector<uint8_t>& frame);
+    void expire(std::chrono::steady_clock::time_point now);
+    void clear(const std::string& source);
+
+    FragmentationStats stats() const;
+
+private:
+    // bytes counts the part slots as well as the data, so a frame announcing many parts pays for them up front.
+    struct Pending {
+        std::vector<std::vector<uint8_t>> parts;
+        std::vector<bool> have;
+        uint16_t received = 0;
+        size_t bytes = 0;
+        std::chrono::steady_clock::time_point firstSeen;
+        std::chrono::steady_clock::time_point lastUpdate;
+    };
+
+    void expireLocked(std::chrono::steady_clock::time_point now);
+    void dropLocked(std::unordered_map<std::string, Pending>::iterator it);
+    void evictOldestLocked();
+
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, Pending> pending_;
+    size_t pendingBytes_ = 0;
+    size_t maxPendingBytes_;
+    std::chrono::milliseconds timeout_;
+    std::chrono::steady_clock::time_point lastSweep_;
+    FragmentationStats stats_;
+};
+
+} // namespace echo
@@ -0,0 +1,193 @@
+#include "FrameBatch.h"
+#include <algorithm>
+
+namespace echo {
+
+bool BatchCodec::isBatch(ByteSpan data) {
+    return data.size >= HEADER_SIZE && data[0] == MARKER;
+}
+
+std::vector<uint8_t> BatchCodec::encode(const std::vector<std::vector<uint8_t>>& frames) {
+    size_t total = HEADER_SIZE;
+    for (const auto& frame : frames) total += ENTRY_OVERHEAD + frame.size();
+
+    std::vector<uint8_t> out;
+    out.reserve(total);
+    out.push_back(MARKER);
+    out.push_back((frames.size() >> 8) & 0xFF);
+    out.push_back(frames.size() & 0xFF);
+    for (const auto& frame : frames) {
+        out.push_back((frame.size() >> 8) & 0xFF);
+        out.push_back(frame.size() & 0xFF);
+        out.insert(out.end(), frame.begin(), frame.end());
+    }
+    return out;
+}
+
+FrameBatcher::FrameBatcher(FlushCallback flush, std::chrono::milliseconds window, size_t maxBatchBytes)
+    : flush_(std::move(flush)), window_(window),
+      maxBatchBytes_(std::min(maxBatchBytes, BatchCodec::MAX_FRAME_SIZE)) {
+}
+
+FrameBatcher::~FrameBatcher() {
+    stop();
+}
+
+void FrameBatcher::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_) return;
+    running_ = true;
+    worker_ = std::thread([this]() { run(); });
+}
+
+void FrameBatcher::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) return;
+        running_ = false;
+    }
+    cv_.notify_all();
+    if (worker_.joinable()) worker_.join();
+
+    std::unordered_map<std::string, Queue> remaining;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        remaining.swap(queues_);
+    }
+    for (auto& kv : remaining) {
+        seal(kv.second);
+        for (auto& batch : kv.second.sealed) {
+            send(kv.first, std::move(batch));
+        }
+    }
+}
+
+void FrameBatcher::seal(Queue& q) {
+    if (q.frames.empty()) return;
+    q.sealed.push_back(std::move(q.frames));
+    q.frames.clear();
+    q.bytes = 0;
+}
+
+void FrameBatcher::enqueue(const std::string& peer, std::vector<uint8_t> frame) {
+    bool oversized = frame.size() + BatchCodec::HEADER_SIZE + BatchCodec::ENTRY_OVERHEAD > maxBatchBytes_;
+    Queue direct;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.framesQueued++;
+
+        if (!running_) {
+            auto it = queues_.find(peer);
+            if (it != queues_.end()) {
+                direct = std::move(it->second);
+                queues_.erase(it);
+            }
+            seal(direct);
+            direct.sealed.push_back(Batch{});
+            direct.sealed.back().push_back(std::move(frame));
+        } else {
+            Queue& q = queues_[peer];
+            size_t entry = frame.size() + BatchCodec::ENTRY_OVERHEAD;
+            if (oversized || BatchCodec::HEADER_SIZE + q.bytes + entry > maxBatchBytes_) {
+                seal(q);
+            }
+            if (oversized) {
+                q.sealed.push_back(Batch{});
+                q.sealed.back().push_back(std::move(frame));
+            } else {
+                if (q.frames.empty()) {
+                    q.deadline = std::chrono::steady_clock::now() + window_.load();
+                }
+                q.frames.push_back(std::move(frame));
+                q.bytes += entry;
+            }
+        }
+    }
+    cv_.notify_one();
+
+    for (auto& batch : direct.sealed) {
+        send(peer, std::move(batch));
+    }
+}
+
+void FrameBatcher::flush(const std::string& peer) {
+    Queue direct;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = queues_.find(peer);
+        if (it == queues_.end()) return;
+        seal(it->second);
+        if (running_) {
+            cv_.notify_one();
+            return;
+        }
+        direct = std::move(it->second);
+        queues_.erase(it);
+    }
+    for (auto& batch : direct.sealed) {
+        send(peer, std::move(batch));
+    }
+}
+
+BatchStats FrameBatcher::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void FrameBatcher::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (running_) {
+        auto now = std::chrono::steady_clock::now();
+        auto next = now + std::chrono::seconds(1);
+        std::vector<std::pair<std::string, std::deque<Batch>>> due;
+
+        for (auto it = queues_.begin(); it != queues_.end();) {
+            Queue& q = it->second;
+            if (!q.frames.empty() && q.deadline <= now) {
+                seal(q);
+            }
+            if (!q.sealed.empty()) {
+                due.emplace_back(it->first, std::move(q.sealed));
+                q.sealed.clear();
+            }
+            if (q.frames.empty()) {
+                it = queues_.erase(it);
+            } else {
+                if (q.deadline < next) next = q.deadline;
+                ++it;
+            }
+        }
+
+        if (!due.empty()) {
+            lock.unlock();
+            for (auto& d : due) {
+                for (auto& batch : d.second) send(d.first, std::move(batch));
+            }
+            lock.lock();
+            continue;
+        }
+
+        cv_.wait_until(lock, next);
+    }
+}
+
+void FrameBatcher::send(const std::string& peer, Batch frames) {
+    if (frames.empty()) return;
+
+    bool ok = false;
+    if (frames.size() == 1) {
+        ok = flush_(peer, frames.front());
+    } else {
+        ok = flush_(peer, BatchCodec::encode(frames));
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.writes++;
+    if (frames.size() > 1) {
+        stats_.batchedWrites++;
+        stats_.framesBatched += frames.size();
+    }
+    if (!ok) stats_.failedWrites++;
+}
+
+} // namespace echo
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "MessageView.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace echo {
+
+class BatchCodec {
+public:
+    static constexpr uint8_t MARKER = 0xF1;
+    static constexpr size_t HEADER_SIZE = 3;
+    static constexpr size_t ENTRY_OVERHEAD = 2;
+    static constexpr size_t MAX_FRAME_SIZE = 0xFFFF;
+
+    static bool isBatch(ByteSpan data);
+    static std::vector<uint8_t> encode(const std::vector<std::vector<uint8_t>>& frames);
+
+    template <typename Fn>
+    static bool forEach(ByteSpan batch, Fn&& fn) {
+        if (!isBatch(batch)) return false;
+        uint16_t count = (static_cast<uint16_t>(batch[1]) << 8) | batch[2];
+        size_t offset = HEADER_SIZE;
+        for (uint16_t i = 0; i < count; ++i) {
+            if (offset + ENTRY_OVERHEAD > batch.size) return false;
+            uint16_t len = (static_cast<uint16_t>(batch[offset]) << 8) | batch[offset + 1];
+            offset += ENTRY_OVERHEAD;
+            if (offset + len > batch.size) return false;
+            fn(batch.subspan(offset, len));
+            offset += len;
+        }
+        return true;
+    }
+};
+
+struct BatchStats {
+    uint64_t framesQueued = 0;
+    uint64_t writes = 0;
+    uint64_t batchedWrites = 0;
+    uint64_t framesBatched = 0;
+    uint64_t failedWrites = 0;
+};
+
+class FrameBatcher {
+public:
+    using FlushCallback = std::function<bool(const std::string& peer, const std::vector<uint8_t>& data)>;
+
+    explicit FrameBatcher(FlushCallback flush,
+                          std::chrono::milliseconds window = std::chrono::milliseconds(15),
+                          size_t maxBatchBytes = 4096);
+    ~FrameBatcher();
+
+    void start();
+    void stop();
+
+    void enqueue(const std::string& peer, std::vector<uint8_t> frame);
+    void flush(const std::string& peer);
+
+    void setWindow(std::chrono::milliseconds window) { window_ = window; }
+    std::chrono::milliseconds getWindow() const { return window_; }
+    BatchStats stats() const;
+
+private:
+    using Batch = std::vector<std::vector<uint8_t>>;
+
+    // While the worker runs it makes every write, so one peer's writes leave in the order they were sealed.
+    struct Queue {
+        Batch frames;
+        size_t bytes = 0;
+        std::chrono::steady_clock::time_point deadline;
+        std::deque<Batch> sealed;
+    };
+
+    static void seal(Queue& q);
+    void run();
+    void send(const std::string& peer, Batch frames);
+
+    FlushCallback flush_;
+    std::atomic<std::chrono::milliseconds> window_;
+    size_t maxBatchBytes_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::unordered_map<std::string, Queue> queues_;
+    std::thread worker_;
+    bool running_ = false;
+    BatchStats stats_;
+};
+
+} // namespace echo
@@ -0,0 +1,302 @@
+#include "LinkPacer.h"
+#include "FrameBatch.h"
+#include "MessageView.h"
+#include <algorithm>
+#include <future>
+
+namespace echo {
+
+namespace {
+
+bool isFileData(ByteSpan frame) {
+    try {
+        return MessageView::parse(frame).type() == MessageType::FILE_DATA;
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+double millis(LinkPacer::Clock::duration d) {
+    return std::chrono::duration<double, std::milli>(d).count();
+}
+
+}
+
+LinkPacer::LinkPacer(WriteCallback write, PacerConfig config)
+    : write_([write = std::move(write)](std::vector<PacedWrite> round, const Done& done) {
+          for (auto& entry : round) {
+              auto started = Clock::now();
+              entry.ok = write(entry.link, entry.data);
+              entry.took = Clock::now() - started;
+              done(entry);
+          }
+      }),
+      config_(config) {
+}
+
+LinkPacer::LinkPacer(RoundCallback writeRound, PacerConfig config)
+    : write_(std::move(writeRound)), config_(config) {
+}
+
+LinkPacer::~LinkPacer() {
+    stop();
+}
+
+void LinkPacer::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_) return;
+    running_ = true;
+    worker_ = std::thread([this]() { run(); });
+}
+
+void LinkPacer::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) return;
+        running_ = false;
+    }
+    cv_.notify_all();
+    if (worker_.joinable()) worker_.join();
+
+    // Chat and control frames still go out on shutdown; queued file data is abandoned with its transfer.
+    std::vector<std::pair<std::string, std::vector<uint8_t>>> remaining;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& kv : links_) {
+            for (auto& frame : kv.second.urgent) remaining.emplace_back(kv.first, std::move(frame));
+            stats_.dropped += kv.second.bulk.size();
+        }
+        links_.clear();
+        stats_.queuedBytes = 0;
+    }
+    for (auto& entry : remaining) {
+        writeOne(entry.first, std::move(entry.second));
+    }
+}
+
+bool LinkPacer::writeOne(const std::string& link, std::vector<uint8_t> data) {
+    std::vector<PacedWrite> round(1);
+    round[0].link = link;
+    round[0].data = std::move(data);
+    std::promise<bool> result;
+    auto ok = result.get_future();
+    write_(std::move(round), [&result](const PacedWrite& write) { result.set_value(write.ok); });
+    return ok.get();
+}
+
+bool LinkPacer::isBulk(const std::vector<uint8_t>& frame) {
+    ByteSpan span(frame);
+    if (!BatchCodec::isBatch(span)) return isFileData(span);
+    bool bulk = true;
+    bool complete = BatchCodec::forEach(span, [&](ByteSpan entry) { bulk = bulk && isFileData(entry); });
+    return complete && bulk;
+}
+
+bool LinkPacer::enqueue(const std::string& link, std::vector<uint8_t> frame) {
+    bool bulk = isBulk(frame);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.framesQueued++;
+        if (running_) {
+            auto it = links_.find(link);
+            if (it == links_.end()) {
+                Link fresh;
+                fresh.rate = config_.bytesPerSecond;
+                fresh.tokens = static_cast<double>(config_.burstBytes);
+                fresh.refilled = Clock::now();
+                it = links_.emplace(link, std::move(fresh)).first;
+            }
+            Link& state = it->second;
+            // Queued file data counts against the limit for file data only; chat is never refused because of it.
+            size_t queued = bulk ? state.queuedBytes : state.urgentBytes;
+            if (queued + frame.size() > config_.maxQueueBytes) {
+                stats_.dropped++;
+                return false;
+            }
+            state.queuedBytes += frame.size();
+            stats_.queuedBytes += frame.size();
+            if (bulk) {
+                stats_.bulkFrames++;
+                state.bulk.push_back(std::move(frame));
+            } else {
+                state.urgentBytes += frame.size();
+                state.urgent.push_back(std::move(frame));
+            }
+            cv_.notify_one();
+            return true;
+        }
+    }
+    size_t bytes = frame.size();
+    bool ok = writeOne(link, std::move(frame));
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.framesSent++;
+    stats_.bytesSent += bytes;
+    if (!ok) stats_.failedWrites++;
+    return ok;
+}
+
+bool LinkPacer::hasRoom(const std::string& link, size_t bytes, bool bulk) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!running_) return true;
+    auto it = links_.find(link);
+    if (it == links_.end()) return bytes <= config_.maxQueueBytes;
+    size_t queued = bulk ? it->second.queuedBytes : it->second.urgentBytes;
+    return queued + bytes <= config_.maxQueueBytes;
+}
+
+void LinkPacer::setConfig(PacerConfig config) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    config_ = config;
+    for (auto& kv : links_) {
+        kv.second.rate = std::min(kv.second.rate, config_.bytesPerSecond);
+        kv.second.tokens = std::min(kv.second.tokens, static_cast<double>(config_.burstBytes));
+    }
+    cv_.notify_one();
+}
+
+PacerConfig LinkPacer::config() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return config_;
+}
+
+PacerStats LinkPacer::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+std::vector<LinkRate> LinkPacer::links() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<LinkRate> out;
+    for (const auto& kv : links_) {
+        const Link& link = kv.second;
+        const Latency& latency = link.written.ms == 0.0 ? link.delivered : link.written;
+        out.push_back(LinkRate{kv.first, config_.bytesPerSecond, link.rate, link.urgent.size() + link.bulk.size(),
+                               link.queuedBytes, latency.ms, latency.baseMs});
+    }
+    std::sort(out.begin(), out.end(), [](const LinkRate& a, const LinkRate& b) { return a.link < b.link; });
+    return out;
+}
+
+void LinkPacer::refill(Link& link, Clock::time_point now) const {
+    double elapsed = std::chrono::duration<double>(now - link.refilled).count();
+    link.tokens = std::min(static_cast<double>(config_.burstBytes), link.tokens + link.rate * elapsed);
+    link.refilled = now;
+}
+
+void LinkPacer::adapt(Link& link, Latency& latency, size_t bytes, bool ok, Clock::duration took, Clock::time_point now) {
+    double sample = millis(took);
+    bool slow = false;
+    if (ok) {
+        latency.ms = latency.ms == 0.0 ? sample : latency.ms + LATENCY_GAIN * (sample - latency.ms);
+        if (latency.baseSince == Clock::time_point{} || sample < latency.baseMs || now - latency.baseSince > BASE_WINDOW) {
+            latency.baseMs = sample;
+            latency.baseSince = now;
+        }
+        // A write is slow when it takes well over the base latency plus its own time on the wire at the configured rate.
+        double expected = latency.baseMs + 1000.0 * static_cast<double>(bytes) / config_.bytesPerSecond;
+        slow = sample > SLOW_FACTOR * expected + static_cast<double>(SLOW_MARGIN.count());
+        if (slow) stats_.slowWrites++;
+    } else {
+        stats_.failedWrites++;
+    }
+
+    if (!ok || slow) {
+        if (now >= link.holdUntil) {
+            link.rate = std::max(config_.bytesPerSecond * MIN_RATE_FRACTION, link.rate * DECREASE);
+            link.tokens = std::min(link.tokens, 0.0);
+            auto hold = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(2.0 * latency.ms));
+            link.holdUntil = now + std::max<Clock::duration>(MIN_HOLD, hold);
+            stats_.decreases++;
+        }
+    } else {
+        link.rate = std::min(config_.bytesPerSecond, link.rate + config_.bytesPerSecond / INCREASE_STEPS);
+    }
+}
+
+void LinkPacer::completed(const PacedWrite& write) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = links_.find(write.link);
+        if (it == links_.end()) return;
+        Link& link = it->second;
+        stats_.framesSent++;
+        stats_.bytesSent += write.data.size();
+        link.busy = false;
+        if (write.sampled) {
+            adapt(link, link.written, write.data.size(), write.ok, write.took, Clock::now());
+        } else if (write.ok) {
+            link.unsettled++;
+        }
+    }
+    cv_.notify_one();
+}
+
+void LinkPacer::feedback(const std::string& link, size_t bytes, bool ok, Clock::duration took) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = links_.find(link);
+        if (it == links_.end()) return;
+        Link& state = it->second;
+        if (state.unsettled > 0) state.unsettled--;
+        adapt(state, state.delivered, bytes, ok, took, Clock::now());
+    }
+    cv_.notify_one();
+}
+
+void LinkPacer::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (running_) {
+        auto now = Clock::now();
+        auto next = now + std::chrono::seconds(1);
+        std::vector<PacedWrite> ready;
+
+        for (auto it = links_.begin(); it != links_.end();) {
+            Link& link = it->second;
+            refill(link, now);
+            if (link.urgent.empty() && link.bulk.empty()) {
+                // Forget idle links once they have recovered, so departed peers do not accumulate.
+                if (!link.busy && link.unsettled == 0 && link.rate >= config_.bytesPerSecond && link.tokens >= config_.burstBytes) {
+                    it = links_.erase(it);
+                } else {
+                    ++it;
+                }
+                continue;
+            }
+            if (link.busy) {
+                ++it;
+                continue;
+            }
+            if (link.tokens <= 0.0) {
+                auto wait = std::chrono::duration<double>((1.0 - link.tokens) / link.rate);
+                next = std::min(next, now + std::chrono::duration_cast<Clock::duration>(wait));
+                ++it;
+                continue;
+            }
+            bool urgent = !link.urgent.empty();
+            auto& lane = urgent ? link.urgent : link.bulk;
+            std::vector<uint8_t> frame = std::move(lane.front());
+            lane.pop_front();
+            if (urgent) link.urgentBytes -= frame.size();
+            link.queuedBytes -= frame.size();
+            stats_.queuedBytes -= frame.size();
+            // The bucket may go into debt for a frame larger than the burst; it waits for the debt to refill.
+            link.tokens -= static_cast<double>(frame.size());
+            link.busy = true;
+            ready.push_back(PacedWrite{it->first, std::move(frame), false, {}});
+            ++it;
+        }
+
+        if (!ready.empty()) {
+            // One frame per ready link per round, so a link with a deep queue cannot hold up the others.
+            // A link stays busy until its own write is done; links that finish sooner go again in the next round.
+            lock.unlock();
+            write_(std::move(ready), [this](const PacedWrite& write) { completed(write); });
+            lock.lock();
+            continue;
+        }
+
+        cv_.wait_until(lock, next);
+    }
+}
+
+} // namespace echo
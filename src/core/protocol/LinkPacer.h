@@ -0,0 +1,140 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace echo {
+
+struct PacerConfig {
+    double bytesPerSecond = 20000.0;
+    size_t burstBytes = 4096;
+    size_t maxQueueBytes = 256 * 1024;
+};
+
+struct PacerStats {
+    uint64_t framesQueued = 0;
+    uint64_t framesSent = 0;
+    uint64_t bytesSent = 0;
+    uint64_t bulkFrames = 0;
+    uint64_t dropped = 0;
+    uint64_t failedWrites = 0;
+    uint64_t slowWrites = 0;
+    uint64_t decreases = 0;
+    size_t queuedBytes = 0;
+};
+
+struct LinkRate {
+    std::string link;
+    double configuredRate = 0.0;
+    double rate = 0.0;
+    size_t queuedFrames = 0;
+    size_t queuedBytes = 0;
+    double latencyMs = 0.0;
+    double baseLatencyMs = 0.0;
+};
+
+// Paces writes into each link with a token bucket whose rate follows AIMD: clean writes add a
+// fixed step up to the configured rate, and a failed write or one that takes well over the
+// link's base latency halves it, at most once per latency period. Writes whose outcome is only
+// known later, such as acknowledged datagrams, report it through feedback() and are judged
+// against their own base latency. File data waits behind every other frame on the same link,
+// so a large transfer cannot starve chat or ACKs.
+class LinkPacer {
+public:
+    using Clock = std::chrono::steady_clock;
+    using WriteCallback = std::function<bool(const std::string& link, const std::vector<uint8_t>& data)>;
+
+    struct PacedWrite {
+        std::string link;
+        std::vector<uint8_t> data;
+        bool ok = false;
+        Clock::duration took{};
+        // False when ok and took only say the write was handed off; its outcome comes through feedback().
+        bool sampled = true;
+    };
+    // Reports one finished write with ok and took filled in. Safe to call from any thread.
+    using Done = std::function<void(const PacedWrite& write)>;
+    // Starts one write per link in the round. Each is reported through done when it finishes,
+    // possibly after the callback returned, so a link gets its next frame without waiting for the others.
+    using RoundCallback = std::function<void(std::vector<PacedWrite> round, const Done& done)>;
+
+    static constexpr double DECREASE = 0.5;
+    static constexpr double INCREASE_STEPS = 64.0;
+    static constexpr double MIN_RATE_FRACTION = 1.0 / 64.0;
+    static constexpr double LATENCY_GAIN = 0.125;
+    static constexpr double SLOW_FACTOR = 2.0;
+    static constexpr std::chrono::milliseconds SLOW_MARGIN{50};
+    static constexpr std::chrono::milliseconds MIN_HOLD{100};
+    static constexpr std::chrono::seconds BASE_WINDOW{30};
+
+    LinkPacer(WriteCallback write, PacerConfig config);
+    LinkPacer(RoundCallback writeRound, PacerConfig config);
+    ~LinkPacer();
+
+    void start();
+    void stop();
+
+    // False when the link's queue is full and the frame was dropped.
+    bool enqueue(const std::string& link, std::vector<uint8_t> frame);
+    // Whether enqueue would take a frame of this size and kind right now.
+    bool hasRoom(const std::string& link, size_t bytes, bool bulk) const;
+    // The late outcome of a write reported with sampled = false: delivered after took, or lost.
+    void feedback(const std::string& link, size_t bytes, bool ok, Clock::duration took);
+
+    void setConfig(PacerConfig config);
+    PacerConfig config() const;
+    PacerStats stats() const;
+    std::vector<LinkRate> links() const;
+
+    static bool isBulk(const std::vector<uint8_t>& frame);
+
+private:
+    struct Latency {
+        double ms = 0.0;
+        double baseMs = 0.0;
+        Clock::time_point baseSince{};
+    };
+
+    struct Link {
+        std::deque<std::vector<uint8_t>> urgent;
+        std::deque<std::vector<uint8_t>> bulk;
+        size_t queuedBytes = 0;
+        size_t urgentBytes = 0;
+        double rate = 0.0;
+        double tokens = 0.0;
+        Clock::time_point refilled;
+        Clock::time_point holdUntil{};
+        Latency written;
+        Latency delivered;
+        // Handed-off writes whose feedback() has not come yet; the link is kept until it does.
+        size_t unsettled = 0;
+        bool busy = false;
+    };
+
+    void run();
+    void refill(Link& link, Clock::time_point now) const;
+    void adapt(Link& link, Latency& latency, size_t bytes, bool ok, Clock::duration took, Clock::time_point now);
+    void completed(const PacedWrite& write);
+    bool writeOne(const std::string& link, std::vector<uint8_t> data);
+
+    RoundCallback write_;
+    PacerConfig config_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::unordered_map<std::string, Link> links_;
+    std::thread worker_;
+    bool running_ = false;
+    PacerStats stats_;
+};
+
+} // namespace echo
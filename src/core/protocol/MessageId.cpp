@@ -0,0 +1,49 @@
+#include "MessageId.h"
+#include <chrono>
+#include <random>
+
+namespace echo {
+
+std::atomic<uint64_t> MessageIdGenerator::sequence_(0);
+
+uint32_t MessageIdGenerator::nodeId() {
+    static const uint32_t id = []() {
+        std::random_device rd;
+        uint64_t seed = (static_cast<uint64_t>(rd()) << 32) ^ rd() ^
+                        static_cast<uint64_t>(std::chrono::high_resolution_clock::now().time_since_epoch().count());
+        uint32_t value = static_cast<uint32_t>(seed ^ (seed >> 32));
+        return value != 0 ? value : 1u;
+    }();
+    return id;
+}
+
+uint64_t MessageIdGenerator::nextSequence() {
+    struct Block {
+        uint64_t next = 0;
+        uint64_t end = 0;
+    };
+    thread_local Block block;
+    if (block.next == block.end) {
+        block.next = sequence_.fetch_add(BLOCK_SIZE, std::memory_order_relaxed);
+        block.end = block.next + BLOCK_SIZE;
+    }
+    return block.next++;
+}
+
+uint32_t MessageIdGenerator::scramble(uint32_t sequence, uint32_t key) {
+    uint32_t x = sequence ^ key;
+    x = (x ^ (x >> 16)) * 0x7FEB352Du;
+    x = (x ^ (x >> 15)) * 0x846CA68Bu;
+    x ^= x >> 16;
+    return x ^ (key >> 7);
+}
+
+uint32_t MessageIdGenerator::next() {
+    return scramble(static_cast<uint32_t>(nextSequence()), nodeId());
+}
+
+uint64_t MessageIdGenerator::next64() {
+    return (static_cast<uint64_t>(nodeId()) << 32) | next();
+}
+
+} // namespace echo
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace echo {
+
+class MessageIdGenerator {
+public:
+    static constexpr uint64_t BLOCK_SIZE = 256;
+
+    static uint32_t nodeId();
+    static uint32_t next();
+    static uint64_t next64();
+
+private:
+    static uint64_t nextSequence();
+    static uint32_t scramble(uint32_t sequence, uint32_t key);
+
+    static std::atomic<uint64_t> sequence_;
+};
+
+} // namespace echo
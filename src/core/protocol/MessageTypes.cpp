@@ -1,196 +1,121 @@
 #include "MessageTypes.h"
-#include <cstring>
+#include "MessageView.h"
+#include "Compression.h"
+#include "MessageId.h"
 #include <stdexcept>
-#include <random>
-#include <atomic>
 
 namespace echo {
 
-std::atomic<uint32_t> MessageFactory::messageIdCounter_(0);
+namespace {
+
+struct VersionFlagsField {
+    static constexpr size_t MIN_SIZE = 1;
+    static size_t size(const MessageHeader&) { return 1; }
+    static void write(uint8_t*& p, const MessageHeader& h) {
+        *p++ = static_cast<uint8_t>((h.flags << 4) | (h.version & 0x0F));
+    }
+    static void read(codec::Reader& r, MessageHeader& h) {
+        uint8_t value = *r.take(1);
+        h.version = value & 0x0F;
+        h.flags = value >> 4;
+    }
+};
+
+using LegacyHeaderSchema = codec::Schema<
+    codec::Field<codec::U8, &MessageHeader::type>,
+    VersionFlagsField,
+    codec::Field<codec::U16, &MessageHeader::length>,
+    codec::Field<codec::U32, &MessageHeader::messageId>,
+    codec::Field<codec::U32, &MessageHeader::timestamp>,
+    codec::Field<codec::U8, &MessageHeader::ttl>>;
+
+using CompactHeaderSchema = codec::Schema<
+    codec::Field<codec::U8, &MessageHeader::type>,
+    VersionFlagsField,
+    codec::Field<codec::VarU16, &MessageHeader::length>,
+    codec::Field<codec::U32, &MessageHeader::messageId>,
+    codec::Field<codec::U32, &MessageHeader::timestamp>,
+    codec::Field<codec::U8, &MessageHeader::ttl>>;
+
+static_assert(LegacyHeaderSchema::MIN_SIZE == MessageHeader::SIZE, "legacy header layout changed");
+static_assert(CompactHeaderSchema::MIN_SIZE == MessageHeader::COMPACT_MIN_SIZE, "compact header layout changed");
 
-std::vector<uint8_t> MessageHeader::serialize() const {
-    std::vector<uint8_t> data(SIZE);
-    data[0] = static_cast<uint8_t>(type);
-    data[1] = version;
-    data[2] = (length >> 8) & 0xFF;
-    data[3] = length & 0xFF;
-    data[4] = (messageId >> 24) & 0xFF;
-    data[5] = (messageId >> 16) & 0xFF;
-    data[6] = (messageId >> 8) & 0xFF;
-    data[7] = messageId & 0xFF;
-    data[8] = (timestamp >> 24) & 0xFF;
-    data[9] = (timestamp >> 16) & 0xFF;
-    data[10] = (timestamp >> 8) & 0xFF;
-    data[11] = timestamp & 0xFF;
-    data[12] = ttl;
-    return data;
 }
 
-MessageHeader MessageHeader::deserialize(const std::vector<uint8_t>& data) {
-    if (data.size() < SIZE) {
-        throw std::runtime_error("Invalid message header size");
-    }
-    
-    MessageHeader header;
-    header.type = static_cast<MessageType>(data[0]);
-    header.version = data[1];
-    header.length = (static_cast<uint16_t>(data[2]) << 8) | data[3];
-    header.messageId = (static_cast<uint32_t>(data[4]) << 24) |
-                      (static_cast<uint32_t>(data[5]) << 16) |
-                      (static_cast<uint32_t>(data[6]) << 8) |
-                      data[7];
-    header.timestamp = (static_cast<uint32_t>(data[8]) << 24) |
-                      (static_cast<uint32_t>(data[9]) << 16) |
-                      (static_cast<uint32_t>(data[10]) << 8) |
-                      data[11];
-    header.ttl = data[12];
-    return header;
+size_t MessageHeader::encodedSize() const {
+    return isCompact() ? CompactHeaderSchema::size(*this) : LegacyHeaderSchema::size(*this);
 }
 
-std::vector<uint8_t> TextMessage::serialize() const {
-    std::vector<uint8_t> data;
-    
-    auto appendString = [&data](const std::string& str) {
-        uint16_t len = static_cast<uint16_t>(str.length());
-        data.push_back((len >> 8) & 0xFF);
-        data.push_back(len & 0xFF);
-        data.insert(data.end(), str.begin(), str.end());
-    };
-    
-    appendString(senderUsername);
-    appendString(senderFingerprint);
-    appendString(recipientUsername);
-    appendString(content);
-    
-    auto time = std::chrono::system_clock::to_time_t(timestamp);
-    uint32_t timeValue = static_cast<uint32_t>(time);
-    data.push_back((timeValue >> 24) & 0xFF);
-    data.push_back((timeValue >> 16) & 0xFF);
-    data.push_back((timeValue >> 8) & 0xFF);
-    data.push_back(timeValue & 0xFF);
-    
-    data.push_back(isGlobal ? 1 : 0);
-    
-    return data;
+std::vector<uint8_t> MessageHeader::serialize() const {
+    return isCompact() ? CompactHeaderSchema::encode(*this) : LegacyHeaderSchema::encode(*this);
 }
 
-TextMessage TextMessage::deserialize(const std::vector<uint8_t>& data) {
-    TextMessage msg;
-    size_t offset = 0;
-    
-    auto readString = [&data, &offset]() -> std::string {
-        if (offset + 2 > data.size()) {
-            throw std::runtime_error("Invalid message data");
-        }
-        uint16_t len = (static_cast<uint16_t>(data[offset]) << 8) | data[offset + 1];
-        offset += 2;
-        
-        if (offset + len > data.size()) {
-            throw std::runtime_error("Invalid string length");
-        }
-        std::string str(data.begin() + offset, data.begin() + offset + len);
-        offset += len;
-        return str;
-    };
-    
-    msg.senderUsername = readString();
-    msg.senderFingerprint = readString();
-    msg.recipientUsername = readString();
-    msg.content = readString();
-    
-    if (offset + 5 > data.size()) {
-        throw std::runtime_error("Invalid message data");
+void MessageHeader::appendTo(std::vector<uint8_t>& out) const {
+    if (isCompact()) {
+        CompactHeaderSchema::appendTo(out, *this);
+    } else {
+        LegacyHeaderSchema::appendTo(out, *this);
     }
-    
-    uint32_t timeValue = (static_cast<uint32_t>(data[offset]) << 24) |
-                        (static_cast<uint32_t>(data[offset + 1]) << 16) |
-                        (static_cast<uint32_t>(data[offset + 2]) << 8) |
-                        data[offset + 3];
-    offset += 4;
-    
-    msg.timestamp = std::chrono::system_clock::from_time_t(timeValue);
-    msg.isGlobal = data[offset] != 0;
-    
-    return msg;
 }
 
-std::vector<uint8_t> AnnounceMessage::serialize() const {
-    std::vector<uint8_t> data;
-    
-    auto appendString = [&data](const std::string& str) {
-        uint16_t len = static_cast<uint16_t>(str.length());
-        data.push_back((len >> 8) & 0xFF);
-        data.push_back(len & 0xFF);
-        data.insert(data.end(), str.begin(), str.end());
-    };
-    
-    appendString(username);
-    appendString(fingerprint);
-    appendString(osType);
-    
-    data.push_back((protocolVersion >> 8) & 0xFF);
-    data.push_back(protocolVersion & 0xFF);
-    
-    return data;
+MessageHeader MessageHeader::deserialize(const std::vector<uint8_t>& data) {
+    return deserialize(data.data(), data.size());
 }
 
-AnnounceMessage AnnounceMessage::deserialize(const std::vector<uint8_t>& data) {
-    AnnounceMessage msg;
-    size_t offset = 0;
-    
-    auto readString = [&data, &offset]() -> std::string {
-        if (offset + 2 > data.size()) {
-            throw std::runtime_error("Invalid message data");
-        }
-        uint16_t len = (static_cast<uint16_t>(data[offset]) << 8) | data[offset + 1];
-        offset += 2;
-        
-        if (offset + len > data.size()) {
-            throw std::runtime_error("Invalid string length");
-        }
-        std::string str(data.begin() + offset, data.begin() + offset + len);
-        offset += len;
-        return str;
-    };
-    
-    msg.username = readString();
-    msg.fingerprint = readString();
-    msg.osType = readString();
-    
-    if (offset + 2 > data.size()) {
-        throw std::runtime_error("Invalid message data");
+MessageHeader MessageHeader::deserialize(const uint8_t* data, size_t size, size_t* consumed) {
+    if (size < 2) {
+        throw std::runtime_error("Invalid message header size");
     }
     
-    msg.protocolVersion = (static_cast<uint16_t>(data[offset]) << 8) | data[offset + 1];
-    
-    return msg;
+    MessageHeader header;
+    codec::Reader reader(ByteSpan(data, size), "Invalid message header size");
+    if ((data[1] & 0x0F) >= VERSION_COMPACT) {
+        CompactHeaderSchema::read(reader, header);
+    } else {
+        LegacyHeaderSchema::read(reader, header);
+    }
+
+    if (consumed) {
+        *consumed = reader.offset();
+    }
+    return header;
 }
 
 std::vector<uint8_t> Message::serialize() const {
     std::vector<uint8_t> data;
+    data.reserve(header.encodedSize() + payload.size());
     
-    auto headerData = header.serialize();
-    data.insert(data.end(), headerData.begin(), headerData.end());
-    
+    header.appendTo(data);
     data.insert(data.end(), payload.begin(), payload.end());
     
     return data;
 }
 
 Message Message::deserialize(const std::vector<uint8_t>& data) {
-    if (data.size() < MessageHeader::SIZE) {
-        throw std::runtime_error("Message too small");
+    return MessageView::parse(data).toMessage();
+}
+
+bool AckMessage::covers(uint32_t sequence) const {
+    if (cumulative - sequence < 0x80000000u || sequence == latest) {
+        return true;
     }
-    
-    Message msg;
-    
-    std::vector<uint8_t> headerData(data.begin(), data.begin() + MessageHeader::SIZE);
-    msg.header = MessageHeader::deserialize(headerData);
-    
-    if (data.size() > MessageHeader::SIZE) {
-        msg.payload = std::vector<uint8_t>(data.begin() + MessageHeader::SIZE, data.end());
+    for (const auto& range : ranges) {
+        if (sequence - range.first <= range.last - range.first) {
+            return true;
+        }
     }
-    
+    return false;
+}
+
+Message MessageFactory::createMessage(MessageType type, std::vector<uint8_t> payload) {
+    Message msg;
+    msg.header.type = type;
+    msg.header.version = 1;
+    msg.header.messageId = generateMessageId();
+    msg.header.timestamp = static_cast<uint32_t>(std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()));
+    msg.header.ttl = MessageHeader::DEFAULT_TTL;
+    msg.payload = std::move(payload);
+    msg.header.length = static_cast<uint16_t>(msg.payload.size());
     return msg;
 }
 
@@ -198,7 +123,8 @@ Message MessageFactory::createTextMessage(const std::string& content,
                                          const std::string& senderUsername,
                                          const std::string& senderFingerprint,
                                          const std::string& recipientUsername,
-                                         bool isGlobal) {
+                                         bool isGlobal,
+                                         uint32_t sequence) {
     TextMessage textMsg;
     textMsg.senderUsername = senderUsername;
     textMsg.senderFingerprint = senderFingerprint;
@@ -206,15 +132,31 @@ Message MessageFactory::createTextMessage(const std::string& content,
     textMsg.content = content;
     textMsg.timestamp = std::chrono::system_clock::now();
     textMsg.isGlobal = isGlobal;
+    textMsg.sequence = sequence;
+    
+    return createMessage(isGlobal ? MessageType::GLOBAL_MESSAGE : MessageType::PRIVATE_MESSAGE,
+                         textMsg.serialize());
+}
+
+Message MessageFactory::createCompactTextMessage(const std::string& content,
+                                                uint32_t senderId,
+                                                const std::string& recipientUsername,
+                                                bool isGlobal,
+                                                uint32_t sequence) {
+    TextMessage textMsg;
+    textMsg.senderId = senderId;
+    textMsg.recipientUsername = recipientUsername;
+    textMsg.content = content;
+    textMsg.sequence = sequence;
     
     Message msg;
     msg.header.type = isGlobal ? MessageType::GLOBAL_MESSAGE : MessageType::PRIVATE_MESSAGE;
-    msg.header.version = 1;
+    msg.header.version = MessageHeader::VERSION_COMPACT;
     msg.header.messageId = generateMessageId();
-    msg.header.timestamp = static_cast<uint32_t>(std::chrono::system_clock::to_time_t(textMsg.timestamp));
-    msg.header.ttl = 7;
+    msg.header.timestamp = static_cast<uint32_t>(std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()));
+    msg.header.ttl = MessageHeader::DEFAULT_TTL;
     
-    msg.payload = textMsg.serialize();
+    msg.payload = textMsg.serializeCompact();
     msg.header.length = static_cast<uint16_t>(msg.payload.size());
     
     return msg;
@@ -222,19 +164,22 @@ Message MessageFactory::createTextMessage(const std::string& content,
 
 Message MessageFactory::createAnnounceMessage(const std::string& username,
                                              const std::string& fingerprint,
-                                             const std::string& osType) {
+                                             const std::string& osType,
+                                             uint32_t senderId) {
     AnnounceMessage announceMsg;
     announceMsg.username = username;
     announceMsg.fingerprint = fingerprint;
     announceMsg.osType = osType;
-    announceMsg.protocolVersion = 1;
+    announceMsg.protocolVersion = senderId != 0 ? AnnounceMessage::PROTOCOL_ACKS : 1;
+    announceMsg.senderId = senderId;
+    announceMsg.capabilities = PayloadCompressor::isAvailable() ? AnnounceMessage::CAP_LZ4 : 0;
     
     Message msg;
     msg.header.type = MessageType::ANNOUNCE;
     msg.header.version = 1;
     msg.header.messageId = generateMessageId();
     msg.header.timestamp = static_cast<uint32_t>(std::chrono::system_clock::now().time_since_epoch().count());
-    msg.header.ttl = 7;
+    msg.header.ttl = MessageHeader::DEFAULT_TTL;
     
     msg.payload = announceMsg.serialize();
     msg.header.length = static_cast<uint16_t>(msg.payload.size());
@@ -242,62 +187,91 @@ Message MessageFactory::createAnnounceMessage(const std::string& username,
     return msg;
 }
 
-Message MessageFactory::createPingMessage() {
-    Message msg;
-    msg.header.type = MessageType::PING;
-    msg.header.version = 1;
-    msg.header.messageId = generateMessageId();
-    msg.header.timestamp = static_cast<uint32_t>(std::chrono::system_clock::now().time_since_epoch().count());
-    msg.header.ttl = 7;
-    msg.header.length = 0;
-    
+Message MessageFactory::createUserStatusMessage(const std::string& username,
+                                               UserStatus status,
+                                               const std::string& statusText) {
+    UserStatusMessage statusMsg;
+    statusMsg.username = username;
+    statusMsg.status = status;
+    statusMsg.statusText = statusText;
+    return createMessage(MessageType::USER_STATUS, statusMsg.serialize());
+}
+
+Message MessageFactory::createChannelJoinMessage(const std::string& channel,
+                                                const std::string& username) {
+    ChannelMessage channelMsg;
+    channelMsg.channel = channel;
+    channelMsg.username = username;
+    return createMessage(MessageType::CHANNEL_JOIN, channelMsg.serialize());
+}
+
+Message MessageFactory::createChannelLeaveMessage(const std::string& channel,
+                                                 const std::string& username) {
+    ChannelMessage channelMsg;
+    channelMsg.channel = channel;
+    channelMsg.username = username;
+    return createMessage(MessageType::CHANNEL_LEAVE, channelMsg.serialize());
+}
+
+Message MessageFactory::createFileRequestMessage(const FileRequestMessage& request) {
+    return createMessage(MessageType::FILE_REQUEST, request.serialize());
+}
+
+Message MessageFactory::createFileChunkMessage(const FileChunkMessage& chunk) {
+    return createMessage(MessageType::FILE_DATA, chunk.serialize());
+}
+
+Message MessageFactory::createNeighborListMessage(const NeighborListMessage& neighbors) {
+    Message msg = createMessage(MessageType::NEIGHBOR_LIST, neighbors.serialize());
+    msg.header.ttl = 1;
     return msg;
 }
 
-Message MessageFactory::createPongMessage() {
-    Message msg;
-    msg.header.type = MessageType::PONG;
-    msg.header.version = 1;
-    msg.header.messageId = generateMessageId();
-    msg.header.timestamp = static_cast<uint32_t>(std::chrono::system_clock::now().time_since_epoch().count());
-    msg.header.ttl = 7;
-    msg.header.length = 0;
-    
+Message MessageFactory::createAckMessage(const AckMessage& ack) {
+    return createMessage(MessageType::ACK, ack.serialize());
+}
+
+Message MessageFactory::createPingMessage(const ProbeMessage& probe) {
+    Message msg = createMessage(MessageType::PING, probe.serialize());
+    msg.header.ttl = 1;
     return msg;
 }
 
-uint32_t MessageFactory::generateMessageId() {
-    static std::random_device rd;
-    static std::mt19937 gen(rd());
-    static std::uniform_int_distribution<uint32_t> dis;
-    
-    return dis(gen);
+Message MessageFactory::createPongMessage(const ProbeMessage& probe) {
+    Message msg = createMessage(MessageType::PONG, probe.serialize());
+    msg.header.ttl = 1;
+    return msg;
 }
 
-Message MessageFactory::createFileDataMessage(const std::string& id,
-                                             const std::string& senderUsername,
-                                             const std::string& senderFingerprint,
-                                             const std::string& filename,
-                                             uint32_t sizeBytes,
-                                             const std::string& base64,
-                                             bool isGlobal) {
-    std::string content = std::string("::FILE::") + id + "::" + filename + "::" + std::to_string(sizeBytes) + "::" + base64;
-    TextMessage textMsg;
-    textMsg.senderUsername = senderUsername;
-    textMsg.senderFingerprint = senderFingerprint;
-    textMsg.recipientUsername = "";
-    textMsg.content = content;
-    textMsg.timestamp = std::chrono::system_clock::now();
-    textMsg.isGlobal = isGlobal;
-    Message msg;
-    msg.header.type = isGlobal ? MessageType::GLOBAL_MESSAGE : MessageType::PRIVATE_MESSAGE;
-    msg.header.version = 1;
-    msg.header.messageId = generateMessageId();
-    msg.header.timestamp = static_cast<uint32_t>(std::chrono::system_clock::to_time_t(textMsg.timestamp));
-    msg.header.ttl = 7;
-    msg.payload = textMsg.serialize();
+void MessageFactory::compressPayload(Message& msg) {
+    std::vector<uint8_t> compressed;
+    if (PayloadCompressor::compress(msg.payload, compressed)) {
+        msg.payload = std::move(compressed);
+        msg.header.flags |= MessageHeader::FLAG_COMPRESSED;
+    }
     msg.header.length = static_cast<uint16_t>(msg.payload.size());
-    return msg;
+}
+
+bool MessageFactory::compressFrame(std::vector<uint8_t>& frame) {
+    MessageView view = MessageView::parse(frame);
+    std::vector<uint8_t> compressed;
+    if (view.isCompressed() || !PayloadCompressor::compress(view.payload().toVector(), compressed)) {
+        return false;
+    }
+
+    MessageHeader header = view.header();
+    header.flags |= MessageHeader::FLAG_COMPRESSED;
+    header.length = static_cast<uint16_t>(compressed.size());
+    std::vector<uint8_t> out;
+    out.reserve(header.encodedSize() + compressed.size());
+    header.appendTo(out);
+    out.insert(out.end(), compressed.begin(), compressed.end());
+    frame = std::move(out);
+    return true;
+}
+
+uint32_t MessageFactory::generateMessageId() {
+    return MessageIdGenerator::next();
 }
 
 } // namespace echo
\ No newline at end of file
@@ -1,10 +1,10 @@
 #pragma once
 
+#include "Codec.h"
 #include <cstdint>
 #include <string>
 #include <vector>
 #include <chrono>
-#include <atomic>
 
 namespace echo {
 
@@ -21,7 +21,15 @@ enum class MessageType : uint8_t {
     USER_STATUS = 0x0A,
     CHANNEL_JOIN = 0x0B,
     CHANNEL_LEAVE = 0x0C,
-    PRIVATE_MESSAGE = 0x0D
+    PRIVATE_MESSAGE = 0x0D,
+    NEIGHBOR_LIST = 0x0E
+};
+
+enum class UserStatus : uint8_t {
+    ONLINE = 0,
+    AWAY = 1,
+    BUSY = 2,
+    OFFLINE = 3
 };
 
 enum class ChatMode {
@@ -36,34 +44,215 @@ struct MessageHeader {
     uint16_t length;
     uint32_t messageId;
     uint32_t timestamp;
-    uint8_t ttl = 7;
+    uint8_t ttl = DEFAULT_TTL;
+    uint8_t flags = 0;
     
+    static constexpr uint8_t DEFAULT_TTL = 7;
     static constexpr size_t SIZE = 13;
+    static constexpr size_t COMPACT_MIN_SIZE = 12;
+    static constexpr uint8_t VERSION_LEGACY = 1;
+    static constexpr uint8_t VERSION_COMPACT = 2;
+    static constexpr uint8_t FLAG_COMPRESSED = 0x01;
+
+    bool isCompressed() const { return (flags & FLAG_COMPRESSED) != 0; }
+    bool isCompact() const { return version >= VERSION_COMPACT; }
+    size_t encodedSize() const;
     
     std::vector<uint8_t> serialize() const;
+    void appendTo(std::vector<uint8_t>& out) const;
     static MessageHeader deserialize(const std::vector<uint8_t>& data);
+    static MessageHeader deserialize(const uint8_t* data, size_t size, size_t* consumed = nullptr);
 };
 
-struct TextMessage {
+struct TextMessage : codec::Encodable<TextMessage> {
     std::string senderUsername;
     std::string senderFingerprint;
     std::string recipientUsername;
     std::string content;
     std::chrono::system_clock::time_point timestamp;
     bool isGlobal = false;
+    uint32_t senderId = 0;
+    uint32_t sequence = 0;
+
+    using Schema = codec::Schema<
+        codec::Field<codec::Str16, &TextMessage::senderUsername>,
+        codec::Field<codec::Str16, &TextMessage::senderFingerprint>,
+        codec::Field<codec::Str16, &TextMessage::recipientUsername>,
+        codec::Field<codec::Str16, &TextMessage::content>,
+        codec::Field<codec::UnixTime32, &TextMessage::timestamp>,
+        codec::Field<codec::U8, &TextMessage::isGlobal>,
+        codec::Field<codec::TrailingU32, &TextMessage::sequence>>;
+
+    using CompactSchema = codec::Schema<
+        codec::Field<codec::U32, &TextMessage::senderId>,
+        codec::Field<codec::VarStr, &TextMessage::recipientUsername>,
+        codec::Field<codec::VarStr, &TextMessage::content>,
+        codec::Field<codec::TrailingU32, &TextMessage::sequence>>;
     
-    std::vector<uint8_t> serialize() const;
-    static TextMessage deserialize(const std::vector<uint8_t>& data);
+    std::vector<uint8_t> serializeCompact() const { return CompactSchema::encode(*this); }
 };
 
-struct AnnounceMessage {
+struct AnnounceMessage : codec::Encodable<AnnounceMessage> {
+    // Version 3 peers acknowledge sequenced private messages; it implies compact header support.
+    static constexpr uint16_t PROTOCOL_ACKS = 3;
+    // Capability bits. A peer that omits the byte receives every payload uncompressed.
+    static constexpr uint8_t CAP_LZ4 = 0x01;
+
     std::string username;
     std::string fingerprint;
     std::string osType;
     uint16_t protocolVersion = 1;
-    
-    std::vector<uint8_t> serialize() const;
-    static AnnounceMessage deserialize(const std::vector<uint8_t>& data);
+    uint32_t senderId = 0;
+    uint8_t capabilities = 0;
+
+    using Schema = codec::Schema<
+        codec::Field<codec::Str16, &AnnounceMessage::username>,
+        codec::Field<codec::Str16, &AnnounceMessage::fingerprint>,
+        codec::Field<codec::Str16, &AnnounceMessage::osType>,
+        codec::Field<codec::U16, &AnnounceMessage::protocolVersion>,
+        codec::Field<codec::TrailingU32, &AnnounceMessage::senderId>,
+        codec::Field<codec::Trailing<codec::U8>, &AnnounceMessage::capabilities>>;
+};
+
+struct UserStatusMessage : codec::Encodable<UserStatusMessage> {
+    std::string username;
+    UserStatus status = UserStatus::ONLINE;
+    std::string statusText;
+
+    using Schema = codec::Schema<
+        codec::Field<codec::Str16, &UserStatusMessage::username>,
+        codec::Field<codec::U8, &UserStatusMessage::status>,
+        codec::Field<codec::Str16, &UserStatusMessage::statusText>>;
+};
+
+struct ChannelMessage : codec::Encodable<ChannelMessage> {
+    std::string channel;
+    std::string username;
+
+    using Schema = codec::Schema<
+        codec::Field<codec::Str16, &ChannelMessage::channel>,
+        codec::Field<codec::Str16, &ChannelMessage::username>>;
+};
+
+struct RouteAdvert {
+    std::string destination;
+    std::string nextHop;
+    uint16_t cost = 0;
+    uint8_t hops = 0;
+
+    using Schema = codec::Schema<
+        codec::Field<codec::Str16, &RouteAdvert::destination>,
+        codec::Field<codec::Str16, &RouteAdvert::nextHop>,
+        codec::Field<codec::U16, &RouteAdvert::cost>,
+        codec::Field<codec::U8, &RouteAdvert::hops>>;
+};
+
+struct NeighborListMessage : codec::Encodable<NeighborListMessage> {
+    // How the routes replace the sender's previous ones. A list without the byte is a full table.
+    static constexpr uint8_t ROUTES_FULL = 0;
+    static constexpr uint8_t ROUTES_DELTA = 1;
+    static constexpr uint8_t ROUTES_NONE = 2;
+    // Cost of a route in a delta that the sender no longer has.
+    static constexpr uint16_t WITHDRAWN = 0xFFFF;
+    static constexpr size_t MAX_ROUTES = 255;
+
+    std::string username;
+    std::vector<std::string> neighbors;
+    std::vector<std::string> relays;
+    std::vector<RouteAdvert> routes;
+    uint8_t routeMode = ROUTES_FULL;
+
+    using Schema = codec::Schema<
+        codec::Field<codec::Str16, &NeighborListMessage::username>,
+        codec::Field<codec::List8<codec::Str16>, &NeighborListMessage::neighbors>,
+        codec::Field<codec::List8<codec::Str16>, &NeighborListMessage::relays>,
+        codec::Field<codec::List8<codec::Record<RouteAdvert::Schema>>, &NeighborListMessage::routes>,
+        codec::Field<codec::Trailing<codec::U8>, &NeighborListMessage::routeMode>>;
+};
+
+struct ProbeMessage : codec::Encodable<ProbeMessage> {
+    uint32_t probeId = 0;
+    std::string username;
+
+    using Schema = codec::Schema<
+        codec::Field<codec::U32, &ProbeMessage::probeId>,
+        codec::Field<codec::Str16, &ProbeMessage::username>>;
+};
+
+struct AckRange {
+    uint32_t first = 0;
+    uint32_t last = 0;
+
+    using Schema = codec::Schema<
+        codec::Field<codec::U32, &AckRange::first>,
+        codec::Field<codec::U32, &AckRange::last>>;
+};
+
+struct AckMessage : codec::Encodable<AckMessage> {
+    std::string username;
+    std::string recipientUsername;
+    uint32_t cumulative = 0;
+    uint32_t latest = 0;
+    std::vector<AckRange> ranges;
+
+    // Whether the sequence is acknowledged, comparing in serial-number order across wraparound.
+    bool covers(uint32_t sequence) const;
+
+    using Schema = codec::Schema<
+        codec::Field<codec::Str16, &AckMessage::username>,
+        codec::Field<codec::Str16, &AckMessage::recipientUsername>,
+        codec::Field<codec::U32, &AckMessage::cumulative>,
+        codec::Field<codec::U32, &AckMessage::latest>,
+        codec::Field<codec::List8<codec::Record<AckRange::Schema>>, &AckMessage::ranges>>;
+};
+
+enum class FileControl : uint8_t {
+    OFFER = 1,
+    ACCEPT = 2,
+    DECLINE = 3,
+    ACK = 4,
+    COMPLETE = 5,
+    CANCEL = 6
+};
+
+struct FileRequestMessage : codec::Encodable<FileRequestMessage> {
+    uint64_t fileId = 0;
+    FileControl control = FileControl::OFFER;
+    std::string senderUsername;
+    std::string recipientUsername;
+    std::string filename;
+    uint32_t sizeBytes = 0;
+    uint16_t chunkSize = 0;
+    uint16_t window = 0;
+    uint32_t nextChunk = 0;
+    std::vector<uint8_t> sha256;
+    std::vector<AckRange> received;
+
+    using Schema = codec::Schema<
+        codec::Field<codec::U64, &FileRequestMessage::fileId>,
+        codec::Field<codec::U8, &FileRequestMessage::control>,
+        codec::Field<codec::Str16, &FileRequestMessage::senderUsername>,
+        codec::Field<codec::Str16, &FileRequestMessage::recipientUsername>,
+        codec::Field<codec::Str16, &FileRequestMessage::filename>,
+        codec::Field<codec::U32, &FileRequestMessage::sizeBytes>,
+        codec::Field<codec::U16, &FileRequestMessage::chunkSize>,
+        codec::Field<codec::U16, &FileRequestMessage::window>,
+        codec::Field<codec::U32, &FileRequestMessage::nextChunk>,
+        codec::Field<codec::Bytes16, &FileRequestMessage::sha256>,
+        codec::Field<codec::Trailing<codec::List8<codec::Record<AckRange::Schema>>>, &FileRequestMessage::received>>;
+};
+
+struct FileChunkMessage : codec::Encodable<FileChunkMessage> {
+    uint64_t fileId = 0;
+    uint32_t index = 0;
+    uint32_t crc32 = 0;
+    std::vector<uint8_t> data;
+
+    using Schema = codec::Schema<
+        codec::Field<codec::U64, &FileChunkMessage::fileId>,
+        codec::Field<codec::U32, &FileChunkMessage::index>,
+        codec::Field<codec::U32, &FileChunkMessage::crc32>,
+        codec::Field<codec::Bytes16, &FileChunkMessage::data>>;
 };
 
 struct Message {
@@ -83,26 +272,45 @@ public:
                                     const std::string& senderUsername,
                                     const std::string& senderFingerprint,
                                     const std::string& recipientUsername = "",
-                                    bool isGlobal = false);
+                                    bool isGlobal = false,
+                                    uint32_t sequence = 0);
+    
+    static Message createCompactTextMessage(const std::string& content,
+                                           uint32_t senderId,
+                                           const std::string& recipientUsername = "",
+                                           bool isGlobal = false,
+                                           uint32_t sequence = 0);
     
     static Message createAnnounceMessage(const std::string& username,
                                         const std::string& fingerprint,
-                                        const std::string& osType);
+                                        const std::string& osType,
+                                        uint32_t senderId = 0);
+    
+    static Message createUserStatusMessage(const std::string& username,
+                                          UserStatus status,
+                                          const std::string& statusText = "");
+    
+    static Message createChannelJoinMessage(const std::string& channel,
+                                           const std::string& username);
+    
+    static Message createChannelLeaveMessage(const std::string& channel,
+                                            const std::string& username);
+    
+    static Message createFileRequestMessage(const FileRequestMessage& request);
+    static Message createFileChunkMessage(const FileChunkMessage& chunk);
+    static Message createNeighborListMessage(const NeighborListMessage& neighbors);
     
-    static Message createPingMessage();
-    static Message createPongMessage();
-    static Message createFileDataMessage(const std::string& id,
-                                        const std::string& senderUsername,
-                                        const std::string& senderFingerprint,
-                                        const std::string& filename,
-                                        uint32_t sizeBytes,
-                                        const std::string& base64,
-                                        bool isGlobal);
+    static Message createPingMessage(const ProbeMessage& probe);
+    static Message createPongMessage(const ProbeMessage& probe);
+    static Message createAckMessage(const AckMessage& ack);
     
     static uint32_t generateMessageId();
+    static void compressPayload(Message& msg);
+    // Compresses a serialized frame in place; only for frames whose every reader announced CAP_LZ4.
+    static bool compressFrame(std::vector<uint8_t>& frame);
     
 private:
-    static std::atomic<uint32_t> messageIdCounter_;
+    static Message createMessage(MessageType type, std::vector<uint8_t> payload);
 };
 
 } // namespace echo
\ No newline at end of file
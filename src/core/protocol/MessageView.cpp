@@ -0,0 +1,83 @@
+#include "MessageView.h"
+#include "Compression.h"
+#include <stdexcept>
+
+namespace echo {
+
+MessageView MessageView::parse(ByteSpan frame) {
+    if (frame.size < MessageHeader::COMPACT_MIN_SIZE) {
+        throw std::runtime_error("Message too small");
+    }
+    MessageView view;
+    view.frame_ = frame;
+    view.header_ = MessageHeader::deserialize(frame.data, frame.size, &view.headerSize_);
+    return view;
+}
+
+bool MessageView::isText() const {
+    MessageType t = type();
+    return t == MessageType::GLOBAL_MESSAGE ||
+           t == MessageType::TEXT_MESSAGE ||
+           t == MessageType::PRIVATE_MESSAGE;
+}
+
+ByteSpan MessageView::decodedPayload(std::vector<uint8_t>& storage) const {
+    if (!isCompressed()) {
+        return payload();
+    }
+    PayloadCompressor::decompress(payload(), storage);
+    return ByteSpan(storage);
+}
+
+Message MessageView::toMessage() const {
+    Message msg;
+    msg.header = header_;
+    if (isCompressed()) {
+        msg.payload = PayloadCompressor::decompress(payload());
+        msg.header.flags &= static_cast<uint8_t>(~MessageHeader::FLAG_COMPRESSED);
+        msg.header.length = static_cast<uint16_t>(msg.payload.size());
+    } else {
+        msg.payload = payload().toVector();
+    }
+    return msg;
+}
+
+TextMessageView TextMessageView::parse(ByteSpan payload) {
+    TextMessageView view;
+    codec::Reader reader(payload);
+    Schema::read(reader, view);
+    return view;
+}
+
+TextMessageView TextMessageView::parse(const MessageView& msg, ByteSpan payload) {
+    if (!msg.isCompact()) {
+        return parse(payload);
+    }
+
+    TextMessageView view;
+    codec::Reader reader(payload);
+    CompactSchema::read(reader, view);
+    if (view.senderId_ == 0) {
+        throw std::runtime_error("Invalid sender id");
+    }
+
+    view.timeValue_ = msg.timestamp();
+    view.isGlobal_ = msg.type() == MessageType::GLOBAL_MESSAGE;
+
+    return view;
+}
+
+TextMessage TextMessageView::toTextMessage() const {
+    TextMessage msg;
+    msg.senderUsername.assign(senderUsername_);
+    msg.senderFingerprint.assign(senderFingerprint_);
+    msg.recipientUsername.assign(recipientUsername_);
+    msg.content.assign(content_);
+    msg.timestamp = std::chrono::system_clock::from_time_t(timeValue_);
+    msg.isGlobal = isGlobal_;
+    msg.senderId = senderId_;
+    msg.sequence = sequence_;
+    return msg;
+}
+
+} // namespace echo
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "ByteSpan.h"
+#include "MessageTypes.h"
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace echo {
+
+class MessageView {
+public:
+    MessageView() = default;
+
+    static MessageView parse(ByteSpan frame);
+
+    MessageType type() const { return header_.type; }
+    uint8_t version() const { return header_.version; }
+    uint8_t flags() const { return header_.flags; }
+    bool isCompressed() const { return header_.isCompressed(); }
+    bool isCompact() const { return header_.isCompact(); }
+    uint16_t length() const { return header_.length; }
+    uint32_t messageId() const { return header_.messageId; }
+    uint32_t timestamp() const { return header_.timestamp; }
+    uint8_t ttl() const { return header_.ttl; }
+
+    bool isText() const;
+    ByteSpan frame() const { return frame_; }
+    size_t headerSize() const { return headerSize_; }
+    ByteSpan payload() const { return frame_.subspan(headerSize_); }
+    ByteSpan decodedPayload(std::vector<uint8_t>& storage) const;
+
+    const MessageHeader& header() const { return header_; }
+    Message toMessage() const;
+
+private:
+    ByteSpan frame_;
+    MessageHeader header_{};
+    size_t headerSize_ = 0;
+};
+
+class TextMessageView {
+public:
+    TextMessageView() = default;
+
+    static TextMessageView parse(ByteSpan payload);
+    static TextMessageView parse(const MessageView& msg, ByteSpan payload);
+
+    std::string_view senderUsername() const { return senderUsername_; }
+    std::string_view senderFingerprint() const { return senderFingerprint_; }
+    std::string_view recipientUsername() const { return recipientUsername_; }
+    std::string_view content() const { return content_; }
+    uint32_t senderId() const { return senderId_; }
+    uint32_t sequence() const { return sequence_; }
+    bool isCompact() const { return senderId_ != 0; }
+    uint32_t timeValue() const { return timeValue_; }
+    bool isGlobal() const { return isGlobal_; }
+
+    TextMessage toTextMessage() const;
+
+private:
+    std::string_view senderUsername_;
+    std::string_view senderFingerprint_;
+    std::string_view recipientUsername_;
+    std::string_view content_;
+    uint32_t timeValue_ = 0;
+    uint32_t senderId_ = 0;
+    uint32_t sequence_ = 0;
+    bool isGlobal_ = false;
+
+    using Schema = codec::Schema<
+        codec::Field<codec::Str16, &TextMessageView::senderUsername_>,
+        codec::Field<codec::Str16, &TextMessageView::senderFingerprint_>,
+        codec::Field<codec::Str16, &TextMessageView::recipientUsername_>,
+        codec::Field<codec::Str16, &TextMessageView::content_>,
+        codec::Field<codec::U32, &TextMessageView::timeValue_>,
+        codec::Field<codec::U8, &TextMessageView::isGlobal_>,
+        codec::Field<codec::TrailingU32, &TextMessageView::sequence_>>;
+
+    using CompactSchema = codec::Schema<
+        codec::Field<codec::U32, &TextMessageView::senderId_>,
+        codec::Field<codec::VarStr, &TextMessageView::recipientUsername_>,
+        codec::Field<codec::VarStr, &TextMessageView::content_>,
+        codec::Field<codec::TrailingU32, &TextMessageView::sequence_>>;
+};
+
+} // namespace echo
@@ -0,0 +1,342 @@
+#include "ReliableDelivery.h"
+#include "MessageView.h"
+
+namespace echo {
+
+namespace {
+
+// Message id, timestamp and TTL close both header versions, so the id sits 9 bytes before the payload.
+constexpr size_t ID_FROM_HEADER_END = 9;
+
+}
+
+ReliableDelivery::ReliableDelivery(SendCallback send, uint32_t seed)
+    : send_(std::move(send)), rng_(seed) {
+}
+
+ReliableDelivery::~ReliableDelivery() {
+    stop();
+}
+
+void ReliableDelivery::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_) return;
+    running_ = true;
+    worker_ = std::thread([this]() { run(); });
+}
+
+void ReliableDelivery::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) return;
+        running_ = false;
+    }
+    cv_.notify_all();
+    if (worker_.joinable()) worker_.join();
+}
+
+void ReliableDelivery::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (running_) {
+        if (wheel_.empty()) {
+            cv_.wait_for(lock, std::chrono::seconds(1));
+        } else {
+            cv_.wait_for(lock, wheel_.resolution());
+        }
+        if (!running_) break;
+        lock.unlock();
+        tick(Clock::now());
+        lock.lock();
+    }
+}
+
+void ReliableDelivery::setLocalName(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    localName_ = name;
+}
+
+uint32_t ReliableDelivery::nextSequence(const std::string& peer) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Peer& state = peers_[peer];
+    if (state.nextSequence == 0) {
+        // A random start keeps a restarted sender from colliding with sequences the receiver already acknowledged.
+        state.nextSequence = std::uniform_int_distribution<uint32_t>(1, 0x7FFFFFFF)(rng_);
+    }
+    return state.nextSequence++;
+}
+
+uint64_t ReliableDelivery::armLocked(TimerTarget target, Clock::time_point when) {
+    uint64_t id = nextTimer_++;
+    timers_.emplace(id, std::move(target));
+    wheel_.schedule(id, when);
+    return id;
+}
+
+void ReliableDelivery::send(const std::string& peer, uint32_t sequence, std::vector<uint8_t> frame) {
+    send(peer, sequence, std::move(frame), Clock::now());
+}
+
+void ReliableDelivery::send(const std::string& peer, uint32_t sequence, std::vector<uint8_t> frame,
+                            Clock::time_point now) {
+    Actions actions;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Peer& state = peers_[peer];
+        stats_.sent++;
+        // Until the peer acknowledges once, only one message is in flight so it can anchor its receive window.
+        if (!state.synced && (!state.outstanding.empty() || !state.held.empty())) {
+            state.held.emplace_back(sequence, std::move(frame));
+        } else {
+            transmitLocked(peer, state, sequence, std::move(frame), now, actions);
+        }
+    }
+    execute(actions);
+    cv_.notify_all();
+}
+
+void ReliableDelivery::transmitLocked(const std::string& peer, Peer& state, uint32_t sequence,
+                                      std::vector<uint8_t> frame, Clock::time_point now, Actions& actions) {
+    Outstanding& entry = state.outstanding[sequence];
+    entry.frame = frame;
+    entry.sent = now;
+    entry.retries = 0;
+    entry.timer = armLocked(TimerTarget{peer, sequence, false}, now + state.rtt.rto());
+    actions.frames.emplace_back(peer, std::move(frame));
+}
+
+void ReliableDelivery::releaseLocked(const std::string& peer, Peer& state, Clock::time_point now, Actions& actions) {
+    while (!state.held.empty() && (state.synced || state.outstanding.empty())) {
+        auto item = std::move(state.held.front());
+        state.held.pop_front();
+        transmitLocked(peer, state, item.first, std::move(item.second), now, actions);
+    }
+}
+
+std::map<uint32_t, ReliableDelivery::Outstanding>::iterator ReliableDelivery::finishLocked(
+    const std::string& peer, Peer& state, std::map<uint32_t, Outstanding>::iterator it, bool delivered,
+    Actions& actions) {
+    wheel_.cancel(it->second.timer);
+    timers_.erase(it->second.timer);
+    if (delivered) {
+        stats_.delivered++;
+    } else {
+        stats_.failed++;
+    }
+    if (onResult_) {
+        actions.events.push_back([cb = onResult_, peer, sequence = it->first, delivered,
+                                  frame = std::move(it->second.frame)]() { cb(peer, sequence, delivered, frame); });
+    }
+    return state.outstanding.erase(it);
+}
+
+bool ReliableDelivery::receive(const std::string& peer, uint32_t sequence) {
+    return receive(peer, sequence, Clock::now());
+}
+
+bool ReliableDelivery::receive(const std::string& peer, uint32_t sequence, Clock::time_point now) {
+    bool fresh = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Peer& state = peers_[peer];
+        uint32_t ahead = sequence - state.cumulative;
+        uint32_t behind = state.cumulative - sequence;
+        if (!state.receiving || (ahead > RECEIVE_WINDOW && behind >= RECEIVE_WINDOW)) {
+            state.receiving = true;
+            state.cumulative = sequence - 1;
+            state.received.clear();
+            ahead = 1;
+        }
+
+        fresh = ahead != 0 && ahead <= RECEIVE_WINDOW && !state.received.count(sequence);
+        if (fresh) {
+            state.latest = sequence;
+        }
+        if (!fresh) {
+            stats_.duplicates++;
+        } else if (ahead == 1) {
+            stats_.received++;
+            state.cumulative = sequence;
+            while (!state.received.empty() && *state.received.begin() == state.cumulative + 1) {
+                state.cumulative++;
+                state.received.erase(state.received.begin());
+            }
+        } else {
+            stats_.received++;
+            stats_.outOfOrder++;
+            state.received.insert(sequence);
+        }
+        // In-order data waits briefly so several messages share one ACK; gaps and duplicates are answered at once.
+        scheduleAckLocked(peer, state, fresh && ahead == 1 ? now + ACK_DELAY : now);
+    }
+    cv_.notify_all();
+    return fresh;
+}
+
+void ReliableDelivery::scheduleAckLocked(const std::string& peer, Peer& state, Clock::time_point when) {
+    if (state.ackTimer != 0 && timers_.count(state.ackTimer)) {
+        if (when < state.ackDue) {
+            wheel_.schedule(state.ackTimer, when);
+            state.ackDue = when;
+        }
+        return;
+    }
+    state.ackTimer = armLocked(TimerTarget{peer, 0, true}, when);
+    state.ackDue = when;
+}
+
+std::vector<AckRange> ReliableDelivery::ranges(const std::set<uint32_t>& received, size_t limit) {
+    std::vector<AckRange> out;
+    for (uint32_t sequence : received) {
+        if (!out.empty() && out.back().last + 1 == sequence) {
+            out.back().last = sequence;
+            continue;
+        }
+        if (out.size() == limit) break;
+        out.push_back(AckRange{sequence, sequence});
+    }
+    return out;
+}
+
+void ReliableDelivery::ackLocked(const std::string& peer, Peer& state, Actions& actions) {
+    AckMessage ack;
+    ack.username = localName_;
+    ack.recipientUsername = peer;
+    ack.cumulative = state.cumulative;
+    ack.latest = state.latest;
+    ack.ranges = ranges(state.received, MAX_ACK_RANGES);
+    actions.frames.emplace_back(peer, MessageFactory::createAckMessage(ack).serialize());
+    state.ackTimer = 0;
+    stats_.acksSent++;
+}
+
+void ReliableDelivery::handleAck(const AckMessage& ack) {
+    handleAck(ack, Clock::now());
+}
+
+void ReliableDelivery::handleAck(const AckMessage& ack, Clock::time_point now) {
+    Actions actions;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = peers_.find(ack.username);
+        if (it == peers_.end()) return;
+        Peer& state = it->second;
+        stats_.acksReceived++;
+
+        bool progress = false;
+        bool measured = false;
+        Clock::duration rtt{};
+        for (auto entry = state.outstanding.begin(); entry != state.outstanding.end();) {
+            if (!ack.covers(entry->first)) {
+                ++entry;
+                continue;
+            }
+            // Only the message that provoked this ACK gives a sample, and never a retransmitted one (Karn).
+            if (entry->first == ack.latest && entry->second.retries == 0) {
+                rtt = now - entry->second.sent;
+                measured = true;
+            }
+            entry = finishLocked(it->first, state, entry, true, actions);
+            progress = true;
+        }
+        if (measured) {
+            state.rtt.sample(rtt);
+        }
+        if (progress) {
+            state.synced = true;
+            releaseLocked(it->first, state, now, actions);
+        }
+    }
+    execute(actions);
+}
+
+void ReliableDelivery::restamp(std::vector<uint8_t>& frame) {
+    MessageView view = MessageView::parse(frame);
+    uint8_t* p = frame.data() + view.headerSize() - ID_FROM_HEADER_END;
+    codec::storeU32(p, MessageFactory::generateMessageId());
+}
+
+void ReliableDelivery::tick(Clock::time_point now) {
+    Actions actions;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<uint64_t> fired;
+        wheel_.advance(now, [&fired](uint64_t id) { fired.push_back(id); });
+        for (auto& kv : peers_) {
+            kv.second.burst = 0;
+        }
+
+        for (uint64_t id : fired) {
+            auto timer = timers_.find(id);
+            if (timer == timers_.end()) continue;
+            TimerTarget target = std::move(timer->second);
+            timers_.erase(timer);
+            auto peer = peers_.find(target.peer);
+            if (peer == peers_.end()) continue;
+            Peer& state = peer->second;
+
+            if (target.ack) {
+                if (state.ackTimer == id) {
+                    ackLocked(target.peer, state, actions);
+                }
+                continue;
+            }
+
+            auto entry = state.outstanding.find(target.sequence);
+            if (entry == state.outstanding.end() || entry->second.timer != id) continue;
+            if (entry->second.retries >= MAX_RETRIES) {
+                finishLocked(target.peer, state, entry, false, actions);
+                releaseLocked(target.peer, state, now, actions);
+                continue;
+            }
+            if (state.burst >= MAX_BURST) {
+                entry->second.timer = armLocked(TimerTarget{target.peer, target.sequence, false}, now + BURST_DEFER);
+                stats_.deferred++;
+                continue;
+            }
+            // The timeout backs off when the oldest message is resent, not once for every message behind it.
+            if (entry == state.outstanding.begin()) {
+                state.rtt.backoff();
+            }
+            state.burst++;
+            entry->second.retries++;
+            entry->second.sent = now;
+            restamp(entry->second.frame);
+            actions.frames.emplace_back(target.peer, entry->second.frame);
+            entry->second.timer = armLocked(TimerTarget{target.peer, target.sequence, false}, now + state.rtt.rto());
+            stats_.retransmits++;
+        }
+    }
+    execute(actions);
+}
+
+void ReliableDelivery::execute(Actions& actions) {
+    for (auto& frame : actions.frames) {
+        send_(frame.first, std::move(frame.second));
+    }
+    for (auto& event : actions.events) {
+        event();
+    }
+}
+
+std::vector<PeerRtt> ReliableDelivery::rtts() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<PeerRtt> out;
+    for (const auto& kv : peers_) {
+        if (kv.second.nextSequence == 0) continue;
+        const RttEstimator& rtt = kv.second.rtt;
+        out.push_back(PeerRtt{kv.first, rtt.srttMs(), rtt.rttvarMs(), rtt.rto(), rtt.hasSample()});
+    }
+    return out;
+}
+
+ReliabilityStats ReliableDelivery::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ReliabilityStats s = stats_;
+    s.pending = 0;
+    for (const auto& kv : peers_) {
+        s.pending += kv.second.outstanding.size() + kv.second.held.size();
+    }
+    return s;
+}
+
+} // namespace echo
@@ -0,0 +1,146 @@
+#pragma once
+
+#include "MessageTypes.h"
+#include "RttEstimator.h"
+#include "TimerWheel.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace echo {
+
+struct ReliabilityStats {
+    uint64_t sent = 0;
+    uint64_t delivered = 0;
+    uint64_t retransmits = 0;
+    uint64_t deferred = 0;
+    uint64_t failed = 0;
+    uint64_t received = 0;
+    uint64_t duplicates = 0;
+    uint64_t outOfOrder = 0;
+    uint64_t acksSent = 0;
+    uint64_t acksReceived = 0;
+    size_t pending = 0;
+};
+
+struct PeerRtt {
+    std::string peer;
+    double srttMs = 0.0;
+    double rttvarMs = 0.0;
+    std::chrono::milliseconds rto{0};
+    bool measured = false;
+};
+
+class ReliableDelivery {
+public:
+    static constexpr std::chrono::milliseconds ACK_DELAY{40};
+    static constexpr std::chrono::milliseconds BURST_DEFER{100};
+    static constexpr int MAX_RETRIES = 6;
+    static constexpr size_t MAX_ACK_RANGES = 8;
+    static constexpr size_t MAX_BURST = 4;
+    static constexpr uint32_t RECEIVE_WINDOW = 1024;
+
+    using Clock = std::chrono::steady_clock;
+    using SendCallback = std::function<bool(const std::string& peer, std::vector<uint8_t> frame)>;
+    using ResultCallback = std::function<void(const std::string& peer, uint32_t sequence, bool delivered,
+                                              const std::vector<uint8_t>& frame)>;
+
+    explicit ReliableDelivery(SendCallback send, uint32_t seed = std::random_device{}());
+    ~ReliableDelivery();
+
+    void start();
+    void stop();
+
+    void setLocalName(const std::string& name);
+    void setOnResult(ResultCallback cb) { onResult_ = std::move(cb); }
+
+    uint32_t nextSequence(const std::string& peer);
+    void send(const std::string& peer, uint32_t sequence, std::vector<uint8_t> frame, Clock::time_point now);
+    void send(const std::string& peer, uint32_t sequence, std::vector<uint8_t> frame);
+    bool receive(const std::string& peer, uint32_t sequence, Clock::time_point now);
+    bool receive(const std::string& peer, uint32_t sequence);
+    void handleAck(const AckMessage& ack, Clock::time_point now);
+    void handleAck(const AckMessage& ack);
+    void tick(Clock::time_point now);
+
+    std::vector<PeerRtt> rtts() const;
+    ReliabilityStats stats() const;
+
+    static std::vector<AckRange> ranges(const std::set<uint32_t>& received, size_t limit);
+    static void restamp(std::vector<uint8_t>& frame);
+
+private:
+    struct Outstanding {
+        std::vector<uint8_t> frame;
+        Clock::time_point sent;
+        int retries = 0;
+        uint64_t timer = 0;
+    };
+
+    struct Peer {
+        uint32_t nextSequence = 0;
+        bool synced = false;
+        std::map<uint32_t, Outstanding> outstanding;
+        std::deque<std::pair<uint32_t, std::vector<uint8_t>>> held;
+        RttEstimator rtt;
+        size_t burst = 0;
+
+        bool receiving = false;
+        uint32_t cumulative = 0;
+        uint32_t latest = 0;
+        std::set<uint32_t> received;
+        uint64_t ackTimer = 0;
+        Clock::time_point ackDue;
+    };
+
+    struct TimerTarget {
+        std::string peer;
+        uint32_t sequence = 0;
+        bool ack = false;
+    };
+
+    struct Actions {
+        std::vector<std::pair<std::string, std::vector<uint8_t>>> frames;
+        std::vector<std::function<void()>> events;
+    };
+
+    void transmitLocked(const std::string& peer, Peer& state, uint32_t sequence, std::vector<uint8_t> frame,
+                        Clock::time_point now, Actions& actions);
+    void scheduleAckLocked(const std::string& peer, Peer& state, Clock::time_point when);
+    void ackLocked(const std::string& peer, Peer& state, Actions& actions);
+    void releaseLocked(const std::string& peer, Peer& state, Clock::time_point now, Actions& actions);
+    std::map<uint32_t, Outstanding>::iterator finishLocked(const std::string& peer, Peer& state,
+                                                           std::map<uint32_t, Outstanding>::iterator it,
+                                                           bool delivered, Actions& actions);
+    uint64_t armLocked(TimerTarget target, Clock::time_point when);
+    void execute(Actions& actions);
+    void run();
+
+    SendCallback send_;
+    ResultCallback onResult_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::thread worker_;
+    bool running_ = false;
+    std::string localName_;
+    std::mt19937 rng_;
+    std::map<std::string, Peer> peers_;
+    TimerWheel wheel_;
+    std::unordered_map<uint64_t, TimerTarget> timers_;
+    uint64_t nextTimer_ = 1;
+    ReliabilityStats stats_;
+};
+
+} // namespace echo
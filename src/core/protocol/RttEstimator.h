@@ -0,0 +1,52 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace echo {
+
+// Retransmission timeout per RFC 6298: SRTT/RTTVAR smoothing with Karn's exponential backoff.
+class RttEstimator {
+public:
+    static constexpr std::chrono::milliseconds INITIAL_RTO{1000};
+    static constexpr std::chrono::milliseconds MIN_RTO{200};
+    static constexpr std::chrono::milliseconds MAX_RTO{60000};
+
+    // The floor defaults to RFC 6298's; a link with sub-millisecond round trips can lower it.
+    explicit RttEstimator(std::chrono::milliseconds initial = INITIAL_RTO, std::chrono::milliseconds minimum = MIN_RTO)
+        : minMs_(static_cast<double>(minimum.count())), rtoMs_(clamp(static_cast<double>(initial.count()))) {}
+
+    void sample(std::chrono::steady_clock::duration rtt) {
+        double r = std::chrono::duration<double, std::milli>(rtt).count();
+        if (!hasSample_) {
+            srttMs_ = r;
+            rttvarMs_ = r / 2.0;
+            hasSample_ = true;
+        } else {
+            rttvarMs_ = 0.75 * rttvarMs_ + 0.25 * std::abs(srttMs_ - r);
+            srttMs_ = 0.875 * srttMs_ + 0.125 * r;
+        }
+        rtoMs_ = clamp(srttMs_ + std::max(1.0, 4.0 * rttvarMs_));
+    }
+
+    void backoff() { rtoMs_ = clamp(rtoMs_ * 2.0); }
+
+    std::chrono::milliseconds rto() const { return std::chrono::milliseconds(static_cast<long long>(rtoMs_)); }
+    double srttMs() const { return srttMs_; }
+    double rttvarMs() const { return rttvarMs_; }
+    bool hasSample() const { return hasSample_; }
+
+private:
+    double clamp(double ms) const {
+        return std::min(static_cast<double>(MAX_RTO.count()), std::max(minMs_, ms));
+    }
+
+    double minMs_;
+    double srttMs_ = 0.0;
+    double rttvarMs_ = 0.0;
+    double rtoMs_;
+    bool hasSample_ = false;
+};
+
+} // namespace echo
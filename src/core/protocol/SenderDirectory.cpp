@@ -0,0 +1,58 @@
+#include "SenderDirectory.h"
+
+namespace echo {
+
+void SenderDirectory::learn(const AnnounceMessage& announce) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    versionByUser_[announce.username] = announce.protocolVersion;
+    capabilitiesByUser_[announce.username] = announce.capabilities;
+    if (announce.senderId == 0) return;
+
+    SenderInfo& info = byId_[announce.senderId];
+    info.username = announce.username;
+    info.fingerprint = announce.fingerprint;
+    info.protocolVersion = announce.protocolVersion;
+    info.lastSeen = std::chrono::steady_clock::now();
+}
+
+bool SenderDirectory::lookup(uint32_t senderId, SenderInfo& out) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = byId_.find(senderId);
+    if (it == byId_.end()) return false;
+    out = it->second;
+    return true;
+}
+
+bool SenderDirectory::supportsCompact(const std::string& username) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = versionByUser_.find(username);
+    return it != versionByUser_.end() && it->second >= MessageHeader::VERSION_COMPACT;
+}
+
+bool SenderDirectory::supportsAcks(const std::string& username) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = versionByUser_.find(username);
+    return it != versionByUser_.end() && it->second >= AnnounceMessage::PROTOCOL_ACKS;
+}
+
+bool SenderDirectory::supportsCompression(const std::string& username) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = capabilitiesByUser_.find(username);
+    return it != capabilitiesByUser_.end() && (it->second & AnnounceMessage::CAP_LZ4) != 0;
+}
+
+bool SenderDirectory::claimAnnounce(const std::string& peer, std::chrono::seconds interval) {
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = announcedTo_.find(peer);
+    if (it != announcedTo_.end() && now - it->second < interval) return false;
+    announcedTo_[peer] = now;
+    return true;
+}
+
+size_t SenderDirectory::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return byId_.size();
+}
+
+} // namespace echo
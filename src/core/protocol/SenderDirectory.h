@@ -0,0 +1,37 @@
+#pragma once
+
+#include "MessageTypes.h"
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace echo {
+
+struct SenderInfo {
+    std::string username;
+    std::string fingerprint;
+    uint16_t protocolVersion = 1;
+    std::chrono::steady_clock::time_point lastSeen;
+};
+
+class SenderDirectory {
+public:
+    void learn(const AnnounceMessage& announce);
+    bool lookup(uint32_t senderId, SenderInfo& out) const;
+    bool supportsCompact(const std::string& username) const;
+    bool supportsAcks(const std::string& username) const;
+    bool supportsCompression(const std::string& username) const;
+    bool claimAnnounce(const std::string& peer, std::chrono::seconds interval);
+    size_t size() const;
+
+private:
+    mutable std::mutex mutex_;
+    std::unordered_map<uint32_t, SenderInfo> byId_;
+    std::unordered_map<std::string, uint16_t> versionByUser_;
+    std::unordered_map<std::string, uint8_t> capabilitiesByUser_;
+    std::unordered_map<std::string, std::chrono::steady_clock::time_point> announcedTo_;
+};
+
+} // namespace echo
@@ -0,0 +1,69 @@
+#include "TimerWheel.h"
+#include <algorithm>
+
+namespace echo {
+
+TimerWheel::TimerWheel(std::chrono::milliseconds resolution, size_t slots)
+    : resolution_(std::max(std::chrono::milliseconds(1), resolution)), slots_(std::max<size_t>(1, slots)) {
+}
+
+uint64_t TimerWheel::tickOf(Clock::time_point t) const {
+    auto since = std::chrono::duration_cast<std::chrono::milliseconds>(t.time_since_epoch()).count();
+    return since > 0 ? static_cast<uint64_t>(since) / static_cast<uint64_t>(resolution_.count()) : 0;
+}
+
+void TimerWheel::schedule(uint64_t id, Clock::time_point deadline) {
+    uint64_t tick = tickOf(deadline);
+    if (started_) {
+        tick = std::max(tick, current_);
+    }
+    // Rescheduling leaves the old slot entry behind; it no longer matches armed_ and is dropped when reached.
+    armed_[id] = tick;
+    slots_[tick % slots_.size()].push_back(Timer{id, tick});
+}
+
+void TimerWheel::cancel(uint64_t id) {
+    armed_.erase(id);
+}
+
+size_t TimerWheel::advance(Clock::time_point now, const FireCallback& fire) {
+    uint64_t target = tickOf(now);
+    if (!started_) {
+        started_ = true;
+        current_ = target;
+        for (const auto& kv : armed_) {
+            current_ = std::min(current_, kv.second);
+        }
+    }
+    if (target < current_) {
+        return 0;
+    }
+
+    std::vector<uint64_t> due;
+    uint64_t steps = std::min<uint64_t>(target - current_ + 1, slots_.size());
+    for (uint64_t i = 0; i < steps; ++i) {
+        auto& slot = slots_[(current_ + i) % slots_.size()];
+        auto keep = slot.begin();
+        for (auto& timer : slot) {
+            auto armed = armed_.find(timer.id);
+            if (armed == armed_.end() || armed->second != timer.tick) {
+                continue;
+            }
+            if (timer.tick <= target) {
+                due.push_back(timer.id);
+                armed_.erase(armed);
+            } else {
+                *keep++ = timer;
+            }
+        }
+        slot.erase(keep, slot.end());
+    }
+    current_ = target + 1;
+
+    for (uint64_t id : due) {
+        fire(id);
+    }
+    return due.size();
+}
+
+} // namespace echo
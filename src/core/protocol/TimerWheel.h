@@ -0,0 +1,42 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+namespace echo {
+
+class TimerWheel {
+public:
+    using Clock = std::chrono::steady_clock;
+    using FireCallback = std::function<void(uint64_t id)>;
+
+    explicit TimerWheel(std::chrono::milliseconds resolution = std::chrono::milliseconds(10), size_t slots = 512);
+
+    void schedule(uint64_t id, Clock::time_point deadline);
+    void cancel(uint64_t id);
+    size_t advance(Clock::time_point now, const FireCallback& fire);
+
+    bool empty() const { return armed_.empty(); }
+    size_t size() const { return armed_.size(); }
+    std::chrono::milliseconds resolution() const { return resolution_; }
+
+private:
+    struct Timer {
+        uint64_t id;
+        uint64_t tick;
+    };
+
+    uint64_t tickOf(Clock::time_point t) const;
+
+    std::chrono::milliseconds resolution_;
+    std::vector<std::vector<Timer>> slots_;
+    std::unordered_map<uint64_t, uint64_t> armed_;
+    uint64_t current_ = 0;
+    bool started_ = false;
+};
+
+} // namespace echo
@@ -0,0 +1,48 @@
+#include "BluetoothTransport.h"
+
+namespace echo {
+
+bool BluetoothTransport::send(const std::string& address, std::vector<uint8_t> frame) {
+    if (address.empty()) return false;
+    manager_.queueData(address, std::move(frame));
+    return true;
+}
+
+void BluetoothTransport::broadcast(std::vector<uint8_t> frame) {
+    for (const auto& device : manager_.getEchoDevices()) {
+        manager_.queueData(device.address, frame);
+    }
+}
+
+std::vector<TransportPeer> BluetoothTransport::peers() const {
+    std::vector<TransportPeer> out;
+    for (const auto& device : manager_.getEchoDevices()) {
+        out.push_back(TransportPeer{device.echoUsername, device.address, device.rssi, device.lastSeen});
+    }
+    return out;
+}
+
+TransportPeer BluetoothTransport::peerFor(const std::string& address) const {
+    for (auto& peer : peers()) {
+        if (peer.address == address) return peer;
+    }
+    return TransportPeer{"", address, 0, std::chrono::steady_clock::now()};
+}
+
+void BluetoothTransport::setOnData(DataCallback cb) {
+    manager_.setDataReceivedCallback(std::move(cb));
+}
+
+void BluetoothTransport::setOnPeerUp(PeerCallback cb) {
+    manager_.setDeviceConnectedCallback([this, cb = std::move(cb)](const std::string& address) {
+        if (cb) cb(peerFor(address));
+    });
+}
+
+void BluetoothTransport::setOnPeerDown(PeerCallback cb) {
+    manager_.setDeviceDisconnectedCallback([this, cb = std::move(cb)](const std::string& address) {
+        if (cb) cb(peerFor(address));
+    });
+}
+
+} // namespace echo
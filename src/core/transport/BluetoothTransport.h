@@ -0,0 +1,33 @@
+#pragma once
+
+#include "Transport.h"
+#include "core/bluetooth/BluetoothManager.h"
+
+namespace echo {
+
+// BLE links: every connected echo device is its own relay link, addressed by its BLE address.
+class BluetoothTransport : public ITransport {
+public:
+    static constexpr uint32_t COST = 4;
+
+    explicit BluetoothTransport(BluetoothManager& manager) : manager_(manager) {}
+
+    const std::string& name() const override { return name_; }
+    bool send(const std::string& address, std::vector<uint8_t> frame) override;
+    void broadcast(std::vector<uint8_t> frame) override;
+    std::vector<TransportPeer> peers() const override;
+    size_t mtu() const override { return manager_.getLinkMtu(); }
+    uint32_t cost() const override { return COST; }
+
+    void setOnData(DataCallback cb) override;
+    void setOnPeerUp(PeerCallback cb) override;
+    void setOnPeerDown(PeerCallback cb) override;
+
+private:
+    TransportPeer peerFor(const std::string& address) const;
+
+    BluetoothManager& manager_;
+    std::string name_ = "ble";
+};
+
+} // namespace echo
@@ -0,0 +1,168 @@
+#include "LoopbackTransport.h"
+
+namespace echo {
+
+LoopbackHub::LoopbackHub() {
+    worker_ = std::thread([this]() { run(); });
+}
+
+LoopbackHub::~LoopbackHub() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    cv_.notify_all();
+    if (worker_.joinable()) worker_.join();
+}
+
+void LoopbackHub::attach(LoopbackTransport* node) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    nodes_[node->node()] = node;
+}
+
+void LoopbackHub::detach(LoopbackTransport* node) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_.wait(lock, [this, node]() { return delivering_ != node; });
+    auto it = nodes_.find(node->node());
+    if (it != nodes_.end() && it->second == node) {
+        nodes_.erase(it);
+    }
+}
+
+void LoopbackHub::connect(const std::string& a, const std::string& b) {
+    if (a == b) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto now = std::chrono::steady_clock::now();
+        links_[a][b] = now;
+        links_[b][a] = now;
+    }
+    notifyLink(a, b, true);
+}
+
+void LoopbackHub::disconnect(const std::string& a, const std::string& b) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!links_[a].erase(b)) return;
+        links_[b].erase(a);
+    }
+    notifyLink(a, b, false);
+}
+
+void LoopbackHub::notifyLink(const std::string& a, const std::string& b, bool up) {
+    auto notify = [this, up](const std::string& self, const std::string& other) {
+        LoopbackTransport::PeerCallback cb;
+        TransportPeer peer{other, LoopbackTransport::addressOf(other), 0, std::chrono::steady_clock::now()};
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = nodes_.find(self);
+            if (it == nodes_.end()) return;
+            cb = up ? it->second->onPeerUp_ : it->second->onPeerDown_;
+        }
+        if (cb) cb(peer);
+    };
+    notify(a, b);
+    notify(b, a);
+}
+
+bool LoopbackHub::linked(const std::string& a, const std::string& b) const {
+    auto it = links_.find(a);
+    return it != links_.end() && it->second.count(b);
+}
+
+std::vector<TransportPeer> LoopbackHub::peersOf(const std::string& name) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<TransportPeer> out;
+    auto it = links_.find(name);
+    if (it == links_.end()) return out;
+    out.reserve(it->second.size());
+    for (const auto& link : it->second) {
+        out.push_back(TransportPeer{link.first, LoopbackTransport::addressOf(link.first), 0, link.second});
+    }
+    return out;
+}
+
+bool LoopbackHub::enqueue(const std::string& from, const std::string& to, std::vector<uint8_t> frame, size_t mtu) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_ || !linked(from, to)) {
+            stats_.dropped++;
+            return false;
+        }
+        stats_.frames++;
+        stats_.bytes += frame.size();
+        stats_.fragments += frame.size() <= mtu ? 1 : (frame.size() + mtu - 1) / mtu;
+        queue_.push_back(Delivery{from, to, std::move(frame)});
+    }
+    cv_.notify_one();
+    return true;
+}
+
+void LoopbackHub::drain() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_.wait(lock, [this]() { return !running_ || (queue_.empty() && !busy_); });
+}
+
+LoopbackStats LoopbackHub::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void LoopbackHub::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        cv_.wait(lock, [this]() { return !running_ || !queue_.empty(); });
+        if (!running_) break;
+        Delivery delivery = std::move(queue_.front());
+        queue_.pop_front();
+        auto it = nodes_.find(delivery.to);
+        // A link may have been cut while the frame was queued, which loses it like a radio would.
+        if (it == nodes_.end() || !linked(delivery.from, delivery.to) || !it->second->onData_) {
+            stats_.dropped++;
+            idle_.notify_all();
+            continue;
+        }
+        LoopbackTransport* target = it->second;
+        busy_ = true;
+        delivering_ = target;
+        lock.unlock();
+        target->onData_(LoopbackTransport::addressOf(delivery.from), delivery.frame);
+        lock.lock();
+        busy_ = false;
+        delivering_ = nullptr;
+        idle_.notify_all();
+    }
+    idle_.notify_all();
+}
+
+LoopbackTransport::LoopbackTransport(LoopbackHub& hub, std::string node, size_t mtu, uint32_t cost)
+    : hub_(hub), node_(std::move(node)), mtu_(mtu), cost_(cost) {
+    hub_.attach(this);
+}
+
+LoopbackTransport::~LoopbackTransport() {
+    hub_.detach(this);
+}
+
+bool LoopbackTransport::send(const std::string& address, std::vector<uint8_t> frame) {
+    const size_t prefix = std::char_traits<char>::length(ADDRESS_PREFIX);
+    if (address.compare(0, prefix, ADDRESS_PREFIX) != 0) return false;
+    return hub_.enqueue(node_, address.substr(prefix), std::move(frame), mtu_);
+}
+
+void LoopbackTransport::broadcast(std::vector<uint8_t> frame) {
+    auto peers = hub_.peersOf(node_);
+    for (size_t i = 0; i < peers.size(); ++i) {
+        if (i + 1 == peers.size()) {
+            hub_.enqueue(node_, peers[i].name, std::move(frame), mtu_);
+        } else {
+            hub_.enqueue(node_, peers[i].name, frame, mtu_);
+        }
+    }
+}
+
+std::vector<TransportPeer> LoopbackTransport::peers() const {
+    return hub_.peersOf(node_);
+}
+
+} // namespace echo
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "Transport.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace echo {
+
+class LoopbackTransport;
+
+struct LoopbackStats {
+    uint64_t frames = 0;
+    uint64_t bytes = 0;
+    uint64_t fragments = 0;
+    uint64_t dropped = 0;
+};
+
+// An in-process medium joining LoopbackTransports by point-to-point links. Frames are delivered
+// in order on one worker thread, so receive callbacks never run on the sender's stack.
+// Transports must be destroyed before their hub.
+class LoopbackHub {
+public:
+    LoopbackHub();
+    ~LoopbackHub();
+
+    void connect(const std::string& a, const std::string& b);
+    void disconnect(const std::string& a, const std::string& b);
+    void drain();
+    LoopbackStats stats() const;
+
+private:
+    friend class LoopbackTransport;
+
+    struct Delivery {
+        std::string from;
+        std::string to;
+        std::vector<uint8_t> frame;
+    };
+
+    void attach(LoopbackTransport* node);
+    void detach(LoopbackTransport* node);
+    bool linked(const std::string& a, const std::string& b) const;
+    std::vector<TransportPeer> peersOf(const std::string& name) const;
+    bool enqueue(const std::string& from, const std::string& to, std::vector<uint8_t> frame, size_t mtu);
+    void notifyLink(const std::string& a, const std::string& b, bool up);
+    void run();
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::condition_variable idle_;
+    std::map<std::string, LoopbackTransport*> nodes_;
+    std::map<std::string, std::map<std::string, std::chrono::steady_clock::time_point>> links_;
+    std::deque<Delivery> queue_;
+    bool running_ = true;
+    bool busy_ = false;
+    const LoopbackTransport* delivering_ = nullptr;
+    LoopbackStats stats_;
+    std::thread worker_;
+};
+
+class LoopbackTransport : public ITransport {
+public:
+    static constexpr const char* ADDRESS_PREFIX = "lo:";
+    static constexpr size_t DEFAULT_MTU = 512;
+
+    LoopbackTransport(LoopbackHub& hub, std::string node, size_t mtu = DEFAULT_MTU, uint32_t cost = 1);
+    ~LoopbackTransport() override;
+
+    const std::string& node() const { return node_; }
+    static std::string addressOf(const std::string& node) { return ADDRESS_PREFIX + node; }
+
+    const std::string& name() const override { return name_; }
+    bool send(const std::string& address, std::vector<uint8_t> frame) override;
+    void broadcast(std::vector<uint8_t> frame) override;
+    std::vector<TransportPeer> peers() const override;
+    size_t mtu() const override { return mtu_; }
+    uint32_t cost() const override { return cost_; }
+
+    void setOnData(DataCallback cb) override { onData_ = std::move(cb); }
+    void setOnPeerUp(PeerCallback cb) override { onPeerUp_ = std::move(cb); }
+    void setOnPeerDown(PeerCallback cb) override { onPeerDown_ = std::move(cb); }
+
+private:
+    friend class LoopbackHub;
+
+    LoopbackHub& hub_;
+    std::string node_;
+    std::string name_ = "loopback";
+    size_t mtu_;
+    uint32_t cost_;
+    DataCallback onData_;
+    PeerCallback onPeerUp_;
+    PeerCallback onPeerDown_;
+};
+
+} // namespace echo
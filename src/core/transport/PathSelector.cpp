@@ -0,0 +1,177 @@
+#include "PathSelector.h"
+#include <algorithm>
+
+namespace echo {
+
+void PathSelector::expire(Path& path, Clock::time_point now) {
+    while (!path.inFlight.empty() && now - path.inFlight.front().sent > path.rtt.rto()) {
+        path.inFlight.pop_front();
+        path.lost++;
+        path.loss += LOSS_GAIN * (1.0 - path.loss);
+    }
+}
+
+bool PathSelector::silent(const Path& path, Clock::time_point now) {
+    if (path.unanswered == Clock::time_point{}) return false;
+    return now - path.unanswered > std::max<Clock::duration>(MIN_SILENCE, 2 * path.rtt.rto());
+}
+
+double PathSelector::score(const Path& path) {
+    double rttMs = path.rtt.hasSample() ? std::max(1.0, path.rtt.srttMs()) : static_cast<double>(UNMEASURED_RTT.count());
+    return static_cast<double>(path.cost) * rttMs / (1.0 - std::min(path.loss, MAX_LOSS));
+}
+
+std::vector<std::string> PathSelector::choose(const std::string& peer, const std::vector<PathCandidate>& candidates) {
+    return choose(peer, candidates, Clock::now());
+}
+
+std::vector<std::string> PathSelector::choose(const std::string& peer, const std::vector<PathCandidate>& candidates,
+                                              Clock::time_point now) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Peer& state = peers_[peer];
+    const std::string* bestLive = nullptr;
+    const std::string* bestSilent = nullptr;
+    double liveScore = 0.0;
+    double silentScore = 0.0;
+    for (const auto& candidate : candidates) {
+        Path& path = state.paths[candidate.transport];
+        path.cost = candidate.cost;
+        expire(path, now);
+        double s = score(path);
+        if (silent(path, now)) {
+            if (!bestSilent || s < silentScore) {
+                bestSilent = &candidate.transport;
+                silentScore = s;
+            }
+        } else if (!bestLive || s < liveScore) {
+            bestLive = &candidate.transport;
+            liveScore = s;
+        }
+    }
+
+    std::vector<std::string> out;
+    if (!bestLive) {
+        // Nothing has answered lately: race every path until one does.
+        for (const auto& candidate : candidates) {
+            if (!out.empty()) state.paths[candidate.transport].raced++;
+            out.push_back(candidate.transport);
+        }
+    } else {
+        out.push_back(*bestLive);
+        if (bestSilent && silentScore < liveScore) {
+            state.paths[*bestSilent].raced++;
+            out.push_back(*bestSilent);
+        }
+    }
+    if (!out.empty()) state.primary = out.front();
+    return out;
+}
+
+void PathSelector::sent(const std::string& peer, const std::string& transport, uint32_t sequence) {
+    sent(peer, transport, sequence, Clock::now());
+}
+
+void PathSelector::sent(const std::string& peer, const std::string& transport, uint32_t sequence,
+                        Clock::time_point now) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Peer& state = peers_[peer];
+    Path& path = state.paths[transport];
+    path.sent++;
+    if (sequence == 0) return;
+
+    // A sequence seen before is a retransmission or a raced copy; its ACK says nothing about one path's RTT.
+    bool resent = false;
+    for (auto& kv : state.paths) {
+        for (auto& tracked : kv.second.inFlight) {
+            if (tracked.sequence == sequence) {
+                tracked.resent = true;
+                resent = true;
+            }
+        }
+    }
+    if (path.inFlight.size() >= MAX_TRACKED) {
+        path.inFlight.pop_front();
+    }
+    path.inFlight.push_back(Tracked{sequence, now, resent});
+    if (path.unanswered == Clock::time_point{}) {
+        path.unanswered = now;
+    }
+}
+
+void PathSelector::heard(const std::string& peer, const std::string& transport) {
+    heard(peer, transport, Clock::now());
+}
+
+void PathSelector::heard(const std::string& peer, const std::string& transport, Clock::time_point now) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = peers_.find(peer);
+    if (it == peers_.end()) return;
+    auto path = it->second.paths.find(transport);
+    if (path == it->second.paths.end()) return;
+    path->second.lastHeard = now;
+    path->second.unanswered = Clock::time_point{};
+}
+
+void PathSelector::acked(const AckMessage& ack) {
+    acked(ack, Clock::now());
+}
+
+void PathSelector::acked(const AckMessage& ack, Clock::time_point now) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = peers_.find(ack.username);
+    if (it == peers_.end()) return;
+    for (auto& kv : it->second.paths) {
+        Path& path = kv.second;
+        for (auto entry = path.inFlight.begin(); entry != path.inFlight.end();) {
+            if (!ack.covers(entry->sequence)) {
+                ++entry;
+                continue;
+            }
+            if (entry->sequence == ack.latest && !entry->resent) {
+                path.rtt.sample(now - entry->sent);
+            }
+            path.delivered++;
+            path.loss -= LOSS_GAIN * path.loss;
+            entry = path.inFlight.erase(entry);
+        }
+    }
+}
+
+std::vector<PathStats> PathSelector::stats() const {
+    return stats(Clock::now());
+}
+
+std::vector<PathStats> PathSelector::stats(Clock::time_point now) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<PathStats> out;
+    for (const auto& peer : peers_) {
+        for (const auto& kv : peer.second.paths) {
+            const Path& path = kv.second;
+            PathStats s;
+            s.peer = peer.first;
+            s.transport = kv.first;
+            s.cost = path.cost;
+            s.primary = peer.second.primary == kv.first;
+            s.silent = silent(path, now);
+            s.sent = path.sent;
+            s.delivered = path.delivered;
+            s.lost = path.lost;
+            s.raced = path.raced;
+            s.loss = path.loss;
+            s.srttMs = path.rtt.srttMs();
+            s.rto = path.rtt.rto();
+            s.measured = path.rtt.hasSample();
+            s.heard = path.lastHeard != Clock::time_point{};
+            if (s.heard) {
+                s.sinceHeard = std::chrono::duration_cast<std::chrono::milliseconds>(now - path.lastHeard);
+            }
+            out.push_back(s);
+        }
+    }
+    std::sort(out.begin(), out.end(), [](const PathStats& a, const PathStats& b) {
+        return a.peer != b.peer ? a.peer < b.peer : a.transport < b.transport;
+    });
+    return out;
+}
+
+} // namespace echo
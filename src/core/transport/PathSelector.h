@@ -0,0 +1,102 @@
+#pragma once
+
+#include "core/protocol/MessageTypes.h"
+#include "core/protocol/RttEstimator.h"
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace echo {
+
+struct PathCandidate {
+    std::string transport;
+    uint32_t cost = 1;
+};
+
+struct PathStats {
+    std::string peer;
+    std::string transport;
+    uint32_t cost = 0;
+    bool primary = false;
+    bool silent = false;
+    uint64_t sent = 0;
+    uint64_t delivered = 0;
+    uint64_t lost = 0;
+    uint64_t raced = 0;
+    double loss = 0.0;
+    double srttMs = 0.0;
+    std::chrono::milliseconds rto{0};
+    bool measured = false;
+    bool heard = false;
+    std::chrono::milliseconds sinceHeard{0};
+};
+
+// Chooses which direct transport carries a private frame to a peer. Each (peer, transport) path
+// keeps an RTT estimate and a loss average learned from end-to-end ACKs; the path with the lowest
+// cost x RTT / (1 - loss) carries the frame alone. A path that has gone unanswered for longer than
+// its deadline is silent: the best live path takes over, and the silent one keeps getting a copy
+// while it still scores better, so it is picked again as soon as the peer is heard on it.
+class PathSelector {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr std::chrono::milliseconds MIN_SILENCE{1000};
+    static constexpr std::chrono::milliseconds UNMEASURED_RTT{100};
+    static constexpr double LOSS_GAIN = 0.125;
+    static constexpr double MAX_LOSS = 0.9;
+    static constexpr size_t MAX_TRACKED = 256;
+
+    std::vector<std::string> choose(const std::string& peer, const std::vector<PathCandidate>& candidates,
+                                    Clock::time_point now);
+    std::vector<std::string> choose(const std::string& peer, const std::vector<PathCandidate>& candidates);
+
+    // A sequence of 0 marks a frame that expects no ACK, such as an ACK itself.
+    void sent(const std::string& peer, const std::string& transport, uint32_t sequence, Clock::time_point now);
+    void sent(const std::string& peer, const std::string& transport, uint32_t sequence);
+    void heard(const std::string& peer, const std::string& transport, Clock::time_point now);
+    void heard(const std::string& peer, const std::string& transport);
+    void acked(const AckMessage& ack, Clock::time_point now);
+    void acked(const AckMessage& ack);
+
+    std::vector<PathStats> stats(Clock::time_point now) const;
+    std::vector<PathStats> stats() const;
+
+private:
+    struct Tracked {
+        uint32_t sequence = 0;
+        Clock::time_point sent;
+        bool resent = false;
+    };
+
+    struct Path {
+        uint32_t cost = 1;
+        RttEstimator rtt;
+        double loss = 0.0;
+        Clock::time_point lastHeard{};
+        Clock::time_point unanswered{};
+        std::deque<Tracked> inFlight;
+        uint64_t sent = 0;
+        uint64_t delivered = 0;
+        uint64_t lost = 0;
+        uint64_t raced = 0;
+    };
+
+    struct Peer {
+        std::map<std::string, Path> paths;
+        std::string primary;
+    };
+
+    static void expire(Path& path, Clock::time_point now);
+    static bool silent(const Path& path, Clock::time_point now);
+    static double score(const Path& path);
+
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, Peer> peers_;
+};
+
+} // namespace echo
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace echo {
+
+struct TransportPeer {
+    std::string name;
+    std::string address;
+    int16_t rssi = 0;
+    std::chrono::steady_clock::time_point lastSeen{};
+};
+
+// A link layer that carries serialized frames between echo nodes (BLE, WiFi, in-process loopback).
+// Addresses are transport specific. On a shared medium every peer sits behind one relay link
+// named by sharedLink(); otherwise each peer address is its own link.
+class ITransport {
+public:
+    using DataCallback = std::function<void(const std::string& link, const std::vector<uint8_t>& data)>;
+    using PeerCallback = std::function<void(const TransportPeer& peer)>;
+
+    virtual ~ITransport() = default;
+
+    virtual const std::string& name() const = 0;
+    virtual std::string sharedLink() const { return ""; }
+
+    virtual bool send(const std::string& address, std::vector<uint8_t> frame) = 0;
+    virtual void broadcast(std::vector<uint8_t> frame) = 0;
+    virtual std::vector<TransportPeer> peers() const = 0;
+
+    // Largest frame carried in one link-layer write; larger frames are fragmented or streamed.
+    virtual size_t mtu() const = 0;
+    // Relative cost of one frame; the cheapest transport that reaches a peer is preferred.
+    virtual uint32_t cost() const = 0;
+
+    // Peer-up may repeat for a peer that is already up: connectionless transports report every sighting.
+    virtual void setOnData(DataCallback cb) = 0;
+    virtual void setOnPeerUp(PeerCallback cb) = 0;
+    virtual void setOnPeerDown(PeerCallback cb) = 0;
+};
+
+} // namespace echo
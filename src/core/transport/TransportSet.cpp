@@ -0,0 +1,136 @@
+#include "TransportSet.h"
+
+namespace echo {
+
+namespace {
+
+bool findPeer(const ITransport& transport, const std::string& username, TransportPeer& out) {
+    for (auto& peer : transport.peers()) {
+        if (peer.name == username) {
+            out = std::move(peer);
+            return true;
+        }
+    }
+    return false;
+}
+
+}
+
+void TransportSet::add(ITransport& transport) {
+    transports_.push_back(&transport);
+}
+
+ITransport* TransportSet::owner(const std::string& link) const {
+    for (ITransport* transport : transports_) {
+        if (transport->sharedLink() == link) return transport;
+    }
+    for (ITransport* transport : transports_) {
+        if (!transport->sharedLink().empty()) continue;
+        for (const auto& peer : transport->peers()) {
+            if (peer.address == link) return transport;
+        }
+    }
+    return nullptr;
+}
+
+ITransport* TransportSet::find(const std::string& name) const {
+    for (ITransport* transport : transports_) {
+        if (transport->name() == name) return transport;
+    }
+    return nullptr;
+}
+
+std::vector<ITransport*> TransportSet::reaching(const std::string& username) const {
+    std::vector<ITransport*> out;
+    TransportPeer peer;
+    for (ITransport* transport : transports_) {
+        if (findPeer(*transport, username, peer)) out.push_back(transport);
+    }
+    return out;
+}
+
+bool TransportSet::hasPeer(const std::string& username) const {
+    TransportPeer peer;
+    for (ITransport* transport : transports_) {
+        if (findPeer(*transport, username, peer)) return true;
+    }
+    return false;
+}
+
+std::vector<TransportPeer> TransportSet::peers() const {
+    std::vector<TransportPeer> out;
+    for (ITransport* transport : transports_) {
+        auto peers = transport->peers();
+        out.insert(out.end(), std::make_move_iterator(peers.begin()), std::make_move_iterator(peers.end()));
+    }
+    return out;
+}
+
+std::vector<RelayLink> TransportSet::relayLinks() const {
+    std::vector<RelayLink> links;
+    for (ITransport* transport : transports_) {
+        auto peers = transport->peers();
+        std::string shared = transport->sharedLink();
+        if (!shared.empty()) {
+            if (!peers.empty()) links.push_back(RelayLink{shared, peers.size()});
+            continue;
+        }
+        for (const auto& peer : peers) {
+            links.push_back(RelayLink{peer.address, 1});
+        }
+    }
+    return links;
+}
+
+std::vector<MeshNeighbor> TransportSet::meshNeighbors() const {
+    std::vector<MeshNeighbor> neighbors;
+    for (ITransport* transport : transports_) {
+        std::string shared = transport->sharedLink();
+        for (const auto& peer : transport->peers()) {
+            if (peer.name.empty()) continue;
+            neighbors.push_back(MeshNeighbor{peer.name, shared.empty() ? peer.address : shared, peer.rssi, peer.lastSeen});
+        }
+    }
+    return neighbors;
+}
+
+bool TransportSet::sendOnLink(const std::string& link, std::vector<uint8_t> frame) const {
+    ITransport* transport = owner(link);
+    if (!transport) return false;
+    if (transport->sharedLink() == link) {
+        transport->broadcast(std::move(frame));
+        return true;
+    }
+    return transport->send(link, std::move(frame));
+}
+
+bool TransportSet::sendToHop(const NextHop& hop, std::vector<uint8_t> frame) const {
+    ITransport* transport = owner(hop.link);
+    if (!transport) return false;
+    TransportPeer peer;
+    if (!hop.name.empty() && transport->sharedLink() == hop.link && findPeer(*transport, hop.name, peer)) {
+        return transport->send(peer.address, std::move(frame));
+    }
+    return sendOnLink(hop.link, std::move(frame));
+}
+
+bool TransportSet::sendTo(const std::string& username, std::vector<uint8_t> frame) const {
+    ITransport* best = nullptr;
+    for (ITransport* transport : reaching(username)) {
+        if (!best || transport->cost() < best->cost()) best = transport;
+    }
+    return best && sendVia(*best, username, std::move(frame));
+}
+
+bool TransportSet::sendVia(ITransport& transport, const std::string& username, std::vector<uint8_t> frame) const {
+    TransportPeer peer;
+    return findPeer(transport, username, peer) && transport.send(peer.address, std::move(frame));
+}
+
+void TransportSet::broadcast(const std::vector<uint8_t>& frame) const {
+    for (ITransport* transport : transports_) {
+        transport->broadcast(frame);
+    }
+}
+
+} // namespace echo
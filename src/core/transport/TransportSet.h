@@ -0,0 +1,37 @@
+#pragma once
+
+#include "Transport.h"
+#include "core/mesh/MeshNetwork.h"
+#include "core/mesh/MessageRouter.h"
+#include <string>
+#include <vector>
+
+namespace echo {
+
+// The transports a node sends through, seen as relay links and mesh neighbors. Transports are
+// added before any worker that calls into the set starts, and must outlive it.
+class TransportSet {
+public:
+    void add(ITransport& transport);
+    const std::vector<ITransport*>& transports() const { return transports_; }
+
+    ITransport* owner(const std::string& link) const;
+    ITransport* find(const std::string& name) const;
+    bool hasPeer(const std::string& username) const;
+    std::vector<ITransport*> reaching(const std::string& username) const;
+    std::vector<TransportPeer> peers() const;
+
+    std::vector<RelayLink> relayLinks() const;
+    std::vector<MeshNeighbor> meshNeighbors() const;
+
+    bool sendOnLink(const std::string& link, std::vector<uint8_t> frame) const;
+    bool sendToHop(const NextHop& hop, std::vector<uint8_t> frame) const;
+    bool sendTo(const std::string& username, std::vector<uint8_t> frame) const;
+    bool sendVia(ITransport& transport, const std::string& username, std::vector<uint8_t> frame) const;
+    void broadcast(const std::vector<uint8_t>& frame) const;
+
+private:
+    std::vector<ITransport*> transports_;
+};
+
+} // namespace echo
@@ -0,0 +1,45 @@
+#include "WifiTransport.h"
+#include "core/mesh/MessageRouter.h"
+
+namespace echo {
+
+std::string WifiTransport::sharedLink() const {
+    return MessageRouter::WIFI_LINK;
+}
+
+bool WifiTransport::send(const std::string& address, std::vector<uint8_t> frame) {
+    if (address.empty()) return false;
+    return wifi_.queueTo(address, std::move(frame));
+}
+
+void WifiTransport::broadcast(std::vector<uint8_t> frame) {
+    wifi_.queueBroadcast(std::move(frame));
+}
+
+std::vector<TransportPeer> WifiTransport::peers() const {
+    std::vector<TransportPeer> out;
+    for (const auto& p : wifi_.peerLastSeen()) {
+        out.push_back(TransportPeer{p.first, p.first, 0, p.second});
+    }
+    return out;
+}
+
+void WifiTransport::setOnData(DataCallback cb) {
+    wifi_.setOnData([cb = std::move(cb)](const std::string&, const std::vector<uint8_t>& data) {
+        if (cb) cb(MessageRouter::WIFI_LINK, data);
+    });
+}
+
+void WifiTransport::setOnPeerUp(PeerCallback cb) {
+    wifi_.setOnPeerSeen([cb = std::move(cb)](const std::string& username) {
+        if (cb) cb(TransportPeer{username, username, 0, std::chrono::steady_clock::now()});
+    });
+}
+
+void WifiTransport::setOnPeerDown(PeerCallback cb) {
+    wifi_.setOnPeerGone([cb = std::move(cb)](const std::string& username) {
+        if (cb) cb(TransportPeer{username, username, 0, {}});
+    });
+}
+
+} // namespace echo
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "Transport.h"
+#include "core/network/WifiDirect.h"
+
+namespace echo {
+
+// The LAN is one shared relay link; peers are addressed by username and found through UDP beacons.
+class WifiTransport : public ITransport {
+public:
+    static constexpr uint32_t COST = 1;
+
+    explicit WifiTransport(WifiDirect& wifi) : wifi_(wifi) {}
+
+    const std::string& name() const override { return name_; }
+    std::string sharedLink() const override;
+    bool send(const std::string& address, std::vector<uint8_t> frame) override;
+    void broadcast(std::vector<uint8_t> frame) override;
+    std::vector<TransportPeer> peers() const override;
+    size_t mtu() const override { return WifiDirect::MAX_FRAME; }
+    uint32_t cost() const override { return COST; }
+
+    void setOnData(DataCallback cb) override;
+    void setOnPeerUp(PeerCallback cb) override;
+    void setOnPeerDown(PeerCallback cb) override;
+
+private:
+    WifiDirect& wifi_;
+    std::string name_ = "wifi";
+};
+
+} // namespace echo
@@ -1,13 +1,15 @@
 #include "ConsoleUI.h"
 #include "core/crypto/UserIdentity.h"
 #include "core/network/WifiDirect.h"
+#include "core/protocol/MessageId.h"
+#include "core/transport/BluetoothTransport.h"
+#include "core/transport/WifiTransport.h"
 #include <iostream>
 #include <sstream>
 #include <iomanip>
 #include <algorithm>
 #include <mutex>
 #include <chrono>
-#include <unordered_set>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -18,8 +20,30 @@
 
 namespace echo {
 
+namespace {
+
+uint32_t sequenceOf(const std::vector<uint8_t>& frame) {
+    auto view = MessageView::parse(frame);
+    if (view.type() != MessageType::PRIVATE_MESSAGE) return 0;
+    std::vector<uint8_t> expanded;
+    return TextMessageView::parse(view, view.decodedPayload(expanded)).sequence();
+}
+
+}
+
 ConsoleUI::ConsoleUI()
-    : running_(false), currentChatMode_(ChatMode::NONE) {
+    : running_(false), currentChatMode_(ChatMode::NONE),
+      router_([this](const std::string& link, std::vector<uint8_t> frame) { transports_.sendOnLink(link, std::move(frame)); },
+              [this]() { return transports_.relayLinks(); }),
+      mesh_([this](const NextHop& hop, std::vector<uint8_t> frame) {
+                // Mesh control frames are read only by the neighbor they are sent to.
+                if (senders_.supportsCompression(hop.name)) MessageFactory::compressFrame(frame);
+                transports_.sendToHop(hop, std::move(frame));
+            },
+            [this]() { return transports_.meshNeighbors(); }) {
+    router_.setRoleCallback([this](const std::string& ingress) { return mesh_.roleFor(ingress); });
+    router_.setUnicast([this](const std::string& destination, NextHop& hop) { return mesh_.nextHop(destination, hop); },
+                       [this](const NextHop& hop, std::vector<uint8_t> frame) { transports_.sendToHop(hop, std::move(frame)); });
 }
 
 ConsoleUI::~ConsoleUI() {
@@ -28,32 +52,61 @@ ConsoleUI::~ConsoleUI() {
 
 void ConsoleUI::run(BluetoothManager& bluetoothManager, UserIdentity& identity) {
     running_ = true;
+    bluetooth_ = &bluetoothManager;
+    identity_ = &identity;
+    senderId_ = MessageIdGenerator::nodeId();
     wifi_ = std::make_unique<echo::WifiDirect>();
-    wifi_->setOnData([this](const std::string& /*src*/, const std::vector<uint8_t>& data) {
-        onDataReceived("wifi", data);
+    wifiLink_ = std::make_unique<WifiTransport>(*wifi_);
+    bleLink_ = std::make_unique<BluetoothTransport>(bluetoothManager);
+    transports_.add(*wifiLink_);
+    transports_.add(*bleLink_);
+    for (ITransport* transport : transports_.transports()) {
+        transport->setOnData([this](const std::string& link, const std::vector<uint8_t>& data) {
+            onDataReceived(link, data);
+        });
+    }
+    outbox_ = std::make_unique<MessageStore>("echo_outbox");
+    if (!outbox_->open()) {
+        std::cerr << "Warning: could not open echo_outbox, offline messages will not be queued" << std::endl;
+        outbox_.reset();
+    }
+    wifiLink_->setOnPeerUp([this](const TransportPeer& peer) { deliverStored(peer.name); });
+    wifiLink_->setOnPeerDown([this](const TransportPeer& peer) { onDeviceDisconnected(peer); });
+    bleLink_->setOnPeerUp([this](const TransportPeer& peer) { onDeviceConnected(peer); });
+    bleLink_->setOnPeerDown([this](const TransportPeer& peer) { onDeviceDisconnected(peer); });
+    reliable_ = std::make_unique<ReliableDelivery>(
+        [this](const std::string& peer, std::vector<uint8_t> frame) {
+            return sendPrivateFrame(peer, std::move(frame));
+        });
+    reliable_->setLocalName(identity.getUsername());
+    reliable_->setOnResult([this](const std::string& peer, uint32_t, bool delivered, const std::vector<uint8_t>& frame) {
+        onDeliveryResult(peer, delivered, frame);
     });
+    reliable_->start();
     wifi_->start(identity.getUsername(), identity.getFingerprint());
 
+    files_ = std::make_unique<FileTransferManager>(
+        [this](const std::string& peer, std::vector<uint8_t> frame) {
+            sendFileFrame(peer, std::move(frame));
+        });
+    files_->setLocalUsername(identity.getUsername());
+    files_->setOnOffer([this](const FileOffer& offer) { onFileOffer(offer); });
+    files_->setOnReceived([this](const FileOffer& offer, const std::vector<uint8_t>& data) {
+        onFileReceived(offer, data);
+    });
+    files_->setOnFinished([this](const FileOffer& offer, bool ok, const std::string& reason) {
+        onFileFinished(offer, ok, reason);
+    });
+    files_->start();
+    router_.start();
+    mesh_.setLocalName(identity.getUsername());
+    mesh_.start();
+
     bluetoothManager.setDeviceDiscoveredCallback(
         [this](const DiscoveredDevice& device) {
             onDeviceDiscovered(device);
         });
 
-    bluetoothManager.setDeviceConnectedCallback(
-        [this, &bluetoothManager](const std::string& address) {
-            onDeviceConnected(address, bluetoothManager);
-        });
-
-    bluetoothManager.setDeviceDisconnectedCallback(
-        [this](const std::string& address) {
-            onDeviceDisconnected(address);
-        });
-
-    bluetoothManager.setDataReceivedCallback(
-        [this](const std::string& address, const std::vector<uint8_t>& data) {
-            onDataReceived(address, data);
-        });
-
     printHelp();
 
     std::string input;
@@ -77,7 +130,15 @@ void ConsoleUI::run(BluetoothManager& bluetoothManager, UserIdentity& identity)
             handleCommand(input, bluetoothManager, identity);
         }
     }
-    if (wifi_) { wifi_->stop(); wifi_.reset(); }
+    if (reliable_) { reliable_->stop(); }
+    mesh_.stop();
+    router_.stop();
+    if (files_) { files_->stop(); }
+    transports_ = TransportSet();
+    if (wifi_) { wifi_->stop(); }
+    wifiLink_.reset();
+    wifi_.reset();
+    if (outbox_) { outbox_->close(); }
 }
 
 void ConsoleUI::printHelp() const {
@@ -96,6 +157,8 @@ void ConsoleUI::printHelp() const {
     std::cout << "/decline <id>     - Decline a received file" << std::endl;
     std::cout << "/who              - List online Echo users" << std::endl;
     std::cout << "whoami            - Show your identity" << std::endl;
+    std::cout << "stats             - Show transport counters" << std::endl;
+    std::cout << "paths             - Show per-peer transport path selection and delivery" << std::endl;
     std::cout << "/nick <n>      - Change your username" << std::endl;
     std::cout << "clear             - Clear screen" << std::endl;
     std::cout << "help              - Show this help" << std::endl;
@@ -135,19 +198,23 @@ void ConsoleUI::handleCommand(const std::string& command, BluetoothManager& blue
             }
         }
     else if (simpleCmd == "whoami") cmd.type = CommandType::WHOAMI;
+            else if (simpleCmd == "stats") {
+                printStats(bluetoothManager);
+                return;
+            }
+            else if (simpleCmd == "paths") {
+                printPaths();
+                return;
+            }
             else if (simpleCmd == "wifi") {
                 std::string sub;
                 if (iss >> sub) {
                     if (sub == "start") {
-                        if (!wifi_) {
-                            wifi_ = std::make_unique<echo::WifiDirect>();
-                            wifi_->setOnData([this](const std::string& /*src*/, const std::vector<uint8_t>& data) { onDataReceived("wifi", data); });
-                            wifi_->start(identity.getUsername(), identity.getFingerprint());
-                        }
+                        // WiFi starts with the console; this only turns on its logging.
                         wifi_->setVerbose(true);
                         std::cout << "WiFi verbose mode enabled" << std::endl;
-                        std::cout << "Local IP: " << (wifi_ ? wifi_->getLocalIp() : "unknown") << std::endl;
-                        std::cout << "TCP Port: " << (wifi_ ? std::to_string(wifi_->getPort()) : "unknown") << std::endl;
+                        std::cout << "Local IP: " << wifi_->getLocalIp() << std::endl;
+                        std::cout << "TCP Port: " << wifi_->getPort() << std::endl;
                         return;
                     } else if (sub == "stop") {
                         if (wifi_) wifi_->setVerbose(false);
@@ -385,7 +452,7 @@ void ConsoleUI::handleChatMode(const std::string& input, BluetoothManager& bluet
         size_t p2 = input.find('\'', p1 == std::string::npos ? 0 : p1 + 1);
         if (p1 != std::string::npos && p2 != std::string::npos && p2 > p1 + 1) {
             std::string path = input.substr(p1 + 1, p2 - p1 - 1);
-            bool ok = handleFileSend(path, bluetoothManager, identity);
+            bool ok = handleFileSend(path);
             if (currentChatMode_ == ChatMode::GLOBAL) {
                 std::cout << (ok ? "[GLOBAL] sent" : "[GLOBAL] failed") << std::endl;
             } else if (currentChatMode_ == ChatMode::PERSONAL) {
@@ -399,7 +466,7 @@ void ConsoleUI::handleChatMode(const std::string& input, BluetoothManager& bluet
     }
 
     if (!input.empty() && input[0] != '/') {
-        sendMessage(input, bluetoothManager, identity);
+        sendMessage(input, identity);
     }
 
     std::cout << getPrompt();
@@ -440,50 +507,40 @@ void ConsoleUI::exitChatMode() {
     std::cout << getPrompt();
 }
 
-void ConsoleUI::sendMessage(const std::string& message, BluetoothManager& bluetoothManager, UserIdentity& identity) {
+void ConsoleUI::sendMessage(const std::string& message, UserIdentity& identity) {
     if (currentChatMode_ == ChatMode::GLOBAL) {
-        auto msg = MessageFactory::createTextMessage(
-            message,
-            identity.getUsername(),
-            identity.getFingerprint(),
-            "",
-            true
-        );
+        // Relays carry global frames to nodes that never heard this node's announce, so they stay v1.
+        auto msg = MessageFactory::createTextMessage(message, identity.getUsername(), identity.getFingerprint(), "", true);
 
         auto data = msg.serialize();
-        bool sent = false;
-
-        if (wifi_) {
-            sent = wifi_->sendBroadcast(data) || sent;
-        }
-
-        auto devices = bluetoothManager.getEchoDevices();
-        for (const auto& device : devices) {
-            sent = bluetoothManager.sendData(device.address, data) || sent;
-        }
+        seenMessages_.markSeen(MessageView::parse(data));
+        transports_.broadcast(data);
 
         std::cout << "[#global][You]: " << message << std::endl;
         addToHistory("[#global][You]: " + message);
 
     } else if (currentChatMode_ == ChatMode::PERSONAL) {
-        auto msg = MessageFactory::createTextMessage(
-            message,
-            identity.getUsername(),
-            identity.getFingerprint(),
-            currentChatTarget_,
-            false
-        );
+        announceTo(currentChatTarget_);
+
+        NextHop hop;
+        bool routed = mesh_.nextHop(currentChatTarget_, hop);
+        bool direct = routed ? hop.name == currentChatTarget_ : transports_.hasPeer(currentChatTarget_);
+        // Direct peers must have announced ACK support; multi-hop routes only exist between current mesh nodes.
+        bool acked = reliable_ && (direct ? senders_.supportsAcks(currentChatTarget_) : routed);
+        uint32_t sequence = acked ? reliable_->nextSequence(currentChatTarget_) : 0;
+        auto msg = direct && senders_.supportsCompact(currentChatTarget_)
+            ? MessageFactory::createCompactTextMessage(message, senderId_, currentChatTarget_, false, sequence)
+            : MessageFactory::createTextMessage(message, identity.getUsername(), identity.getFingerprint(), currentChatTarget_, false, sequence);
 
         auto data = msg.serialize();
-        bool sent = false;
-
-        if (wifi_) {
-            sent = wifi_->sendTo(currentChatTarget_, data) || sent;
-        }
-
-        std::string address = findAddressByUsername(currentChatTarget_, bluetoothManager);
-        if (!address.empty()) {
-            sent = bluetoothManager.sendData(address, data) || sent;
+        if (acked) {
+            reliable_->send(currentChatTarget_, sequence, std::move(data));
+        } else if (!sendPrivateFrame(currentChatTarget_, data)) {
+            if (outbox_ && outbox_->enqueue(currentChatTarget_, data)) {
+                std::cout << "[OUTBOX] " << currentChatTarget_ << " is not reachable, message queued" << std::endl;
+            } else {
+                std::cout << "[OUTBOX] " << currentChatTarget_ << " is not reachable and the outbox is full" << std::endl;
+            }
         }
 
         std::cout << "[You]: " << message << std::endl;
@@ -491,6 +548,33 @@ void ConsoleUI::sendMessage(const std::string& message, BluetoothManager& blueto
     }
 }
 
+void ConsoleUI::announceTo(const std::string& username) {
+    for (ITransport* transport : transports_.transports()) {
+        for (const auto& peer : transport->peers()) {
+            if (peer.name == username) {
+                announceTo(*transport, peer.address);
+            }
+        }
+    }
+}
+
+void ConsoleUI::announceTo(ITransport& transport, const std::string& address, bool force) {
+    if (!identity_ || address.empty()) return;
+
+#ifdef _WIN32
+    const char* osType = "windows";
+#elif defined(__APPLE__)
+    const char* osType = "macos";
+#else
+    const char* osType = "linux";
+#endif
+
+    std::string key = transport.name() + ":" + address;
+    if (force || senders_.claimAnnounce(key, std::chrono::seconds(60))) {
+        transport.send(address, MessageFactory::createAnnounceMessage(identity_->getUsername(), identity_->getFingerprint(), osType, senderId_).serialize());
+    }
+}
+
 void ConsoleUI::displayMessage(const std::string& from, const std::string& message, bool isPrivate) {
     std::lock_guard<std::mutex> lock(historyMutex_);
 
@@ -578,47 +662,203 @@ void ConsoleUI::printEchoDevices(const BluetoothManager& bluetoothManager) const
     std::cout << "===================\n" << std::endl;
 }
 
+void ConsoleUI::printStats(const BluetoothManager& bluetoothManager) const {
+    auto frag = bluetoothManager.getFragmentationStats();
+
+    std::cout << "\n=== Transport Stats ===" << std::endl;
+    std::cout << "BLE frames split:      " << frag.framesSplit << std::endl;
+    std::cout << "BLE fragments sent:    " << frag.fragmentsSent << std::endl;
+    std::cout << "BLE fragments rx:      " << frag.fragmentsReceived << std::endl;
+    std::cout << "BLE frames reassembled:" << " " << frag.framesReassembled << std::endl;
+    std::cout << "BLE duplicate frags:   " << frag.duplicateFragments << std::endl;
+    std::cout << "BLE reassembly timeout:" << " " << frag.timedOut << std::endl;
+    std::cout << "BLE reassembly evicted:" << " " << frag.evicted << std::endl;
+    std::cout << "BLE malformed frags:   " << frag.malformed << std::endl;
+    std::cout << "BLE pending:           " << frag.pendingFrames << " frames, " << frag.pendingBytes << " bytes" << std::endl;
+
+    auto printBatch = [](const char* label, const BatchStats& b) {
+        std::cout << label << " frames queued " << b.framesQueued
+                  << ", writes " << b.writes
+                  << " (" << b.batchedWrites << " batched, " << b.framesBatched << " frames)"
+                  << ", failed " << b.failedWrites << std::endl;
+    };
+    printBatch("BLE batching: ", bluetoothManager.getBatchStats());
+    if (wifi_) {
+        printBatch("WiFi batching:", wifi_->getBatchStats());
+    }
+    auto printPacing = [](const char* label, double configured, const PacerStats& p, const std::vector<LinkRate>& links) {
+        std::cout << label << " configured " << static_cast<uint64_t>(configured) << " B/s, "
+                  << p.framesSent << " writes (" << p.bytesSent << " bytes, " << p.bulkFrames << " file data)"
+                  << ", " << p.queuedBytes << " bytes queued, " << p.dropped << " dropped, " << p.failedWrites << " failed"
+                  << ", " << p.slowWrites << " slow, " << p.decreases << " rate cuts" << std::endl;
+        for (const auto& link : links) {
+            std::cout << "  " << link.link << ": " << static_cast<uint64_t>(link.rate) << "/"
+                      << static_cast<uint64_t>(link.configuredRate) << " B/s, " << link.queuedFrames << " queued ("
+                      << link.queuedBytes << " bytes), write " << std::fixed << std::setprecision(1) << link.latencyMs
+                      << " ms (base " << link.baseLatencyMs << " ms)" << std::endl;
+            std::cout.unsetf(std::ios::fixed);
+        }
+    };
+    printPacing("BLE pacing:   ", bluetoothManager.getConfiguredRate(), bluetoothManager.getPacerStats(),
+                bluetoothManager.getLinkRates());
+    if (wifi_) {
+        printPacing("WiFi pacing:  ", wifi_->getConfiguredRate(), wifi_->getPacerStats(), wifi_->getLinkRates());
+        auto server = wifi_->getServerStats();
+        std::cout << "WiFi server (" << backendName(wifi_->getServerBackend()) << "): " << server.accepted
+                  << " connections accepted, " << server.active << " open, "
+                  << server.frames << " frames (" << server.bytes << " bytes), " << server.malformed << " malformed"
+                  << ", " << server.stalls << " worker stalls, " << server.acceptPauses << " accept pauses, "
+                  << server.syscalls << " syscalls" << std::endl;
+        auto pool = wifi_->getPoolStats();
+        std::cout << "WiFi connections: " << pool.open << " open, " << pool.connects << " connects, " << pool.reused
+                  << " sends reused a connection, " << pool.reconnects << " reconnects, " << pool.failures << " failures"
+                  << ", " << pool.idleClosed << " closed idle, " << pool.batched << " sends batched through io_uring" << std::endl;
+        std::cout << "WiFi breaker: " << pool.broken << " peer(s) skipped until their next beacon, " << pool.breakerTrips
+                  << " trips, " << pool.skipped << " sends skipped" << std::endl;
+        auto datagrams = wifi_->getDatagramStats();
+        std::cout << "WiFi datagrams: " << datagrams.sent << " sent, " << datagrams.acked << " acked, "
+                  << datagrams.retransmits << " retransmits, " << datagrams.expired << " moved to TCP, "
+                  << datagrams.inFlight << " in flight, " << datagrams.received << " received ("
+                  << datagrams.duplicates << " duplicates), " << datagrams.syscalls << " syscalls" << std::endl;
+    }
+    for (ITransport* transport : transports_.transports()) {
+        std::cout << "Link " << transport->name() << ": " << transport->peers().size() << " peer(s), mtu "
+                  << transport->mtu() << ", cost " << transport->cost() << std::endl;
+    }
+
+    auto dedup = seenMessages_.stats();
+    std::cout << "Dedup: " << dedup.misses << " new, " << dedup.hits << " duplicates dropped"
+              << ", " << dedup.idCollisions << " id collisions"
+              << ", " << dedup.entries << " tracked (" << dedup.expired << " expired)" << std::endl;
+    auto relay = router_.stats();
+    std::cout << "Relay: " << relay.relayed << " frames relayed as " << relay.framesForwarded << " sends"
+              << ", " << relay.expired << " TTL expired, " << relay.noNeighbors << " with no other neighbor" << std::endl;
+    std::cout << "Gossip: " << relay.scheduled << " scheduled, " << relay.suppressed << " suppressed by duplicates"
+              << ", " << relay.skipped << " skipped by probability, " << relay.sendsSaved << " sends saved"
+              << ", " << relay.pending << " pending" << std::endl;
+    auto mesh = mesh_.stats();
+    std::cout << "Mesh: " << mesh.oneHop << " neighbors, " << mesh.twoHop << " two-hop, " << mesh.relays << " relays chosen"
+              << ", selected as relay by " << mesh.selectors
+              << " (" << relay.relayForwarded << " forwarded, " << relay.relaySuppressed << " suppressed)" << std::endl;
+    std::cout << "Routes: " << mesh.routes << " known, " << relay.unicastSent << " private sends routed"
+              << ", " << relay.unicastForwarded << " forwarded for others, " << relay.noRoute << " without route"
+              << ", probes " << mesh.probesAnswered << "/" << mesh.probesSent << " answered"
+              << ", " << mesh.routeUpdatesSent << " updates and " << mesh.routeTablesSent << " full tables sent ("
+              << mesh.routesAdvertised << " routes)" << std::endl;
+    for (const auto& route : mesh_.routes()) {
+        std::cout << "  " << route.destination << " via " << route.nextHop << " (" << route.link << ")"
+                  << " cost " << route.cost << ", " << static_cast<int>(route.hops) << " hop(s)" << std::endl;
+    }
+    if (outbox_) {
+        auto box = outbox_->stats();
+        std::cout << "Outbox: " << box.queued << " queued for " << box.recipients << " recipient(s)"
+                  << " (" << box.relayQueued << " carried for others), " << box.bytes << " bytes in "
+                  << box.segments << " segment(s), " << box.delivered << " delivered, " << box.expired << " expired"
+                  << ", " << box.rejected << " rejected" << std::endl;
+    }
+    if (reliable_) {
+        auto rd = reliable_->stats();
+        std::cout << "Reliability: " << rd.delivered << "/" << rd.sent << " acknowledged, " << rd.pending << " pending, "
+                  << rd.retransmits << " retransmits (" << rd.deferred << " deferred), " << rd.failed << " failed"
+                  << ", acks " << rd.acksSent << " sent/" << rd.acksReceived << " received"
+                  << ", " << rd.duplicates << " duplicate and " << rd.outOfOrder << " out-of-order receives" << std::endl;
+        for (const auto& peer : reliable_->rtts()) {
+            std::cout << "  " << peer.peer << ": ";
+            if (peer.measured) {
+                std::cout << "srtt " << std::fixed << std::setprecision(1) << peer.srttMs << " ms, rttvar "
+                          << peer.rttvarMs << " ms, ";
+                std::cout.unsetf(std::ios::fixed);
+            }
+            std::cout << "rto " << peer.rto.count() << " ms" << std::endl;
+        }
+    }
+    if (files_) {
+        auto ft = files_->stats();
+        std::cout << "Files: " << ft.filesSent << " sent, " << ft.filesReceived << " received, "
+                  << ft.transfersFailed << " failed, " << ft.activeTransfers << " active" << std::endl;
+        std::cout << "File chunks: " << ft.chunksSent << " sent (" << ft.chunksRetransmitted << " retransmitted, "
+                  << ft.chunksSacked << " selectively acked), "
+                  << ft.chunksReceived << " received (" << ft.duplicateChunks << " duplicate, "
+                  << ft.crcFailures << " crc errors)" << std::endl;
+    }
+    std::cout << "=======================\n" << std::endl;
+}
+
+void ConsoleUI::printPaths() const {
+    auto paths = paths_.stats();
+    std::cout << "\n=== Paths ===" << std::endl;
+    if (paths.empty()) {
+        std::cout << "No private messages sent to direct peers yet" << std::endl;
+    }
+    for (const auto& path : paths) {
+        std::cout << path.peer << " via " << path.transport;
+        if (path.primary) std::cout << " [primary]";
+        if (path.silent) std::cout << " [silent]";
+        std::cout << ": cost " << path.cost << ", " << path.sent << " sent, " << path.delivered << " delivered, "
+                  << path.lost << " lost, " << path.raced << " raced, loss " << std::fixed << std::setprecision(1)
+                  << path.loss * 100.0 << "%";
+        if (path.measured) {
+            std::cout << ", srtt " << path.srttMs << " ms";
+        }
+        std::cout.unsetf(std::ios::fixed);
+        std::cout << ", rto " << path.rto.count() << " ms";
+        if (path.heard) {
+            std::cout << ", heard " << path.sinceHeard.count() << " ms ago";
+        }
+        std::cout << std::endl;
+    }
+    std::cout << "=============\n" << std::endl;
+}
+
 void ConsoleUI::onDeviceDiscovered(const DiscoveredDevice& device) {
     (void)device;
 }
 
-void ConsoleUI::onDeviceConnected(const std::string& address, const BluetoothManager& bluetoothManager) {
-    std::string username = findUsernameByAddress(address, bluetoothManager);
-    if (!username.empty()) {
-        std::cout << "\n[CONNECTED] " << username << " (" << address << ")" << std::endl;
+void ConsoleUI::onDeviceConnected(const TransportPeer& peer) {
+    if (!peer.name.empty()) {
+        std::cout << "\n[CONNECTED] " << peer.name << " (" << peer.address << ")" << std::endl;
     } else {
-        std::cout << "\n[CONNECTED] " << address << std::endl;
+        std::cout << "\n[CONNECTED] " << peer.address << std::endl;
+    }
+    if (bleLink_) announceTo(*bleLink_, peer.address);
+    if (!peer.name.empty()) {
+        deliverStored(peer.name);
     }
     std::cout << getPrompt();
     std::cout.flush();
 }
 
-void ConsoleUI::onDeviceDisconnected(const std::string& address) {
-    std::cout << "\n[DISCONNECTED] " << address << std::endl;
+void ConsoleUI::onDeviceDisconnected(const TransportPeer& peer) {
+    std::cout << "\n[DISCONNECTED] " << peer.address << std::endl;
     std::cout << getPrompt();
     std::cout.flush();
 }
 
 void ConsoleUI::onDataReceived(const std::string& address, const std::vector<uint8_t>& data) {
-    try {
-        auto msg = Message::deserialize(data);
-
-        static std::unordered_set<uint32_t> seenMessages;
-        static std::mutex seenMutex;
-
-        {
-            std::lock_guard<std::mutex> lock(seenMutex);
-            if (seenMessages.count(msg.header.messageId)) {
-                return;
-            }
-            seenMessages.insert(msg.header.messageId);
+    if (BatchCodec::isBatch(data)) {
+        bool ok = BatchCodec::forEach(data, [this, &address](ByteSpan frame) {
+            onFrameReceived(address, frame);
+        });
+        if (!ok) {
+            std::cerr << "\n[ERROR] Truncated frame batch from " << address << std::endl;
+            std::cout << getPrompt();
+            std::cout.flush();
+        }
+        return;
+    }
+    onFrameReceived(address, data);
+}
 
-            if (seenMessages.size() > 1000) {
-                seenMessages.clear();
-            }
+void ConsoleUI::onFrameReceived(const std::string& address, ByteSpan data) {
+    try {
+        auto msg = MessageView::parse(data);
+        if (!seenMessages_.markSeen(msg)) {
+            router_.overheard(msg, address);
+            return;
         }
 
         processReceivedMessage(msg, address);
+        router_.relay(msg, address);
     } catch (const std::exception& e) {
         std::cerr << "\n[ERROR] Failed to parse message: " << e.what() << std::endl;
         std::cout << getPrompt();
@@ -626,52 +866,158 @@ void ConsoleUI::onDataReceived(const std::string& address, const std::vector<uin
     }
 }
 
-void ConsoleUI::processReceivedMessage(const Message& msg, const std::string& sourceAddress) {
-    if (msg.header.type == MessageType::GLOBAL_MESSAGE ||
-        msg.header.type == MessageType::TEXT_MESSAGE ||
-        msg.header.type == MessageType::PRIVATE_MESSAGE) {
-
-        auto textMsg = TextMessage::deserialize(msg.payload);
-        if (textMsg.content.rfind("::FILE::", 0) == 0) {
-            size_t a = textMsg.content.find("::", 8);
-            size_t b = textMsg.content.find("::", a == std::string::npos ? 0 : a + 2);
-            size_t c = textMsg.content.find("::", b == std::string::npos ? 0 : b + 2);
-            if (a != std::string::npos && b != std::string::npos && c != std::string::npos) {
-                std::string id = textMsg.content.substr(8, a - 8);
-                std::string filename = textMsg.content.substr(a + 2, b - (a + 2));
-                std::string ssize = textMsg.content.substr(b + 2, c - (b + 2));
-                std::string b64 = textMsg.content.substr(c + 2);
-                PendingFile pf;
-                pf.filename = filename;
-                pf.base64data = b64;
-                pf.senderUsername = textMsg.senderUsername;
-                pendingFiles_[id] = pf;
-                std::cout << "\n[FILE] from " << textMsg.senderUsername << ": " << filename << " bytes=" << ssize << " id=" << id << std::endl;
-                std::cout << "Use /accept " << id << " or /decline " << id << std::endl;
-                std::cout << getPrompt();
-                std::cout.flush();
-                return;
-            }
+bool ConsoleUI::sendPrivateFrame(const std::string& recipient, std::vector<uint8_t> frame) {
+    auto direct = transports_.reaching(recipient);
+    if (direct.empty()) {
+        return router_.sendUnicast(std::move(frame), recipient);
+    }
+
+    // A direct peer gets one copy on its best path, plus a racing copy only while a better path is silent.
+    std::vector<PathCandidate> candidates;
+    for (ITransport* transport : direct) {
+        candidates.push_back(PathCandidate{transport->name(), transport->cost()});
+    }
+    auto chosen = paths_.choose(recipient, candidates);
+    uint32_t sequence = sequenceOf(frame);
+    // Relays decode private frames to route them, so only frames that go straight to the recipient are compressed.
+    if (senders_.supportsCompression(recipient)) MessageFactory::compressFrame(frame);
+    bool sent = false;
+    for (size_t i = 0; i < chosen.size(); ++i) {
+        ITransport* transport = transports_.find(chosen[i]);
+        if (!transport) continue;
+        std::vector<uint8_t> copy = i + 1 < chosen.size() ? frame : std::move(frame);
+        if (transports_.sendVia(*transport, recipient, std::move(copy))) {
+            paths_.sent(recipient, chosen[i], sequence);
+            sent = true;
+        }
+    }
+    return sent;
+}
+
+void ConsoleUI::onPeerHeard(const std::string& username, const std::string& link) {
+    if (ITransport* transport = transports_.owner(link)) {
+        paths_.heard(username, transport->name());
+    }
+}
+
+void ConsoleUI::deliverStored(const std::string& recipient) {
+    if (!outbox_ || outbox_->pending(recipient) == 0) return;
+    size_t sent = outbox_->drain(recipient, [this, &recipient](std::vector<uint8_t> frame, bool relayed) {
+        // Our own ACKed messages go back through reliable delivery, which re-queues them if they fail again.
+        uint32_t sequence = relayed || !reliable_ ? 0 : sequenceOf(frame);
+        if (sequence == 0) return sendPrivateFrame(recipient, std::move(frame));
+        ReliableDelivery::restamp(frame);
+        reliable_->send(recipient, sequence, std::move(frame));
+        return true;
+    });
+    if (sent > 0) {
+        std::cout << "\n[OUTBOX] Delivered " << sent << " queued message(s) for " << recipient << std::endl;
+        std::cout << getPrompt();
+        std::cout.flush();
+    }
+}
+
+void ConsoleUI::onDeliveryResult(const std::string& recipient, bool delivered, const std::vector<uint8_t>& frame) {
+    if (delivered) return;
+    if (outbox_ && outbox_->enqueue(recipient, frame)) {
+        std::cout << "\n[OUTBOX] No acknowledgement from " << recipient << ", message queued" << std::endl;
+    } else {
+        std::cout << "\n[OUTBOX] No acknowledgement from " << recipient << " and the outbox is full" << std::endl;
+    }
+    std::cout << getPrompt();
+    std::cout.flush();
+}
+
+void ConsoleUI::processReceivedMessage(const MessageView& msg, const std::string& sourceAddress) {
+    if (msg.type() == MessageType::ANNOUNCE) {
+        handleAnnounce(msg, sourceAddress);
+        return;
+    }
+
+    if (msg.type() == MessageType::NEIGHBOR_LIST) {
+        std::vector<uint8_t> expanded;
+        mesh_.handleNeighborList(NeighborListMessage::deserialize(msg.decodedPayload(expanded)), sourceAddress);
+        return;
+    }
+
+    if (msg.type() == MessageType::PING || msg.type() == MessageType::PONG) {
+        std::vector<uint8_t> expanded;
+        auto probe = ProbeMessage::deserialize(msg.decodedPayload(expanded));
+        if (msg.type() == MessageType::PING) {
+            mesh_.handlePing(probe, sourceAddress);
+        } else {
+            mesh_.handlePong(probe, sourceAddress);
+        }
+        return;
+    }
+
+    if (msg.type() == MessageType::ACK) {
+        std::vector<uint8_t> expanded;
+        auto ack = AckMessage::deserialize(msg.decodedPayload(expanded));
+        if (identity_ && ack.recipientUsername == identity_->getUsername()) {
+            onPeerHeard(ack.username, sourceAddress);
+            paths_.acked(ack);
+            if (reliable_) reliable_->handleAck(ack);
+        } else {
+            router_.forwardUnicast(msg, ack.recipientUsername);
+        }
+        return;
+    }
+
+    if (msg.type() == MessageType::FILE_REQUEST || msg.type() == MessageType::FILE_DATA) {
+        if (!files_) return;
+        std::vector<uint8_t> expanded;
+        ByteSpan payload = msg.decodedPayload(expanded);
+        if (msg.type() == MessageType::FILE_REQUEST) {
+            files_->handleRequest(FileRequestMessage::deserialize(payload));
+        } else {
+            files_->handleChunk(FileChunkMessage::deserialize(payload));
         }
+        return;
+    }
 
-        if (textMsg.isGlobal && currentChatMode_ == ChatMode::GLOBAL) {
+    if (msg.isText()) {
+        std::vector<uint8_t> expanded;
+        auto textMsg = TextMessageView::parse(msg, msg.decodedPayload(expanded));
+        std::string_view content = textMsg.content();
+        std::string resolved;
+        if (textMsg.isCompact()) {
+            resolved = resolveSender(textMsg);
+        }
+        std::string_view sender = textMsg.isCompact() ? std::string_view(resolved) : textMsg.senderUsername();
+        if (!textMsg.isGlobal() && identity_ && !textMsg.recipientUsername().empty() &&
+            textMsg.recipientUsername() != identity_->getUsername()) {
+            std::string recipient(textMsg.recipientUsername());
+            if (!router_.forwardUnicast(msg, recipient) && msg.ttl() > 1 && outbox_) {
+                outbox_->enqueue(recipient, MessageRouter::forwardCopy(msg), true);
+            }
+            return;
+        }
+        if (!textMsg.isGlobal()) {
+            onPeerHeard(std::string(sender), sourceAddress);
+        }
+        if (!textMsg.isGlobal() && textMsg.sequence() != 0 && reliable_ &&
+            !reliable_->receive(std::string(sender), textMsg.sequence())) {
+            return;
+        }
+        if (textMsg.isGlobal() && currentChatMode_ == ChatMode::GLOBAL) {
             std::string indicator = (sourceAddress == "wifi") ? " [LAN]" : "";
-            std::string displayName = textMsg.senderUsername + indicator;
-            std::cout << "[#global][" << displayName << "]: " << textMsg.content << std::endl;
-            addToHistory("[#global][" + displayName + "]: " + textMsg.content);
+            std::string displayName = std::string(sender) + indicator;
+            std::cout << "[#global][" << displayName << "]: " << content << std::endl;
+            addToHistory("[#global][" + displayName + "]: " + std::string(content));
             std::cout << getPrompt();
             std::cout.flush();
-        } else if (!textMsg.isGlobal) {
+        } else if (!textMsg.isGlobal()) {
             if (currentChatMode_ == ChatMode::PERSONAL &&
-                currentChatTarget_ == textMsg.senderUsername) {
+                currentChatTarget_ == sender) {
                 std::string indicator = (sourceAddress == "wifi") ? " [LAN]" : "";
-                std::string displayName = textMsg.senderUsername + indicator;
-                std::cout << "[" << displayName << "]: " << textMsg.content << std::endl;
-                addToHistory("[" + displayName + "]: " + textMsg.content);
+                std::string displayName = std::string(sender) + indicator;
+                std::cout << "[" << displayName << "]: " << content << std::endl;
+                addToHistory("[" + displayName + "]: " + std::string(content));
             } else {
                 std::string indicator = (sourceAddress == "wifi") ? " [LAN]" : "";
-                std::cout << "\n[NEW MESSAGE from " << textMsg.senderUsername << indicator << "]: "
-                         << textMsg.content << std::endl;
+                std::cout << "\n[NEW MESSAGE from " << sender << indicator << "]: "
+                         << content << std::endl;
             }
             std::cout << getPrompt();
             std::cout.flush();
@@ -679,11 +1025,42 @@ void ConsoleUI::processReceivedMessage(const Message& msg, const std::string& so
     }
 }
 
-bool ConsoleUI::handleFileSend(const std::string& path, BluetoothManager& bluetoothManager, UserIdentity& identity) {
+void ConsoleUI::handleAnnounce(const MessageView& msg, const std::string& sourceAddress) {
+    std::vector<uint8_t> expanded;
+    ByteSpan payload = msg.decodedPayload(expanded);
+    auto announce = AnnounceMessage::deserialize(payload.toVector());
+    if (identity_ && announce.username == identity_->getUsername()) return;
+
+    onPeerHeard(announce.username, sourceAddress);
+    SenderInfo previous;
+    bool newSession = announce.senderId != 0 && !senders_.lookup(announce.senderId, previous);
+    senders_.learn(announce);
+
+    if (sourceAddress == "local") return;
+    ITransport* transport = transports_.owner(sourceAddress);
+    // A BLE device can announce before its advertisement marks it as an echo device.
+    if (!transport) transport = bleLink_.get();
+    if (transport) {
+        announceTo(*transport, transport->sharedLink() == sourceAddress ? announce.username : sourceAddress, newSession);
+    }
+}
+
+std::string ConsoleUI::resolveSender(const TextMessageView& textMsg) const {
+    SenderInfo info;
+    if (senders_.lookup(textMsg.senderId(), info)) {
+        return info.username;
+    }
+    std::ostringstream oss;
+    oss << "#" << std::hex << std::setw(8) << std::setfill('0') << textMsg.senderId();
+    return oss.str();
+}
+
+bool ConsoleUI::handleFileSend(const std::string& path) {
     if (currentChatMode_ != ChatMode::GLOBAL && currentChatMode_ != ChatMode::PERSONAL) {
         std::cout << "Not in chat mode" << std::endl;
         return false;
     }
+    if (!files_) { std::cout << "File transfer not running" << std::endl; return false; }
     std::error_code ec;
     std::filesystem::path p(path);
     if (!std::filesystem::exists(p, ec)) { std::cout << "File not found" << std::endl; return false; }
@@ -691,130 +1068,89 @@ bool ConsoleUI::handleFileSend(const std::string& path, BluetoothManager& blueto
     uintmax_t sz = std::filesystem::file_size(p, ec);
     if (ec) { std::cout << "Size error" << std::endl; return false; }
     if (sz == 0) { std::cout << "Empty file" << std::endl; return false; }
-    if (sz > MAX_FILE_BYTES) { std::cout << "File too large limit=" << MAX_FILE_BYTES << std::endl; return false; }
+    if (sz > FileTransferManager::MAX_FILE_BYTES) {
+        std::cout << "File too large limit=" << FileTransferManager::MAX_FILE_BYTES << std::endl;
+        return false;
+    }
     std::vector<uint8_t> buf(sz);
     FILE* f = fopen(path.c_str(), "rb");
     if (!f) { std::cout << "Open failed" << std::endl; return false; }
     size_t r = fread(buf.data(), 1, buf.size(), f);
     fclose(f);
     if (r != buf.size()) { std::cout << "Read failed" << std::endl; return false; }
-    std::string b64 = base64Encode(buf);
-    std::string id = generateFileId();
-    std::string fname = p.filename().string();
 
     bool isGlobal = (currentChatMode_ == ChatMode::GLOBAL);
-    auto msg = MessageFactory::createFileDataMessage(id, identity.getUsername(), identity.getFingerprint(), fname, (uint32_t)sz, b64, isGlobal);
-    auto data = msg.serialize();
-    bool any = false;
-
-    if (isGlobal) {
-        if (wifi_) any = wifi_->sendBroadcast(data) || any;
-        auto devices = bluetoothManager.getEchoDevices();
-        for (const auto& d : devices) { any = bluetoothManager.sendData(d.address, data) || any; }
-    } else {
-        if (wifi_) any = wifi_->sendTo(currentChatTarget_, data) || any;
-        std::string address = findAddressByUsername(currentChatTarget_, bluetoothManager);
-        if (!address.empty()) {
-            any = bluetoothManager.sendData(address, data) || any;
-        }
+    std::string peer = isGlobal ? FileTransferManager::BROADCAST_PEER : currentChatTarget_;
+    if (!isGlobal && !transports_.hasPeer(peer)) {
+        std::cout << "No recipients" << std::endl;
+        return false;
     }
 
-    if (!any) { std::cout << "No recipients" << std::endl; }
-    return any;
+    uint64_t id = files_->offer(peer, p.filename().string(), std::move(buf));
+    std::cout << "[FILE] offered " << p.filename().string() << " bytes=" << sz
+              << " id=" << FileTransferManager::formatId(id) << std::endl;
+    return true;
 }
 
 void ConsoleUI::handleFileAccept(const std::string& id) {
-    auto it = pendingFiles_.find(id);
-    if (it == pendingFiles_.end()) { std::cout << "No such file id" << std::endl; return; }
-    std::string filename = it->second.filename;
-    std::string b64 = it->second.base64data;
-    std::string sender = it->second.senderUsername;
-    auto data = base64Decode(b64);
-    if (data.empty() || data.size() > MAX_FILE_BYTES) { std::cout << "Invalid file" << std::endl; pendingFiles_.erase(it); return; }
-    std::filesystem::path dir = std::filesystem::current_path() / "FileSharing";
-    std::error_code ec;
-    std::filesystem::create_directories(dir, ec);
-    for (auto& ch : filename) { if (ch == '/' || ch == '\\') ch = '_'; }
-    std::filesystem::path out = dir / filename;
-    FILE* f = fopen(out.string().c_str(), "wb");
-    if (!f) { std::cout << "Save failed" << std::endl; return; }
-    fwrite(data.data(), 1, data.size(), f);
-    fclose(f);
-    std::cout << "[File Sharing][" << sender << "] Saved to: " << out.string() << std::endl;
-    pendingFiles_.erase(id);
+    uint64_t fileId = 0;
+    if (!files_ || !FileTransferManager::parseId(id, fileId) || !files_->accept(fileId)) {
+        std::cout << "No such file id" << std::endl;
+        return;
+    }
+    std::cout << "Accepted " << id << ", receiving..." << std::endl;
 }
 
 void ConsoleUI::handleFileDecline(const std::string& id) {
-    auto it = pendingFiles_.find(id);
-    if (it != pendingFiles_.end()) pendingFiles_.erase(it);
+    uint64_t fileId = 0;
+    if (files_ && FileTransferManager::parseId(id, fileId)) {
+        files_->decline(fileId);
+    }
     std::cout << "Declined " << id << std::endl;
 }
 
-std::string ConsoleUI::base64Encode(const std::vector<uint8_t>& data) {
-    static const char* tbl = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-    std::string out; out.reserve(((data.size() + 2) / 3) * 4);
-    size_t i = 0; size_t n = data.size();
-    while (i + 2 < n) {
-        uint32_t val = (data[i] << 16) | (data[i+1] << 8) | data[i+2];
-        out.push_back(tbl[(val >> 18) & 63]);
-        out.push_back(tbl[(val >> 12) & 63]);
-        out.push_back(tbl[(val >> 6) & 63]);
-        out.push_back(tbl[val & 63]);
-        i += 3;
-    }
-    if (i < n) {
-        uint32_t val = data[i] << 16;
-        if (i + 1 < n) val |= (data[i+1] << 8);
-        out.push_back(tbl[(val >> 18) & 63]);
-        out.push_back(tbl[(val >> 12) & 63]);
-        if (i + 1 < n) {
-            out.push_back(tbl[(val >> 6) & 63]);
-            out.push_back('=');
-        } else {
-            out.push_back('=');
-            out.push_back('=');
-        }
-    }
-    return out;
-}
-
-std::vector<uint8_t> ConsoleUI::base64Decode(const std::string& s) {
-    auto val = [](char c) -> int { if (c >= 'A' && c <= 'Z') return c - 'A'; if (c >= 'a' && c <= 'z') return c - 'a' + 26; if (c >= '0' && c <= '9') return c - '0' + 52; if (c == '+') return 62; if (c == '/') return 63; if (c == '=') return -1; return -2; };
-    std::vector<uint8_t> out; out.reserve(s.size()/4*3);
-    int n = 0; uint32_t buf = 0; int pad = 0;
-    for (char c : s) {
-        int v = val(c);
-        if (v == -2) continue;
-        if (v == -1) { v = 0; pad++; }
-        buf = (buf << 6) | (uint32_t)v; n += 6;
-        if (n >= 24) {
-            out.push_back((buf >> 16) & 0xFF);
-            if (pad < 2) out.push_back((buf >> 8) & 0xFF);
-            if (pad < 1) out.push_back(buf & 0xFF);
-            buf = 0; n = 0; pad = 0;
-        }
+void ConsoleUI::sendFileFrame(const std::string& peer, std::vector<uint8_t> frame) {
+    if (peer == FileTransferManager::BROADCAST_PEER) {
+        transports_.broadcast(frame);
+        return;
     }
-    return out;
+    if (senders_.supportsCompression(peer)) MessageFactory::compressFrame(frame);
+    transports_.sendTo(peer, std::move(frame));
 }
 
-std::string ConsoleUI::generateFileId() {
-    static const char* hexd = "0123456789abcdef";
-    uint32_t r1 = MessageFactory::generateMessageId();
-    uint32_t r2 = MessageFactory::generateMessageId();
-    char buf[17];
-    for (int i = 0; i < 8; ++i) buf[i] = hexd[(r1 >> ((7 - i) * 4)) & 0xF];
-    for (int i = 0; i < 8; ++i) buf[8 + i] = hexd[(r2 >> ((7 - i) * 4)) & 0xF];
-    return std::string(buf, buf + 16);
+void ConsoleUI::onFileOffer(const FileOffer& offer) {
+    std::string id = FileTransferManager::formatId(offer.fileId);
+    std::cout << "\n[FILE] from " << offer.peer << ": " << offer.filename << " bytes=" << offer.sizeBytes << " id=" << id << std::endl;
+    std::cout << "Use /accept " << id << " or /decline " << id << std::endl;
+    std::cout << getPrompt();
+    std::cout.flush();
 }
 
-std::string ConsoleUI::findUsernameByAddress(const std::string& address, const BluetoothManager& bluetoothManager) const {
-    auto devices = bluetoothManager.getEchoDevices();
-    for (const auto& device : devices) {
-        if (device.address == address) {
-            return device.echoUsername;
-        }
+void ConsoleUI::onFileReceived(const FileOffer& offer, const std::vector<uint8_t>& data) {
+    std::filesystem::path dir = std::filesystem::current_path() / "FileSharing";
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+    std::string filename = offer.filename;
+    for (auto& ch : filename) { if (ch == '/' || ch == '\\') ch = '_'; }
+    std::filesystem::path out = dir / filename;
+    FILE* f = fopen(out.string().c_str(), "wb");
+    if (!f) { std::cout << "\nSave failed: " << out.string() << std::endl; return; }
+    fwrite(data.data(), 1, data.size(), f);
+    fclose(f);
+    std::cout << "\n[File Sharing][" << offer.peer << "] Saved to: " << out.string() << std::endl;
+    std::cout << getPrompt();
+    std::cout.flush();
+}
+
+void ConsoleUI::onFileFinished(const FileOffer& offer, bool ok, const std::string& reason) {
+    std::string id = FileTransferManager::formatId(offer.fileId);
+    if (ok) {
+        std::cout << "\n[FILE] " << offer.filename << " delivered to " << offer.peer << " id=" << id << std::endl;
+    } else {
+        std::cout << "\n[FILE] " << offer.filename << " (" << offer.peer << ") failed: " << reason << " id=" << id << std::endl;
     }
-    return "";
+    std::cout << getPrompt();
+    std::cout.flush();
 }
 
 std::string ConsoleUI::findAddressByUsername(const std::string& username, const BluetoothManager& bluetoothManager) const {
@@ -1,8 +1,18 @@
 #pragma once
 
 #include "core/bluetooth/BluetoothManager.h"
+#include "core/mesh/MeshNetwork.h"
+#include "core/mesh/MessageRouter.h"
+#include "core/mesh/MessageStore.h"
 #include "core/protocol/MessageTypes.h"
+#include "core/protocol/MessageView.h"
+#include "core/protocol/DuplicateFilter.h"
+#include "core/protocol/FileTransfer.h"
+#include "core/protocol/ReliableDelivery.h"
+#include "core/protocol/SenderDirectory.h"
 #include "core/commands/IRCParser.h"
+#include "core/transport/PathSelector.h"
+#include "core/transport/TransportSet.h"
 #include <string>
 #include <deque>
 #include <mutex>
@@ -14,12 +24,8 @@ namespace echo {
 
 class UserIdentity;
 class WifiDirect;
-
-struct PendingFile {
-    std::string filename;
-    std::string base64data;
-    std::string senderUsername;
-};
+class WifiTransport;
+class BluetoothTransport;
 
 class ConsoleUI {
 public:
@@ -34,6 +40,20 @@ private:
     ChatMode currentChatMode_;
     std::string currentChatTarget_;
     std::unique_ptr<WifiDirect> wifi_;
+    BluetoothManager* bluetooth_ = nullptr;
+    std::unique_ptr<WifiTransport> wifiLink_;
+    std::unique_ptr<BluetoothTransport> bleLink_;
+    TransportSet transports_;
+    PathSelector paths_;
+    UserIdentity* identity_ = nullptr;
+    uint32_t senderId_ = 0;
+    SenderDirectory senders_;
+    DuplicateFilter seenMessages_;
+    std::unique_ptr<FileTransferManager> files_;
+    MessageRouter router_;
+    MeshNetwork mesh_;
+    std::unique_ptr<MessageStore> outbox_;
+    std::unique_ptr<ReliableDelivery> reliable_;
 
     std::deque<std::string> messageHistory_;
     std::mutex historyMutex_;
@@ -48,7 +68,7 @@ private:
     void enterGlobalChat(BluetoothManager& bluetoothManager);
     void exitChatMode();
 
-    void sendMessage(const std::string& message, BluetoothManager& bluetoothManager, UserIdentity& identity);
+    void sendMessage(const std::string& message, UserIdentity& identity);
     void displayMessage(const std::string& from, const std::string& message, bool isPrivate);
 
     void addToHistory(const std::string& message);
@@ -57,26 +77,35 @@ private:
 
     void printDevices(const BluetoothManager& bluetoothManager) const;
     void printEchoDevices(const BluetoothManager& bluetoothManager) const;
+    void printStats(const BluetoothManager& bluetoothManager) const;
+    void printPaths() const;
 
     void onDeviceDiscovered(const DiscoveredDevice& device);
-    void onDeviceConnected(const std::string& address, const BluetoothManager& bluetoothManager);
-    void onDeviceDisconnected(const std::string& address);
+    void onDeviceConnected(const TransportPeer& peer);
+    void onDeviceDisconnected(const TransportPeer& peer);
     void onDataReceived(const std::string& address, const std::vector<uint8_t>& data);
+    void onFrameReceived(const std::string& address, ByteSpan data);
+    void onPeerHeard(const std::string& username, const std::string& link);
+    bool sendPrivateFrame(const std::string& recipient, std::vector<uint8_t> frame);
+    void deliverStored(const std::string& recipient);
+    void onDeliveryResult(const std::string& recipient, bool delivered, const std::vector<uint8_t>& frame);
+
+    void processReceivedMessage(const MessageView& msg, const std::string& sourceAddress);
+    void handleAnnounce(const MessageView& msg, const std::string& sourceAddress);
+    void announceTo(ITransport& transport, const std::string& address, bool force = false);
+    void announceTo(const std::string& username);
+    std::string resolveSender(const TextMessageView& textMsg) const;
 
-    void processReceivedMessage(const Message& msg, const std::string& sourceAddress);
-
-    std::string findUsernameByAddress(const std::string& address, const BluetoothManager& bluetoothManager) const;
     std::string findAddressByUsername(const std::string& username, const BluetoothManager& bluetoothManager) const;
     bool connectByTarget(const std::string& target, BluetoothManager& bluetoothManager);
 
-    bool handleFileSend(const std::string& path, BluetoothManager& bluetoothManager, UserIdentity& identity);
+    bool handleFileSend(const std::string& path);
     void handleFileAccept(const std::string& id);
     void handleFileDecline(const std::string& id);
-    std::string base64Encode(const std::vector<uint8_t>& data);
-    std::vector<uint8_t> base64Decode(const std::string& encoded);
-    std::string generateFileId();
-    std::unordered_map<std::string, PendingFile> pendingFiles_;
-    static constexpr size_t MAX_FILE_BYTES = 32768;
+    void sendFileFrame(const std::string& peer, std::vector<uint8_t> frame);
+    void onFileOffer(const FileOffer& offer);
+    void onFileReceived(const FileOffer& offer, const std::vector<uint8_t>& data);
+    void onFileFinished(const FileOffer& offer, bool ok, const std::string& reason);
 };
 
 }
\ No newline at end of file
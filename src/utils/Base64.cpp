@@ -0,0 +1,52 @@
+#include "Base64.h"
+
+namespace echo {
+
+std::string base64Encode(const std::vector<uint8_t>& data) {
+    static const char* tbl = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out; out.reserve(((data.size() + 2) / 3) * 4);
+    size_t i = 0; size_t n = data.size();
+    while (i + 2 < n) {
+        uint32_t val = (data[i] << 16) | (data[i+1] << 8) | data[i+2];
+        out.push_back(tbl[(val >> 18) & 63]);
+        out.push_back(tbl[(val >> 12) & 63]);
+        out.push_back(tbl[(val >> 6) & 63]);
+        out.push_back(tbl[val & 63]);
+        i += 3;
+    }
+    if (i < n) {
+        uint32_t val = data[i] << 16;
+        if (i + 1 < n) val |= (data[i+1] << 8);
+        out.push_back(tbl[(val >> 18) & 63]);
+        out.push_back(tbl[(val >> 12) & 63]);
+        if (i + 1 < n) {
+            out.push_back(tbl[(val >> 6) & 63]);
+            out.push_back('=');
+        } else {
+            out.push_back('=');
+            out.push_back('=');
+        }
+    }
+    return out;
+}
+
+std::vector<uint8_t> base64Decode(const std::string& s) {
+    auto val = [](char c) -> int { if (c >= 'A' && c <= 'Z') return c - 'A'; if (c >= 'a' && c <= 'z') return c - 'a' + 26; if (c >= '0' && c <= '9') return c - '0' + 52; if (c == '+') return 62; if (c == '/') return 63; if (c == '=') return -1; return -2; };
+    std::vector<uint8_t> out; out.reserve(s.size()/4*3);
+    int n = 0; uint32_t buf = 0; int pad = 0;
+    for (char c : s) {
+        int v = val(c);
+        if (v == -2) continue;
+        if (v == -1) { v = 0; pad++; }
+        buf = (buf << 6) | (uint32_t)v; n += 6;
+        if (n >= 24) {
+            out.push_back((buf >> 16) & 0xFF);
+            if (pad < 2) out.push_back((buf >> 8) & 0xFF);
+            if (pad < 1) out.push_back(buf & 0xFF);
+            buf = 0; n = 0; pad = 0;
+        }
+    }
+    return out;
+}
+
+} // namespace echo
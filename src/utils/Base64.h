@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace echo {
+
+std::string base64Encode(const std::vector<uint8_t>& data);
+std::vector<uint8_t> base64Decode(const std::string& encoded);
+
+} // namespace echo
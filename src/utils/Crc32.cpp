@@ -0,0 +1,50 @@
+#include "Crc32.h"
+#include <array>
+
+namespace echo {
+
+namespace {
+
+std::array<std::array<uint32_t, 256>, 4> buildTables() {
+    std::array<std::array<uint32_t, 256>, 4> tables{};
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; ++k) {
+            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        }
+        tables[0][i] = c;
+    }
+    for (uint32_t i = 0; i < 256; ++i) {
+        for (size_t t = 1; t < 4; ++t) {
+            tables[t][i] = (tables[t - 1][i] >> 8) ^ tables[0][tables[t - 1][i] & 0xFF];
+        }
+    }
+    return tables;
+}
+
+const std::array<std::array<uint32_t, 256>, 4>& crcTables() {
+    static const auto tables = buildTables();
+    return tables;
+}
+
+}
+
+uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc) {
+    const auto& t = crcTables();
+    crc = ~crc;
+    while (size >= 4) {
+        crc ^= static_cast<uint32_t>(data[0]) |
+               (static_cast<uint32_t>(data[1]) << 8) |
+               (static_cast<uint32_t>(data[2]) << 16) |
+               (static_cast<uint32_t>(data[3]) << 24);
+        crc = t[3][crc & 0xFF] ^ t[2][(crc >> 8) & 0xFF] ^ t[1][(crc >> 16) & 0xFF] ^ t[0][crc >> 24];
+        data += 4;
+        size -= 4;
+    }
+    while (size--) {
+        crc = t[0][(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+} // namespace echo
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace echo {
+
+uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0);
+
+} // namespace echo